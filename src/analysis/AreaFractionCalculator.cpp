@@ -0,0 +1,377 @@
+#include "analysis/AreaFractionCalculator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <numbers>
+#include <span>
+#include <utility>
+#include <vector>
+
+#include "analysis/MaterialTable.h"
+#include "analysis/OverlapDetector.h"
+#include "model/DocumentModel.h"
+#include "model/ShapeGeometry.h"
+#include "model/ShapeStore.h"
+#include "model/SubstrateModel.h"
+#include "model/core/ModelTypes.h"
+#include "utils/ParallelFor.h"
+
+namespace {
+constexpr size_t kMinRowsPerChunk = 1024;
+constexpr int kMinQuadratureSamples = 8;
+constexpr int kMinBoundarySegments = 16;
+
+struct Accumulator {
+  std::vector<double> area;
+  std::vector<double> interface_length;
+  std::vector<size_t> inclusion_count;
+  double total_interface{0.0};
+  size_t overlapping_shapes{0};
+
+  explicit Accumulator(size_t phase_count)
+      : area(phase_count, 0.0),
+        interface_length(phase_count, 0.0),
+        inclusion_count(phase_count, 0) {}
+
+  void add_interface(uint16_t first, uint16_t second, double length) {
+    interface_length[first] += length;
+    interface_length[second] += length;
+    total_interface += length;
+  }
+};
+
+// Shape context for the overlap-corrected passes
+struct ShapeContext {
+  std::span<const ShapeFrame> frames;
+  std::span<const Aabb> bounds;
+  std::span<const uint16_t> phases;
+  std::span<const uint32_t> neighbors;  // Overlapping rows, ascending
+  Size2D substrate;
+};
+
+// Visible (not covered by later shapes, inside the substrate) area of a row
+double visible_area(size_t row, const ShapeContext& context, int samples,
+                    std::vector<double>& breaks,
+                    std::vector<std::pair<double, double>>& spans) {
+  const Aabb& box = context.bounds[row];
+  const double y_min = std::max(box.min_y, 0.0);
+  const double y_max = std::min(box.max_y, context.substrate.height);
+  if (y_min >= y_max) {
+    return 0.0;
+  }
+
+  // Split where occluders start or end so every piece is smooth inside
+  breaks.clear();
+  breaks.push_back(y_min);
+  breaks.push_back(y_max);
+  for (const uint32_t other : context.neighbors) {
+    if (other < row) {
+      continue;
+    }
+    for (const double edge :
+         {context.bounds[other].min_y, context.bounds[other].max_y}) {
+      if (edge > y_min && edge < y_max) {
+        breaks.push_back(edge);
+      }
+    }
+  }
+  std::sort(breaks.begin(), breaks.end());
+  breaks.erase(std::unique(breaks.begin(), breaks.end()), breaks.end());
+
+  const ShapeFrame& frame = context.frames[row];
+  double area = 0.0;
+  for (size_t piece = 0; piece + 1 < breaks.size(); ++piece) {
+    const double from = breaks[piece];
+    const double height = breaks[piece + 1] - from;
+    for (int k = 0; k < samples; ++k) {
+      // y = from + height * (1 - cos(pi u)) / 2, midpoint rule in u
+      const double u = (k + 0.5) / samples;
+      const double y =
+        from + height * (1.0 - std::cos(std::numbers::pi * u)) / 2.0;
+      const double weight = height * std::numbers::pi / 2.0 *
+                            std::sin(std::numbers::pi * u) / samples;
+
+      double span_min = 0.0;
+      double span_max = 0.0;
+      if (!ShapeGeometry::row_span(frame, y, span_min, span_max)) {
+        continue;
+      }
+      span_min = std::max(span_min, 0.0);
+      span_max = std::min(span_max, context.substrate.width);
+      if (span_min >= span_max) {
+        continue;
+      }
+
+      spans.clear();
+      for (const uint32_t other : context.neighbors) {
+        double other_min = 0.0;
+        double other_max = 0.0;
+        if (other > row &&
+            ShapeGeometry::row_span(context.frames[other], y, other_min,
+                                    other_max)) {
+          other_min = std::max(other_min, span_min);
+          other_max = std::min(other_max, span_max);
+          if (other_min < other_max) {
+            spans.emplace_back(other_min, other_max);
+          }
+        }
+      }
+      double covered = 0.0;
+      if (!spans.empty()) {
+        std::sort(spans.begin(), spans.end());
+        double run_min = spans.front().first;
+        double run_max = spans.front().second;
+        for (const auto& [next_min, next_max] : spans) {
+          if (next_min > run_max) {
+            covered += run_max - run_min;
+            run_min = next_min;
+            run_max = next_max;
+          } else {
+            run_max = std::max(run_max, next_max);
+          }
+        }
+        covered += run_max - run_min;
+      }
+      area += weight * (span_max - span_min - covered);
+    }
+  }
+  return area;
+}
+
+// Interface along the visible outline of a row
+void visible_interface(size_t row, const ShapeContext& context, int segments,
+                       Accumulator& accumulator) {
+  const ShapeFrame& frame = context.frames[row];
+  const uint16_t phase = context.phases[row];
+  const double arc_step = ShapeGeometry::perimeter(frame) / segments;
+  Point2D previous = ShapeGeometry::boundary_point(frame, 0.0);
+  for (int k = 0; k < segments; ++k) {
+    const Point2D next =
+      ShapeGeometry::boundary_point(frame, static_cast<double>(k + 1) /
+                                             segments);
+    const Point2D middle =
+      ShapeGeometry::boundary_point(frame, (k + 0.5) / segments);
+    // Rectangles are parameterized by arc length; ellipses use the chord
+    const double length =
+      frame.is_elliptic()
+        ? std::hypot(next.x - previous.x, next.y - previous.y)
+        : arc_step;
+    previous = next;
+
+    if (middle.x < 0.0 || middle.y < 0.0 || middle.x > context.substrate.width ||
+        middle.y > context.substrate.height) {
+      continue;
+    }
+    // Hidden under a later shape, or bordering the topmost earlier one
+    uint16_t other_phase = MaterialTable::kSubstratePhase;
+    bool hidden = false;
+    for (const uint32_t other : context.neighbors) {
+      if (ShapeGeometry::contains(context.frames[other], middle)) {
+        if (other > row) {
+          hidden = true;
+          break;
+        }
+        other_phase = context.phases[other];
+      }
+    }
+    if (!hidden && other_phase != phase) {
+      accumulator.add_interface(phase, other_phase, length);
+    }
+  }
+}
+
+// Frames, overlap graph (CSR, neighbors ascending) and border crossings of
+// every row of a store
+struct ShapeLayout {
+  std::vector<ShapeFrame> frames;
+  std::vector<Aabb> bounds;
+  std::vector<uint32_t> neighbor_offsets;
+  std::vector<uint32_t> neighbors;
+  std::vector<uint8_t> crosses_border;
+
+  std::span<const uint32_t> neighbors_of(size_t row) const {
+    return {neighbors.data() + neighbor_offsets[row],
+            neighbor_offsets[row + 1] - neighbor_offsets[row]};
+  }
+  // Closed-form area and perimeter apply
+  bool is_isolated(size_t row) const {
+    return neighbor_offsets[row] == neighbor_offsets[row + 1] &&
+           crosses_border[row] == 0;
+  }
+};
+
+ShapeLayout layout_of(const ShapeStore& store, const Size2D& substrate_size) {
+  ShapeLayout layout;
+  const size_t count = store.size();
+  layout.frames.resize(count);
+  layout.bounds.resize(count);
+  for (size_t row = 0; row < count; ++row) {
+    layout.frames[row] = ShapeGeometry::make_frame(store, row);
+    layout.bounds[row] = ShapeGeometry::bounds(layout.frames[row]);
+  }
+
+  OverlapOptions overlap_options;
+  overlap_options.compute_depth = false;
+  const OverlapReport overlaps =
+    OverlapDetector(overlap_options).detect(store, substrate_size);
+  auto& offsets = layout.neighbor_offsets;
+  offsets.assign(count + 1, 0);
+  for (const auto& pair : overlaps.overlaps) {
+    ++offsets[pair.first + 1];
+    ++offsets[pair.second + 1];
+  }
+  for (size_t row = 0; row < count; ++row) {
+    offsets[row + 1] += offsets[row];
+  }
+  layout.neighbors.resize(offsets.back());
+  {
+    std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+    for (const auto& pair : overlaps.overlaps) {
+      layout.neighbors[fill[pair.first]++] = static_cast<uint32_t>(pair.second);
+      layout.neighbors[fill[pair.second]++] = static_cast<uint32_t>(pair.first);
+    }
+  }
+  for (size_t row = 0; row < count; ++row) {
+    std::sort(layout.neighbors.begin() + offsets[row],
+              layout.neighbors.begin() + offsets[row + 1]);
+  }
+  layout.crosses_border.assign(count, 0);
+  for (const auto& crossing : overlaps.boundary_crossings) {
+    layout.crosses_border[crossing.row] = 1;
+  }
+  return layout;
+}
+}  // namespace
+
+AreaFractionCalculator::AreaFractionCalculator(AreaFractionOptions options)
+    : options_(options) {}
+
+auto AreaFractionCalculator::compute(const DocumentModel& document) const
+  -> AreaFractionReport {
+  AreaFractionReport report;
+  const MaterialTable table(document);
+  const auto substrate = document.substrate();
+  const Size2D substrate_size = substrate ? substrate->size() : Size2D{};
+  report.substrate_area = substrate_size.width * substrate_size.height;
+  report.phases.resize(table.phase_count());
+  for (size_t id = 0; id < table.phase_count(); ++id) {
+    const auto& phase = table.phase(static_cast<uint16_t>(id));
+    report.phases[id].name = phase.name;
+    report.phases[id].color = phase.color;
+  }
+  if (!(report.substrate_area > 0.0)) {
+    return report;
+  }
+
+  const ShapeStore& store = document.shape_store();
+  const size_t count = store.size();
+  const ShapeLayout layout = layout_of(store, substrate_size);
+
+  const Aabb substrate_box{.max_x = substrate_size.width,
+                           .max_y = substrate_size.height};
+  const auto phases = table.row_phases();
+  const int samples =
+    std::max(options_.quadrature_samples, kMinQuadratureSamples);
+  const int segments =
+    std::max(options_.boundary_segments, kMinBoundarySegments);
+
+  std::vector<Accumulator> chunks(worker_thread_count(),
+                                  Accumulator(table.phase_count()));
+  parallel_for(count, kMinRowsPerChunk, [&](size_t begin, size_t end,
+                                            size_t chunk) {
+    Accumulator& local = chunks[chunk];
+    std::vector<double> breaks;
+    std::vector<std::pair<double, double>> spans;
+    for (size_t row = begin; row < end; ++row) {
+      const uint16_t phase = phases[row];
+      ++local.inclusion_count[phase];
+      const ShapeFrame& frame = layout.frames[row];
+      if (!ShapeGeometry::intersects(frame, substrate_box)) {
+        continue;  // Entirely outside the substrate
+      }
+      if (layout.is_isolated(row)) {
+        local.area[phase] += ShapeGeometry::area(frame);
+        if (phase != MaterialTable::kSubstratePhase) {
+          local.add_interface(phase, MaterialTable::kSubstratePhase,
+                              ShapeGeometry::perimeter(frame));
+        }
+        continue;
+      }
+
+      ++local.overlapping_shapes;
+      const ShapeContext context{.frames = layout.frames,
+                                 .bounds = layout.bounds,
+                                 .phases = phases,
+                                 .neighbors = layout.neighbors_of(row),
+                                 .substrate = substrate_size};
+      local.area[phase] += visible_area(row, context, samples, breaks, spans);
+      visible_interface(row, context, segments, local);
+    }
+  });
+
+  double inclusion_area = 0.0;
+  for (const Accumulator& local : chunks) {
+    for (size_t id = 0; id < report.phases.size(); ++id) {
+      report.phases[id].area += local.area[id];
+      report.phases[id].interface_length += local.interface_length[id];
+      report.phases[id].inclusion_count += local.inclusion_count[id];
+      if (id != MaterialTable::kSubstratePhase) {
+        inclusion_area += local.area[id];
+      }
+    }
+    report.total_interface_length += local.total_interface;
+    report.overlapping_shapes += local.overlapping_shapes;
+  }
+
+  // The matrix is whatever the inclusions leave uncovered
+  auto& matrix = report.phases[MaterialTable::kSubstratePhase];
+  matrix.area = std::max(report.substrate_area - inclusion_area, 0.0);
+  matrix.inclusion_count = 0;
+  for (auto& phase : report.phases) {
+    phase.area_fraction = phase.area / report.substrate_area;
+  }
+  return report;
+}
+
+auto AreaFractionCalculator::covered_area(const ShapeStore& store,
+                                          const Size2D& substrate_size) const
+  -> double {
+  if (!(substrate_size.width > 0.0) || !(substrate_size.height > 0.0)) {
+    return 0.0;
+  }
+  const ShapeLayout layout = layout_of(store, substrate_size);
+  const Aabb substrate_box{.max_x = substrate_size.width,
+                           .max_y = substrate_size.height};
+  const int samples =
+    std::max(options_.quadrature_samples, kMinQuadratureSamples);
+
+  std::vector<double> chunks(worker_thread_count(), 0.0);
+  parallel_for(store.size(), kMinRowsPerChunk, [&](size_t begin, size_t end,
+                                                   size_t chunk) {
+    std::vector<double> breaks;
+    std::vector<std::pair<double, double>> spans;
+    for (size_t row = begin; row < end; ++row) {
+      const ShapeFrame& frame = layout.frames[row];
+      if (!ShapeGeometry::intersects(frame, substrate_box)) {
+        continue;
+      }
+      if (layout.is_isolated(row)) {
+        chunks[chunk] += ShapeGeometry::area(frame);
+        continue;
+      }
+      const ShapeContext context{.frames = layout.frames,
+                                 .bounds = layout.bounds,
+                                 .phases = {},
+                                 .neighbors = layout.neighbors_of(row),
+                                 .substrate = substrate_size};
+      chunks[chunk] += visible_area(row, context, samples, breaks, spans);
+    }
+  });
+  double area = 0.0;
+  for (const double chunk_area : chunks) {
+    area += chunk_area;
+  }
+  return area;
+}
@@ -0,0 +1,126 @@
+#include "analysis/Distribution.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <random>
+#include <utility>
+#include <vector>
+
+auto Distribution::constant(double value) -> Distribution {
+  Distribution result;
+  result.kind_ = Kind::Constant;
+  result.first_ = value;
+  return result;
+}
+
+auto Distribution::uniform(double min, double max) -> Distribution {
+  if (!(min < max)) {
+    return constant(min);
+  }
+  Distribution result;
+  result.kind_ = Kind::Uniform;
+  result.first_ = min;
+  result.second_ = max;
+  return result;
+}
+
+auto Distribution::normal(double mean, double stddev) -> Distribution {
+  if (!(stddev > 0.0)) {
+    return constant(mean);
+  }
+  Distribution result;
+  result.kind_ = Kind::Normal;
+  result.first_ = mean;
+  result.second_ = stddev;
+  return result;
+}
+
+auto Distribution::log_normal(double mean, double stddev) -> Distribution {
+  if (!(mean > 0.0) || !(stddev > 0.0)) {
+    return constant(mean);
+  }
+  Distribution result;
+  result.kind_ = Kind::LogNormal;
+  const double variance = std::log1p((stddev * stddev) / (mean * mean));
+  result.first_ = std::log(mean) - variance / 2.0;
+  result.second_ = std::sqrt(variance);
+  return result;
+}
+
+auto Distribution::histogram(std::vector<double> bin_edges,
+                             std::vector<double> weights) -> Distribution {
+  const double fallback = bin_edges.empty() ? 0.0 : bin_edges.front();
+  if (bin_edges.size() != weights.size() + 1 || weights.empty()) {
+    return constant(fallback);
+  }
+  double total = 0.0;
+  for (size_t i = 0; i < weights.size(); ++i) {
+    if (!(bin_edges[i] < bin_edges[i + 1]) || !(weights[i] >= 0.0)) {
+      return constant(fallback);
+    }
+    total += weights[i];
+  }
+  if (!(total > 0.0)) {
+    return constant(fallback);
+  }
+  Distribution result;
+  result.kind_ = Kind::Histogram;
+  result.bin_edges_ = std::move(bin_edges);
+  result.weights_ = std::move(weights);
+  double running = 0.0;
+  for (const double weight : result.weights_) {
+    running += weight;
+    result.cumulative_weights_.push_back(running);
+  }
+  return result;
+}
+
+double Distribution::mean() const {
+  switch (kind_) {
+    case Kind::Uniform:
+      return (first_ + second_) / 2.0;
+    case Kind::LogNormal:
+      return std::exp(first_ + second_ * second_ / 2.0);
+    case Kind::Histogram: {
+      double weighted = 0.0;
+      double total = 0.0;
+      for (size_t i = 0; i < weights_.size(); ++i) {
+        weighted += weights_[i] * (bin_edges_[i] + bin_edges_[i + 1]) / 2.0;
+        total += weights_[i];
+      }
+      return weighted / total;
+    }
+    case Kind::Constant:
+    case Kind::Normal:
+    default:
+      return first_;
+  }
+}
+
+double Distribution::sample(std::mt19937_64& rng) const {
+  switch (kind_) {
+    case Kind::Uniform:
+      return std::uniform_real_distribution<double>(first_, second_)(rng);
+    case Kind::Normal:
+      return std::normal_distribution<double>(first_, second_)(rng);
+    case Kind::LogNormal:
+      return std::lognormal_distribution<double>(first_, second_)(rng);
+    case Kind::Histogram: {
+      const double pick = std::uniform_real_distribution<double>(
+        0.0, cumulative_weights_.back())(rng);
+      // Zero-weight bins are never picked: their running sum equals the
+      // previous one
+      const auto bin_it = std::upper_bound(cumulative_weights_.begin(),
+                                           cumulative_weights_.end(), pick);
+      const size_t bin =
+        std::min(static_cast<size_t>(bin_it - cumulative_weights_.begin()),
+                 weights_.size() - 1);
+      return std::uniform_real_distribution<double>(bin_edges_[bin],
+                                                    bin_edges_[bin + 1])(rng);
+    }
+    case Kind::Constant:
+    default:
+      return first_;
+  }
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <random>
+#include <vector>
+
+/**
+ * @brief Scalar random distribution used for generated inclusion parameters
+ * (size, aspect ratio, orientation).
+ *
+ * Either an analytic law or a measured histogram. Invalid parameters fall back
+ * to a constant of the first parameter.
+ */
+class Distribution {
+ public:
+  enum class Kind { Constant, Uniform, Normal, LogNormal, Histogram };
+
+  Distribution() = default;
+
+  static auto constant(double value) -> Distribution;
+  static auto uniform(double min, double max) -> Distribution;
+  static auto normal(double mean, double stddev) -> Distribution;
+  // Parameterized by the mean and standard deviation of the values themselves
+  static auto log_normal(double mean, double stddev) -> Distribution;
+  /**
+   * @brief Piecewise-uniform distribution from a measured histogram.
+   * @param bin_edges Increasing bin edges (one more than weights).
+   * @param weights Non-negative bin counts or weights.
+   */
+  static auto histogram(std::vector<double> bin_edges,
+                        std::vector<double> weights) -> Distribution;
+
+  Kind kind() const {
+    return kind_;
+  }
+  double mean() const;
+
+  double sample(std::mt19937_64& rng) const;
+
+ private:
+  Kind kind_{Kind::Constant};
+  double first_{0.0};   // value / min / mean / log-mean
+  double second_{0.0};  // max / stddev / log-stddev
+  std::vector<double> bin_edges_;
+  std::vector<double> weights_;
+  std::vector<double> cumulative_weights_;  // Bin picks without allocating
+};
@@ -0,0 +1,76 @@
+#include "analysis/MaterialTable.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <limits>
+#include <string>
+#include <unordered_map>
+
+#include "model/DocumentModel.h"
+#include "model/MaterialModel.h"
+#include "model/ShapeModel.h"
+#include "model/SubstrateModel.h"
+#include "model/core/ModelTypes.h"
+
+namespace {
+constexpr size_t kMaxPhases = std::numeric_limits<uint16_t>::max();
+constexpr int kRedShift = 24;
+constexpr int kGreenShift = 16;
+constexpr int kBlueShift = 8;
+
+uint32_t color_key(const Color& color) {
+  return (static_cast<uint32_t>(color.r) << kRedShift) |
+         (static_cast<uint32_t>(color.g) << kGreenShift) |
+         (static_cast<uint32_t>(color.b) << kBlueShift) |
+         static_cast<uint32_t>(color.a);
+}
+
+std::string custom_phase_name(const Color& color) {
+  char buffer[sizeof("Custom #RRGGBB")];
+  std::snprintf(buffer, sizeof(buffer), "Custom #%02X%02X%02X", color.r,
+                color.g, color.b);
+  return buffer;
+}
+}  // namespace
+
+MaterialTable::MaterialTable(const DocumentModel& document) {
+  const auto substrate = document.substrate();
+  phases_.push_back(Phase{.name = substrate ? substrate->name() : "Substrate",
+                          .color = substrate ? substrate->color() : Color{},
+                          .is_preset = false});
+
+  const auto& materials = document.materials();
+  for (const auto& material : materials) {
+    phases_.push_back(Phase{.name = material->name(),
+                            .color = material->color(),
+                            .is_preset = true});
+  }
+
+  const auto& shapes = document.shapes();
+  const auto material_indices = document.shape_store().material_indices();
+  std::unordered_map<uint32_t, uint16_t> custom_phases;
+  row_phases_.reserve(shapes.size());
+  for (size_t row = 0; row < shapes.size(); ++row) {
+    const int32_t material_index = material_indices[row];
+    if (material_index >= 0 &&
+        static_cast<size_t>(material_index) < materials.size()) {
+      row_phases_.push_back(static_cast<uint16_t>(material_index + 1));
+      continue;
+    }
+    const Color color = shapes[row]->custom_color();
+    const auto [phase_it, inserted] = custom_phases.try_emplace(
+      color_key(color), static_cast<uint16_t>(phases_.size()));
+    if (inserted) {
+      if (phases_.size() >= kMaxPhases) {
+        // Out of phase ids: fold remaining colors into the last phase
+        phase_it->second = static_cast<uint16_t>(phases_.size() - 1);
+      } else {
+        phases_.push_back(Phase{.name = custom_phase_name(color),
+                                .color = color,
+                                .is_preset = false});
+      }
+    }
+    row_phases_.push_back(phase_it->second);
+  }
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "model/core/ModelTypes.h"
+
+class DocumentModel;
+
+/**
+ * @brief Maps every inclusion of a document to a phase id.
+ *
+ * Phase 0 is the substrate (matrix), followed by the preset materials in
+ * document order and then one phase per distinct custom color. Shapes with a
+ * custom material of the same color share a phase.
+ */
+class MaterialTable {
+ public:
+  static constexpr uint16_t kSubstratePhase = 0;
+
+  struct Phase {
+    std::string name;
+    Color color;
+    bool is_preset{false};
+  };
+
+  explicit MaterialTable(const DocumentModel& document);
+
+  size_t phase_count() const {
+    return phases_.size();
+  }
+  const Phase& phase(uint16_t id) const {
+    return phases_[id];
+  }
+  const std::vector<Phase>& phases() const {
+    return phases_;
+  }
+
+  /**
+   * @brief Phase of each shape, indexed like DocumentModel::shapes().
+   */
+  std::span<const uint16_t> row_phases() const {
+    return row_phases_;
+  }
+
+ private:
+  std::vector<Phase> phases_;
+  std::vector<uint16_t> row_phases_;
+};
@@ -0,0 +1,449 @@
+#include "analysis/OverlapDetector.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <numbers>
+#include <vector>
+
+#include "model/DocumentModel.h"
+#include "model/ShapeGeometry.h"
+#include "model/ShapeStore.h"
+#include "model/core/ModelTypes.h"
+#include "utils/ParallelFor.h"
+
+namespace {
+// Rows per worker chunk; below this the pass runs on the calling thread
+constexpr size_t kMinRowsPerChunk = 2048;
+
+constexpr int kMaxGjkIterations = 64;
+constexpr int kMaxEpaIterations = 64;
+// Convergence tolerances in scene units (pixels)
+constexpr double kGjkTolerance = 1.0e-7;
+constexpr double kEpaTolerance = 1.0e-6;
+// Initial EPA polygon: support points in this many directions
+constexpr int kEpaInitialDirections = 8;
+
+double dot(const Point2D& a, const Point2D& b) {
+  return a.x * b.x + a.y * b.y;
+}
+
+double cross(const Point2D& a, const Point2D& b) {
+  return a.x * b.y - a.y * b.x;
+}
+
+Point2D scaled(const Point2D& point, double factor) {
+  return Point2D{.x = point.x * factor, .y = point.y * factor};
+}
+
+bool is_circle(const ShapeFrame& frame) {
+  return frame.is_elliptic() && frame.half_width == frame.half_height;
+}
+
+// Support point of the Minkowski difference first - second
+Point2D minkowski_support(const ShapeFrame& first, const ShapeFrame& second,
+                          const Point2D& dir) {
+  return ShapeGeometry::support(first, dir.x, dir.y) -
+         ShapeGeometry::support(second, -dir.x, -dir.y);
+}
+
+// Closest point to the origin on segment [a, b]
+Point2D closest_on_segment(const Point2D& a, const Point2D& b) {
+  const Point2D edge = b - a;
+  const double length_sq = dot(edge, edge);
+  if (length_sq <= 0.0) {
+    return a;
+  }
+  const double t = std::clamp(-dot(a, edge) / length_sq, 0.0, 1.0);
+  return a + scaled(edge, t);
+}
+
+struct Simplex {
+  std::array<Point2D, 3> points;
+  int count{0};
+};
+
+// Reduce the simplex to the feature closest to the origin. Returns false when
+// the origin lies inside the triangle.
+bool reduce_simplex(Simplex& simplex, Point2D& closest) {
+  if (simplex.count == 1) {
+    closest = simplex.points[0];
+    return true;
+  }
+  if (simplex.count == 2) {
+    closest = closest_on_segment(simplex.points[0], simplex.points[1]);
+    return true;
+  }
+
+  const Point2D& a = simplex.points[0];
+  const Point2D& b = simplex.points[1];
+  const Point2D& c = simplex.points[2];
+  const double area = cross(b - a, c - a);
+  if (area != 0.0) {
+    const double side_ab = cross(b - a, Point2D{} - a) * area;
+    const double side_bc = cross(c - b, Point2D{} - b) * area;
+    const double side_ca = cross(a - c, Point2D{} - c) * area;
+    if (side_ab >= 0.0 && side_bc >= 0.0 && side_ca >= 0.0) {
+      return false;
+    }
+  }
+
+  // Keep the closest edge
+  const std::array<std::array<int, 2>, 3> edges = {{{0, 1}, {1, 2}, {2, 0}}};
+  double best_distance = std::numeric_limits<double>::infinity();
+  std::array<int, 2> best_edge = edges[0];
+  for (const auto& edge : edges) {
+    const Point2D point =
+      closest_on_segment(simplex.points[edge[0]], simplex.points[edge[1]]);
+    const double distance = dot(point, point);
+    if (distance < best_distance) {
+      best_distance = distance;
+      best_edge = edge;
+      closest = point;
+    }
+  }
+  simplex.points = {simplex.points[best_edge[0]], simplex.points[best_edge[1]],
+                    Point2D{}};
+  simplex.count = 2;
+  return true;
+}
+
+// GJK distance between two convex outlines; 0 when they overlap. The final
+// simplex is left in @p simplex: on overlap a triangle around the origin, or
+// the point or segment the origin was found on.
+double gjk_distance(const ShapeFrame& first, const ShapeFrame& second,
+                    Simplex& simplex) {
+  Point2D direction = second.center - first.center;
+  if (dot(direction, direction) <= 0.0) {
+    direction = Point2D{.x = 1.0, .y = 0.0};
+  }
+  simplex = Simplex{};
+  simplex.points[0] = minkowski_support(first, second, direction);
+  simplex.count = 1;
+  Point2D closest = simplex.points[0];
+
+  for (int iteration = 0; iteration < kMaxGjkIterations; ++iteration) {
+    const double length_sq = dot(closest, closest);
+    if (length_sq <= kGjkTolerance * kGjkTolerance) {
+      return 0.0;
+    }
+    const double length = std::sqrt(length_sq);
+    const Point2D next =
+      minkowski_support(first, second, scaled(closest, -1.0));
+    // Lower bound of the distance along the current direction
+    if (length - dot(closest, next) / length <= kGjkTolerance) {
+      return length;
+    }
+    simplex.points[simplex.count++] = next;
+    if (!reduce_simplex(simplex, closest)) {
+      return 0.0;
+    }
+  }
+  return std::sqrt(dot(closest, closest));
+}
+
+double gjk_distance(const ShapeFrame& first, const ShapeFrame& second) {
+  Simplex simplex;
+  return gjk_distance(first, second, simplex);
+}
+
+// Expanding polytope: penetration depth of two overlapping convex outlines.
+// Seeded with the final GJK simplex, which encloses the origin, plus support
+// points in a few fixed directions to start closer to the outline.
+double epa_depth(const ShapeFrame& first, const ShapeFrame& second,
+                 const Simplex& simplex) {
+  std::vector<Point2D> polygon(simplex.points.begin(),
+                               simplex.points.begin() + simplex.count);
+  polygon.reserve(polygon.size() + kEpaInitialDirections + kMaxEpaIterations);
+  for (int i = 0; i < kEpaInitialDirections; ++i) {
+    const double angle = 2.0 * std::numbers::pi * i / kEpaInitialDirections;
+    polygon.push_back(minkowski_support(
+      first, second, Point2D{.x = std::cos(angle), .y = std::sin(angle)}));
+  }
+  // All points lie on the outline of the difference and the origin is inside
+  // it, so ordered by angle about the origin they form a convex polygon
+  std::ranges::sort(polygon, {}, [](const Point2D& point) {
+    return std::atan2(point.y, point.x);
+  });
+  const auto same_point = [](const Point2D& a, const Point2D& b) {
+    return std::abs(a.x - b.x) + std::abs(a.y - b.y) <= kEpaTolerance;
+  };
+  polygon.erase(std::ranges::unique(polygon, same_point).begin(),
+                polygon.end());
+  while (polygon.size() > 1 && same_point(polygon.front(), polygon.back())) {
+    polygon.pop_back();
+  }
+  if (polygon.size() < 3) {
+    return 0.0;
+  }
+
+  // Support points in increasing angle form a counter-clockwise polygon
+  // (y axis up); the outward normal of edge (dx, dy) is (dy, -dx)
+  double best_distance = 0.0;
+  for (int iteration = 0; iteration < kMaxEpaIterations; ++iteration) {
+    best_distance = std::numeric_limits<double>::infinity();
+    size_t best_edge = 0;
+    Point2D best_normal;
+    for (size_t i = 0; i < polygon.size(); ++i) {
+      const Point2D& a = polygon[i];
+      const Point2D& b = polygon[(i + 1) % polygon.size()];
+      const Point2D edge = b - a;
+      const double length = std::hypot(edge.x, edge.y);
+      if (length <= 0.0) {
+        continue;
+      }
+      const Point2D normal{.x = edge.y / length, .y = -edge.x / length};
+      const double distance = dot(normal, a);
+      if (distance < best_distance) {
+        best_distance = distance;
+        best_edge = i;
+        best_normal = normal;
+      }
+    }
+    // An edge through or in front of the origin is expanded like any other;
+    // only a support point on it means the outlines just touch
+    const Point2D point = minkowski_support(first, second, best_normal);
+    if (dot(point, best_normal) - best_distance <= kEpaTolerance) {
+      return std::max(best_distance, 0.0);
+    }
+    polygon.insert(polygon.begin() + static_cast<std::ptrdiff_t>(best_edge) + 1,
+                   point);
+  }
+  return std::max(best_distance, 0.0);
+}
+
+// Separating axis test for two oriented boxes. Returns the smallest overlap
+// over all axes (negative when separated).
+double box_overlap(const ShapeFrame& first, const ShapeFrame& second) {
+  const Point2D delta = second.center - first.center;
+  const std::array<Point2D, 4> axes = {
+    Point2D{.x = first.cos_a, .y = first.sin_a},
+    Point2D{.x = -first.sin_a, .y = first.cos_a},
+    Point2D{.x = second.cos_a, .y = second.sin_a},
+    Point2D{.x = -second.sin_a, .y = second.cos_a}};
+  const auto radius = [](const ShapeFrame& frame, const Point2D& axis) {
+    return frame.half_width *
+             std::abs(frame.cos_a * axis.x + frame.sin_a * axis.y) +
+           frame.half_height *
+             std::abs(-frame.sin_a * axis.x + frame.cos_a * axis.y);
+  };
+  double min_overlap = std::numeric_limits<double>::infinity();
+  for (const auto& axis : axes) {
+    const double overlap = radius(first, axis) + radius(second, axis) -
+                           std::abs(dot(delta, axis));
+    min_overlap = std::min(min_overlap, overlap);
+    if (min_overlap < 0.0) {
+      break;
+    }
+  }
+  return min_overlap;
+}
+
+struct NearPair {
+  uint32_t first{0};
+  uint32_t second{0};
+  double gap{0.0};
+};
+
+struct ChunkResult {
+  std::vector<OverlapPair> overlaps;
+  std::vector<NearPair> near_pairs;
+  std::vector<BoundaryCrossing> crossings;
+};
+}  // namespace
+
+OverlapDetector::OverlapDetector(OverlapOptions options)
+    : options_(options) {}
+
+auto OverlapDetector::test_pair(const ShapeFrame& first,
+                                const ShapeFrame& second, bool compute_depth)
+  -> PairResult {
+  PairResult result;
+  if (is_circle(first) && is_circle(second)) {
+    const Point2D delta = second.center - first.center;
+    const double separation =
+      std::hypot(delta.x, delta.y) - first.half_width - second.half_width;
+    result.overlapping = separation < 0.0;
+    result.depth = result.overlapping ? -separation : 0.0;
+    result.gap = result.overlapping ? 0.0 : separation;
+    return result;
+  }
+
+  if (!first.is_elliptic() && !second.is_elliptic()) {
+    const double overlap = box_overlap(first, second);
+    if (overlap > 0.0) {
+      result.overlapping = true;
+      result.depth = overlap;  // Exact for convex polygons
+      return result;
+    }
+    result.gap = gjk_distance(first, second);
+    return result;
+  }
+
+  Simplex simplex;
+  const double distance = gjk_distance(first, second, simplex);
+  if (distance > 0.0) {
+    result.gap = distance;
+    return result;
+  }
+  result.overlapping = true;
+  if (compute_depth) {
+    result.depth = epa_depth(first, second, simplex);
+  }
+  return result;
+}
+
+auto OverlapDetector::detect(const DocumentModel& document) const
+  -> OverlapReport {
+  const auto substrate = document.substrate();
+  return detect(document.shape_store(),
+                substrate ? substrate->size() : Size2D{});
+}
+
+auto OverlapDetector::detect(const ShapeStore& store,
+                             const Size2D& substrate_size) const
+  -> OverlapReport {
+  OverlapReport report;
+  const size_t count = store.size();
+  if (count == 0) {
+    return report;
+  }
+
+  std::vector<ShapeFrame> frames(count);
+  std::vector<Aabb> bounds(count);
+  parallel_for(count, kMinRowsPerChunk,
+               [&](size_t begin, size_t end, size_t /*chunk*/) {
+                 for (size_t row = begin; row < end; ++row) {
+                   frames[row] = ShapeGeometry::make_frame(store, row);
+                   bounds[row] = ShapeGeometry::bounds(frames[row]);
+                 }
+               });
+
+  // Sweep order: bounding boxes sorted by min x, as separate columns so the
+  // candidate filter below runs over contiguous arrays
+  std::vector<uint32_t> order(count);
+  for (size_t row = 0; row < count; ++row) {
+    order[row] = static_cast<uint32_t>(row);
+  }
+  std::sort(order.begin(), order.end(), [&](uint32_t lhs, uint32_t rhs) {
+    return bounds[lhs].min_x < bounds[rhs].min_x;
+  });
+  std::vector<double> sweep_min_x(count);
+  std::vector<double> sweep_max_x(count);
+  std::vector<double> sweep_min_y(count);
+  std::vector<double> sweep_max_y(count);
+  for (size_t i = 0; i < count; ++i) {
+    const Aabb& box = bounds[order[i]];
+    sweep_min_x[i] = box.min_x;
+    sweep_max_x[i] = box.max_x;
+    sweep_min_y[i] = box.min_y;
+    sweep_max_y[i] = box.max_y;
+  }
+
+  const double margin = std::max(options_.gap_search_distance, 0.0);
+  const bool find_gaps = margin > 0.0;
+  const Aabb substrate_box{
+    .max_x = substrate_size.width, .max_y = substrate_size.height};
+  const bool check_substrate = options_.check_substrate &&
+                               substrate_size.width > 0.0 &&
+                               substrate_size.height > 0.0;
+
+  std::vector<ChunkResult> chunks(worker_thread_count());
+  parallel_for(
+    count, kMinRowsPerChunk, [&](size_t begin, size_t end, size_t chunk) {
+      ChunkResult& local = chunks[chunk];
+      std::vector<uint32_t> candidates;
+      for (size_t i = begin; i < end; ++i) {
+        const uint32_t row = order[i];
+        const double reach_x = sweep_max_x[i] + margin;
+        const double low_y = sweep_min_y[i] - margin;
+        const double high_y = sweep_max_y[i] + margin;
+        const auto sweep_end =
+          std::upper_bound(sweep_min_x.begin() + static_cast<std::ptrdiff_t>(i) + 1,
+                           sweep_min_x.end(), reach_x);
+        const size_t last =
+          static_cast<size_t>(sweep_end - sweep_min_x.begin());
+
+        // Branch-free y filter over the x-overlapping run
+        candidates.resize(last - i);
+        size_t candidate_count = 0;
+        for (size_t j = i + 1; j < last; ++j) {
+          candidates[candidate_count] = static_cast<uint32_t>(j);
+          candidate_count += static_cast<size_t>(
+            (sweep_min_y[j] <= high_y) & (sweep_max_y[j] >= low_y));
+        }
+
+        for (size_t k = 0; k < candidate_count; ++k) {
+          const uint32_t other = order[candidates[k]];
+          const PairResult result =
+            test_pair(frames[row], frames[other], options_.compute_depth);
+          if (result.overlapping) {
+            local.overlaps.push_back(OverlapPair{.first = std::min(row, other),
+                                                 .second = std::max(row, other),
+                                                 .depth = result.depth});
+          } else if (find_gaps && result.gap <= margin) {
+            local.near_pairs.push_back(
+              NearPair{.first = row, .second = other, .gap = result.gap});
+          }
+        }
+      }
+
+    });
+
+  // Boundary crossings; chunks cover increasing rows so the merged list stays
+  // sorted
+  if (check_substrate) {
+    parallel_for(
+      count, kMinRowsPerChunk, [&](size_t begin, size_t end, size_t chunk) {
+        ChunkResult& local = chunks[chunk];
+        for (size_t row = begin; row < end; ++row) {
+          const Aabb& box = bounds[row];
+          if (box.min_x >= 0.0 && box.min_y >= 0.0 &&
+              box.max_x <= substrate_size.width &&
+              box.max_y <= substrate_size.height) {
+            continue;  // Fully inside
+          }
+          if (!ShapeGeometry::intersects(frames[row], substrate_box)) {
+            continue;  // Fully outside
+          }
+          const double protrusion =
+            std::max({-box.min_x, -box.min_y, box.max_x - substrate_size.width,
+                      box.max_y - substrate_size.height});
+          local.crossings.push_back(
+            BoundaryCrossing{.row = row, .protrusion = protrusion});
+        }
+      });
+  }
+
+  if (find_gaps) {
+    report.min_gaps.assign(count, std::numeric_limits<double>::infinity());
+    report.nearest_neighbors.assign(count, ShapeStore::kInvalidRow);
+  }
+  for (auto& local : chunks) {
+    report.overlaps.insert(report.overlaps.end(), local.overlaps.begin(),
+                           local.overlaps.end());
+    report.boundary_crossings.insert(report.boundary_crossings.end(),
+                                     local.crossings.begin(),
+                                     local.crossings.end());
+    for (const NearPair& pair : local.near_pairs) {
+      if (pair.gap < report.min_gaps[pair.first]) {
+        report.min_gaps[pair.first] = pair.gap;
+        report.nearest_neighbors[pair.first] = pair.second;
+      }
+      if (pair.gap < report.min_gaps[pair.second]) {
+        report.min_gaps[pair.second] = pair.gap;
+        report.nearest_neighbors[pair.second] = pair.first;
+      }
+      report.min_gap = std::min(report.min_gap, pair.gap);
+    }
+  }
+  std::sort(report.overlaps.begin(), report.overlaps.end(),
+            [](const OverlapPair& lhs, const OverlapPair& rhs) {
+              return lhs.first != rhs.first ? lhs.first < rhs.first
+                                            : lhs.second < rhs.second;
+            });
+  return report;
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstddef>
+#include <limits>
+#include <vector>
+
+#include "model/ShapeGeometry.h"
+#include "model/ShapeStore.h"
+#include "model/core/ModelTypes.h"
+
+class DocumentModel;
+
+/**
+ * @brief Two overlapping inclusions (rows of the ShapeStore, first < second).
+ */
+struct OverlapPair {
+  size_t first{0};
+  size_t second{0};
+  double depth{0.0};  // Penetration depth (minimum translation distance)
+};
+
+/**
+ * @brief Inclusion whose outline crosses the substrate border.
+ */
+struct BoundaryCrossing {
+  size_t row{0};
+  double protrusion{0.0};  // How far the outline reaches past the border
+};
+
+struct OverlapReport {
+  std::vector<OverlapPair> overlaps;  // Sorted by (first, second)
+  std::vector<BoundaryCrossing> boundary_crossings;  // Sorted by row
+
+  // Per row: smallest gap to a non-overlapping neighbor within the search
+  // distance (infinity if none) and that neighbor (ShapeStore::kInvalidRow)
+  std::vector<double> min_gaps;
+  std::vector<size_t> nearest_neighbors;
+  double min_gap{std::numeric_limits<double>::infinity()};
+};
+
+struct OverlapOptions {
+  // Separated pairs closer than this report their gap; 0 disables gaps
+  double gap_search_distance{0.0};
+  bool compute_depth{true};
+  bool check_substrate{true};
+};
+
+/**
+ * @brief Finds overlapping inclusions, their penetration depths, minimum gaps
+ * and substrate boundary crossings.
+ *
+ * Broad phase: sweep and prune over structure-of-arrays bounding boxes sorted
+ * by min x, split across worker threads. Narrow phase: exact tests per shape
+ * pair - closed forms for circle/circle, separating axes for rectangle and
+ * stick pairs, GJK distance/EPA depth for anything involving an ellipse.
+ */
+class OverlapDetector {
+ public:
+  struct PairResult {
+    bool overlapping{false};
+    double depth{0.0};  // Valid when overlapping
+    double gap{0.0};    // Valid when not overlapping
+  };
+
+  explicit OverlapDetector(OverlapOptions options = {});
+
+  auto detect(const DocumentModel& document) const -> OverlapReport;
+  auto detect(const ShapeStore& store, const Size2D& substrate_size) const
+    -> OverlapReport;
+
+  static auto test_pair(const ShapeFrame& first, const ShapeFrame& second,
+                        bool compute_depth = true) -> PairResult;
+
+ private:
+  OverlapOptions options_;
+};
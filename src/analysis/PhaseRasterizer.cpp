@@ -0,0 +1,208 @@
+#include "analysis/PhaseRasterizer.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#include "analysis/MaterialTable.h"
+#include "model/DocumentModel.h"
+#include "model/ShapeGeometry.h"
+#include "model/ShapeStore.h"
+#include "model/SubstrateModel.h"
+#include "model/core/ModelTypes.h"
+#include "utils/ParallelFor.h"
+
+namespace {
+constexpr size_t kMinTileSize = 16;
+
+// Fill count pixels with one value, a vector register at a time
+void fill_span(uint16_t* out, size_t count, uint16_t value) {
+  size_t i = 0;
+#if defined(__AVX2__)
+  constexpr size_t kLanes = 16;
+  const __m256i lanes = _mm256_set1_epi16(static_cast<int16_t>(value));
+  for (; i + kLanes <= count; i += kLanes) {
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), lanes);
+  }
+#elif defined(__SSE2__)
+  constexpr size_t kLanes = 8;
+  const __m128i lanes = _mm_set1_epi16(static_cast<int16_t>(value));
+  for (; i + kLanes <= count; i += kLanes) {
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), lanes);
+  }
+#elif defined(__ARM_NEON)
+  constexpr size_t kLanes = 8;
+  const uint16x8_t lanes = vdupq_n_u16(value);
+  for (; i + kLanes <= count; i += kLanes) {
+    vst1q_u16(out + i, lanes);
+  }
+#endif
+  for (; i < count; ++i) {
+    out[i] = value;
+  }
+}
+
+// Pixels [first, last) whose centers lie in [min, max] scene units
+struct PixelRange {
+  ptrdiff_t first{0};
+  ptrdiff_t last{0};
+};
+
+PixelRange pixel_range(double min, double max, double pixels_per_unit,
+                       ptrdiff_t limit) {
+  const double first = std::ceil(min * pixels_per_unit - 0.5);
+  const double last = std::floor(max * pixels_per_unit - 0.5) + 1.0;
+  const auto clamp = [limit](double value) {
+    return static_cast<ptrdiff_t>(
+      std::clamp(value, 0.0, static_cast<double>(limit)));
+  };
+  return {clamp(first), clamp(last)};
+}
+}  // namespace
+
+PhaseRasterizer::PhaseRasterizer(PhaseRasterSettings settings)
+    : settings_(settings) {}
+
+auto PhaseRasterizer::rasterize(const DocumentModel& document) const
+  -> PhaseMap {
+  const auto started = std::chrono::steady_clock::now();
+  PhaseMap map;
+  const MaterialTable table(document);
+  map.phases = table.phases();
+
+  const auto substrate = document.substrate();
+  const Size2D substrate_size = substrate ? substrate->size() : Size2D{};
+  if (!(substrate_size.width > 0.0) || !(substrate_size.height > 0.0)) {
+    return map;
+  }
+
+  // Resolve the image size, keeping the aspect ratio for a missing side
+  map.width = settings_.width_px;
+  map.height = settings_.height_px;
+  if (map.width == 0 && map.height == 0) {
+    map.width = static_cast<size_t>(std::lround(substrate_size.width));
+    map.height = static_cast<size_t>(std::lround(substrate_size.height));
+  } else if (map.width == 0) {
+    map.width = static_cast<size_t>(std::lround(
+      map.height * substrate_size.width / substrate_size.height));
+  } else if (map.height == 0) {
+    map.height = static_cast<size_t>(std::lround(
+      map.width * substrate_size.height / substrate_size.width));
+  }
+  map.width = std::max<size_t>(map.width, 1);
+  map.height = std::max<size_t>(map.height, 1);
+  map.pixels.resize(map.width * map.height);
+
+  const double x_scale = map.width / substrate_size.width;
+  const double y_scale = map.height / substrate_size.height;
+  const auto width = static_cast<ptrdiff_t>(map.width);
+  const auto height = static_cast<ptrdiff_t>(map.height);
+  const auto tile = static_cast<ptrdiff_t>(
+    std::max(settings_.tile_size, kMinTileSize));
+  const ptrdiff_t tiles_x = (width + tile - 1) / tile;
+  const ptrdiff_t tiles_y = (height + tile - 1) / tile;
+
+  // Bin shapes by the tiles their pixel bounds touch (CSR, in draw order)
+  const ShapeStore& store = document.shape_store();
+  const size_t count = store.size();
+  std::vector<ShapeFrame> frames(count);
+  std::vector<PixelRange> columns(count);
+  std::vector<PixelRange> rows(count);
+  std::vector<uint32_t> tile_offsets(tiles_x * tiles_y + 1, 0);
+  for (size_t row = 0; row < count; ++row) {
+    frames[row] = ShapeGeometry::make_frame(store, row);
+    const Aabb box = ShapeGeometry::bounds(frames[row]);
+    columns[row] = pixel_range(box.min_x, box.max_x, x_scale, width);
+    rows[row] = pixel_range(box.min_y, box.max_y, y_scale, height);
+    if (columns[row].first >= columns[row].last ||
+        rows[row].first >= rows[row].last) {
+      continue;
+    }
+    for (ptrdiff_t ty = rows[row].first / tile;
+         ty <= (rows[row].last - 1) / tile; ++ty) {
+      for (ptrdiff_t tx = columns[row].first / tile;
+           tx <= (columns[row].last - 1) / tile; ++tx) {
+        ++tile_offsets[ty * tiles_x + tx + 1];
+      }
+    }
+  }
+  for (size_t index = 1; index < tile_offsets.size(); ++index) {
+    tile_offsets[index] += tile_offsets[index - 1];
+  }
+  std::vector<uint32_t> tile_shapes(tile_offsets.back());
+  {
+    std::vector<uint32_t> fill(tile_offsets.begin(), tile_offsets.end() - 1);
+    for (size_t row = 0; row < count; ++row) {
+      if (columns[row].first >= columns[row].last ||
+          rows[row].first >= rows[row].last) {
+        continue;
+      }
+      for (ptrdiff_t ty = rows[row].first / tile;
+           ty <= (rows[row].last - 1) / tile; ++ty) {
+        for (ptrdiff_t tx = columns[row].first / tile;
+             tx <= (columns[row].last - 1) / tile; ++tx) {
+          tile_shapes[fill[ty * tiles_x + tx]++] = static_cast<uint32_t>(row);
+        }
+      }
+    }
+  }
+
+  const auto phases = table.row_phases();
+  uint16_t* pixels = map.pixels.data();
+  const size_t tile_count = static_cast<size_t>(tiles_x * tiles_y);
+  std::atomic<size_t> next_tile{0};
+  // Tile costs vary a lot, so workers pull tiles instead of fixed chunks
+  parallel_for(std::min(worker_thread_count(), tile_count), 1,
+               [&](size_t, size_t, size_t) {
+    for (size_t index = next_tile.fetch_add(1, std::memory_order_relaxed);
+         index < tile_count;
+         index = next_tile.fetch_add(1, std::memory_order_relaxed)) {
+      const ptrdiff_t x0 = static_cast<ptrdiff_t>(index) % tiles_x * tile;
+      const ptrdiff_t y0 = static_cast<ptrdiff_t>(index) / tiles_x * tile;
+      const ptrdiff_t x1 = std::min(x0 + tile, width);
+      const ptrdiff_t y1 = std::min(y0 + tile, height);
+      for (ptrdiff_t y = y0; y < y1; ++y) {
+        fill_span(pixels + y * width + x0, x1 - x0,
+                  MaterialTable::kSubstratePhase);
+      }
+
+      for (uint32_t offset = tile_offsets[index];
+           offset < tile_offsets[index + 1]; ++offset) {
+        const uint32_t row = tile_shapes[offset];
+        const ShapeFrame& frame = frames[row];
+        const uint16_t phase = phases[row];
+        const ptrdiff_t row_begin = std::max(rows[row].first, y0);
+        const ptrdiff_t row_end = std::min(rows[row].last, y1);
+        for (ptrdiff_t y = row_begin; y < row_end; ++y) {
+          double min_x = 0.0;
+          double max_x = 0.0;
+          if (!ShapeGeometry::row_span(frame, (y + 0.5) / y_scale, min_x,
+                                       max_x)) {
+            continue;
+          }
+          const PixelRange span = pixel_range(min_x, max_x, x_scale, width);
+          const ptrdiff_t first = std::max(span.first, x0);
+          const ptrdiff_t last = std::min(span.last, x1);
+          if (first < last) {
+            fill_span(pixels + y * width + first, last - first, phase);
+          }
+        }
+      }
+    }
+  });
+
+  map.elapsed_ms = std::chrono::duration<double, std::milli>(
+                     std::chrono::steady_clock::now() - started)
+                     .count();
+  return map;
+}
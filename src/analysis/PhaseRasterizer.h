@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "analysis/MaterialTable.h"
+
+class DocumentModel;
+
+struct PhaseRasterSettings {
+  // Image size; 0 uses one pixel per scene unit, a single 0 keeps the
+  // substrate aspect ratio
+  size_t width_px{0};
+  size_t height_px{0};
+  size_t tile_size{256};  // Tile edge in pixels, the unit of parallel work
+};
+
+/**
+ * @brief Material-id image: every pixel holds the MaterialTable phase id of
+ * the topmost shape covering its center, 0 for the bare substrate.
+ */
+struct PhaseMap {
+  size_t width{0};
+  size_t height{0};
+  std::vector<uint16_t> pixels;  // Row-major, top row first
+  std::vector<MaterialTable::Phase> phases;
+  double elapsed_ms{0.0};
+
+  uint16_t at(size_t x, size_t y) const {
+    return pixels[y * width + x];
+  }
+  double megapixels_per_second() const {
+    return elapsed_ms > 0.0 ? static_cast<double>(pixels.size()) /
+                                (elapsed_ms * 1000.0)
+                            : 0.0;
+  }
+};
+
+/**
+ * @brief Scanline rasterizer for phase maps, independent of QGraphicsScene.
+ *
+ * Shapes are binned into square tiles that worker threads pull from a shared
+ * counter. Each tile is cleared to the substrate phase and the shapes touching
+ * it are filled span by span in draw order, so no pixel is written outside its
+ * tile and no synchronization is needed. Pixels are point-sampled at their
+ * centers; there is no anti-aliasing.
+ */
+class PhaseRasterizer {
+ public:
+  explicit PhaseRasterizer(PhaseRasterSettings settings = {});
+
+  auto rasterize(const DocumentModel& document) const -> PhaseMap;
+
+ private:
+  PhaseRasterSettings settings_;
+};
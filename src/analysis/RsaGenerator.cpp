@@ -0,0 +1,310 @@
+#include "analysis/RsaGenerator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <numbers>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "analysis/AreaFractionCalculator.h"
+#include "analysis/OverlapDetector.h"
+#include "model/DocumentModel.h"
+#include "model/ShapeGeometry.h"
+#include "model/ShapeModel.h"
+#include "model/ShapeSizeConverter.h"
+#include "model/ShapeStore.h"
+#include "model/SpatialIndex.h"
+#include "model/core/ModelTypes.h"
+#include "utils/ParallelFor.h"
+
+namespace {
+// Candidates drawn per worker thread and batch
+constexpr size_t kCandidatesPerWorker = 64;
+constexpr size_t kMinCandidatesPerChunk = 16;
+constexpr double kMinShapeSizePx = 1.0;
+// Samples used to estimate the typical extent for the index cell size
+constexpr size_t kExtentSamples = 256;
+constexpr double kCellSizeToExtentRatio = 2.0;
+// Scan lines for the area of a candidate that crosses the substrate border
+constexpr int kClipSamples = 128;
+
+struct Candidate {
+  ShapeStore::Record record;
+  ShapeFrame frame;
+  Aabb bounds;
+  bool free{false};
+};
+
+auto frame_of(const ShapeStore::Record& record) -> ShapeFrame {
+  return ShapeGeometry::make_frame(record.type, record.position, record.size,
+                                   record.rotation_deg);
+}
+
+auto expanded(const Aabb& box, double margin) -> Aabb {
+  return Aabb{.min_x = box.min_x - margin,
+              .min_y = box.min_y - margin,
+              .max_x = box.max_x + margin,
+              .max_y = box.max_y + margin};
+}
+
+// Area of the part of a shape inside the substrate; the scan lines are
+// cosine-spaced as in AreaFractionCalculator
+double clipped_area(const Candidate& candidate, const Size2D& substrate) {
+  const Aabb& box = candidate.bounds;
+  if (box.min_x >= 0.0 && box.min_y >= 0.0 && box.max_x <= substrate.width &&
+      box.max_y <= substrate.height) {
+    return ShapeGeometry::area(candidate.frame);
+  }
+  const double y_min = std::max(box.min_y, 0.0);
+  const double height = std::min(box.max_y, substrate.height) - y_min;
+  double area = 0.0;
+  for (int k = 0; height > 0.0 && k < kClipSamples; ++k) {
+    const double u = (k + 0.5) / kClipSamples;
+    const double y =
+      y_min + height * (1.0 - std::cos(std::numbers::pi * u)) / 2.0;
+    double span_min = 0.0;
+    double span_max = 0.0;
+    if (ShapeGeometry::row_span(candidate.frame, y, span_min, span_max)) {
+      const double width = std::min(span_max, substrate.width) -
+                           std::max(span_min, 0.0);
+      area += std::max(width, 0.0) * height * std::numbers::pi / 2.0 *
+              std::sin(std::numbers::pi * u) / kClipSamples;
+    }
+  }
+  return area;
+}
+
+bool conflicts(const ShapeFrame& first, const ShapeFrame& second,
+               double min_gap) {
+  const auto result = OverlapDetector::test_pair(first, second, false);
+  return result.overlapping || (min_gap > 0.0 && result.gap < min_gap);
+}
+
+class CandidateSampler {
+ public:
+  CandidateSampler(const RsaSettings& settings, const Size2D& substrate_size)
+      : settings_(settings), substrate_size_(substrate_size) {
+    double running = 0.0;
+    for (size_t i = 0; i < settings_.shape_types.size(); ++i) {
+      running += i < settings_.shape_weights.size()
+                   ? std::max(settings_.shape_weights[i], 0.0)
+                   : 1.0;
+      cumulative_weights_.push_back(running);
+    }
+  }
+
+  bool has_types() const {
+    return !cumulative_weights_.empty() && cumulative_weights_.back() > 0.0;
+  }
+
+  // Draw one candidate; returns false when it cannot fit the substrate
+  bool draw(std::mt19937_64& rng, Candidate& candidate) const {
+    ShapeStore::Record& record = candidate.record;
+    record.type = static_cast<uint8_t>(pick_type(rng));
+    record.size = draw_size(static_cast<ShapeModel::ShapeType>(record.type),
+                            rng);
+    record.rotation_deg = settings_.rotation_deg.sample(rng);
+    record.material_index = settings_.material_index;
+
+    // Bounds relative to the position, then a position that keeps them inside
+    record.position = Point2D{};
+    const Aabb local_bounds = ShapeGeometry::bounds(frame_of(record));
+    double min_x = 0.0;
+    double max_x = substrate_size_.width;
+    double min_y = 0.0;
+    double max_y = substrate_size_.height;
+    if (settings_.keep_inside) {
+      min_x = -local_bounds.min_x;
+      max_x = substrate_size_.width - local_bounds.max_x;
+      min_y = -local_bounds.min_y;
+      max_y = substrate_size_.height - local_bounds.max_y;
+      if (min_x > max_x || min_y > max_y) {
+        return false;
+      }
+    }
+    record.position =
+      Point2D{.x = std::uniform_real_distribution<double>(min_x, max_x)(rng),
+              .y = std::uniform_real_distribution<double>(min_y, max_y)(rng)};
+    candidate.frame = frame_of(record);
+    candidate.bounds = ShapeGeometry::bounds(candidate.frame);
+    return true;
+  }
+
+  // Typical bounding box extent, for the spatial index cell size
+  double estimate_extent(std::mt19937_64 rng) const {
+    double sum = 0.0;
+    for (size_t i = 0; i < kExtentSamples; ++i) {
+      ShapeStore::Record record;
+      record.type = static_cast<uint8_t>(pick_type(rng));
+      record.size =
+        draw_size(static_cast<ShapeModel::ShapeType>(record.type), rng);
+      const Aabb box = ShapeGeometry::bounds(frame_of(record));
+      sum += std::max(box.width(), box.height());
+    }
+    return sum / static_cast<double>(kExtentSamples);
+  }
+
+ private:
+  ShapeModel::ShapeType pick_type(std::mt19937_64& rng) const {
+    const double pick = std::uniform_real_distribution<double>(
+      0.0, cumulative_weights_.back())(rng);
+    const auto type_it = std::upper_bound(cumulative_weights_.begin(),
+                                          cumulative_weights_.end(), pick);
+    const size_t index = std::min(
+      static_cast<size_t>(type_it - cumulative_weights_.begin()),
+      settings_.shape_types.size() - 1);
+    return settings_.shape_types[index];
+  }
+
+  Size2D draw_size(ShapeModel::ShapeType type, std::mt19937_64& rng) const {
+    const double width = std::max(settings_.size.sample(rng), kMinShapeSizePx);
+    switch (type) {
+      case ShapeModel::ShapeType::Circle:
+        return Size2D{.width = width, .height = width};
+      case ShapeModel::ShapeType::Stick:
+        return Size2D{.width = width,
+                      .height = ShapeConstants::kStickThickness};
+      case ShapeModel::ShapeType::Rectangle:
+      case ShapeModel::ShapeType::Ellipse:
+      default:
+        return Size2D{
+          .width = width,
+          .height = std::max(width * settings_.aspect_ratio.sample(rng),
+                             kMinShapeSizePx)};
+    }
+  }
+
+  const RsaSettings& settings_;
+  Size2D substrate_size_;
+  std::vector<double> cumulative_weights_;
+};
+}  // namespace
+
+RsaGenerator::RsaGenerator(RsaSettings settings)
+    : settings_(std::move(settings)) {}
+
+auto RsaGenerator::generate(const Size2D& substrate_size,
+                            const ShapeStore* obstacles) const -> RsaResult {
+  RsaResult result;
+  const double substrate_area = substrate_size.width * substrate_size.height;
+  const CandidateSampler sampler(settings_, substrate_size);
+  if (!(substrate_area > 0.0) || !sampler.has_types()) {
+    return result;
+  }
+  const double target = std::clamp(settings_.target_fraction, 0.0, 1.0);
+  const double min_gap = std::max(settings_.min_gap, 0.0);
+
+  std::mt19937_64 rng(settings_.seed != 0 ? settings_.seed
+                                          : std::random_device{}());
+
+  // Placed shapes (obstacles first) indexed by position in placed_frames
+  std::vector<ShapeFrame> placed_frames;
+  SpatialIndex placed_index(sampler.estimate_extent(rng) *
+                              kCellSizeToExtentRatio +
+                            min_gap);
+  const auto place = [&](const ShapeFrame& frame) {
+    const auto slot = static_cast<uint32_t>(placed_frames.size());
+    placed_frames.push_back(frame);
+    placed_index.insert(SpatialIndex::Handle{.slot = slot, .generation = 0},
+                        frame);
+  };
+  // Obstacles may overlap each other and cross the border; accepted
+  // candidates overlap nothing, so only their own clipping is left to count
+  double covered_area = 0.0;
+  if (obstacles != nullptr) {
+    for (size_t row = 0; row < obstacles->size(); ++row) {
+      place(ShapeGeometry::make_frame(*obstacles, row));
+    }
+    covered_area =
+      AreaFractionCalculator().covered_area(*obstacles, substrate_size);
+  }
+
+  const auto is_free = [&](const Candidate& candidate) {
+    for (const auto& handle :
+         placed_index.query_box(expanded(candidate.bounds, min_gap))) {
+      if (conflicts(candidate.frame, placed_frames[handle.slot], min_gap)) {
+        return false;
+      }
+    }
+    return true;
+  };
+
+  const size_t batch_size = worker_thread_count() * kCandidatesPerWorker;
+  std::vector<Candidate> batch;
+  std::vector<size_t> accepted_in_batch;
+  size_t rejections = 0;
+  bool done = covered_area / substrate_area >= target;
+
+  while (!done) {
+    batch.clear();
+    for (size_t i = 0; i < batch_size; ++i) {
+      Candidate candidate;
+      if (sampler.draw(rng, candidate)) {
+        batch.push_back(candidate);
+      } else {
+        ++result.attempts;
+        ++rejections;
+      }
+    }
+    if (rejections > settings_.max_consecutive_rejections) {
+      break;
+    }
+
+    // Test against everything placed before this batch in parallel
+    parallel_for(batch.size(), kMinCandidatesPerChunk,
+                 [&](size_t begin, size_t end, size_t /*chunk*/) {
+                   for (size_t i = begin; i < end; ++i) {
+                     batch[i].free = is_free(batch[i]);
+                   }
+                 });
+
+    // Accept in draw order; candidates accepted earlier in this batch are not
+    // in the index yet when the parallel pass runs
+    accepted_in_batch.clear();
+    for (size_t i = 0; i < batch.size() && !done; ++i) {
+      ++result.attempts;
+      const Candidate& candidate = batch[i];
+      bool free = candidate.free;
+      const Aabb reach = expanded(candidate.bounds, min_gap);
+      for (size_t j = 0; free && j < accepted_in_batch.size(); ++j) {
+        const Candidate& other = batch[accepted_in_batch[j]];
+        free = !(reach.intersects(other.bounds) &&
+                 conflicts(candidate.frame, other.frame, min_gap));
+      }
+      if (!free) {
+        if (++rejections > settings_.max_consecutive_rejections) {
+          done = true;
+        }
+        continue;
+      }
+
+      rejections = 0;
+      accepted_in_batch.push_back(i);
+      place(candidate.frame);
+      covered_area += clipped_area(candidate, substrate_size);
+      result.shapes.push_back(candidate.record);
+      if (covered_area / substrate_area >= target ||
+          (settings_.max_shapes != 0 &&
+           result.shapes.size() >= settings_.max_shapes)) {
+        done = true;
+      }
+    }
+  }
+
+  result.area_fraction = covered_area / substrate_area;
+  result.target_reached = result.area_fraction >= target;
+  return result;
+}
+
+auto RsaGenerator::generate_into(DocumentModel& document) const -> RsaResult {
+  const auto substrate = document.substrate();
+  if (!substrate) {
+    return {};
+  }
+  RsaResult result = generate(substrate->size(), &document.shape_store());
+  document.create_shapes(result.shapes);
+  return result;
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "analysis/Distribution.h"
+#include "model/ShapeModel.h"
+#include "model/ShapeStore.h"
+#include "model/core/ModelTypes.h"
+
+class DocumentModel;
+
+struct RsaSettings {
+  // Shape types to place, picked with the given relative weights (equal
+  // weights when empty)
+  std::vector<ShapeModel::ShapeType> shape_types{
+    ShapeModel::ShapeType::Circle};
+  std::vector<double> shape_weights;
+
+  // Width of the shape: diameter for circles, length for sticks
+  Distribution size{Distribution::uniform(20.0, 40.0)};
+  // Height / width for rectangles and ellipses
+  Distribution aspect_ratio{Distribution::constant(1.0)};
+  Distribution rotation_deg{Distribution::uniform(0.0, 360.0)};
+
+  double target_fraction{0.3};  // Covered substrate area, 0..1
+  double min_gap{0.0};          // Minimum distance between outlines
+  bool keep_inside{true};       // Keep outlines inside the substrate
+  size_t max_shapes{0};         // 0 = no limit
+  // Give up after this many rejected candidates in a row (jamming limit)
+  size_t max_consecutive_rejections{200000};
+  int32_t material_index{-1};  // Preset material for generated shapes
+  uint64_t seed{0};            // 0 = non-deterministic
+};
+
+struct RsaResult {
+  std::vector<ShapeStore::Record> shapes;
+  // Covered substrate area, including pre-existing shapes; overlaps are
+  // counted once and parts outside the substrate not at all
+  double area_fraction{0.0};
+  size_t attempts{0};
+  bool target_reached{false};
+};
+
+/**
+ * @brief Random sequential adsorption: fills the substrate with
+ * non-overlapping inclusions until a target area fraction is reached.
+ *
+ * Candidates are drawn in batches on one random stream (reproducible for a
+ * given seed), tested in parallel against the already placed shapes through a
+ * SpatialIndex, then accepted in draw order with a final check against the
+ * shapes accepted earlier in the same batch.
+ */
+class RsaGenerator {
+ public:
+  explicit RsaGenerator(RsaSettings settings);
+
+  /**
+   * @brief Generate shapes for a substrate, avoiding the shapes already in
+   * obstacles (if any).
+   */
+  auto generate(const Size2D& substrate_size,
+                const ShapeStore* obstacles = nullptr) const -> RsaResult;
+
+  /**
+   * @brief Generate around the document's shapes and insert the result with
+   * one bulk DocumentModel::create_shapes() call.
+   */
+  auto generate_into(DocumentModel& document) const -> RsaResult;
+
+ private:
+  RsaSettings settings_;
+};
@@ -0,0 +1,392 @@
+#include <spdlog/common.h>
+#include <spdlog/sinks/stdout_color_sinks.h>
+#include <spdlog/spdlog.h>
+
+#include <QString>
+#include <charconv>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <exception>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <unordered_map>
+#include <vector>
+
+#include "analysis/AreaFractionCalculator.h"
+#include "analysis/Distribution.h"
+#include "analysis/OverlapDetector.h"
+#include "analysis/PhaseRasterizer.h"
+#include "analysis/RsaGenerator.h"
+#include "model/DocumentModel.h"
+#include "model/ShapeModel.h"
+#include "model/SubstrateModel.h"
+#include "serialization/JsonWriter.h"
+#include "serialization/PhaseMapWriter.h"
+#include "serialization/ProjectSerializer.h"
+
+namespace {
+constexpr int kExitFailure = 1;
+constexpr int kExitUsage = 2;
+constexpr double kPercent = 100.0;
+// Input name for an empty default document
+constexpr std::string_view kNewDocument = "-";
+
+constexpr std::string_view kUsage =
+  "Usage: nir-cli <command> <project.json> [arguments] [options]\n"
+  "\n"
+  "Commands:\n"
+  "  stats <project>               Area fraction and interface length per\n"
+  "                                material (tab-separated)\n"
+  "  overlaps <project>            Overlapping pairs and shapes crossing the\n"
+  "                                substrate border\n"
+  "      --gap D                   Also report the minimum gap up to D\n"
+  "  rasterize <project> <image>   Material-id image (.tif, .pgm or raw)\n"
+  "      --width N --height N      Image size (default 1 px per unit)\n"
+  "  generate <project> <output>   Add random non-overlapping inclusions\n"
+  "      --fraction F              Target area fraction, 0..1 (0.3)\n"
+  "      --size MIN:MAX            Uniform size range (20:40)\n"
+  "      --aspect MIN:MAX          Uniform height/width range (1:1)\n"
+  "      --types LIST              circle,ellipse,rectangle,stick (circle)\n"
+  "      --gap D                   Minimum distance between outlines\n"
+  "      --material N              Preset material index\n"
+  "      --seed N                  Random seed (0 = random)\n"
+  "      --allow-outside           Let inclusions cross the border\n"
+  "      --compact                 Write JSON without indentation\n"
+  "\n"
+  "Projects ending in .nirb use the binary format, .nirz the compressed\n"
+  "binary format and others JSON. Use '-' as the project for an empty\n"
+  "document; --substrate W:H sets the substrate size for any command.\n";
+
+struct Arguments {
+  std::string command;
+  std::vector<std::string> positional;
+  std::unordered_map<std::string, std::string> options;
+  std::vector<std::string> flags;
+
+  bool has_flag(std::string_view name) const {
+    for (const auto& flag : flags) {
+      if (flag == name) {
+        return true;
+      }
+    }
+    return false;
+  }
+  const std::string* option(const std::string& name) const {
+    const auto it = options.find(name);
+    return it == options.end() ? nullptr : &it->second;
+  }
+};
+
+// Options that take no value
+bool is_flag(std::string_view name) {
+  return name == "--allow-outside" || name == "--compact" ||
+         name == "--help";
+}
+
+bool is_command(std::string_view name) {
+  return name == "stats" || name == "overlaps" || name == "rasterize" ||
+         name == "generate";
+}
+
+bool parse_arguments(int argc, char* argv[], Arguments& arguments) {
+  for (int i = 1; i < argc; ++i) {
+    const std::string_view arg = argv[i];
+    if (arg.size() > 2 && arg.starts_with("--")) {
+      if (is_flag(arg)) {
+        arguments.flags.emplace_back(arg);
+        continue;
+      }
+      if (i + 1 >= argc) {
+        std::fprintf(stderr, "Missing value for %s\n", argv[i]);
+        return false;
+      }
+      arguments.options[std::string(arg)] = argv[++i];
+    } else if (arguments.command.empty()) {
+      arguments.command = arg;
+    } else {
+      arguments.positional.emplace_back(arg);
+    }
+  }
+  return true;
+}
+
+bool parse_number(std::string_view text, double& value) {
+  const auto [end, error] =
+    std::from_chars(text.data(), text.data() + text.size(), value);
+  return error == std::errc{} && end == text.data() + text.size();
+}
+
+bool parse_number(std::string_view text, uint64_t& value) {
+  const auto [end, error] =
+    std::from_chars(text.data(), text.data() + text.size(), value);
+  return error == std::errc{} && end == text.data() + text.size();
+}
+
+// Rejects values outside the int32_t range
+bool parse_number(std::string_view text, int32_t& value) {
+  const auto [end, error] =
+    std::from_chars(text.data(), text.data() + text.size(), value);
+  return error == std::errc{} && end == text.data() + text.size();
+}
+
+// "A:B", or a single value for both
+bool parse_pair(std::string_view text, double& first, double& second) {
+  const size_t colon = text.find(':');
+  if (colon == std::string_view::npos) {
+    return parse_number(text, first) && parse_number(text, second);
+  }
+  return parse_number(text.substr(0, colon), first) &&
+         parse_number(text.substr(colon + 1), second);
+}
+
+bool parse_range(std::string_view text, double& min, double& max) {
+  return parse_pair(text, min, max) && min <= max;
+}
+
+template <typename T>
+bool read_option(const Arguments& arguments, const std::string& name,
+                 T& value) {
+  const std::string* text = arguments.option(name);
+  if (text == nullptr) {
+    return true;
+  }
+  if (!parse_number(*text, value)) {
+    std::fprintf(stderr, "Invalid value for %s: %s\n", name.c_str(),
+                 text->c_str());
+    return false;
+  }
+  return true;
+}
+
+bool parse_shape_types(std::string_view text,
+                       std::vector<ShapeModel::ShapeType>& types) {
+  types.clear();
+  while (!text.empty()) {
+    const size_t comma = text.find(',');
+    const std::string_view name = text.substr(0, comma);
+    if (name == "circle") {
+      types.push_back(ShapeModel::ShapeType::Circle);
+    } else if (name == "ellipse") {
+      types.push_back(ShapeModel::ShapeType::Ellipse);
+    } else if (name == "rectangle") {
+      types.push_back(ShapeModel::ShapeType::Rectangle);
+    } else if (name == "stick") {
+      types.push_back(ShapeModel::ShapeType::Stick);
+    } else {
+      return false;
+    }
+    text = comma == std::string_view::npos ? std::string_view{}
+                                           : text.substr(comma + 1);
+  }
+  return !types.empty();
+}
+
+bool load_document(const Arguments& arguments, DocumentModel& document) {
+  const std::string& input = arguments.positional.front();
+  if (input != kNewDocument &&
+      !ProjectSerializer::load_from_file(QString::fromStdString(input),
+                                         &document)) {
+    std::fprintf(stderr, "Failed to load project: %s\n", input.c_str());
+    return false;
+  }
+  if (const std::string* text = arguments.option("--substrate")) {
+    Size2D size;
+    if (!parse_pair(*text, size.width, size.height) || !(size.width > 0.0) ||
+        !(size.height > 0.0)) {
+      std::fprintf(stderr, "Invalid value for --substrate: %s\n",
+                   text->c_str());
+      return false;
+    }
+    document.substrate()->set_size(size);
+  }
+  return true;
+}
+
+int run_stats(const DocumentModel& document) {
+  const AreaFractionReport report = AreaFractionCalculator().compute(document);
+  std::printf("phase\tname\tinclusions\tarea\tarea_percent\tinterface\n");
+  for (size_t id = 0; id < report.phases.size(); ++id) {
+    const PhaseFraction& phase = report.phases[id];
+    std::printf("%zu\t%s\t%zu\t%.6g\t%.6f\t%.6g\n", id, phase.name.c_str(),
+                phase.inclusion_count, phase.area,
+                phase.area_fraction * kPercent, phase.interface_length);
+  }
+  std::printf("total\t\t%zu\t%.6g\t%.6f\t%.6g\n", document.shapes().size(),
+              report.substrate_area, kPercent, report.total_interface_length);
+  return 0;
+}
+
+int run_overlaps(const Arguments& arguments, const DocumentModel& document) {
+  OverlapOptions options;
+  if (!read_option(arguments, "--gap", options.gap_search_distance)) {
+    return kExitUsage;
+  }
+  const OverlapReport report = OverlapDetector(options).detect(document);
+  const auto& shapes = document.shapes();
+  for (const auto& pair : report.overlaps) {
+    std::printf("overlap\t%s\t%s\t%.6g\n", shapes[pair.first]->name().c_str(),
+                shapes[pair.second]->name().c_str(), pair.depth);
+  }
+  for (const auto& crossing : report.boundary_crossings) {
+    std::printf("border\t%s\t\t%.6g\n", shapes[crossing.row]->name().c_str(),
+                crossing.protrusion);
+  }
+  std::fprintf(stderr, "%zu overlaps, %zu border crossings",
+               report.overlaps.size(), report.boundary_crossings.size());
+  if (options.gap_search_distance > 0.0) {
+    std::fprintf(stderr, ", minimum gap %.6g", report.min_gap);
+  }
+  std::fprintf(stderr, "\n");
+  return 0;
+}
+
+int run_rasterize(const Arguments& arguments, const DocumentModel& document) {
+  if (arguments.positional.size() < 2) {
+    std::fprintf(stderr, "rasterize needs an output image\n");
+    return kExitUsage;
+  }
+  uint64_t width = 0;
+  uint64_t height = 0;
+  if (!read_option(arguments, "--width", width) ||
+      !read_option(arguments, "--height", height)) {
+    return kExitUsage;
+  }
+  PhaseRasterSettings settings;
+  settings.width_px = static_cast<size_t>(width);
+  settings.height_px = static_cast<size_t>(height);
+  const PhaseMap map = PhaseRasterizer(settings).rasterize(document);
+  if (map.pixels.empty()) {
+    std::fprintf(stderr, "The substrate has no area\n");
+    return kExitFailure;
+  }
+
+  const std::string& output = arguments.positional[1];
+  if (!PhaseMapWriter::write(output, map)) {
+    std::fprintf(stderr, "Failed to write image: %s\n", output.c_str());
+    return kExitFailure;
+  }
+  std::fprintf(stderr, "%zux%zu, %zu phases, %.1f ms (%.0f MP/s)\n", map.width,
+               map.height, map.phases.size(), map.elapsed_ms,
+               map.megapixels_per_second());
+  return 0;
+}
+
+int run_generate(const Arguments& arguments, DocumentModel& document) {
+  if (arguments.positional.size() < 2) {
+    std::fprintf(stderr, "generate needs an output project\n");
+    return kExitUsage;
+  }
+  RsaSettings settings;
+  double size_min = 20.0;
+  double size_max = 40.0;
+  double aspect_min = 1.0;
+  double aspect_max = 1.0;
+  int32_t material = -1;
+  if (const std::string* text = arguments.option("--size");
+      text != nullptr && !parse_range(*text, size_min, size_max)) {
+    std::fprintf(stderr, "Invalid value for --size: %s\n", text->c_str());
+    return kExitUsage;
+  }
+  if (const std::string* text = arguments.option("--aspect");
+      text != nullptr && !parse_range(*text, aspect_min, aspect_max)) {
+    std::fprintf(stderr, "Invalid value for --aspect: %s\n", text->c_str());
+    return kExitUsage;
+  }
+  if (const std::string* text = arguments.option("--types");
+      text != nullptr && !parse_shape_types(*text, settings.shape_types)) {
+    std::fprintf(stderr, "Invalid value for --types: %s\n", text->c_str());
+    return kExitUsage;
+  }
+  if (!read_option(arguments, "--fraction", settings.target_fraction) ||
+      !read_option(arguments, "--gap", settings.min_gap) ||
+      !read_option(arguments, "--seed", settings.seed) ||
+      !read_option(arguments, "--material", material)) {
+    return kExitUsage;
+  }
+  // Preset index into the input project's material list
+  if (const std::string* text = arguments.option("--material");
+      text != nullptr &&
+      (material < 0 ||
+       static_cast<size_t>(material) >= document.materials().size())) {
+    std::fprintf(stderr, "Invalid value for --material: %s\n", text->c_str());
+    return kExitUsage;
+  }
+  settings.size = Distribution::uniform(size_min, size_max);
+  settings.aspect_ratio = Distribution::uniform(aspect_min, aspect_max);
+  settings.keep_inside = !arguments.has_flag("--allow-outside");
+  if (arguments.option("--material") != nullptr) {
+    settings.material_index = material;
+  }
+
+  const auto started = std::chrono::steady_clock::now();
+  const RsaResult result = RsaGenerator(settings).generate_into(document);
+  const double elapsed_ms = std::chrono::duration<double, std::milli>(
+                              std::chrono::steady_clock::now() - started)
+                              .count();
+
+  const std::string& output = arguments.positional[1];
+  const auto layout = arguments.has_flag("--compact")
+                        ? JsonWriter::Layout::Compact
+                        : JsonWriter::Layout::Indented;
+  if (!ProjectSerializer::save_to_file(QString::fromStdString(output),
+                                       &document, layout)) {
+    std::fprintf(stderr, "Failed to save project: %s\n", output.c_str());
+    return kExitFailure;
+  }
+  std::fprintf(stderr,
+               "Generated %zu inclusions, area fraction %.2f%%%s, %.1f ms\n",
+               result.shapes.size(), result.area_fraction * kPercent,
+               result.target_reached ? "" : " (jammed before target)",
+               elapsed_ms);
+  return 0;
+}
+}  // namespace
+
+auto main(int argc, char* argv[]) -> int {
+  // Diagnostics go to stderr so stdout stays machine-readable
+  spdlog::set_default_logger(spdlog::stderr_color_mt("nir-cli"));
+  spdlog::set_level(spdlog::level::warn);
+
+  Arguments arguments;
+  if (!parse_arguments(argc, argv, arguments)) {
+    return kExitUsage;
+  }
+  if (arguments.command.empty() || arguments.command == "help" ||
+      arguments.has_flag("--help")) {
+    std::fputs(kUsage.data(), arguments.command.empty() ? stderr : stdout);
+    return arguments.command.empty() ? kExitUsage : 0;
+  }
+  if (!is_command(arguments.command)) {
+    std::fprintf(stderr, "Unknown command: %s\n\n%s",
+                 arguments.command.c_str(), kUsage.data());
+    return kExitUsage;
+  }
+  if (arguments.positional.empty()) {
+    std::fprintf(stderr, "%s needs a project\n\n%s", arguments.command.c_str(),
+                 kUsage.data());
+    return kExitUsage;
+  }
+
+  try {
+    DocumentModel document;
+    if (!load_document(arguments, document)) {
+      return kExitFailure;
+    }
+    if (arguments.command == "stats") {
+      return run_stats(document);
+    }
+    if (arguments.command == "overlaps") {
+      return run_overlaps(arguments, document);
+    }
+    if (arguments.command == "rasterize") {
+      return run_rasterize(arguments, document);
+    }
+    return run_generate(arguments, document);
+  } catch (const std::exception& e) {
+    std::fprintf(stderr, "Error: %s\n", e.what());
+    return kExitFailure;
+  }
+}
@@ -0,0 +1,192 @@
+// Benchmark of the scene <-> model binding on a large scene: selection
+// lookups, dragging the selection and recoloring it. The lookup step is also
+// timed with the dynamic_cast dispatch the binder used before items carried a
+// type tag.
+//
+// Usage: nir-binder-bench [items]
+
+#include <QApplication>
+#include <QGraphicsItem>
+#include <QGraphicsScene>
+#include <QLineF>
+#include <QList>
+#include <QRectF>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+
+#include "model/DocumentModel.h"
+#include "model/ShapeModel.h"
+#include "model/core/ModelTypes.h"
+#include "scene/ISceneObject.h"
+#include "scene/items/CircleItem.h"
+#include "scene/items/EllipseItem.h"
+#include "scene/items/RectangleItem.h"
+#include "scene/items/StickItem.h"
+#include "ui/bindings/ShapeModelBinder.h"
+
+namespace {
+constexpr size_t kDefaultItems = 50'000;
+constexpr size_t kSelectEvery = 10;
+constexpr size_t kDragSteps = 20;
+constexpr int kColumns = 250;
+constexpr double kSpacing = 40.0;
+constexpr double kItemSize = 20.0;
+
+double nanoseconds_since(std::chrono::steady_clock::time_point start,
+                         size_t operations) {
+  const std::chrono::duration<double, std::nano> elapsed =
+    std::chrono::steady_clock::now() - start;
+  return elapsed.count() / static_cast<double>(operations);
+}
+
+ISceneObject* make_item(size_t index) {
+  const QRectF rect(-kItemSize / 2.0, -kItemSize / 2.0, kItemSize, kItemSize);
+  switch (index % 4) {
+    case 0:
+      return new RectangleItem(rect);
+    case 1:
+      return new EllipseItem(rect);
+    case 2:
+      return new CircleItem(kItemSize / 2.0);
+    default:
+      return new StickItem(QLineF(-kItemSize / 2.0, 0.0, kItemSize / 2.0, 0.0));
+  }
+}
+
+// Type resolution as the binder did it before ISceneObject::kind()
+ShapeModel::ShapeType dynamic_cast_type(QGraphicsItem* graphics_item) {
+  auto* item = dynamic_cast<ISceneObject*>(graphics_item);
+  if (dynamic_cast<RectangleItem*>(item) != nullptr) {
+    return ShapeModel::ShapeType::Rectangle;
+  }
+  if (dynamic_cast<EllipseItem*>(item) != nullptr) {
+    return ShapeModel::ShapeType::Ellipse;
+  }
+  if (dynamic_cast<CircleItem*>(item) != nullptr) {
+    return ShapeModel::ShapeType::Circle;
+  }
+  if (dynamic_cast<StickItem*>(item) != nullptr) {
+    return ShapeModel::ShapeType::Stick;
+  }
+  return ShapeModel::ShapeType::Rectangle;
+}
+
+ShapeModel::ShapeType tagged_type(QGraphicsItem* graphics_item) {
+  ISceneObject* item = scene_object_cast(graphics_item);
+  switch (item != nullptr ? item->kind() : ISceneObject::Kind::Substrate) {
+    case ISceneObject::Kind::Ellipse:
+      return ShapeModel::ShapeType::Ellipse;
+    case ISceneObject::Kind::Circle:
+      return ShapeModel::ShapeType::Circle;
+    case ISceneObject::Kind::Stick:
+      return ShapeModel::ShapeType::Stick;
+    default:
+      return ShapeModel::ShapeType::Rectangle;
+  }
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+  if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) {
+    qputenv("QT_QPA_PLATFORM", "offscreen");
+  }
+  QApplication app(argc, argv);
+  const size_t item_count =
+    argc > 1 ? std::strtoull(argv[1], nullptr, 10) : kDefaultItems;
+  if (item_count == 0) {
+    std::fprintf(stderr, "Usage: nir-binder-bench [items]\n");
+    return 2;
+  }
+
+  DocumentModel document;
+  ShapeModelBinder binder(document);
+  QGraphicsScene scene;
+  auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < item_count; ++i) {
+    ISceneObject* item = make_item(i);
+    QGraphicsItem* graphics_item = item->graphics_item();
+    graphics_item->setPos(static_cast<double>(i % kColumns) * kSpacing,
+                          static_cast<double>(i / kColumns) * kSpacing);
+    scene.addItem(graphics_item);
+    binder.bind_shape(item);
+  }
+  std::printf("bind %zu items: %.1f ns/item\n", item_count,
+              nanoseconds_since(start, item_count));
+
+  const auto& shapes = document.shapes();
+  for (size_t i = 0; i < shapes.size(); i += kSelectEvery) {
+    if (QGraphicsItem* item = binder.item_for(shapes[i])) {
+      item->setSelected(true);
+    }
+  }
+  const QList<QGraphicsItem*> selected = scene.selectedItems();
+  const auto selected_count = static_cast<size_t>(selected.size());
+  std::printf("selected %zu items\n", selected_count);
+  if (selected_count == 0) {
+    return 1;
+  }
+
+  // Scene selection -> model -> item, as the selection sync does it
+  size_t found = 0;
+  start = std::chrono::steady_clock::now();
+  for (QGraphicsItem* graphics_item : selected) {
+    auto* item = dynamic_cast<ISceneObject*>(graphics_item);
+    if (auto model = binder.model_for(item)) {
+      found += binder.item_for(model) == graphics_item ? 1 : 0;
+    }
+  }
+  const double lookup_cast = nanoseconds_since(start, selected_count);
+  start = std::chrono::steady_clock::now();
+  for (QGraphicsItem* graphics_item : selected) {
+    ISceneObject* item = scene_object_cast(graphics_item);
+    if (auto model = binder.model_for(item)) {
+      found += binder.object_for(model) == item ? 1 : 0;
+    }
+  }
+  const double lookup_tagged = nanoseconds_since(start, selected_count);
+  std::printf("selection lookup: dynamic_cast %.1f ns, tagged %.1f ns "
+              "(%zu round trips)\n",
+              lookup_cast, lookup_tagged, found);
+
+  const QList<QGraphicsItem*> all_items = scene.items();
+  const auto all_count = static_cast<size_t>(all_items.size());
+  size_t type_sum = 0;
+  start = std::chrono::steady_clock::now();
+  for (QGraphicsItem* graphics_item : all_items) {
+    type_sum += static_cast<size_t>(dynamic_cast_type(graphics_item));
+  }
+  const double type_cast = nanoseconds_since(start, all_count);
+  start = std::chrono::steady_clock::now();
+  for (QGraphicsItem* graphics_item : all_items) {
+    type_sum += static_cast<size_t>(tagged_type(graphics_item));
+  }
+  const double type_tagged = nanoseconds_since(start, all_count);
+  std::printf("type dispatch: dynamic_cast %.1f ns, tagged %.1f ns (%zu)\n",
+              type_cast, type_tagged, type_sum);
+
+  // Moving an item pushes its geometry into the bound model
+  start = std::chrono::steady_clock::now();
+  for (size_t step = 0; step < kDragSteps; ++step) {
+    for (QGraphicsItem* graphics_item : selected) {
+      graphics_item->moveBy(1.0, 0.5);
+    }
+  }
+  std::printf("drag selection: %.1f ns per item step\n",
+              nanoseconds_since(start, selected_count * kDragSteps));
+
+  // Recoloring a model pushes the color into the bound item
+  start = std::chrono::steady_clock::now();
+  for (QGraphicsItem* graphics_item : selected) {
+    if (auto model = binder.model_for(scene_object_cast(graphics_item))) {
+      model->set_custom_color(Color{.r = 50, .g = 100, .b = 200, .a = 255});
+    }
+  }
+  std::printf("recolor selection: %.1f ns per item\n",
+              nanoseconds_since(start, selected_count));
+
+  binder.clear_bindings();
+  return 0;
+}
@@ -0,0 +1,435 @@
+#include "commands/BulkShapeCommands.h"
+
+#include <QGraphicsItem>
+#include <QGraphicsScene>
+#include <QString>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <span>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "model/DocumentModel.h"
+#include "model/MaterialModel.h"
+#include "model/ShapeGeometry.h"
+#include "model/ShapeModel.h"
+#include "model/ShapeSizeConverter.h"
+#include "model/ShapeStore.h"
+#include "scene/ISceneObject.h"
+#include "ui/bindings/ShapeModelBinder.h"
+#include "ui/controller/DocumentController.h"
+#include "ui/editor/EditorArea.h"
+
+namespace {
+// Smallest width or height scaling leaves a shape with
+constexpr double kMinScaledExtent = 1.0;
+constexpr double kHalf = 0.5;
+
+auto record_of(const ShapeModel& shape) -> ShapeStore::Record {
+  return {.type = static_cast<uint8_t>(shape.type()),
+          .position = shape.position(),
+          .size = shape.size(),
+          .rotation_deg = shape.rotation_deg()};
+}
+
+auto records_of(const std::vector<std::shared_ptr<ShapeModel>>& shapes)
+  -> std::vector<ShapeStore::Record> {
+  std::vector<ShapeStore::Record> records;
+  records.reserve(shapes.size());
+  for (const auto& shape : shapes) {
+    records.push_back(record_of(*shape));
+  }
+  return records;
+}
+
+// Rectangles and ellipses are positioned by their top-left corner, circles
+// and sticks by their center (see ShapeFrame)
+auto position_for_center(uint8_t type, const Point2D& center,
+                         const Size2D& size) -> Point2D {
+  const auto shape_type = static_cast<ShapeModel::ShapeType>(type);
+  if (shape_type == ShapeModel::ShapeType::Circle ||
+      shape_type == ShapeModel::ShapeType::Stick) {
+    return center;
+  }
+  return {.x = center.x - size.width * kHalf,
+          .y = center.y - size.height * kHalf};
+}
+
+auto center_of(const ShapeStore::Record& record) -> Point2D {
+  return ShapeGeometry::make_frame(record.type, record.position, record.size,
+                                   record.rotation_deg)
+    .center;
+}
+
+auto scaled(const ShapeStore::Record& record, double factor)
+  -> ShapeStore::Record {
+  ShapeStore::Record result = record;
+  result.size.width = record.size.width * factor;
+  // A stick's height is its pen width
+  if (static_cast<ShapeModel::ShapeType>(record.type) !=
+      ShapeModel::ShapeType::Stick) {
+    result.size.height = record.size.height * factor;
+  }
+  if (result.size.width < kMinScaledExtent ||
+      result.size.height < kMinScaledExtent) {
+    return record;
+  }
+  result.position =
+    position_for_center(record.type, center_of(record), result.size);
+  return result;
+}
+
+auto with_type(const ShapeStore::Record& record, ShapeModel::ShapeType type)
+  -> ShapeStore::Record {
+  ShapeStore::Record result = record;
+  result.type = static_cast<uint8_t>(type);
+  result.size = ShapeSizeConverter::convert(
+    static_cast<ShapeModel::ShapeType>(record.type), type, record.size);
+  result.position =
+    position_for_center(result.type, center_of(record), result.size);
+  return result;
+}
+
+enum class ItemState : uint8_t { kNone, kShown, kSelected };
+
+// Remove the scene items of the shapes and report what each shape had
+auto remove_items(ShapeModelBinder& binder, QGraphicsScene& scene,
+                  std::span<const std::shared_ptr<ShapeModel>> shapes)
+  -> std::vector<ItemState> {
+  std::vector<ItemState> states(shapes.size(), ItemState::kNone);
+  std::vector<ISceneObject*> items(shapes.size(), nullptr);
+  bool any_selected = false;
+  for (size_t i = 0; i < shapes.size(); ++i) {
+    items[i] = binder.object_for(shapes[i]);
+    if (items[i] == nullptr) {
+      continue;
+    }
+    const bool selected = items[i]->graphics_item()->isSelected();
+    states[i] = selected ? ItemState::kSelected : ItemState::kShown;
+    any_selected |= selected;
+  }
+  // One selection change instead of one per removed item
+  if (any_selected) {
+    scene.clearSelection();
+  }
+  for (ISceneObject* item : items) {
+    if (item == nullptr) {
+      continue;
+    }
+    binder.unbind_shape(item);
+    QGraphicsItem* graphics_item = item->graphics_item();
+    scene.removeItem(graphics_item);
+    delete graphics_item;
+  }
+  return states;
+}
+
+// Give the shapes marked in states a new item, bound and placed by the model
+// and stacked by row. Last rows first, so that the item of the next shape
+// is usually there already
+void add_items(const DocumentModel& document, ShapeModelBinder& binder,
+               QGraphicsScene& scene,
+               std::span<const std::shared_ptr<ShapeModel>> shapes,
+               std::span<const ItemState> states) {
+  std::vector<size_t> order;
+  order.reserve(shapes.size());
+  for (size_t i = 0; i < shapes.size() && i < states.size(); ++i) {
+    if (states[i] != ItemState::kNone) {
+      order.push_back(i);
+    }
+  }
+  std::ranges::sort(order, std::ranges::greater{}, [&](size_t i) {
+    return document.row_of(*shapes[i]);
+  });
+  for (const size_t i : order) {
+    ISceneObject* item = DocumentController::create_item_for_shape(shapes[i]);
+    if (item == nullptr) {
+      continue;
+    }
+    item->set_name(QString::fromStdString(shapes[i]->name()));
+    scene.addItem(item->graphics_item());
+    binder.attach_shape(item, shapes[i]);
+    binder.stack_in_document_order(item);
+    item->graphics_item()->setSelected(states[i] == ItemState::kSelected);
+  }
+}
+
+auto shape_count(size_t count) -> std::string {
+  return std::to_string(count) + (count == 1 ? " Shape" : " Shapes");
+}
+}  // namespace
+
+// TransformShapesCommand
+TransformShapesCommand::TransformShapesCommand(
+  DocumentModel* document, Kind kind,
+  std::vector<std::shared_ptr<ShapeModel>> shapes,
+  std::vector<ShapeStore::Record> new_records)
+    : document_(document),
+      kind_(kind),
+      shapes_(std::move(shapes)),
+      old_records_(records_of(shapes_)),
+      new_records_(std::move(new_records)) {}
+
+auto TransformShapesCommand::rotate(
+  DocumentModel* document, std::vector<std::shared_ptr<ShapeModel>> shapes,
+  double delta_deg) -> TransformShapesCommand {
+  std::vector<ShapeStore::Record> records = records_of(shapes);
+  for (ShapeStore::Record& record : records) {
+    record.rotation_deg += delta_deg;  // Normalized by the model
+  }
+  return {document, Kind::kRotate, std::move(shapes), std::move(records)};
+}
+
+auto TransformShapesCommand::scale(
+  DocumentModel* document, std::vector<std::shared_ptr<ShapeModel>> shapes,
+  double factor) -> TransformShapesCommand {
+  std::vector<ShapeStore::Record> records = records_of(shapes);
+  for (ShapeStore::Record& record : records) {
+    record = scaled(record, factor);
+  }
+  return {document, Kind::kScale, std::move(shapes), std::move(records)};
+}
+
+auto TransformShapesCommand::execute() -> bool {
+  if (document_ == nullptr || shapes_.empty() ||
+      new_records_.size() != shapes_.size()) {
+    return false;
+  }
+  document_->set_shape_records(shapes_, new_records_);
+  return true;
+}
+
+auto TransformShapesCommand::undo() -> bool {
+  if (document_ == nullptr || shapes_.empty()) {
+    return false;
+  }
+  document_->set_shape_records(shapes_, old_records_);
+  return true;
+}
+
+auto TransformShapesCommand::description() const -> std::string {
+  return (kind_ == Kind::kRotate ? "Rotate " : "Scale ") +
+         shape_count(shapes_.size());
+}
+
+auto TransformShapesCommand::merge_key() const -> MergeKey {
+  return {.target = document_, .property = static_cast<int>(kind_)};
+}
+
+auto TransformShapesCommand::merge_with(const Command& other) -> bool {
+  const auto* other_cmd = dynamic_cast<const TransformShapesCommand*>(&other);
+  if (other_cmd == nullptr || other_cmd->kind_ != kind_ ||
+      other_cmd->shapes_ != shapes_) {
+    return false;
+  }
+  new_records_ = other_cmd->new_records_;
+  return true;
+}
+
+// AddShapesCommand
+AddShapesCommand::AddShapesCommand(DocumentModel* document,
+                                   ShapeModelBinder* binder,
+                                   EditorArea* editor_area,
+                                   std::vector<ShapeStore::Record> records,
+                                   bool with_items)
+    : document_(document),
+      binder_(binder),
+      editor_area_(editor_area),
+      records_(std::move(records)),
+      with_items_(with_items) {}
+
+auto AddShapesCommand::execute() -> bool {
+  if (document_ == nullptr || binder_ == nullptr || editor_area_ == nullptr ||
+      editor_area_->scene() == nullptr) {
+    return false;
+  }
+  if (shapes_.empty()) {
+    if (records_.empty()) {
+      return false;
+    }
+    shapes_ = document_->create_shapes(records_);
+    records_ = {};  // The shapes hold the values from now on
+  } else {
+    document_->restore_shapes(shapes_);
+  }
+  if (with_items_) {
+    const std::vector<ItemState> states(shapes_.size(), ItemState::kShown);
+    add_items(*document_, *binder_, *editor_area_->scene(), shapes_, states);
+  }
+  return true;
+}
+
+auto AddShapesCommand::undo() -> bool {
+  if (document_ == nullptr || binder_ == nullptr || editor_area_ == nullptr ||
+      editor_area_->scene() == nullptr || shapes_.empty()) {
+    return false;
+  }
+  remove_items(*binder_, *editor_area_->scene(), shapes_);
+  document_->remove_shapes(shapes_);
+  return true;
+}
+
+auto AddShapesCommand::description() const -> std::string {
+  return "Add " + shape_count(shapes_.empty() ? records_.size()
+                                              : shapes_.size());
+}
+
+// DeleteShapesCommand
+DeleteShapesCommand::DeleteShapesCommand(
+  DocumentModel* document, ShapeModelBinder* binder, EditorArea* editor_area,
+  std::vector<std::shared_ptr<ShapeModel>> shapes)
+    : document_(document),
+      binder_(binder),
+      editor_area_(editor_area),
+      shapes_(std::move(shapes)) {
+  if (document_ != nullptr) {
+    std::erase_if(shapes_, [this](const std::shared_ptr<ShapeModel>& shape) {
+      return shape == nullptr ||
+             document_->row_of(*shape) == ShapeStore::kInvalidRow;
+    });
+    // Undo puts the shapes back by ascending row
+    std::ranges::sort(shapes_, {}, [this](const auto& shape) {
+      return document_->row_of(*shape);
+    });
+  }
+}
+
+auto DeleteShapesCommand::execute() -> bool {
+  if (document_ == nullptr || binder_ == nullptr || editor_area_ == nullptr ||
+      editor_area_->scene() == nullptr || shapes_.empty()) {
+    return false;
+  }
+  const std::vector<ItemState> states =
+    remove_items(*binder_, *editor_area_->scene(), shapes_);
+  had_item_.assign(states.size(), 0);
+  rows_.resize(shapes_.size());
+  for (size_t i = 0; i < states.size(); ++i) {
+    had_item_[i] = states[i] != ItemState::kNone ? 1 : 0;
+    rows_[i] = document_->row_of(*shapes_[i]);
+  }
+  document_->remove_shapes(shapes_);
+  return true;
+}
+
+auto DeleteShapesCommand::undo() -> bool {
+  if (document_ == nullptr || binder_ == nullptr || editor_area_ == nullptr ||
+      editor_area_->scene() == nullptr || shapes_.empty()) {
+    return false;
+  }
+  document_->restore_shapes(shapes_, rows_);
+  std::vector<ItemState> states(shapes_.size(), ItemState::kNone);
+  for (size_t i = 0; i < states.size() && i < had_item_.size(); ++i) {
+    if (had_item_[i] != 0) {
+      states[i] = ItemState::kShown;
+    }
+  }
+  add_items(*document_, *binder_, *editor_area_->scene(), shapes_, states);
+  return true;
+}
+
+auto DeleteShapesCommand::description() const -> std::string {
+  return "Delete " + shape_count(shapes_.size());
+}
+
+// AssignShapesMaterialCommand
+AssignShapesMaterialCommand::AssignShapesMaterialCommand(
+  DocumentModel* document, std::vector<std::shared_ptr<ShapeModel>> shapes,
+  std::shared_ptr<MaterialModel> material)
+    : document_(document),
+      shapes_(std::move(shapes)),
+      material_(std::move(material)) {
+  std::erase(shapes_, nullptr);
+  old_materials_.reserve(shapes_.size());
+  old_presets_.reserve(shapes_.size());
+  for (const auto& shape : shapes_) {
+    const bool preset =
+      shape->material_mode() == ShapeModel::MaterialMode::Preset;
+    // nullptr for a custom material that was never created
+    old_materials_.push_back(preset ? shape->material()
+                                    : shape->custom_material());
+    old_presets_.push_back(preset ? 1 : 0);
+  }
+}
+
+auto AssignShapesMaterialCommand::execute() -> bool {
+  if (document_ == nullptr || shapes_.empty()) {
+    return false;
+  }
+  const DocumentModel::Batch batch(*document_);
+  for (const auto& shape : shapes_) {
+    if (material_ != nullptr) {
+      shape->assign_material(material_);
+    } else if (shape->material_mode() == ShapeModel::MaterialMode::Preset) {
+      shape->clear_material();
+    }
+  }
+  return true;
+}
+
+auto AssignShapesMaterialCommand::undo() -> bool {
+  if (document_ == nullptr || shapes_.empty()) {
+    return false;
+  }
+  const DocumentModel::Batch batch(*document_);
+  for (size_t i = 0; i < shapes_.size(); ++i) {
+    if (old_presets_[i] != 0) {
+      shapes_[i]->assign_material(old_materials_[i]);
+    } else {
+      shapes_[i]->set_custom_material(old_materials_[i]);
+    }
+  }
+  return true;
+}
+
+auto AssignShapesMaterialCommand::description() const -> std::string {
+  return "Change Material of " + shape_count(shapes_.size());
+}
+
+// ChangeShapesTypeCommand
+ChangeShapesTypeCommand::ChangeShapesTypeCommand(
+  DocumentModel* document, ShapeModelBinder* binder, EditorArea* editor_area,
+  std::vector<std::shared_ptr<ShapeModel>> shapes,
+  ShapeModel::ShapeType new_type)
+    : document_(document),
+      binder_(binder),
+      editor_area_(editor_area),
+      shapes_(std::move(shapes)) {
+  std::erase_if(shapes_, [new_type](const std::shared_ptr<ShapeModel>& shape) {
+    return shape == nullptr || shape->type() == new_type;
+  });
+  old_records_ = records_of(shapes_);
+  new_records_.reserve(old_records_.size());
+  for (const ShapeStore::Record& record : old_records_) {
+    new_records_.push_back(with_type(record, new_type));
+  }
+}
+
+auto ChangeShapesTypeCommand::execute() -> bool {
+  return apply(new_records_);
+}
+
+auto ChangeShapesTypeCommand::undo() -> bool {
+  return apply(old_records_);
+}
+
+auto ChangeShapesTypeCommand::apply(
+  const std::vector<ShapeStore::Record>& records) -> bool {
+  if (document_ == nullptr || binder_ == nullptr || editor_area_ == nullptr ||
+      editor_area_->scene() == nullptr || shapes_.empty()) {
+    return false;
+  }
+  // Items cannot change their class: replace those of the old type
+  QGraphicsScene& scene = *editor_area_->scene();
+  const std::vector<ItemState> states = remove_items(*binder_, scene, shapes_);
+  document_->set_shape_records(shapes_, records);
+  add_items(*document_, *binder_, scene, shapes_, states);
+  return true;
+}
+
+auto ChangeShapesTypeCommand::description() const -> std::string {
+  return "Change Type of " + shape_count(shapes_.size());
+}
@@ -0,0 +1,177 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "commands/Command.h"
+#include "model/ShapeModel.h"
+#include "model/ShapeStore.h"
+
+class DocumentModel;
+class ShapeModelBinder;
+class EditorArea;
+class MaterialModel;
+
+/**
+ * @brief Rotation or scaling of many shapes as one undoable edit.
+ *
+ * Holds the records of all shapes before and after the edit and applies
+ * either side in one DocumentModel::set_shape_records() pass; bound scene
+ * items follow through the binder. Consecutive steps of the same kind on the
+ * same shapes (wheel notches) merge into one command.
+ */
+class TransformShapesCommand : public Command {
+ public:
+  enum class Kind : std::uint8_t { kRotate, kScale };
+
+  TransformShapesCommand(DocumentModel* document, Kind kind,
+                         std::vector<std::shared_ptr<ShapeModel>> shapes,
+                         std::vector<ShapeStore::Record> new_records);
+
+  /**
+   * @brief Rotate every shape about its own center by @p delta_deg.
+   */
+  static auto rotate(DocumentModel* document,
+                     std::vector<std::shared_ptr<ShapeModel>> shapes,
+                     double delta_deg) -> TransformShapesCommand;
+  /**
+   * @brief Scale every shape about its own center by @p factor (sticks only
+   * in length). Shapes that would shrink below a scene unit keep their size.
+   */
+  static auto scale(DocumentModel* document,
+                    std::vector<std::shared_ptr<ShapeModel>> shapes,
+                    double factor) -> TransformShapesCommand;
+
+  auto execute() -> bool override;
+  auto undo() -> bool override;
+  [[nodiscard]] auto description() const -> std::string override;
+  [[nodiscard]] auto merge_key() const -> MergeKey override;
+  auto merge_with(const Command& other) -> bool override;
+
+ private:
+  DocumentModel* document_;
+  Kind kind_;
+  std::vector<std::shared_ptr<ShapeModel>> shapes_;
+  std::vector<ShapeStore::Record> old_records_;
+  std::vector<ShapeStore::Record> new_records_;
+};
+
+/**
+ * @brief Command to add many shapes at once (e.g. generated inclusions).
+ *
+ * The first execute() creates the shapes from their records and drops the
+ * records; from then on the history holds only the shape objects, which the
+ * document shares while they are in it. Undo removes them in one pass and
+ * redo brings back the same objects.
+ */
+class AddShapesCommand : public Command {
+ public:
+  /**
+   * @param with_items Give every shape a scene item; false when the batched
+   * inclusion layer draws them.
+   */
+  AddShapesCommand(DocumentModel* document, ShapeModelBinder* binder,
+                   EditorArea* editor_area,
+                   std::vector<ShapeStore::Record> records, bool with_items);
+
+  auto execute() -> bool override;
+  auto undo() -> bool override;
+  [[nodiscard]] auto description() const -> std::string override;
+
+  [[nodiscard]] auto shapes() const
+    -> const std::vector<std::shared_ptr<ShapeModel>>& {
+    return shapes_;
+  }
+
+ private:
+  DocumentModel* document_;
+  ShapeModelBinder* binder_;
+  EditorArea* editor_area_;
+  std::vector<ShapeStore::Record> records_;  // Until the first execute()
+  bool with_items_;
+  std::vector<std::shared_ptr<ShapeModel>> shapes_;
+};
+
+/**
+ * @brief Command to delete many shapes in one DocumentModel::remove_shapes()
+ * pass.
+ *
+ * Undo brings the same shape objects back at their rows, so commands
+ * further back in the history still refer to them and the stacking order is
+ * unchanged. Only shapes that had a scene item get one back; with batched
+ * rendering the layer draws the rest.
+ */
+class DeleteShapesCommand : public Command {
+ public:
+  DeleteShapesCommand(DocumentModel* document, ShapeModelBinder* binder,
+                      EditorArea* editor_area,
+                      std::vector<std::shared_ptr<ShapeModel>> shapes);
+
+  auto execute() -> bool override;
+  auto undo() -> bool override;
+  [[nodiscard]] auto description() const -> std::string override;
+
+ private:
+  DocumentModel* document_;
+  ShapeModelBinder* binder_;
+  EditorArea* editor_area_;
+  std::vector<std::shared_ptr<ShapeModel>> shapes_;  // Sorted by row
+  // Per shape, as of the last execute(): row before the deletion and
+  // whether it had a scene item
+  std::vector<size_t> rows_;
+  std::vector<uint8_t> had_item_;
+};
+
+/**
+ * @brief Command to give many shapes a preset material, or their own custom
+ * material (nullptr), in one batch.
+ */
+class AssignShapesMaterialCommand : public Command {
+ public:
+  AssignShapesMaterialCommand(DocumentModel* document,
+                              std::vector<std::shared_ptr<ShapeModel>> shapes,
+                              std::shared_ptr<MaterialModel> material);
+
+  auto execute() -> bool override;
+  auto undo() -> bool override;
+  [[nodiscard]] auto description() const -> std::string override;
+
+ private:
+  DocumentModel* document_;
+  std::vector<std::shared_ptr<ShapeModel>> shapes_;
+  std::shared_ptr<MaterialModel> material_;
+  // Material of each shape before the command, and whether it was a preset
+  std::vector<std::shared_ptr<MaterialModel>> old_materials_;
+  std::vector<uint8_t> old_presets_;
+};
+
+/**
+ * @brief Command to change the type of many shapes, keeping their centers.
+ *
+ * Types and converted sizes are written in one set_shape_records() pass;
+ * shapes that have a scene item get a new item of the new type.
+ */
+class ChangeShapesTypeCommand : public Command {
+ public:
+  ChangeShapesTypeCommand(DocumentModel* document, ShapeModelBinder* binder,
+                          EditorArea* editor_area,
+                          std::vector<std::shared_ptr<ShapeModel>> shapes,
+                          ShapeModel::ShapeType new_type);
+
+  auto execute() -> bool override;
+  auto undo() -> bool override;
+  [[nodiscard]] auto description() const -> std::string override;
+
+ private:
+  auto apply(const std::vector<ShapeStore::Record>& records) -> bool;
+
+  DocumentModel* document_;
+  ShapeModelBinder* binder_;
+  EditorArea* editor_area_;
+  std::vector<std::shared_ptr<ShapeModel>> shapes_;
+  std::vector<ShapeStore::Record> old_records_;
+  std::vector<ShapeStore::Record> new_records_;
+};
@@ -8,6 +8,11 @@
  *
  * Commands encapsulate operations that can be executed and undone.
  * This enables Undo/Redo functionality throughout the application.
+ *
+ * There are no document versions to swap back to: each command keeps what
+ * it needs to undo itself. Structural commands keep the shape and material
+ * objects they add or remove; edits keep the values before and after, so a
+ * transform of N shapes costs 2 N records of history.
  */
 class Command {
  public:
@@ -41,6 +46,22 @@ class Command {
     return "Command";
   }
 
+  /**
+   * @brief What a command edits, for coalescing continuous edits (see
+   * CommandManager::execute_coalesced()). Commands with equal keys may be
+   * merged with merge_with(); a null target never merges.
+   */
+  struct MergeKey {
+    const void* target{nullptr};
+    int property{0};
+
+    bool operator==(const MergeKey& other) const = default;
+  };
+
+  [[nodiscard]] virtual auto merge_key() const -> MergeKey {
+    return {};
+  }
+
   /**
    * @brief Merge this command with another command if possible.
    * Used for combining multiple similar operations (e.g., moving an item).
@@ -0,0 +1,59 @@
+#include "commands/CommandGroup.h"
+
+#include <functional>
+#include <string>
+#include <utility>
+
+CommandGroup::CommandGroup(std::unique_ptr<Command> first) {
+  add(std::move(first));
+}
+
+auto CommandGroup::execute() -> bool {
+  for (auto& member : members_) {
+    if (!member->execute()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+auto CommandGroup::undo() -> bool {
+  for (auto member = members_.rbegin(); member != members_.rend(); ++member) {
+    if (!(*member)->undo()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+auto CommandGroup::description() const -> std::string {
+  return members_.empty() ? Command::description()
+                          : members_.front()->description();
+}
+
+auto CommandGroup::merge(const Command& command) -> bool {
+  const MergeKey key = command.merge_key();
+  if (key.target == nullptr) {
+    return false;
+  }
+  const auto member = index_.find(key);
+  return member != index_.end() &&
+         members_[member->second]->merge_with(command);
+}
+
+void CommandGroup::add(std::unique_ptr<Command> command) {
+  if (command == nullptr) {
+    return;
+  }
+  const MergeKey key = command->merge_key();
+  if (key.target != nullptr) {
+    index_[key] = members_.size();
+  }
+  members_.push_back(std::move(command));
+}
+
+auto CommandGroup::MergeKeyHash::operator()(const MergeKey& key) const
+  -> size_t {
+  return std::hash<const void*>{}(key.target) ^
+         (static_cast<size_t>(key.property) << 1U);
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "commands/Command.h"
+
+/**
+ * @brief Commands undone and redone together as one history entry.
+ *
+ * CommandManager keeps the commands of one continuous edit in a group. A
+ * command whose merge key matches a member is merged into that member, so a
+ * drag of several shapes holds one command per shape and property no matter
+ * how many steps it took.
+ */
+class CommandGroup : public Command {
+ public:
+  explicit CommandGroup(std::unique_ptr<Command> first);
+
+  auto execute() -> bool override;
+  auto undo() -> bool override;
+  [[nodiscard]] auto description() const -> std::string override;
+
+  /**
+   * @brief Merge an executed @p command into the member with its merge key.
+   * @return false if there is no such member or it refused the merge.
+   */
+  auto merge(const Command& command) -> bool;
+  /**
+   * @brief Add an executed command as a new member.
+   */
+  void add(std::unique_ptr<Command> command);
+
+  [[nodiscard]] auto size() const -> size_t {
+    return members_.size();
+  }
+
+ private:
+  struct MergeKeyHash {
+    auto operator()(const MergeKey& key) const -> size_t;
+  };
+
+  std::vector<std::unique_ptr<Command>> members_;
+  std::unordered_map<MergeKey, size_t, MergeKeyHash> index_;
+};
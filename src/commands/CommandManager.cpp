@@ -1,8 +1,12 @@
 #include "commands/CommandManager.h"
 
 #include <algorithm>
+#include <chrono>
 #include <string>
 
+#include "commands/CommandGroup.h"
+#include "serialization/ChangeJournal.h"
+
 CommandManager::CommandManager(QObject* parent) : QObject(parent) {}
 
 auto CommandManager::execute(std::unique_ptr<Command> command) -> bool {
@@ -15,6 +19,47 @@ auto CommandManager::execute(std::unique_ptr<Command> command) -> bool {
     return false;
   }
 
+  gesture_ = nullptr;
+  push_history(std::move(command));
+  return true;
+}
+
+auto CommandManager::open_gesture() -> CommandGroup* {
+  if (gesture_ == nullptr) {
+    return nullptr;
+  }
+  if (history_.empty() || current_index_ != history_.size() ||
+      history_.back().get() != gesture_ ||
+      std::chrono::steady_clock::now() - last_coalesced_ > merge_interval_) {
+    gesture_ = nullptr;
+  }
+  return gesture_;
+}
+
+auto CommandManager::merge_into_gesture(const Command& command) -> bool {
+  CommandGroup* gesture = open_gesture();
+  if (gesture == nullptr || !gesture->merge(command)) {
+    return false;
+  }
+  // The journal picks the edit up with the next commit or autosave; history
+  // and undo description are unchanged
+  last_coalesced_ = std::chrono::steady_clock::now();
+  return true;
+}
+
+void CommandManager::add_to_gesture(std::unique_ptr<Command> command) {
+  last_coalesced_ = std::chrono::steady_clock::now();
+  if (CommandGroup* gesture = open_gesture()) {
+    gesture->add(std::move(command));
+    return;
+  }
+  auto group = std::make_unique<CommandGroup>(std::move(command));
+  CommandGroup* opened = group.get();
+  push_history(std::move(group));
+  gesture_ = opened;
+}
+
+void CommandManager::push_history(std::unique_ptr<Command> command) {
   // Remove any commands after current_index_ (user did redo, then new command)
   if (current_index_ < history_.size()) {
     history_.erase(history_.begin() + static_cast<ptrdiff_t>(current_index_),
@@ -28,8 +73,8 @@ auto CommandManager::execute(std::unique_ptr<Command> command) -> bool {
   // Trim history if needed
   trim_history();
 
+  commit_journal();
   emit history_changed();
-  return true;
 }
 
 auto CommandManager::undo() -> bool {
@@ -37,11 +82,13 @@ auto CommandManager::undo() -> bool {
     return false;
   }
 
+  gesture_ = nullptr;
   // Move back in history
   --current_index_;
 
   // Undo the command at current_index_
   if (history_[current_index_]->undo()) {
+    commit_journal();
     emit history_changed();
     return true;
   }
@@ -56,9 +103,11 @@ auto CommandManager::redo() -> bool {
     return false;
   }
 
+  gesture_ = nullptr;
   // Redo the command at current_index_
   if (history_[current_index_]->execute()) {
     ++current_index_;
+    commit_journal();
     emit history_changed();
     return true;
   }
@@ -75,6 +124,7 @@ auto CommandManager::can_redo() const -> bool {
 }
 
 void CommandManager::clear() {
+  gesture_ = nullptr;
   history_.clear();
   current_index_ = 0;
   emit history_changed();
@@ -94,6 +144,12 @@ auto CommandManager::redo_description() const -> std::string {
   return history_[current_index_]->description();
 }
 
+void CommandManager::commit_journal() {
+  if (journal_ != nullptr) {
+    journal_->commit();
+  }
+}
+
 void CommandManager::trim_history() {
   if (max_history_size_ == 0) {
     return;  // Unlimited
@@ -1,17 +1,29 @@
 #pragma once
 
 #include <QObject>
+#include <chrono>
 #include <memory>
+#include <utility>
 #include <vector>
 
 #include "commands/Command.h"
 
+class ChangeJournal;
+class CommandGroup;
+
 /**
  * @brief Manages command history for Undo/Redo functionality.
  *
  * This class maintains a history of executed commands and provides
  * undo/redo capabilities. Commands are stored in a vector with a
  * current index pointing to the last executed command.
+ *
+ * Continuous edits (drags, spin boxes) go through execute_coalesced(): their
+ * commands collect in one history entry, a gesture, until the edit ends
+ * (close_gesture(), e.g. on mouse release) or anything else touches the
+ * history. Edits without such an end (wheel steps) rely on the merge
+ * interval: a longer pause also closes the gesture. Commands on the same
+ * target and property merge in place.
  */
 class CommandManager : public QObject {
   Q_OBJECT
@@ -31,6 +43,40 @@ class CommandManager : public QObject {
    */
   auto execute(std::unique_ptr<Command> command) -> bool;
 
+  /**
+   * @brief Execute a command of a continuous edit and coalesce it into the
+   * open gesture entry, or start a new one.
+   * @param command Executed in place; moved to the heap only if it cannot
+   * be merged into a command of the gesture.
+   * @return true if the command executed successfully.
+   */
+  template <typename ConcreteCommand>
+  auto execute_coalesced(ConcreteCommand command) -> bool {
+    if (!command.execute()) {
+      return false;
+    }
+    if (!merge_into_gesture(command)) {
+      add_to_gesture(std::make_unique<ConcreteCommand>(std::move(command)));
+    }
+    return true;
+  }
+
+  /**
+   * @brief End the open gesture: the next coalesced command starts a new
+   * history entry.
+   */
+  void close_gesture() {
+    gesture_ = nullptr;
+  }
+
+  /**
+   * @brief Longest pause between the commands of one gesture, for gestures
+   * that are not closed explicitly.
+   */
+  void set_merge_interval(std::chrono::milliseconds interval) {
+    merge_interval_ = interval;
+  }
+
   /**
    * @brief Undo the last executed command.
    * @return true if undo was successful, false otherwise.
@@ -80,6 +126,15 @@ class CommandManager : public QObject {
     max_history_size_ = size;
   }
 
+  /**
+   * @brief Commit the change journal after every executed, undone or redone
+   * command, so each one becomes a recoverable journal frame.
+   * @param journal Journal to commit (not owned), or nullptr.
+   */
+  void set_change_journal(ChangeJournal* journal) {
+    journal_ = journal;
+  }
+
   /**
    * @brief Get current history size.
    * @return Number of commands in history.
@@ -95,9 +150,20 @@ class CommandManager : public QObject {
   void history_changed();
 
  private:
+  void push_history(std::unique_ptr<Command> command);
   void trim_history();
+  void commit_journal();
+  // Open gesture entry, or nullptr once it timed out or was closed
+  auto open_gesture() -> CommandGroup*;
+  auto merge_into_gesture(const Command& command) -> bool;
+  void add_to_gesture(std::unique_ptr<Command> command);
 
   std::vector<std::unique_ptr<Command>> history_;
   size_t current_index_{0};
   size_t max_history_size_{100};  // Default: keep last 100 commands
+  ChangeJournal* journal_{nullptr};
+  // Newest history entry while it takes coalesced commands
+  CommandGroup* gesture_{nullptr};
+  std::chrono::steady_clock::time_point last_coalesced_;
+  std::chrono::milliseconds merge_interval_{500};
 };
@@ -17,7 +17,12 @@ auto CreateMaterialCommand::execute() -> bool {
     return false;
   }
 
-  created_material_ = document_->create_material(color_, name_);
+  // Redo brings back the same material, which later commands refer to
+  if (created_material_ != nullptr) {
+    document_->restore_material(created_material_);
+  } else {
+    created_material_ = document_->create_material(color_, name_);
+  }
   if (created_material_ == nullptr) {
     return false;
   }
@@ -40,7 +45,6 @@ auto CreateMaterialCommand::undo() -> bool {
   }
 
   document_->remove_material(created_material_);
-  created_material_.reset();
   return true;
 }
 
@@ -77,22 +81,8 @@ auto DeleteMaterialCommand::undo() -> bool {
   if (document_ == nullptr || material_ == nullptr) {
     return false;
   }
-
-  // Recreate material
-  // Note: DocumentModel doesn't have insert_at, so we'll add at end
-  // This is acceptable as order doesn't matter for materials
-  auto restored =
-    document_->create_material(material_->color(), material_->name());
-  if (restored == nullptr) {
-    return false;
-  }
-
-  // Copy all properties
-  restored->set_grid_type(material_->grid_type());
-  restored->set_grid_frequency_x(material_->grid_frequency_x());
-  restored->set_grid_frequency_y(material_->grid_frequency_y());
-
-  material_ = restored;
+  // The same object: shapes and commands that refer to it stay valid
+  document_->restore_material(material_);
   return true;
 }
 
@@ -3,7 +3,9 @@
 #include <QGraphicsItem>
 #include <QGraphicsScene>
 #include <QPointF>
-#include <algorithm>
+#include <QString>
+#include <memory>
+#include <span>
 #include <string>
 #include <variant>
 
@@ -15,6 +17,27 @@
 #include "ui/controller/DocumentController.h"
 #include "ui/editor/EditorArea.h"
 
+namespace {
+// New scene item for a shape of the document, placed by the model and
+// stacked by its row
+auto add_item(ShapeModelBinder& binder, EditorArea& editor_area,
+              const std::shared_ptr<ShapeModel>& shape) -> ISceneObject* {
+  auto* scene = editor_area.scene();
+  if (scene == nullptr) {
+    return nullptr;
+  }
+  ISceneObject* item = DocumentController::create_item_for_shape(shape);
+  if (item == nullptr) {
+    return nullptr;
+  }
+  item->set_name(QString::fromStdString(shape->name()));
+  scene->addItem(item->graphics_item());
+  binder.attach_shape(item, shape);
+  binder.stack_in_document_order(item);
+  return item;
+}
+}  // namespace
+
 // CreateShapeCommand
 CreateShapeCommand::CreateShapeCommand(DocumentModel* document,
                                        ShapeModelBinder* binder,
@@ -31,6 +54,15 @@ auto CreateShapeCommand::execute() -> bool {
   if (document_ == nullptr || binder_ == nullptr || editor_area_ == nullptr) {
     return false;
   }
+  // Creation and placement reach document observers as one change
+  const DocumentModel::Batch batch(*document_);
+
+  // Redo brings back the same shape, which later commands refer to
+  if (created_shape_ != nullptr) {
+    document_->restore_shapes(std::span(&created_shape_, 1));
+    created_item_ = add_item(*binder_, *editor_area_, created_shape_);
+    return created_item_ != nullptr;
+  }
 
   // Create shape in document
   created_shape_ = document_->create_shape(type_, name_);
@@ -125,15 +157,7 @@ DeleteShapeCommand::DeleteShapeCommand(DocumentModel* document,
     : document_(document),
       binder_(binder),
       editor_area_(editor_area),
-      shape_(shape) {
-  if (shape_ != nullptr) {
-    saved_position_ = shape_->position();
-    saved_size_ = shape_->size();
-    saved_rotation_ = shape_->rotation_deg();
-    saved_name_ = shape_->name();
-    saved_type_ = shape_->type();
-  }
-}
+      shape_(shape) {}
 
 auto DeleteShapeCommand::execute() -> bool {
   if (document_ == nullptr || binder_ == nullptr || editor_area_ == nullptr ||
@@ -141,32 +165,29 @@ auto DeleteShapeCommand::execute() -> bool {
     return false;
   }
 
-  // Find item for shape
-  item_ = dynamic_cast<ISceneObject*>(binder_->item_for(shape_));
-  if (item_ == nullptr) {
+  // Undo puts the shape back at this row
+  shape_row_ = document_->row_of(*shape_);
+  if (shape_row_ == ShapeStore::kInvalidRow) {
     return false;
   }
 
-  // Find index in document
-  const auto& shapes = document_->shapes();
-  const auto shape_it = std::find(shapes.begin(), shapes.end(), shape_);
-  if (shape_it == shapes.end()) {
-    return false;
+  // Find item for shape; none if the batched inclusion layer draws it
+  item_ = binder_->object_for(shape_);
+  had_item_ = item_ != nullptr;
+  if (item_ != nullptr) {
+    binder_->unbind_shape(item_);
   }
-  shape_index_ = static_cast<int>(std::distance(shapes.begin(), shape_it));
-
-  // Unbind
-  binder_->unbind_shape(item_);
 
   // Remove from scene
   auto* scene = editor_area_->scene();
-  if (scene != nullptr) {
+  if (scene != nullptr && item_ != nullptr) {
     auto* graphics_item = dynamic_cast<QGraphicsItem*>(item_);
     if (graphics_item != nullptr) {
       scene->removeItem(graphics_item);
       delete graphics_item;
     }
   }
+  item_ = nullptr;
 
   // Remove from document
   document_->remove_shape(shape_);
@@ -179,68 +200,19 @@ auto DeleteShapeCommand::undo() -> bool {
       shape_ == nullptr) {
     return false;
   }
-
-  // Restore shape properties
-  shape_->set_position(saved_position_);
-  shape_->set_size(saved_size_);
-  shape_->set_rotation_deg(saved_rotation_);
-  shape_->set_name(saved_name_);
-  shape_->set_type(saved_type_);
-
-  // Re-add shape to document
-  // Note: We need to manually add it back since DocumentModel doesn't have
-  // insert_at. We'll add it to the end, which is acceptable as order doesn't
-  // matter for shapes. But actually, we can't directly add to shapes_ vector
-  // as it's private. So we need to use a workaround - create a new shape and
-  // copy properties, or add a method to DocumentModel.
-  // For now, let's create a new shape and copy all properties
-  auto restored_shape = document_->create_shape(saved_type_, saved_name_);
-  if (restored_shape == nullptr) {
-    return false;
-  }
-  restored_shape->set_position(saved_position_);
-  restored_shape->set_size(saved_size_);
-  restored_shape->set_rotation_deg(saved_rotation_);
-
-  // Copy material if shape had one
-  if (shape_->material() != nullptr) {
-    restored_shape->assign_material(shape_->material());
-  }
-
-  // Recreate scene item
-  item_ = DocumentController::create_item_for_shape(restored_shape);
-  if (item_ == nullptr) {
-    document_->remove_shape(restored_shape);
-    return false;
-  }
-
-  // Add to scene
-  auto* scene = editor_area_->scene();
-  if (scene == nullptr) {
-    delete item_;
-    document_->remove_shape(restored_shape);
-    return false;
+  // The same shape object, with the values it kept while removed, so that
+  // commands further back in the history still refer to it
+  document_->restore_shapes(std::span(&shape_, 1),
+                            std::span(&shape_row_, 1));
+  if (!had_item_) {
+    return true;  // Drawn by the batched inclusion layer
   }
-
-  auto* graphics_item = dynamic_cast<QGraphicsItem*>(item_);
-  if (graphics_item == nullptr) {
-    delete item_;
-    document_->remove_shape(restored_shape);
-    return false;
-  }
-
-  graphics_item->setPos(saved_position_.x, saved_position_.y);
-  graphics_item->setRotation(saved_rotation_);
-  scene->addItem(graphics_item);
-  binder_->attach_shape(item_, restored_shape);
-
-  // Update shape_ to point to restored shape
-  shape_ = restored_shape;
-  return true;
+  item_ = add_item(*binder_, *editor_area_, shape_);
+  return item_ != nullptr;
 }
 
 auto DeleteShapeCommand::description() const -> std::string {
-  return "Delete " + (saved_name_.empty() ? "Shape" : saved_name_);
+  return "Delete " + (shape_ == nullptr ? "Shape" : shape_->name());
 }
 
 // ModifyShapePropertyCommand
@@ -384,6 +356,21 @@ auto ModifyShapePropertyCommand::description() const -> std::string {
   return "Modify Shape";
 }
 
+namespace {
+bool is_continuous(ModifyShapePropertyCommand::Property property) {
+  using Property = ModifyShapePropertyCommand::Property;
+  return property == Property::kPosition || property == Property::kSize ||
+         property == Property::kRotation || property == Property::kColor;
+}
+}  // namespace
+
+auto ModifyShapePropertyCommand::merge_key() const -> MergeKey {
+  if (shape_ == nullptr || !is_continuous(property_)) {
+    return {};
+  }
+  return {.target = shape_.get(), .property = static_cast<int>(property_)};
+}
+
 auto ModifyShapePropertyCommand::merge_with(const Command& other) -> bool {
   const auto* other_cmd =
     dynamic_cast<const ModifyShapePropertyCommand*>(&other);
@@ -396,122 +383,11 @@ auto ModifyShapePropertyCommand::merge_with(const Command& other) -> bool {
     return false;
   }
 
-  // Only merge certain properties (e.g., position, rotation for dragging)
-  if (property_ == Property::kPosition || property_ == Property::kRotation) {
-    // Update new_value_ to other's new_value_ (we're merging forward)
+  // Keep the oldest value and take the newest (we're merging forward)
+  if (is_continuous(property_)) {
     new_value_ = other_cmd->new_value_;
     return true;
   }
 
   return false;
 }
-
-// ChangeShapeTypeCommand
-ChangeShapeTypeCommand::ChangeShapeTypeCommand(
-  DocumentModel* document, ShapeModelBinder* binder, EditorArea* editor_area,
-  std::shared_ptr<ShapeModel> shape, ShapeModel::ShapeType new_type)
-    : document_(document),
-      binder_(binder),
-      editor_area_(editor_area),
-      shape_(std::move(shape)),
-      new_type_(new_type) {
-  if (shape_ != nullptr) {
-    old_type_ = shape_->type();
-  }
-}
-
-auto ChangeShapeTypeCommand::execute() -> bool {
-  if (document_ == nullptr || binder_ == nullptr || editor_area_ == nullptr ||
-      shape_ == nullptr) {
-    return false;
-  }
-
-  if (shape_->type() == new_type_) {
-    return false;  // No change needed
-  }
-
-  // Find old item
-  old_item_ = dynamic_cast<ISceneObject*>(binder_->item_for(shape_));
-  if (old_item_ == nullptr) {
-    return false;
-  }
-
-  // Get current properties
-  const auto old_size = shape_->size();
-  // const auto old_position = shape_->position();
-  const auto old_rotation = shape_->rotation_deg();
-  const auto old_name = shape_->name();
-
-  // Convert size
-  const auto new_size =
-    DocumentController::convert_shape_size(old_type_, new_type_, old_size);
-
-  // Update model
-  shape_->set_type(new_type_);
-  shape_->set_size(new_size);
-
-  // Use DocumentController to replace the item
-  DocumentController controller;
-  controller.set_document_model(document_);
-  controller.set_shape_binder(binder_);
-  controller.set_editor_area(editor_area_);
-
-  auto* old_graphics_item = dynamic_cast<QGraphicsItem*>(old_item_);
-  if (old_graphics_item == nullptr) {
-    return false;
-  }
-
-  const QPointF center = old_graphics_item->sceneBoundingRect().center();
-  controller.replace_shape_item(old_item_, shape_, center, old_rotation,
-                                QString::fromStdString(old_name));
-
-  // Find new item
-  new_item_ = dynamic_cast<ISceneObject*>(binder_->item_for(shape_));
-
-  return new_item_ != nullptr;
-}
-
-auto ChangeShapeTypeCommand::undo() -> bool {
-  if (document_ == nullptr || binder_ == nullptr || editor_area_ == nullptr ||
-      shape_ == nullptr) {
-    return false;
-  }
-
-  // Get current properties
-  const auto current_size = shape_->size();
-  // const auto current_position = shape_->position();
-  const auto current_rotation = shape_->rotation_deg();
-  const auto current_name = shape_->name();
-
-  // Convert size back
-  const auto restored_size =
-    DocumentController::convert_shape_size(new_type_, old_type_, current_size);
-
-  // Update model
-  shape_->set_type(old_type_);
-  shape_->set_size(restored_size);
-
-  // Use DocumentController to replace the item back
-  DocumentController controller;
-  controller.set_document_model(document_);
-  controller.set_shape_binder(binder_);
-  controller.set_editor_area(editor_area_);
-
-  if (new_item_ != nullptr) {
-    auto* new_graphics_item = dynamic_cast<QGraphicsItem*>(new_item_);
-    if (new_graphics_item != nullptr) {
-      const QPointF center = new_graphics_item->sceneBoundingRect().center();
-      controller.replace_shape_item(new_item_, shape_, center, current_rotation,
-                                    QString::fromStdString(current_name));
-    }
-  }
-
-  // Find old item (should be restored)
-  old_item_ = dynamic_cast<ISceneObject*>(binder_->item_for(shape_));
-
-  return old_item_ != nullptr;
-}
-
-auto ChangeShapeTypeCommand::description() const -> std::string {
-  return "Change Shape Type";
-}
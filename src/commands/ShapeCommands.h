@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstddef>
 #include <memory>
 #include <string>
 #include <variant>
@@ -15,7 +16,8 @@ class ISceneObject;
 class MaterialModel;
 
 /**
- * @brief Command to create a new shape.
+ * @brief Command to create a new shape. Redo brings back the shape created
+ * first.
  */
 class CreateShapeCommand : public Command {
  public:
@@ -38,7 +40,8 @@ class CreateShapeCommand : public Command {
 };
 
 /**
- * @brief Command to delete a shape.
+ * @brief Command to delete a shape. Undo brings back the same shape object
+ * at its row, so its stacking order is unchanged.
  */
 class DeleteShapeCommand : public Command {
  public:
@@ -54,14 +57,11 @@ class DeleteShapeCommand : public Command {
   DocumentModel* document_;
   ShapeModelBinder* binder_;
   EditorArea* editor_area_;
+  // Kept while deleted; it holds its own values until undo brings it back
   std::shared_ptr<ShapeModel> shape_;
   ISceneObject* item_{nullptr};
-  Point2D saved_position_;
-  Size2D saved_size_;
-  double saved_rotation_{0.0};
-  std::string saved_name_;
-  ShapeModel::ShapeType saved_type_;
-  int shape_index_{-1};  // Index in document's shapes vector
+  bool had_item_{false};  // False if the batched inclusion layer drew it
+  size_t shape_row_{ShapeStore::kInvalidRow};  // Row before the deletion
 };
 
 /**
@@ -79,6 +79,11 @@ class ModifyShapePropertyCommand : public Command {
   auto execute() -> bool override;
   auto undo() -> bool override;
   [[nodiscard]] auto description() const -> std::string override;
+  /**
+   * @brief Shape and property for position, size, rotation and color edits,
+   * which arrive continuously from drags and spin boxes.
+   */
+  [[nodiscard]] auto merge_key() const -> MergeKey override;
   auto merge_with(const Command& other) -> bool override;
 
  private:
@@ -91,28 +96,3 @@ class ModifyShapePropertyCommand : public Command {
                std::shared_ptr<MaterialModel>>
     old_value_;
 };
-
-/**
- * @brief Command to change shape type.
- */
-class ChangeShapeTypeCommand : public Command {
- public:
-  ChangeShapeTypeCommand(DocumentModel* document, ShapeModelBinder* binder,
-                         EditorArea* editor_area,
-                         std::shared_ptr<ShapeModel> shape,
-                         ShapeModel::ShapeType new_type);
-
-  auto execute() -> bool override;
-  auto undo() -> bool override;
-  [[nodiscard]] auto description() const -> std::string override;
-
- private:
-  DocumentModel* document_;
-  ShapeModelBinder* binder_;
-  EditorArea* editor_area_;
-  std::shared_ptr<ShapeModel> shape_;
-  ShapeModel::ShapeType new_type_;
-  ShapeModel::ShapeType old_type_;
-  ISceneObject* old_item_{nullptr};
-  ISceneObject* new_item_{nullptr};
-};
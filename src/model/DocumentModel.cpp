@@ -1,43 +1,394 @@
 #include "model/DocumentModel.h"
 
 #include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
 #include <memory>
+#include <numeric>
+#include <span>
 #include <string>
+#include <string_view>
 #include <vector>
 
 #include "model/MaterialModel.h"
+#include "model/ShapeGeometry.h"
 #include "model/ShapeModel.h"
+#include "model/ShapeStore.h"
+#include "model/SpatialIndex.h"
 #include "model/SubstrateModel.h"
 #include "model/core/ModelTypes.h"
 
+namespace {
+using Edit = DocumentModel::Edit;
+
+bool is_shape_edit(Edit::Kind kind) {
+  return kind == Edit::Kind::ShapesAdded || kind == Edit::Kind::ShapesRemoved ||
+         kind == Edit::Kind::ShapesChanged || kind == Edit::Kind::ShapesCleared;
+}
+
+bool is_material_edit(Edit::Kind kind) {
+  return kind == Edit::Kind::MaterialsAdded ||
+         kind == Edit::Kind::MaterialsRemoved ||
+         kind == Edit::Kind::MaterialsChanged ||
+         kind == Edit::Kind::MaterialsCleared;
+}
+
+// Merge edit into the last one when it extends the same range
+bool merge_edit(Edit& last, const Edit& edit) {
+  if (last.kind == Edit::Kind::SubstrateChanged &&
+      edit.kind == Edit::Kind::SubstrateChanged) {
+    return true;
+  }
+  const bool added_row_changed =
+    (last.kind == Edit::Kind::ShapesAdded &&
+     edit.kind == Edit::Kind::ShapesChanged) ||
+    (last.kind == Edit::Kind::MaterialsAdded &&
+     edit.kind == Edit::Kind::MaterialsChanged);
+  if (added_row_changed) {
+    // Rows added in this batch are reported as new anyway
+    return edit.index >= last.index &&
+           edit.index + edit.count <= last.index + last.count;
+  }
+  if (last.kind != edit.kind) {
+    return false;
+  }
+  switch (edit.kind) {
+    case Edit::Kind::ShapesAdded:
+    case Edit::Kind::MaterialsAdded:
+      if (edit.index == last.index + last.count) {
+        last.count += edit.count;
+        return true;
+      }
+      return false;
+    case Edit::Kind::ShapesRemoved:
+    case Edit::Kind::MaterialsRemoved:
+      // Front to back (same row again) or back to front (the row before)
+      if (edit.index == last.index) {
+        last.count += edit.count;
+        return true;
+      }
+      if (edit.index + edit.count == last.index) {
+        last.index = edit.index;
+        last.count += edit.count;
+        return true;
+      }
+      return false;
+    case Edit::Kind::ShapesChanged:
+    case Edit::Kind::MaterialsChanged:
+      if (edit.index <= last.index + last.count &&
+          last.index <= edit.index + edit.count) {
+        const size_t end =
+          std::max(last.index + last.count, edit.index + edit.count);
+        last.index = std::min(last.index, edit.index);
+        last.count = end - last.index;
+        return true;
+      }
+      return false;
+    case Edit::Kind::ShapesCleared:
+    case Edit::Kind::MaterialsCleared:
+    case Edit::Kind::SubstrateChanged:
+      return false;
+  }
+  return false;
+}
+
+void coalesce_edit(std::vector<Edit>& edits, const Edit& edit) {
+  // A clear supersedes the earlier edits of the same list
+  if (edit.kind == Edit::Kind::ShapesCleared ||
+      edit.kind == Edit::Kind::MaterialsCleared) {
+    const auto same_list = edit.kind == Edit::Kind::ShapesCleared
+                             ? is_shape_edit
+                             : is_material_edit;
+    std::erase_if(edits, [same_list](const Edit& earlier) {
+      return same_list(earlier.kind);
+    });
+  } else if (!edits.empty() && merge_edit(edits.back(), edit)) {
+    return;
+  }
+  edits.push_back(edit);
+}
+
+// Move the last rows.size() shapes to rows (ascending), the same way
+// ShapeStore::move_last_rows() moves the columns
+void move_last_shapes(std::vector<std::shared_ptr<ShapeModel>>& shapes,
+                      std::span<const size_t> rows) {
+  std::vector<std::shared_ptr<ShapeModel>> moved(
+    std::make_move_iterator(shapes.end() -
+                            static_cast<std::ptrdiff_t>(rows.size())),
+    std::make_move_iterator(shapes.end()));
+  size_t source = shapes.size() - rows.size();
+  size_t next = rows.size();
+  for (size_t row = shapes.size(); next > 0;) {
+    --row;
+    if (rows[next - 1] == row) {
+      shapes[row] = std::move(moved[--next]);
+    } else {
+      shapes[row] = std::move(shapes[--source]);
+    }
+  }
+}
+}  // namespace
+
 DocumentModel::DocumentModel()
     : substrate_(std::make_shared<SubstrateModel>()) {
-  substrate_->on_changed().connect(
-    [this](const ModelChange& change) { notify_all(change); });
+  connect_substrate();
+}
+
+DocumentModel::~DocumentModel() {
+  // Shapes may outlive the document (e.g. held by undo commands): hand their
+  // values back before the store goes away. Last rows first, so the store
+  // never shifts its columns
+  for (auto shape_it = shapes_.rbegin(); shape_it != shapes_.rend();
+       ++shape_it) {
+    (*shape_it)->detach_from_store();
+  }
 }
 
 auto DocumentModel::create_shape(ShapeModel::ShapeType type,
                                  const std::string& name)
   -> std::shared_ptr<ShapeModel> {
-  auto shape = std::make_shared<ShapeModel>(type);
-  if (!name.empty()) {
-    shape->set_name(name);
-  }
-  shape->on_changed().connect(
-    [this](const ModelChange& change) { notify_all(change); });
+  auto shape = std::make_shared<ShapeModel>();
+  ShapeStore::Record record;
+  record.type = static_cast<uint8_t>(type);
+  shape->attach_to_store(
+    this, record,
+    name.empty() ? ShapeModel::kDefaultName : std::string_view(name));
+  shape_ids_.emplace(shape->id(), shape->store_handle());
+  update_spatial_index(shape.get());
+  connect_shape(shape);
   shapes_.push_back(shape);
+  notify_edit(Edit::Kind::ShapesAdded, shapes_.size() - 1);
   notify_all(ModelChange{ModelChange::Type::Custom, "shape_added"});
   return shape;
 }
 
+auto DocumentModel::create_shapes(std::span<const ShapeStore::Record> records,
+                                  const std::string& name_prefix)
+  -> std::vector<std::shared_ptr<ShapeModel>> {
+  std::string name;
+  return create_named_shapes(records, [&](size_t i) -> std::string_view {
+    name = name_prefix + " " + std::to_string(i + 1);
+    return name;
+  });
+}
+
+auto DocumentModel::create_shapes(std::span<const ShapeStore::Record> records,
+                                  std::span<const std::string_view> names)
+  -> std::vector<std::shared_ptr<ShapeModel>> {
+  return create_named_shapes(records, [names](size_t i) {
+    return i < names.size() ? names[i] : std::string_view{};
+  });
+}
+
+auto DocumentModel::insert_shapes(size_t row,
+                                  std::span<const ShapeStore::Record> records)
+  -> std::vector<std::shared_ptr<ShapeModel>> {
+  return create_named_shapes(
+    records, [](size_t /*index*/) { return std::string_view{}; }, row);
+}
+
+auto DocumentModel::create_named_shapes(
+  std::span<const ShapeStore::Record> records,
+  const std::function<std::string_view(size_t)>& name_for, size_t row)
+  -> std::vector<std::shared_ptr<ShapeModel>> {
+  std::vector<std::shared_ptr<ShapeModel>> created;
+  if (records.empty()) {
+    return created;
+  }
+  const size_t first_row = shapes_.size();
+  created.reserve(records.size());
+  shapes_.reserve(shapes_.size() + records.size());
+  shape_store_.reserve(shape_store_.size() + records.size());
+  // A batch at least as large as the document is cheaper to index in one
+  // pass, which also re-tunes the grid to the new shape sizes
+  const bool rebuild_index = records.size() >= shapes_.size();
+
+  for (size_t i = 0; i < records.size(); ++i) {
+    auto shape = std::make_shared<ShapeModel>();
+    // Not connected yet: fill the values without per-shape notifications
+    shape->attach_to_store(this, records[i], name_for(i));
+    shape_ids_.emplace(shape->id(), shape->store_handle());
+    if (!rebuild_index) {
+      update_spatial_index(shape.get());
+    }
+    connect_shape(shape);
+    shapes_.push_back(shape);
+    created.push_back(std::move(shape));
+  }
+  if (rebuild_index) {
+    spatial_index_.rebuild(shape_store_);
+  }
+  std::vector<size_t> rows;
+  if (row < first_row) {
+    rows.resize(records.size());
+    std::iota(rows.begin(), rows.end(), row);
+  }
+  place_added_shapes(first_row, rows);
+  notify_all(ModelChange{ModelChange::Type::Custom, "shapes_added"});
+  return created;
+}
+
 void DocumentModel::remove_shape(const std::shared_ptr<ShapeModel>& shape) {
-  shapes_.erase(std::remove(shapes_.begin(), shapes_.end(), shape),
-                shapes_.end());
+  const size_t row =
+    shape != nullptr ? row_of(*shape) : ShapeStore::kInvalidRow;
+  if (row != ShapeStore::kInvalidRow) {
+    spatial_index_.remove(shape->store_handle());
+    shape_ids_.erase(shape->id());
+    shape->detach_from_store();
+    shapes_.erase(shapes_.begin() + static_cast<std::ptrdiff_t>(row));
+    notify_edit(Edit::Kind::ShapesRemoved, row);
+  }
   notify_all(ModelChange{ModelChange::Type::Custom, "shape_removed"});
 }
 
+void DocumentModel::remove_shapes(
+  std::span<const std::shared_ptr<ShapeModel>> shapes) {
+  const Batch batch(*this);
+  std::vector<uint8_t> removed(shapes_.size(), 0);
+  std::vector<ShapeStore::Handle> handles;
+  handles.reserve(shapes.size());
+  for (const auto& shape : shapes) {
+    const size_t row =
+      shape != nullptr ? row_of(*shape) : ShapeStore::kInvalidRow;
+    if (row == ShapeStore::kInvalidRow || removed[row] != 0) {
+      continue;
+    }
+    removed[row] = 1;
+    spatial_index_.remove(shape->store_handle());
+    shape_ids_.erase(shape->id());
+    handles.push_back(shape->release_store_row());
+  }
+  if (handles.empty()) {
+    return;
+  }
+  shape_store_.erase(handles);
+  // shapes may view shapes_ itself: it is not read from here on
+  size_t kept = 0;
+  for (size_t row = 0; row < shapes_.size(); ++row) {
+    if (removed[row] == 0) {
+      shapes_[kept++] = std::move(shapes_[row]);
+    }
+  }
+  shapes_.resize(kept);
+
+  // Runs of removed rows back to front, so that every range holds the rows
+  // as they were when it was erased
+  for (size_t end = removed.size(); end > 0;) {
+    if (removed[end - 1] == 0) {
+      --end;
+      continue;
+    }
+    size_t begin = end - 1;
+    while (begin > 0 && removed[begin - 1] != 0) {
+      --begin;
+    }
+    notify_edit(Edit::Kind::ShapesRemoved, begin, end - begin);
+    end = begin;
+  }
+  notify_all(ModelChange{ModelChange::Type::Custom, "shapes_removed"});
+}
+
+void DocumentModel::restore_shapes(
+  std::span<const std::shared_ptr<ShapeModel>> shapes,
+  std::span<const size_t> rows) {
+  const Batch batch(*this);
+  const bool at_rows = !rows.empty() && rows.size() == shapes.size();
+  const size_t first_row = shapes_.size();
+  std::vector<size_t> targets;
+  shapes_.reserve(shapes_.size() + shapes.size());
+  shape_store_.reserve(shape_store_.size() + shapes.size());
+  for (size_t i = 0; i < shapes.size(); ++i) {
+    const auto& shape = shapes[i];
+    if (shape == nullptr || shape->store_handle().is_valid()) {
+      continue;
+    }
+    // Takes up a preset the document lists again, wherever it is now
+    shape->attach_to_store(this);
+    shape_ids_.emplace(shape->id(), shape->store_handle());
+    update_spatial_index(shape.get());
+    // Still connected: removal does not disconnect a shape
+    shapes_.push_back(shape);
+    if (at_rows) {
+      // Kept ascending and within the document, which may have fewer rows
+      // than at the removal
+      size_t row = std::min(rows[i], shapes_.size() - 1);
+      if (!targets.empty()) {
+        row = std::max(row, targets.back() + 1);
+      }
+      targets.push_back(row);
+    }
+  }
+  if (shapes_.size() == first_row) {
+    return;
+  }
+  place_added_shapes(first_row, targets);
+  notify_all(ModelChange{ModelChange::Type::Custom, "shapes_added"});
+}
+
+void DocumentModel::place_added_shapes(size_t first_row,
+                                       std::span<const size_t> rows) {
+  const size_t count = shapes_.size() - first_row;
+  if (rows.size() != count || rows.front() == first_row) {
+    // Already in place at the end
+    notify_edit(Edit::Kind::ShapesAdded, first_row, count);
+    return;
+  }
+  shape_store_.move_last_rows(rows);
+  move_last_shapes(shapes_, rows);
+  // Runs of consecutive rows front to back: the runs before a run are in
+  // place and the ones after it come later in the document, so each run
+  // reports the rows it has at that point
+  for (size_t begin = 0; begin < rows.size();) {
+    size_t end = begin + 1;
+    while (end < rows.size() && rows[end] == rows[end - 1] + 1) {
+      ++end;
+    }
+    notify_edit(Edit::Kind::ShapesAdded, rows[begin], end - begin);
+    begin = end;
+  }
+}
+
+void DocumentModel::set_shape_records(
+  std::span<const std::shared_ptr<ShapeModel>> shapes,
+  std::span<const ShapeStore::Record> records) {
+  const Batch batch(*this);
+  const size_t count = std::min(shapes.size(), records.size());
+  // Half the document or more is cheaper to index again in one pass
+  defer_spatial_index_ = 2 * count >= shapes_.size();
+  for (size_t i = 0; i < count; ++i) {
+    ShapeModel* shape = shapes[i].get();
+    if (shape == nullptr || !shape_store_.contains(shape->store_handle())) {
+      continue;
+    }
+    const ShapeModel::RecordChange change = shape->write_record(records[i]);
+    // The same notifications as set_type() and set_position() & co., one
+    // per shape and kind rather than per field
+    if (change.type) {
+      shape->notify_change(ModelChange{ModelChange::Type::Custom, "type"});
+    }
+    if (change.geometry) {
+      shape->notify_change(
+        ModelChange{ModelChange::Type::GeometryChanged, "geometry"});
+    }
+  }
+  if (defer_spatial_index_) {
+    defer_spatial_index_ = false;
+    spatial_index_.rebuild(shape_store_);
+  }
+}
+
 void DocumentModel::clear_shapes() {
+  for (auto shape_it = shapes_.rbegin(); shape_it != shapes_.rend();
+       ++shape_it) {
+    (*shape_it)->detach_from_store();
+  }
   shapes_.clear();
+  shape_ids_.clear();
+  shape_store_.clear();
+  spatial_index_.clear();
+  notify_edit(Edit::Kind::ShapesCleared);
   notify_all(ModelChange{ModelChange::Type::Custom, "shapes_cleared"});
 }
 
@@ -47,9 +398,14 @@ auto DocumentModel::create_material(const Color& color, const std::string& name)
   if (!name.empty()) {
     material->set_name(name);
   }
+  MaterialModel* material_ptr = material.get();
   material->on_changed().connect(
-    [this](const ModelChange& change) { notify_all(change); });
+    [this, material_ptr](const ModelChange& change) {
+      on_material_changed(material_ptr, change);
+    });
   materials_.push_back(material);
+  material_ids_.emplace(material->id(), materials_.size() - 1);
+  notify_edit(Edit::Kind::MaterialsAdded, materials_.size() - 1);
   notify_all(ModelChange{ModelChange::Type::Custom, "material_added"});
   return material;
 }
@@ -60,23 +416,267 @@ void DocumentModel::set_substrate(
     return;  // Invalid substrate, ignore
   }
   substrate_ = substrate;
-  substrate_->on_changed().connect(
-    [this](const ModelChange& change) { notify_all(change); });
+  connect_substrate();
+  notify_edit(Edit::Kind::SubstrateChanged);
   notify_all(ModelChange{ModelChange::Type::Custom, "substrate_changed"});
 }
 
 void DocumentModel::remove_material(
   const std::shared_ptr<MaterialModel>& material) {
-  materials_.erase(std::remove(materials_.begin(), materials_.end(), material),
-                   materials_.end());
+  const int32_t index = material != nullptr ? material_index(*material) : -1;
+  if (index < 0) {
+    notify_all(ModelChange{ModelChange::Type::Custom, "material_removed"});
+    return;
+  }
+  // Shapes keep a removed preset, so that undoing the removal gives it back.
+  // Holding it is reported as a change of the shape: journal replay has to
+  // see the shape's material values, not just the index shift
+  Batch batch(*this);
+  const std::span<const int32_t> indices = shape_store_.material_indices();
+  for (size_t row = 0; row < shapes_.size(); ++row) {
+    if (indices[row] == index) {
+      shapes_[row]->hold_preset();
+      notify_edit(Edit::Kind::ShapesChanged, row);
+    } else if (indices[row] > index) {
+      shape_store_.set_material_index(shapes_[row]->store_handle(),
+                                      indices[row] - 1);
+    }
+  }
+  materials_.erase(materials_.begin() + index);
+  reindex_materials();
+  notify_edit(Edit::Kind::MaterialsRemoved, static_cast<size_t>(index));
   notify_all(ModelChange{ModelChange::Type::Custom, "material_removed"});
 }
 
+void DocumentModel::restore_material(
+  const std::shared_ptr<MaterialModel>& material) {
+  if (material == nullptr || material_index(*material) >= 0) {
+    return;
+  }
+  Batch batch(*this);
+  // Still connected: removal does not disconnect a material
+  materials_.push_back(material);
+  material_ids_.emplace(material->id(), materials_.size() - 1);
+  notify_edit(Edit::Kind::MaterialsAdded, materials_.size() - 1);
+  for (size_t row = 0; row < shapes_.size(); ++row) {
+    if (shapes_[row]->release_preset()) {
+      notify_edit(Edit::Kind::ShapesChanged, row);
+    }
+  }
+  notify_all(ModelChange{ModelChange::Type::Custom, "material_added"});
+}
+
 void DocumentModel::clear_materials() {
+  Batch batch(*this);
+  for (size_t row = 0; row < shapes_.size(); ++row) {
+    if (shapes_[row]->hold_preset()) {
+      notify_edit(Edit::Kind::ShapesChanged, row);
+    }
+  }
   materials_.clear();
+  material_ids_.clear();
+  notify_edit(Edit::Kind::MaterialsCleared);
   notify_all(ModelChange{ModelChange::Type::Custom, "materials_cleared"});
 }
 
+auto DocumentModel::find_shape(ModelObject::Id id) const
+  -> std::shared_ptr<ShapeModel> {
+  const auto id_it = shape_ids_.find(id);
+  return id_it != shape_ids_.end() ? shape_for(id_it->second) : nullptr;
+}
+
+auto DocumentModel::shape_for(ShapeStore::Handle handle) const
+  -> std::shared_ptr<ShapeModel> {
+  const size_t row = shape_store_.row_of(handle);
+  return row < shapes_.size() ? shapes_[row] : nullptr;
+}
+
+auto DocumentModel::row_of(const ShapeModel& shape) const -> size_t {
+  // The handle may come from another document's store
+  const size_t row = shape_store_.row_of(shape.store_handle());
+  if (row < shapes_.size() && shapes_[row].get() == &shape) {
+    return row;
+  }
+  return ShapeStore::kInvalidRow;
+}
+
+auto DocumentModel::find_material(ModelObject::Id id) const
+  -> std::shared_ptr<MaterialModel> {
+  const auto id_it = material_ids_.find(id);
+  return id_it != material_ids_.end() ? materials_[id_it->second] : nullptr;
+}
+
+auto DocumentModel::material_index(const MaterialModel& material) const
+  -> int32_t {
+  const auto id_it = material_ids_.find(material.id());
+  if (id_it == material_ids_.end()) {
+    return -1;
+  }
+  return static_cast<int32_t>(id_it->second);
+}
+
 void DocumentModel::notify_all(const ModelChange& change) {
+  if (batch_depth_ > 0) {
+    batch_changed_ = true;
+    batch_last_change_ = change;
+    return;
+  }
   changed_signal_.emit_signal(change);
 }
+
+void DocumentModel::notify_edit(Edit::Kind kind, size_t index, size_t count) {
+  const Edit edit{.kind = kind, .index = index, .count = count};
+  edit_signal_.emit_signal(edit);
+  if (batch_depth_ == 0) {
+    changes_signal_.emit_signal(std::span<const Edit>(&edit, 1));
+    return;
+  }
+  if (kind != Edit::Kind::ShapesChanged &&
+      kind != Edit::Kind::MaterialsChanged &&
+      kind != Edit::Kind::SubstrateChanged) {
+    batch_structure_changed_ = true;
+  }
+  coalesce_edit(batch_edits_, edit);
+}
+
+void DocumentModel::begin_batch() {
+  ++batch_depth_;
+}
+
+void DocumentModel::commit_batch() {
+  if (batch_depth_ == 0 || --batch_depth_ > 0) {
+    return;
+  }
+  const std::vector<Edit> edits = std::move(batch_edits_);
+  batch_edits_.clear();
+  const bool changed = batch_changed_;
+  const bool structure_changed = batch_structure_changed_;
+  const ModelChange last_change = std::move(batch_last_change_);
+  batch_changed_ = false;
+  batch_structure_changed_ = false;
+  batch_last_change_ = ModelChange{};
+
+  if (!edits.empty()) {
+    changes_signal_.emit_signal(std::span<const Edit>(edits));
+  }
+  if (structure_changed) {
+    changed_signal_.emit_signal(
+      ModelChange{ModelChange::Type::Custom, "batch"});
+  } else if (changed) {
+    changed_signal_.emit_signal(last_change);
+  }
+}
+
+void DocumentModel::on_material_changed(const MaterialModel* material,
+                                        const ModelChange& change) {
+  // Removed materials may still be edited (e.g. held by undo commands)
+  const int32_t index = material_index(*material);
+  if (index >= 0) {
+    notify_edit(Edit::Kind::MaterialsChanged, static_cast<size_t>(index));
+  }
+  notify_all(change);
+}
+
+void DocumentModel::connect_substrate() {
+  const SubstrateModel* substrate_ptr = substrate_.get();
+  substrate_->on_changed().connect(
+    [this, substrate_ptr](const ModelChange& change) {
+      if (substrate_ptr == substrate_.get()) {
+        notify_edit(Edit::Kind::SubstrateChanged);
+      }
+      notify_all(change);
+    });
+}
+
+void DocumentModel::connect_shape(const std::shared_ptr<ShapeModel>& shape) {
+  ShapeModel* shape_ptr = shape.get();
+  shape->on_changed().connect([this, shape_ptr](const ModelChange& change) {
+    on_shape_changed(shape_ptr, change);
+  });
+}
+
+void DocumentModel::on_shape_changed(ShapeModel* shape,
+                                     const ModelChange& change) {
+  if (!defer_spatial_index_ &&
+      (change.type == ModelChange::Type::GeometryChanged ||
+       change.type == ModelChange::Type::SizeChanged ||
+       change.property == "type")) {
+    update_spatial_index(shape);
+  }
+  // Shapes removed from the document may still be edited (e.g. held by undo
+  // commands); they have no row
+  if (shape->store_handle().is_valid()) {
+    notify_edit(Edit::Kind::ShapesChanged,
+                shape_store_.row_of(shape->store_handle()));
+  }
+  notify_all(change);
+}
+
+void DocumentModel::reindex_materials() {
+  material_ids_.clear();
+  for (size_t index = 0; index < materials_.size(); ++index) {
+    material_ids_.emplace(materials_[index]->id(), index);
+  }
+}
+
+void DocumentModel::update_spatial_index(const ShapeModel* shape) {
+  const ShapeFrame frame = ShapeGeometry::make_frame(
+    static_cast<uint8_t>(shape->type()), shape->position(), shape->size(),
+    shape->rotation_deg());
+  if (spatial_index_.contains(shape->store_handle())) {
+    spatial_index_.update(shape->store_handle(), frame);
+  } else {
+    spatial_index_.insert(shape->store_handle(), frame);
+  }
+}
+
+auto DocumentModel::shapes_for(const std::vector<SpatialIndex::Handle>& handles,
+                               bool document_order) const
+  -> std::vector<std::shared_ptr<ShapeModel>> {
+  std::vector<size_t> rows;
+  rows.reserve(handles.size());
+  for (const auto& handle : handles) {
+    const size_t row = shape_store_.row_of(handle);
+    if (row < shapes_.size()) {
+      rows.push_back(row);
+    }
+  }
+  if (document_order) {
+    std::sort(rows.begin(), rows.end());
+  }
+  std::vector<std::shared_ptr<ShapeModel>> result;
+  result.reserve(rows.size());
+  for (const size_t row : rows) {
+    result.push_back(shapes_[row]);
+  }
+  return result;
+}
+
+auto DocumentModel::shapes_in_rect(const Aabb& rect) const
+  -> std::vector<std::shared_ptr<ShapeModel>> {
+  return shapes_for(spatial_index_.query_box(rect), true);
+}
+
+auto DocumentModel::shapes_at(const Point2D& point) const
+  -> std::vector<std::shared_ptr<ShapeModel>> {
+  return shapes_for(spatial_index_.query_point(point), true);
+}
+
+auto DocumentModel::shape_at(const Point2D& point) const
+  -> std::shared_ptr<ShapeModel> {
+  // Later shapes are drawn on top
+  size_t top_row = ShapeStore::kInvalidRow;
+  for (const auto& handle : spatial_index_.query_point(point)) {
+    const size_t row = shape_store_.row_of(handle);
+    if (row < shapes_.size() &&
+        (top_row == ShapeStore::kInvalidRow || row > top_row)) {
+      top_row = row;
+    }
+  }
+  return top_row != ShapeStore::kInvalidRow ? shapes_[top_row] : nullptr;
+}
+
+auto DocumentModel::nearest_shapes(const Point2D& point, size_t count) const
+  -> std::vector<std::shared_ptr<ShapeModel>> {
+  return shapes_for(spatial_index_.nearest(point, count), false);
+}
@@ -1,10 +1,20 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
+#include <functional>
 #include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
 #include <vector>
 
 #include "model/MaterialModel.h"
+#include "model/ShapeGeometry.h"
 #include "model/ShapeModel.h"
+#include "model/ShapeStore.h"
+#include "model/SpatialIndex.h"
 #include "model/SubstrateModel.h"
 #include "model/core/ModelObject.h"
 #include "model/core/Signal.h"
@@ -12,18 +22,123 @@
 class DocumentModel {
  public:
   DocumentModel();
+  ~DocumentModel();
+
+  DocumentModel(const DocumentModel&) = delete;
+  DocumentModel& operator=(const DocumentModel&) = delete;
 
   auto create_shape(ShapeModel::ShapeType type, const std::string& name = {})
     -> std::shared_ptr<ShapeModel>;
+  /**
+   * @brief Bulk insert: create one shape per record with a single
+   * "shapes_added" notification.
+   *
+   * Records carry type, geometry and the preset material index (-1 keeps the
+   * default custom material). Shapes are named "<name_prefix> <n>". Geometry
+   * the setters would reject (non-finite values, sizes that are not
+   * positive) is replaced by the defaults; rotations are normalized to
+   * [0, 360) like set_rotation_deg() does.
+   */
+  auto create_shapes(std::span<const ShapeStore::Record> records,
+                     const std::string& name_prefix = "Inclusion")
+    -> std::vector<std::shared_ptr<ShapeModel>>;
+  /**
+   * @brief Bulk insert with one name per record (used by the loaders).
+   */
+  auto create_shapes(std::span<const ShapeStore::Record> records,
+                     std::span<const std::string_view> names)
+    -> std::vector<std::shared_ptr<ShapeModel>>;
+  /**
+   * @brief Bulk insert of unnamed shapes at @p row (clamped to the end); the
+   * shapes from there on move down (used by the journal replay).
+   */
+  auto insert_shapes(size_t row, std::span<const ShapeStore::Record> records)
+    -> std::vector<std::shared_ptr<ShapeModel>>;
+  /**
+   * @brief Remove one shape. Finding it is constant time; the rows after it
+   * move up to keep document order, so the removal is linear in their
+   * number. Remove many shapes with remove_shapes().
+   */
   void remove_shape(const std::shared_ptr<ShapeModel>& shape);
+  /**
+   * @brief Bulk removal in one pass over the document (linear in its size,
+   * not per shape), notified as one batch. Shapes that are not in the
+   * document are skipped.
+   */
+  void remove_shapes(std::span<const std::shared_ptr<ShapeModel>> shapes);
+  /**
+   * @brief Bulk re-insert of shapes removed from this document (e.g. by an
+   * undone deletion), notified as one batch. The shapes keep their identity
+   * and values; shapes that are already in a document are skipped.
+   *
+   * @param rows Row each shape had before it was removed, ascending (shapes
+   * sorted by row). The shapes go back to these rows, so the stacking order
+   * is the same as before the removal; rows past the end are clamped. Without
+   * rows, or with a count that does not match, the shapes are appended.
+   */
+  void restore_shapes(std::span<const std::shared_ptr<ShapeModel>> shapes,
+                      std::span<const size_t> rows = {});
+  /**
+   * @brief Bulk edit: give shapes[i] the type and geometry of records[i] (not
+   * the material index) in one pass, notified as one batch. The spatial index
+   * is rebuilt once when the edit covers a large part of the document. Shapes
+   * that are not in the document are skipped.
+   */
+  void set_shape_records(std::span<const std::shared_ptr<ShapeModel>> shapes,
+                         std::span<const ShapeStore::Record> records);
   void clear_shapes();
   const std::vector<std::shared_ptr<ShapeModel>>& shapes() const {
     return shapes_;
   }
 
+  /**
+   * @brief Columnar view of all shapes; row i corresponds to shapes()[i].
+   */
+  const ShapeStore& shape_store() const {
+    return shape_store_;
+  }
+
+  /**
+   * @brief Constant-time lookups. Objects that are not (or no longer) in this
+   * document give nullptr, ShapeStore::kInvalidRow or -1.
+   */
+  auto find_shape(ModelObject::Id id) const -> std::shared_ptr<ShapeModel>;
+  auto shape_for(ShapeStore::Handle handle) const
+    -> std::shared_ptr<ShapeModel>;
+  auto row_of(const ShapeModel& shape) const -> size_t;
+  auto find_material(ModelObject::Id id) const
+    -> std::shared_ptr<MaterialModel>;
+  auto material_index(const MaterialModel& material) const -> int32_t;
+
+  /**
+   * @brief Spatial index over all shapes, kept up to date on every geometry
+   * change.
+   */
+  const SpatialIndex& spatial_index() const {
+    return spatial_index_;
+  }
+  // Shape lookups through the spatial index (results in document order)
+  auto shapes_in_rect(const Aabb& rect) const
+    -> std::vector<std::shared_ptr<ShapeModel>>;
+  auto shapes_at(const Point2D& point) const
+    -> std::vector<std::shared_ptr<ShapeModel>>;
+  // Topmost (last drawn) shape containing the point, or nullptr
+  auto shape_at(const Point2D& point) const -> std::shared_ptr<ShapeModel>;
+  // Up to count shapes, nearest outline first
+  auto nearest_shapes(const Point2D& point, size_t count) const
+    -> std::vector<std::shared_ptr<ShapeModel>>;
+
   auto create_material(const Color& color = {}, const std::string& name = {})
     -> std::shared_ptr<MaterialModel>;
   void remove_material(const std::shared_ptr<MaterialModel>& material);
+  /**
+   * @brief Re-add a material removed from this document (e.g. by an undone
+   * deletion), keeping its identity: shapes that still refer to it get their
+   * preset back. Appended like create_material(); the shapes are reported as
+   * changed (Edit::Kind::ShapesChanged), as they are when removing a
+   * material makes them hold it.
+   */
+  void restore_material(const std::shared_ptr<MaterialModel>& material);
   void clear_materials();
   const std::vector<std::shared_ptr<MaterialModel>>& materials() const {
     return materials_;
@@ -39,11 +154,121 @@ class DocumentModel {
     return changed_signal_;
   }
 
+  /**
+   * @brief Edit with the rows it touches, for observers that follow the
+   * document incrementally (the object tree, the change journal).
+   *
+   * Rows and indices are taken at the time of the edit: a removal reports the
+   * rows the shapes had before they were erased.
+   */
+  struct Edit {
+    enum class Kind : uint8_t {
+      ShapesAdded,    // Rows [index, index + count)
+      ShapesRemoved,  // Rows [index, index + count)
+      ShapesChanged,  // Rows [index, index + count)
+      ShapesCleared,
+      MaterialsAdded,    // Material indices [index, index + count)
+      MaterialsRemoved,  // Material indices [index, index + count)
+      MaterialsChanged,  // Material indices [index, index + count)
+      MaterialsCleared,
+      SubstrateChanged
+    };
+
+    Kind kind;
+    size_t index{0};
+    size_t count{0};
+  };
+  /**
+   * @brief Every single edit as it happens, batch or not (one row each).
+   */
+  using EditSignal = Signal<const Edit&>;
+  EditSignal& on_edit() {
+    return edit_signal_;
+  }
+  /**
+   * @brief Edits in order, coalesced into ranges: once per batch, or once per
+   * edit outside a batch.
+   */
+  using ChangesSignal = Signal<std::span<const Edit>>;
+  ChangesSignal& on_changes() {
+    return changes_signal_;
+  }
+
+  /**
+   * @brief Group mutations into one notification.
+   *
+   * Until the outermost commit_batch(), on_changed() and on_changes() stay
+   * silent; the commit then emits the coalesced edits once through
+   * on_changes() and a single on_changed() ("batch" when shapes or materials
+   * were added or removed). Batches nest.
+   */
+  void begin_batch();
+  void commit_batch();
+
+  /**
+   * @brief Scoped begin_batch() / commit_batch().
+   */
+  class Batch {
+   public:
+    explicit Batch(DocumentModel& document) : document_(document) {
+      document_.begin_batch();
+    }
+    ~Batch() {
+      document_.commit_batch();
+    }
+
+    Batch(const Batch&) = delete;
+    Batch& operator=(const Batch&) = delete;
+
+   private:
+    DocumentModel& document_;
+  };
+
  private:
+  // Shapes view their row in shape_store_
+  friend class ShapeModel;
+
   void notify_all(const ModelChange& change);
+  void notify_edit(Edit::Kind kind, size_t index = 0, size_t count = 1);
+  void on_material_changed(const MaterialModel* material,
+                           const ModelChange& change);
+  void connect_substrate();
+  void connect_shape(const std::shared_ptr<ShapeModel>& shape);
+  void on_shape_changed(ShapeModel* shape, const ModelChange& change);
+  void reindex_materials();
+  void update_spatial_index(const ShapeModel* shape);
+  auto create_named_shapes(
+    std::span<const ShapeStore::Record> records,
+    const std::function<std::string_view(size_t)>& name_for,
+    size_t row = ShapeStore::kInvalidRow)
+    -> std::vector<std::shared_ptr<ShapeModel>>;
+  // Move the shapes appended from first_row on to rows (empty: leave them at
+  // the end) and report them as added
+  void place_added_shapes(size_t first_row, std::span<const size_t> rows);
+  auto shapes_for(const std::vector<SpatialIndex::Handle>& handles,
+                  bool document_order) const
+    -> std::vector<std::shared_ptr<ShapeModel>>;
 
+  // Declared before shapes_ so that rows outlive the views pointing at them
+  ShapeStore shape_store_;
+  SpatialIndex spatial_index_;
   std::vector<std::shared_ptr<ShapeModel>> shapes_;
   std::vector<std::shared_ptr<MaterialModel>> materials_;
+  // Id lookups: shapes by their stable store handle, materials by index
+  std::unordered_map<ModelObject::Id, ShapeStore::Handle> shape_ids_;
+  std::unordered_map<ModelObject::Id, size_t> material_ids_;
   std::shared_ptr<SubstrateModel> substrate_;
   DocumentSignal changed_signal_;
+  EditSignal edit_signal_;
+  ChangesSignal changes_signal_;
+
+  // Open batch: nesting depth, coalesced edits and the suppressed
+  // on_changed() notifications
+  int batch_depth_{0};
+  std::vector<Edit> batch_edits_;
+  bool batch_changed_{false};
+  bool batch_structure_changed_{false};
+  ModelChange batch_last_change_;
+  // Set while set_shape_records() rebuilds the spatial index afterwards
+  bool defer_spatial_index_{false};
 };
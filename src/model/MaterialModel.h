@@ -3,7 +3,7 @@
 #include "model/core/ModelObject.h"
 #include "model/core/ModelTypes.h"
 
-class MaterialModel : public ModelObject {
+class MaterialModel : public NamedModelObject {
  public:
   enum class GridType {
     None,     // No grid
@@ -3,6 +3,8 @@
 #include <QIcon>
 #include <QVariant>
 #include <QtGlobal>
+#include <cstdint>
+#include <span>
 #include <vector>
 
 #include "model/DocumentModel.h"
@@ -10,23 +12,14 @@
 #include "model/ShapeModel.h"
 #include "ui/editor/SubstrateItem.h"
 
-ObjectTreeModel::ObjectTreeModel(QObject* parent) : QAbstractItemModel(parent) {
-  // Initialize root node structure
-  root_node_.data = nullptr;
-  inclusions_node_.data = nullptr;
-  materials_node_.data = nullptr;
-}
+ObjectTreeModel::ObjectTreeModel(QObject* parent)
+    : QAbstractItemModel(parent) {}
 
 ObjectTreeModel::~ObjectTreeModel() {
   if (document_ != nullptr && document_connection_ != 0) {
-    document_->on_changed().disconnect(document_connection_);
+    document_->on_changes().disconnect(document_connection_);
     document_connection_ = 0;
   }
-
-  qDeleteAll(shape_nodes_);
-  shape_nodes_.clear();
-  qDeleteAll(material_nodes_);
-  material_nodes_.clear();
 }
 
 void ObjectTreeModel::set_substrate(SubstrateItem* substrate) {
@@ -39,29 +32,156 @@ void ObjectTreeModel::set_document(DocumentModel* document) {
   if (document_ == document) {
     return;
   }
+  beginResetModel();
   if (document_ != nullptr && document_connection_ != 0) {
-    document_->on_changed().disconnect(document_connection_);
+    document_->on_changes().disconnect(document_connection_);
     document_connection_ = 0;
   }
   document_ = document;
   if (document_ != nullptr) {
-    document_connection_ =
-      document_->on_changed().connect([this](const ModelChange& change) {
-        if (change.type != ModelChange::Type::Custom) {
-          return;
-        }
-        qDeleteAll(shape_nodes_);
-        shape_nodes_.clear();
-        qDeleteAll(material_nodes_);
-        material_nodes_.clear();
-        beginResetModel();
-        endResetModel();
+    document_connection_ = document_->on_changes().connect(
+      [this](std::span<const DocumentModel::Edit> edits) {
+        on_document_changes(edits);
       });
   }
+  shape_row_count_ = document_shape_count();
+  material_row_count_ = document_material_count();
+  endResetModel();
+}
+
+void ObjectTreeModel::on_document_changes(
+  std::span<const DocumentModel::Edit> edits) {
+  for (const auto& edit : edits) {
+    if (!apply_edit(edit)) {
+      reset_rows();
+      return;
+    }
+  }
+  if (shape_row_count_ != document_shape_count() ||
+      material_row_count_ != document_material_count()) {
+    reset_rows();
+  }
+}
+
+bool ObjectTreeModel::apply_edit(const DocumentModel::Edit& edit) {
+  using Kind = DocumentModel::Edit::Kind;
+  switch (edit.kind) {
+    case Kind::ShapesAdded:
+      return insert_rows(inclusions_node(), shape_row_count_, edit.index,
+                         edit.count);
+    case Kind::ShapesRemoved:
+      return remove_rows(inclusions_node(), shape_row_count_, edit.index,
+                         edit.count);
+    case Kind::ShapesChanged:
+      return change_rows(inclusions_node(), shape_row_count_, edit.index,
+                         edit.count);
+    case Kind::ShapesCleared:
+      return remove_rows(inclusions_node(), shape_row_count_, 0,
+                         static_cast<size_t>(shape_row_count_));
+    case Kind::MaterialsAdded:
+      return insert_rows(materials_node(), material_row_count_, edit.index,
+                         edit.count);
+    case Kind::MaterialsRemoved:
+      return remove_rows(materials_node(), material_row_count_, edit.index,
+                         edit.count);
+    case Kind::MaterialsChanged:
+      return change_rows(materials_node(), material_row_count_, edit.index,
+                         edit.count);
+    case Kind::MaterialsCleared:
+      return remove_rows(materials_node(), material_row_count_, 0,
+                         static_cast<size_t>(material_row_count_));
+    case Kind::SubstrateChanged:
+      return true;  // The substrate is not part of the tree
+  }
+  return true;
+}
+
+bool ObjectTreeModel::insert_rows(TreeNode* group, int& row_count,
+                                  size_t first, size_t count) {
+  if (count == 0) {
+    return true;
+  }
+  if (first > static_cast<size_t>(row_count)) {
+    return false;
+  }
+  const int row = static_cast<int>(first);
+  const QModelIndex parent =
+    create_index_for_node(group, group == inclusions_node() ? 0 : 1, 0);
+  beginInsertRows(parent, row, row + static_cast<int>(count) - 1);
+  row_count += static_cast<int>(count);
+  endInsertRows();
+  return true;
+}
+
+bool ObjectTreeModel::remove_rows(TreeNode* group, int& row_count,
+                                  size_t first, size_t count) {
+  if (count == 0) {
+    return true;
+  }
+  if (first > static_cast<size_t>(row_count) ||
+      count > static_cast<size_t>(row_count) - first) {
+    return false;
+  }
+  const int row = static_cast<int>(first);
+  const QModelIndex parent =
+    create_index_for_node(group, group == inclusions_node() ? 0 : 1, 0);
+  beginRemoveRows(parent, row, row + static_cast<int>(count) - 1);
+  row_count -= static_cast<int>(count);
+  endRemoveRows();
+  return true;
+}
+
+bool ObjectTreeModel::change_rows(TreeNode* group, int row_count,
+                                  size_t first, size_t count) {
+  if (count == 0) {
+    return true;
+  }
+  if (first > static_cast<size_t>(row_count) ||
+      count > static_cast<size_t>(row_count) - first) {
+    return false;
+  }
+  TreeNode* item_node = group == inclusions_node() ? inclusion_item_node()
+                                                   : material_item_node();
+  const int row = static_cast<int>(first);
+  emit dataChanged(create_index_for_node(item_node, row, 0),
+                   create_index_for_node(item_node,
+                                         row + static_cast<int>(count) - 1, 0),
+                   {Qt::DisplayRole});
+  return true;
+}
+
+void ObjectTreeModel::reset_rows() {
   beginResetModel();
+  shape_row_count_ = document_shape_count();
+  material_row_count_ = document_material_count();
   endResetModel();
 }
 
+int ObjectTreeModel::document_shape_count() const {
+  return document_ != nullptr ? static_cast<int>(document_->shapes().size())
+                              : 0;
+}
+
+int ObjectTreeModel::document_material_count() const {
+  return document_ != nullptr
+           ? static_cast<int>(document_->materials().size())
+           : 0;
+}
+
+ShapeModel* ObjectTreeModel::shape_at(int row) const {
+  if (document_ == nullptr || row < 0 || row >= document_shape_count()) {
+    return nullptr;
+  }
+  return document_->shapes()[row].get();
+}
+
+MaterialModel* ObjectTreeModel::material_at(int row) const {
+  if (document_ == nullptr || row < 0 || row >= document_material_count()) {
+    return nullptr;
+  }
+  return document_->materials()[row].get();
+}
+
 TreeNode* ObjectTreeModel::node_from_index(const QModelIndex& index) const {
   if (!index.isValid()) {
     return root_node();
@@ -94,43 +214,15 @@ QModelIndex ObjectTreeModel::index(int row, int column,
   }
 
   if (parent_node == inclusions_node()) {
-    const auto& shapes = document_ != nullptr
-                           ? document_->shapes()
-                           : std::vector<std::shared_ptr<ShapeModel>>{};
-    if (document_ == nullptr) {
-      return {};
-    }
-    if (row >= 0 && row < static_cast<int>(shapes.size())) {
-      ShapeModel* shape_ptr = shapes[row].get();
-      TreeNode* item_node =
-        const_cast<ObjectTreeModel*>(this)->shape_nodes_.value(shape_ptr,
-                                                               nullptr);
-      if (item_node == nullptr) {
-        item_node = new TreeNode(TreeNode::InclusionItem, shape_ptr);
-        const_cast<ObjectTreeModel*>(this)->shape_nodes_.insert(shape_ptr,
-                                                                item_node);
-      }
-      return create_index_for_node(item_node, row, column);
+    if (row < shape_row_count_) {
+      return create_index_for_node(inclusion_item_node(), row, column);
     }
     return {};
   }
 
   if (parent_node == materials_node()) {
-    if (document_ == nullptr) {
-      return {};
-    }
-    const auto& materials = document_->materials();
-    if (row >= 0 && row < static_cast<int>(materials.size())) {
-      MaterialModel* material_ptr = materials[row].get();
-      TreeNode* material_node =
-        const_cast<ObjectTreeModel*>(this)->material_nodes_.value(material_ptr,
-                                                                  nullptr);
-      if (material_node == nullptr) {
-        material_node = new TreeNode(TreeNode::MaterialItem, material_ptr);
-        const_cast<ObjectTreeModel*>(this)->material_nodes_.insert(
-          material_ptr, material_node);
-      }
-      return create_index_for_node(material_node, row, column);
+    if (row < material_row_count_) {
+      return create_index_for_node(material_item_node(), row, column);
     }
     return {};
   }
@@ -172,17 +264,11 @@ int ObjectTreeModel::rowCount(const QModelIndex& parentIdx) const {
   }
 
   if (parent_node == inclusions_node()) {
-    if (document_ != nullptr) {
-      return static_cast<int>(document_->shapes().size());
-    }
-    return 0;
+    return shape_row_count_;
   }
 
   if (parent_node == materials_node()) {
-    if (document_ != nullptr) {
-      return static_cast<int>(document_->materials().size());
-    }
-    return 0;
+    return material_row_count_;
   }
 
   // Leaf nodes have no children
@@ -209,15 +295,13 @@ QVariant ObjectTreeModel::data(const QModelIndex& idx, int role) const {
       return QStringLiteral("Materials");
     }
     if (node->type == TreeNode::InclusionItem) {
-      if (auto* shape_ptr = static_cast<ShapeModel*>(node->data)) {
-        if (document_ != nullptr) {
-          return QString::fromStdString(shape_ptr->name());
-        }
+      if (auto* shape_ptr = shape_at(idx.row())) {
+        return QString::fromStdString(shape_ptr->name());
       }
       return QStringLiteral("Item");
     }
     if (node->type == TreeNode::MaterialItem) {
-      if (auto* material = static_cast<MaterialModel*>(node->data)) {
+      if (auto* material = material_at(idx.row())) {
         return QString::fromStdString(material->name());
       }
       return QStringLiteral("Material");
@@ -273,19 +357,12 @@ QModelIndex ObjectTreeModel::index_from_shape(
   if (document_ == nullptr || shape == nullptr) {
     return {};
   }
-  const auto& shapes = document_->shapes();
-  for (int i = 0; i < static_cast<int>(shapes.size()); ++i) {
-    if (shapes[i] == shape) {
-      ShapeModel* shape_ptr = shapes[i].get();
-      TreeNode* node = shape_nodes_.value(shape_ptr, nullptr);
-      if (node == nullptr) {
-        node = new TreeNode(TreeNode::InclusionItem, shape_ptr);
-        shape_nodes_.insert(shape_ptr, node);
-      }
-      return create_index_for_node(node, i, 0);
-    }
+  const size_t row = document_->row_of(*shape);
+  if (row >= static_cast<size_t>(shape_row_count_)) {
+    return {};
   }
-  return {};
+  return create_index_for_node(inclusion_item_node(), static_cast<int>(row),
+                               0);
 }
 
 std::shared_ptr<MaterialModel> ObjectTreeModel::material_from_index(
@@ -295,11 +372,10 @@ std::shared_ptr<MaterialModel> ObjectTreeModel::material_from_index(
   }
   TreeNode* node = node_from_index(index);
   if (node != nullptr && node->type == TreeNode::MaterialItem) {
-    auto* material_ptr = static_cast<MaterialModel*>(node->data);
-    for (const auto& material : document_->materials()) {
-      if (material.get() == material_ptr) {
-        return material;
-      }
+    const auto& materials = document_->materials();
+    const int row = index.row();
+    if (row >= 0 && row < static_cast<int>(materials.size())) {
+      return materials[row];
     }
   }
   return nullptr;
@@ -310,26 +386,15 @@ QModelIndex ObjectTreeModel::index_from_material(
   if (material == nullptr || document_ == nullptr) {
     return {};
   }
-  const auto& materials = document_->materials();
-  for (int i = 0; i < static_cast<int>(materials.size()); ++i) {
-    if (materials[i] == material) {
-      MaterialModel* material_ptr = materials[i].get();
-      TreeNode* node = material_nodes_.value(material_ptr, nullptr);
-      if (node == nullptr) {
-        node = new TreeNode(TreeNode::MaterialItem, material_ptr);
-        material_nodes_.insert(material_ptr, node);
-      }
-      return create_index_for_node(node, i, 0);
-    }
+  const int32_t row = document_->material_index(*material);
+  if (row < 0 || row >= material_row_count_) {
+    return {};
   }
-  return {};
+  return create_index_for_node(material_item_node(), row, 0);
 }
 
 void ObjectTreeModel::clear_items() {
-  qDeleteAll(shape_nodes_);
-  shape_nodes_.clear();
-  beginResetModel();
-  endResetModel();
+  reset_rows();
 }
 
 std::shared_ptr<MaterialModel> ObjectTreeModel::create_material(
@@ -346,9 +411,6 @@ void ObjectTreeModel::remove_material(
     return;
   }
   document_->remove_material(material);
-  auto* node = material_nodes_.take(material.get());
-  // delete nullptr is safe in C++
-  delete node;
 }
 
 void ObjectTreeModel::clear_materials() {
@@ -356,8 +418,6 @@ void ObjectTreeModel::clear_materials() {
     return;
   }
   document_->clear_materials();
-  qDeleteAll(material_nodes_);
-  material_nodes_.clear();
 }
 
 bool ObjectTreeModel::setData(const QModelIndex& index, const QVariant& value,
@@ -373,19 +433,16 @@ bool ObjectTreeModel::setData(const QModelIndex& index, const QVariant& value,
     return false;  // Reject empty names
   }
 
+  // The document reports the rename, which emits dataChanged()
   if (node->type == TreeNode::InclusionItem) {
-    if (auto* shape_ptr = static_cast<ShapeModel*>(node->data)) {
-      if (document_ != nullptr) {
-        shape_ptr->set_name(new_name.toStdString());
-        emit dataChanged(index, index, {Qt::DisplayRole});
-        return true;
-      }
+    if (auto* shape_ptr = shape_at(index.row())) {
+      shape_ptr->set_name(new_name.toStdString());
+      return true;
     }
   }
   if (node->type == TreeNode::MaterialItem) {
-    if (auto* material = static_cast<MaterialModel*>(node->data)) {
+    if (auto* material = material_at(index.row())) {
       material->set_name(new_name.toStdString());
-      emit dataChanged(index, index, {Qt::DisplayRole});
       return true;
     }
   }
@@ -401,32 +458,17 @@ bool ObjectTreeModel::removeRows(int row, int count,
 
   TreeNode* parent_node = node_from_index(parent);
 
+  // Removed in one batch: the document reports a single range, which
+  // on_document_changes() turns into beginRemoveRows()/endRemoveRows()
   if (parent_node == inclusions_node() && document_ != nullptr) {
     const auto& shapes = document_->shapes();
     if (row < 0 || row + count > static_cast<int>(shapes.size())) {
       return false;
     }
     // Collect shapes to remove before deletion (to avoid index issues)
-    std::vector<std::shared_ptr<ShapeModel>> shapes_to_remove;
-    shapes_to_remove.reserve(count);
-    for (int i = 0; i < count; ++i) {
-      const int current_row = row + i;
-      if (current_row >= 0 && current_row < static_cast<int>(shapes.size())) {
-        shapes_to_remove.push_back(shapes[current_row]);
-      }
-    }
-    if (shapes_to_remove.empty()) {
-      return false;
-    }
-    // Remove from end to avoid index shifting issues
-    beginRemoveRows(parent, row, row + count - 1);
-    for (int i = static_cast<int>(shapes_to_remove.size()) - 1; i >= 0; --i) {
-      document_->remove_shape(shapes_to_remove[i]);
-      // delete nullptr is safe in C++
-      auto* node = shape_nodes_.take(shapes_to_remove[i].get());
-      delete node;
-    }
-    endRemoveRows();
+    const std::vector<std::shared_ptr<ShapeModel>> shapes_to_remove(
+      shapes.begin() + row, shapes.begin() + row + count);
+    document_->remove_shapes(shapes_to_remove);
     return true;
   }
 
@@ -436,28 +478,13 @@ bool ObjectTreeModel::removeRows(int row, int count,
       return false;
     }
     // Collect materials to remove before deletion (to avoid index issues)
-    std::vector<std::shared_ptr<MaterialModel>> materials_to_remove;
-    materials_to_remove.reserve(count);
-    for (int i = 0; i < count; ++i) {
-      const int current_row = row + i;
-      if (current_row >= 0 &&
-          current_row < static_cast<int>(materials.size())) {
-        materials_to_remove.push_back(materials[current_row]);
-      }
-    }
-    if (materials_to_remove.empty()) {
-      return false;
-    }
-    // Remove from end to avoid index shifting issues
-    beginRemoveRows(parent, row, row + count - 1);
-    for (int i = static_cast<int>(materials_to_remove.size()) - 1; i >= 0;
-         --i) {
-      document_->remove_material(materials_to_remove[i]);
-      // delete nullptr is safe in C++
-      auto* node = material_nodes_.take(materials_to_remove[i].get());
-      delete node;
+    const std::vector<std::shared_ptr<MaterialModel>> materials_to_remove(
+      materials.begin() + row, materials.begin() + row + count);
+    const DocumentModel::Batch batch(*document_);
+    for (auto it = materials_to_remove.rbegin();
+         it != materials_to_remove.rend(); ++it) {
+      document_->remove_material(*it);
     }
-    endRemoveRows();
     return true;
   }
 
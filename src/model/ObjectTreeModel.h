@@ -1,28 +1,41 @@
 #pragma once
 
 #include <QAbstractItemModel>
-#include <QHash>
 #include <QVector>
 #include <memory>
+#include <span>
+
+#include "model/DocumentModel.h"
 
 class SubstrateItem;
 class MaterialModel;
-class DocumentModel;
 class ShapeModel;
 
 /**
  * @brief Internal node structure for the tree model
+ *
+ * Items do not get nodes of their own: all inclusions share one InclusionItem
+ * node and all materials one MaterialItem node, and the index row selects the
+ * object in the document.
  */
 struct TreeNode {
   enum Type { Root, Inclusions, Materials, InclusionItem, MaterialItem };
 
   Type type;
-  void* data{nullptr};  // ShapeModel* for InclusionItem, MaterialModel* for
-                        // MaterialItem, nullptr for groups
 
-  TreeNode(Type t, void* d = nullptr) : type(t), data(d) {}
+  explicit TreeNode(Type t) : type(t) {}
 };
 
+/**
+ * @brief Tree of the document's inclusions and materials.
+ *
+ * The model follows DocumentModel::on_changes() and turns each coalesced edit
+ * into the matching beginInsertRows()/beginRemoveRows()/dataChanged() call,
+ * so adding or removing a shape costs the view O(1) regardless of the
+ * document size. Row counts are cached because the document has already
+ * changed when its edits arrive; a full reset only happens when the edits do
+ * not add up to the document.
+ */
 class ObjectTreeModel : public QAbstractItemModel {
   Q_OBJECT
  public:
@@ -79,17 +92,41 @@ class ObjectTreeModel : public QAbstractItemModel {
   TreeNode* materials_node() const {
     return const_cast<TreeNode*>(&materials_node_);
   }
+  TreeNode* inclusion_item_node() const {
+    return const_cast<TreeNode*>(&inclusion_item_node_);
+  }
+  TreeNode* material_item_node() const {
+    return const_cast<TreeNode*>(&material_item_node_);
+  }
+  ShapeModel* shape_at(int row) const;
+  MaterialModel* material_at(int row) const;
+
+  // Document edits to row notifications
+  void on_document_changes(std::span<const DocumentModel::Edit> edits);
+  bool apply_edit(const DocumentModel::Edit& edit);
+  bool insert_rows(TreeNode* group, int& row_count, size_t first,
+                   size_t count);
+  bool remove_rows(TreeNode* group, int& row_count, size_t first,
+                   size_t count);
+  bool change_rows(TreeNode* group, int row_count, size_t first,
+                   size_t count);
+  void reset_rows();
+  int document_shape_count() const;
+  int document_material_count() const;
 
   // Root nodes (persistent)
   mutable TreeNode root_node_{TreeNode::Root};
   mutable TreeNode inclusions_node_{TreeNode::Inclusions};
   mutable TreeNode materials_node_{TreeNode::Materials};
+  // Shared by all items of a group
+  mutable TreeNode inclusion_item_node_{TreeNode::InclusionItem};
+  mutable TreeNode material_item_node_{TreeNode::MaterialItem};
 
   SubstrateItem* substrate_{nullptr};
   QString substrate_name_{"Substrate"};
-  mutable QHash<MaterialModel*, TreeNode*>
-    material_nodes_;  // Map materials to their tree nodes
-  mutable QHash<ShapeModel*, TreeNode*> shape_nodes_;
   DocumentModel* document_{nullptr};
   int document_connection_{0};
+  // Rows as last reported to the views
+  int shape_row_count_{0};
+  int material_row_count_{0};
 };
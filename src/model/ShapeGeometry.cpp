@@ -0,0 +1,363 @@
+#include "model/ShapeGeometry.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <numbers>
+#include <utility>
+
+#include "model/ShapeModel.h"
+#include "model/ShapeSizeConverter.h"
+#include "model/ShapeStore.h"
+#include "model/core/ModelTypes.h"
+
+namespace {
+constexpr double kHalf = 0.5;
+constexpr double kDegreesInHalfCircle = 180.0;
+// Newton-like refinement steps for the closest point on an ellipse; the
+// iteration converges to well below a pixel after a few steps
+constexpr int kEllipseDistanceIterations = 4;
+constexpr double kInvSqrt2 = 0.70710678118654752;
+
+double dot(double ax, double ay, double bx, double by) {
+  return ax * bx + ay * by;
+}
+
+// Distance from the origin to segment [a, b]
+double segment_distance_to_origin(const Point2D& a, const Point2D& b) {
+  const double seg_x = b.x - a.x;
+  const double seg_y = b.y - a.y;
+  const double length_sq = dot(seg_x, seg_y, seg_x, seg_y);
+  double t = 0.0;
+  if (length_sq > 0.0) {
+    t = std::clamp(-dot(a.x, a.y, seg_x, seg_y) / length_sq, 0.0, 1.0);
+  }
+  return std::hypot(a.x + t * seg_x, a.y + t * seg_y);
+}
+
+double ellipse_distance(double half_a, double half_b, double px, double py) {
+  // Work in the first quadrant; the ellipse is symmetric
+  px = std::abs(px);
+  py = std::abs(py);
+  double tx = kInvSqrt2;
+  double ty = kInvSqrt2;
+  for (int i = 0; i < kEllipseDistanceIterations; ++i) {
+    const double x = half_a * tx;
+    const double y = half_b * ty;
+    const double ex =
+      (half_a * half_a - half_b * half_b) * tx * tx * tx / half_a;
+    const double ey =
+      (half_b * half_b - half_a * half_a) * ty * ty * ty / half_b;
+    const double r = std::hypot(x - ex, y - ey);
+    const double q = std::hypot(px - ex, py - ey);
+    if (q <= 0.0) {
+      break;
+    }
+    tx = std::clamp(((px - ex) * r / q + ex) / half_a, 0.0, 1.0);
+    ty = std::clamp(((py - ey) * r / q + ey) / half_b, 0.0, 1.0);
+    const double t = std::hypot(tx, ty);
+    tx /= t;
+    ty /= t;
+  }
+  return std::hypot(px - half_a * tx, py - half_b * ty);
+}
+}  // namespace
+
+bool ShapeFrame::is_elliptic() const {
+  const auto shape_type = static_cast<ShapeModel::ShapeType>(type);
+  return shape_type == ShapeModel::ShapeType::Ellipse ||
+         shape_type == ShapeModel::ShapeType::Circle;
+}
+
+namespace ShapeGeometry {
+
+auto make_frame(uint8_t type, const Point2D& position, const Size2D& size,
+                double rotation_deg) -> ShapeFrame {
+  ShapeFrame frame;
+  frame.type = type;
+  switch (static_cast<ShapeModel::ShapeType>(type)) {
+    case ShapeModel::ShapeType::Circle:
+      // Circle: size stores diameter x diameter, item centered at position
+      frame.half_width = size.width * kHalf;
+      frame.half_height = size.width * kHalf;
+      frame.center = position;
+      break;
+    case ShapeModel::ShapeType::Stick:
+      // Stick: line of length width centered at position
+      frame.half_width = size.width * kHalf;
+      frame.half_height = ShapeConstants::kStickThickness * kHalf;
+      frame.center = position;
+      break;
+    case ShapeModel::ShapeType::Rectangle:
+    case ShapeModel::ShapeType::Ellipse:
+    default:
+      // Rect (0, 0, width, height) in item coordinates
+      frame.half_width = size.width * kHalf;
+      frame.half_height = size.height * kHalf;
+      frame.center = Point2D{.x = position.x + frame.half_width,
+                             .y = position.y + frame.half_height};
+      break;
+  }
+  const double radians =
+    rotation_deg * std::numbers::pi / kDegreesInHalfCircle;
+  frame.cos_a = std::cos(radians);
+  frame.sin_a = std::sin(radians);
+  return frame;
+}
+
+auto make_frame(const ShapeStore& store, size_t row) -> ShapeFrame {
+  return make_frame(
+    store.types()[row], Point2D{.x = store.xs()[row], .y = store.ys()[row]},
+    Size2D{.width = store.widths()[row], .height = store.heights()[row]},
+    store.rotations()[row]);
+}
+
+auto bounds(const ShapeFrame& frame) -> Aabb {
+  const double abs_cos = std::abs(frame.cos_a);
+  const double abs_sin = std::abs(frame.sin_a);
+  double extent_x = 0.0;
+  double extent_y = 0.0;
+  if (frame.is_elliptic()) {
+    const double hw_sq = frame.half_width * frame.half_width;
+    const double hh_sq = frame.half_height * frame.half_height;
+    extent_x =
+      std::sqrt(hw_sq * frame.cos_a * frame.cos_a +
+                hh_sq * frame.sin_a * frame.sin_a);
+    extent_y =
+      std::sqrt(hw_sq * frame.sin_a * frame.sin_a +
+                hh_sq * frame.cos_a * frame.cos_a);
+  } else {
+    extent_x = abs_cos * frame.half_width + abs_sin * frame.half_height;
+    extent_y = abs_sin * frame.half_width + abs_cos * frame.half_height;
+  }
+  return Aabb{.min_x = frame.center.x - extent_x,
+              .min_y = frame.center.y - extent_y,
+              .max_x = frame.center.x + extent_x,
+              .max_y = frame.center.y + extent_y};
+}
+
+auto to_local(const ShapeFrame& frame, const Point2D& point) -> Point2D {
+  const double dx = point.x - frame.center.x;
+  const double dy = point.y - frame.center.y;
+  return Point2D{.x = dx * frame.cos_a + dy * frame.sin_a,
+                 .y = -dx * frame.sin_a + dy * frame.cos_a};
+}
+
+auto to_scene(const ShapeFrame& frame, const Point2D& local) -> Point2D {
+  return Point2D{
+    .x = frame.center.x + local.x * frame.cos_a - local.y * frame.sin_a,
+    .y = frame.center.y + local.x * frame.sin_a + local.y * frame.cos_a};
+}
+
+bool contains(const ShapeFrame& frame, const Point2D& point) {
+  const Point2D local = to_local(frame, point);
+  if (frame.is_elliptic()) {
+    if (frame.half_width <= 0.0 || frame.half_height <= 0.0) {
+      return false;
+    }
+    const double nx = local.x / frame.half_width;
+    const double ny = local.y / frame.half_height;
+    return nx * nx + ny * ny <= 1.0;
+  }
+  return std::abs(local.x) <= frame.half_width &&
+         std::abs(local.y) <= frame.half_height;
+}
+
+bool intersects(const ShapeFrame& frame, const Aabb& box) {
+  if (!bounds(frame).intersects(box)) {
+    return false;
+  }
+
+  if (!frame.is_elliptic()) {
+    // Separating axis test; the scene axes are covered by the bounds check
+    const double box_hx = box.width() * kHalf;
+    const double box_hy = box.height() * kHalf;
+    const double dx = box.min_x + box_hx - frame.center.x;
+    const double dy = box.min_y + box_hy - frame.center.y;
+    const double abs_cos = std::abs(frame.cos_a);
+    const double abs_sin = std::abs(frame.sin_a);
+    const double along_u = std::abs(dot(dx, dy, frame.cos_a, frame.sin_a));
+    if (along_u > frame.half_width + box_hx * abs_cos + box_hy * abs_sin) {
+      return false;
+    }
+    const double along_v = std::abs(dot(dx, dy, -frame.sin_a, frame.cos_a));
+    return along_v <= frame.half_height + box_hx * abs_sin + box_hy * abs_cos;
+  }
+
+  if (frame.half_width <= 0.0 || frame.half_height <= 0.0) {
+    return true;  // Degenerate ellipse, bounds are exact enough
+  }
+  // Either the box holds the ellipse center or one of its edges crosses the
+  // ellipse. Edges are tested against the unit circle in normalized space.
+  if (box.contains(frame.center)) {
+    return true;
+  }
+  const std::array<Point2D, 4> corners = {
+    Point2D{.x = box.min_x, .y = box.min_y},
+    Point2D{.x = box.max_x, .y = box.min_y},
+    Point2D{.x = box.max_x, .y = box.max_y},
+    Point2D{.x = box.min_x, .y = box.max_y}};
+  std::array<Point2D, 4> normalized;
+  for (size_t i = 0; i < corners.size(); ++i) {
+    const Point2D local = to_local(frame, corners[i]);
+    normalized[i] = Point2D{.x = local.x / frame.half_width,
+                            .y = local.y / frame.half_height};
+  }
+  for (size_t i = 0; i < normalized.size(); ++i) {
+    if (segment_distance_to_origin(
+          normalized[i], normalized[(i + 1) % normalized.size()]) <= 1.0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+auto distance_to(const ShapeFrame& frame, const Point2D& point) -> double {
+  if (contains(frame, point)) {
+    return 0.0;
+  }
+  const Point2D local = to_local(frame, point);
+  if (!frame.is_elliptic()) {
+    const double dx = std::max(std::abs(local.x) - frame.half_width, 0.0);
+    const double dy = std::max(std::abs(local.y) - frame.half_height, 0.0);
+    return std::hypot(dx, dy);
+  }
+  if (frame.half_width == frame.half_height || frame.half_width <= 0.0 ||
+      frame.half_height <= 0.0) {
+    const double radius = std::max(frame.half_width, frame.half_height);
+    return std::max(std::hypot(local.x, local.y) - radius, 0.0);
+  }
+  return ellipse_distance(frame.half_width, frame.half_height, local.x,
+                          local.y);
+}
+
+auto support(const ShapeFrame& frame, double dir_x, double dir_y) -> Point2D {
+  // Direction in frame-local coordinates
+  const double local_x = dir_x * frame.cos_a + dir_y * frame.sin_a;
+  const double local_y = -dir_x * frame.sin_a + dir_y * frame.cos_a;
+  Point2D local;
+  if (frame.is_elliptic()) {
+    const double scaled_x = frame.half_width * frame.half_width * local_x;
+    const double scaled_y = frame.half_height * frame.half_height * local_y;
+    const double norm = std::sqrt(scaled_x * local_x + scaled_y * local_y);
+    if (norm > 0.0) {
+      local = Point2D{.x = scaled_x / norm, .y = scaled_y / norm};
+    }
+  } else {
+    local = Point2D{.x = local_x >= 0.0 ? frame.half_width : -frame.half_width,
+                    .y = local_y >= 0.0 ? frame.half_height
+                                        : -frame.half_height};
+  }
+  return to_scene(frame, local);
+}
+
+auto area(const ShapeFrame& frame) -> double {
+  if (frame.is_elliptic()) {
+    return std::numbers::pi * frame.half_width * frame.half_height;
+  }
+  return 4.0 * frame.half_width * frame.half_height;
+}
+
+auto perimeter(const ShapeFrame& frame) -> double {
+  const double a = frame.half_width;
+  const double b = frame.half_height;
+  if (!frame.is_elliptic()) {
+    return 4.0 * (a + b);
+  }
+  if (a + b <= 0.0) {
+    return 0.0;
+  }
+  const double h = ((a - b) * (a - b)) / ((a + b) * (a + b));
+  return std::numbers::pi * (a + b) *
+         (1.0 + 3.0 * h / (10.0 + std::sqrt(4.0 - 3.0 * h)));
+}
+
+auto boundary_point(const ShapeFrame& frame, double t) -> Point2D {
+  const double a = frame.half_width;
+  const double b = frame.half_height;
+  t -= std::floor(t);
+  Point2D local;
+  if (frame.is_elliptic()) {
+    const double angle = 2.0 * std::numbers::pi * t;
+    local = Point2D{.x = a * std::cos(angle), .y = b * std::sin(angle)};
+  } else {
+    // Walk the sides counter-clockwise from the bottom-right corner
+    double distance = t * 4.0 * (a + b);
+    const std::array<Point2D, 4> corners = {
+      Point2D{.x = a, .y = -b}, Point2D{.x = a, .y = b},
+      Point2D{.x = -a, .y = b}, Point2D{.x = -a, .y = -b}};
+    const std::array<double, 4> lengths = {2.0 * b, 2.0 * a, 2.0 * b, 2.0 * a};
+    size_t side = 0;
+    while (side + 1 < corners.size() && distance > lengths[side]) {
+      distance -= lengths[side];
+      ++side;
+    }
+    const Point2D& from = corners[side];
+    const Point2D& to = corners[(side + 1) % corners.size()];
+    const double fraction =
+      lengths[side] > 0.0 ? std::min(distance / lengths[side], 1.0) : 0.0;
+    local = Point2D{.x = from.x + (to.x - from.x) * fraction,
+                    .y = from.y + (to.y - from.y) * fraction};
+  }
+  return to_scene(frame, local);
+}
+
+bool row_span(const ShapeFrame& frame, double y, double& min_x,
+              double& max_x) {
+  const double a = frame.half_width;
+  const double b = frame.half_height;
+  const double dy = y - frame.center.y;
+  const double cos_a = frame.cos_a;
+  const double sin_a = frame.sin_a;
+
+  if (frame.is_elliptic()) {
+    if (a <= 0.0 || b <= 0.0) {
+      return false;
+    }
+    // Points (dx, dy) with A dx^2 + B dx + C <= 0
+    const double inv_a2 = 1.0 / (a * a);
+    const double inv_b2 = 1.0 / (b * b);
+    const double quad_a = cos_a * cos_a * inv_a2 + sin_a * sin_a * inv_b2;
+    const double quad_b = 2.0 * dy * sin_a * cos_a * (inv_a2 - inv_b2);
+    const double quad_c =
+      dy * dy * (sin_a * sin_a * inv_a2 + cos_a * cos_a * inv_b2) - 1.0;
+    const double discriminant = quad_b * quad_b - 4.0 * quad_a * quad_c;
+    if (discriminant < 0.0) {
+      return false;
+    }
+    const double root = std::sqrt(discriminant);
+    min_x = frame.center.x + (-quad_b - root) / (2.0 * quad_a);
+    max_x = frame.center.x + (-quad_b + root) / (2.0 * quad_a);
+    return true;
+  }
+
+  // Clip the line against both slabs of the box in local coordinates:
+  // local = (dx cos + dy sin, -dx sin + dy cos)
+  double low = -std::numeric_limits<double>::infinity();
+  double high = std::numeric_limits<double>::infinity();
+  const auto clip_slab = [&](double slope, double offset, double half) {
+    // |slope * dx + offset| <= half
+    if (slope == 0.0) {
+      return std::abs(offset) <= half;
+    }
+    double from = (-half - offset) / slope;
+    double to = (half - offset) / slope;
+    if (from > to) {
+      std::swap(from, to);
+    }
+    low = std::max(low, from);
+    high = std::min(high, to);
+    return low <= high;
+  };
+  if (!clip_slab(cos_a, dy * sin_a, a) || !clip_slab(-sin_a, dy * cos_a, b)) {
+    return false;
+  }
+  min_x = frame.center.x + low;
+  max_x = frame.center.x + high;
+  return true;
+}
+
+}  // namespace ShapeGeometry
@@ -1,8 +1,15 @@
 #include "model/ShapeModel.h"
 
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
 #include <memory>
+#include <string>
+#include <string_view>
 
+#include "model/DocumentModel.h"
 #include "model/MaterialModel.h"
+#include "model/ShapeStore.h"
 #include "model/core/ModelTypes.h"
 
 namespace {
@@ -10,80 +17,425 @@ constexpr uint8_t kDefaultColorR = 128;
 constexpr uint8_t kDefaultColorG = 128;
 constexpr uint8_t kDefaultColorB = 128;
 constexpr uint8_t kDefaultColorA = 255;
+constexpr double kDegreesInCircle = 360.0;
+
+Color default_color() {
+  return Color{kDefaultColorR, kDefaultColorG, kDefaultColorB, kDefaultColorA};
+}
+
+// Values of the custom materials that were never created
+const MaterialModel& default_material() {
+  static const MaterialModel kDefault(default_color());
+  return kDefault;
+}
+
+// Grid frequencies the material setters accept
+bool is_frequency(double frequency) {
+  return std::isfinite(frequency) && frequency >= 1.0;
+}
+
+bool is_finite(const Point2D& point) {
+  return std::isfinite(point.x) && std::isfinite(point.y);
+}
+
+bool is_positive(const Size2D& size) {
+  return std::isfinite(size.width) && size.width > 0.0 &&
+         std::isfinite(size.height) && size.height > 0.0;
+}
 }  // namespace
 
-ShapeModel::ShapeModel(ShapeType type)
-    : type_(type),
-      material_(std::make_shared<MaterialModel>(Color{
-        kDefaultColorR, kDefaultColorG, kDefaultColorB, kDefaultColorA})) {}
+ShapeModel::ShapeModel(ShapeType type) {
+  if (type != ShapeType::Rectangle) {
+    writable_detached_values().record.type = static_cast<uint8_t>(type);
+  }
+}
+
+ShapeModel::~ShapeModel() {
+  unwatch_custom_material();
+  if (document_ != nullptr) {
+    store().erase(handle_);
+  }
+}
+
+auto ShapeModel::name() const -> std::string {
+  return document_ != nullptr ? std::string(store().name(handle_))
+                              : detached_values().name;
+}
+
+void ShapeModel::set_name(const std::string& name) {
+  const std::string_view trimmed = trimmed_name(name);
+  if (document_ != nullptr) {
+    if (trimmed == store().name(handle_)) {
+      return;
+    }
+    store().set_name(handle_, trimmed);
+  } else {
+    if (trimmed == detached_values().name) {
+      return;
+    }
+    writable_detached_values().name.assign(trimmed);
+  }
+  notify_change(
+    ModelChange{.type = ModelChange::Type::NameChanged, .property = "name"});
+}
+
+auto ShapeModel::type() const -> ShapeType {
+  return static_cast<ShapeType>(document_ != nullptr
+                                  ? store().type(handle_)
+                                  : detached_values().record.type);
+}
+
+std::shared_ptr<MaterialModel> ShapeModel::material() const {
+  if (material_ != nullptr) {
+    return material_;
+  }
+  if (is_preset_material_) {
+    return document_->materials()[static_cast<size_t>(
+      store().material_index(handle_))];
+  }
+  material_ = std::make_shared<MaterialModel>(default_color());
+  watch_custom_material();
+  return material_;
+}
+
+std::shared_ptr<MaterialModel> ShapeModel::custom_material() const {
+  return is_preset_material_ ? nullptr : material_;
+}
+
+const MaterialModel& ShapeModel::material_values() const {
+  if (material_ != nullptr) {
+    return *material_;
+  }
+  if (is_preset_material_) {
+    return *document_->materials()[static_cast<size_t>(
+      store().material_index(handle_))];
+  }
+  return default_material();
+}
 
 void ShapeModel::assign_material(
   const std::shared_ptr<MaterialModel>& material) {
+  if (material == nullptr) {
+    clear_material();
+    return;
+  }
+  unwatch_custom_material();
   material_ = material;
   is_preset_material_ = true;
+  if (document_ != nullptr) {
+    store().set_material_index(handle_, -1);
+    release_preset();
+  }
   notify_change(ModelChange{ModelChange::Type::MaterialChanged, "material"});
 }
 
 void ShapeModel::clear_material() {
-  // Create new custom material with current color
-  const Color current_color = material_ ? material_->color()
-                                        : Color{kDefaultColorR, kDefaultColorG,
-                                                kDefaultColorB, kDefaultColorA};
-  material_ = std::make_shared<MaterialModel>(current_color);
+  // New custom material with the current color
+  const Color current_color = custom_color();
+  set_custom_material(current_color == default_color()
+                        ? nullptr
+                        : std::make_shared<MaterialModel>(current_color));
+}
+
+void ShapeModel::set_custom_material(
+  const std::shared_ptr<MaterialModel>& material) {
+  unwatch_custom_material();
+  material_ = material;
   is_preset_material_ = false;
+  if (document_ != nullptr) {
+    store().set_material_index(handle_, -1);
+  }
+  watch_custom_material();
   notify_change(ModelChange{ModelChange::Type::MaterialChanged, "material"});
 }
 
-void ShapeModel::set_custom_color(const Color& color) {
-  if (!material_) {
-    material_ = std::make_shared<MaterialModel>(color);
-    is_preset_material_ = false;
-  } else if (!is_preset_material_) {
+void ShapeModel::set_custom_values(const MaterialModel& values) {
+  set_custom_values(values.color(), values.grid_type(),
+                    values.grid_frequency_x(), values.grid_frequency_y());
+}
+
+void ShapeModel::set_custom_values(const Color& color,
+                                   MaterialModel::GridType grid_type,
+                                   double grid_frequency_x,
+                                   double grid_frequency_y) {
+  if (is_preset_material_) {
+    return;
+  }
+  const MaterialModel& current = material_values();
+  if (!is_frequency(grid_frequency_x)) {
+    grid_frequency_x = current.grid_frequency_x();
+  }
+  if (!is_frequency(grid_frequency_y)) {
+    grid_frequency_y = current.grid_frequency_y();
+  }
+  if (current.color() == color && current.grid_type() == grid_type &&
+      current.grid_frequency_x() == grid_frequency_x &&
+      current.grid_frequency_y() == grid_frequency_y) {
+    return;
+  }
+  if (material_ != nullptr) {
     material_->set_color(color);
+    material_->set_grid_type(grid_type);
+    material_->set_grid_frequency_x(grid_frequency_x);
+    material_->set_grid_frequency_y(grid_frequency_y);
+    return;
   }
+  // Filled in before anyone watches it
+  const auto material = std::make_shared<MaterialModel>(color);
+  material->set_grid_type(grid_type);
+  material->set_grid_frequency_x(grid_frequency_x);
+  material->set_grid_frequency_y(grid_frequency_y);
+  set_custom_material(material);
+}
+
+Color ShapeModel::custom_color() const {
+  return material_values().color();
+}
+
+void ShapeModel::set_custom_color(const Color& color) {
   // If preset material, don't change color
+  if (is_preset_material_ ||
+      (material_ == nullptr && color == default_color())) {
+    return;
+  }
+  material()->set_color(color);
 }
 
 void ShapeModel::set_type(ShapeType type) {
-  if (type_ == type) {
+  if (this->type() == type) {
     return;
   }
-  type_ = type;
+  if (document_ != nullptr) {
+    store().set_type(handle_, static_cast<uint8_t>(type));
+  } else {
+    writable_detached_values().record.type = static_cast<uint8_t>(type);
+  }
   notify_change(ModelChange{ModelChange::Type::Custom, "type"});
 }
 
+Point2D ShapeModel::position() const {
+  return document_ != nullptr ? store().position(handle_)
+                              : detached_values().record.position;
+}
+
 void ShapeModel::set_position(const Point2D& pos) {
-  if (pos == position_) {
+  if (pos == position()) {
     return;
   }
-  position_ = pos;
+  if (document_ != nullptr) {
+    store().set_position(handle_, pos);
+  } else {
+    writable_detached_values().record.position = pos;
+  }
   notify_change(ModelChange{ModelChange::Type::GeometryChanged, "position"});
 }
 
+Size2D ShapeModel::size() const {
+  return document_ != nullptr ? store().size(handle_)
+                              : detached_values().record.size;
+}
+
 void ShapeModel::set_size(const Size2D& size) {
-  if (size == size_) {
+  if (size == this->size()) {
     return;
   }
   if (!size.is_valid()) {
     return;  // Invalid size, ignore
   }
-  size_ = size;
+  if (document_ != nullptr) {
+    store().set_size(handle_, size);
+  } else {
+    writable_detached_values().record.size = size;
+  }
   notify_change(ModelChange{ModelChange::Type::GeometryChanged, "size"});
 }
 
-void ShapeModel::set_rotation_deg(double rotation) {
-  // Normalize rotation to [0, 360) range
-  constexpr double kDegreesInCircle = 360.0;
-  double normalized = rotation;
-  while (normalized < 0.0) {
+double ShapeModel::rotation_deg() const {
+  return document_ != nullptr ? store().rotation_deg(handle_)
+                              : detached_values().record.rotation_deg;
+}
+
+double ShapeModel::normalized_rotation(double rotation) {
+  if (!std::isfinite(rotation)) {
+    return 0.0;
+  }
+  double normalized = std::fmod(rotation, kDegreesInCircle);
+  if (normalized <= 0.0) {
     normalized += kDegreesInCircle;
   }
-  while (normalized >= kDegreesInCircle) {
-    normalized -= kDegreesInCircle;
+  // Zero, -0 and tiny negative angles end up at a full circle
+  return normalized < kDegreesInCircle ? normalized : 0.0;
+}
+
+void ShapeModel::set_rotation_deg(double rotation) {
+  if (!std::isfinite(rotation)) {
+    return;  // Invalid rotation, ignore
   }
-  if (normalized == rotation_deg_) {
+  const double normalized = normalized_rotation(rotation);
+  if (normalized == rotation_deg()) {
     return;
   }
-  rotation_deg_ = normalized;
+  if (document_ != nullptr) {
+    store().set_rotation_deg(handle_, normalized);
+  } else {
+    writable_detached_values().record.rotation_deg = normalized;
+  }
   notify_change(ModelChange{ModelChange::Type::GeometryChanged, "rotation"});
 }
+
+auto ShapeModel::store() const -> ShapeStore& {
+  return document_->shape_store_;
+}
+
+auto ShapeModel::detached_values() const -> const Detached& {
+  static const Detached kDefaults;
+  return detached_ != nullptr ? *detached_ : kDefaults;
+}
+
+auto ShapeModel::writable_detached_values() -> Detached& {
+  if (detached_ == nullptr) {
+    detached_ = std::make_unique<Detached>();
+  }
+  return *detached_;
+}
+
+void ShapeModel::attach_to_store(DocumentModel* document) {
+  if (document == nullptr || document_ == document) {
+    return;
+  }
+  detach_from_store();
+  const Detached& values = detached_values();
+  document_ = document;
+  handle_ = store().insert(values.record, values.name);
+  detached_.reset();
+  release_preset();
+}
+
+void ShapeModel::attach_to_store(DocumentModel* document,
+                                 const ShapeStore::Record& record,
+                                 std::string_view name) {
+  if (document == nullptr || document_ != nullptr) {
+    return;
+  }
+  ShapeStore::Record valid;
+  if (record.type <= static_cast<uint8_t>(ShapeType::Stick)) {
+    valid.type = record.type;
+  }
+  if (is_finite(record.position)) {
+    valid.position = record.position;
+  }
+  if (is_positive(record.size)) {
+    valid.size = record.size;
+  }
+  valid.rotation_deg = normalized_rotation(record.rotation_deg);
+  is_preset_material_ =
+    record.material_index >= 0 &&
+    static_cast<size_t>(record.material_index) < document->materials().size();
+  valid.material_index = is_preset_material_ ? record.material_index : -1;
+
+  unwatch_custom_material();
+  material_.reset();
+  document_ = document;
+  handle_ = store().insert(valid, trimmed_name(name));
+  detached_.reset();
+}
+
+void ShapeModel::detach_from_store() {
+  if (document_ == nullptr) {
+    return;
+  }
+  ShapeStore& store = this->store();
+  store.erase(release_store_row());
+}
+
+auto ShapeModel::release_store_row() -> ShapeStore::Handle {
+  if (document_ == nullptr) {
+    return {};
+  }
+  hold_preset();
+  Detached& values = writable_detached_values();
+  values.record = store().record(handle_);
+  values.name = store().name(handle_);
+  const ShapeStore::Handle handle = handle_;
+  document_ = nullptr;
+  handle_ = {};
+  return handle;
+}
+
+auto ShapeModel::write_record(const ShapeStore::Record& record)
+  -> RecordChange {
+  ShapeStore::Record current =
+    document_ != nullptr ? store().record(handle_) : detached_values().record;
+  RecordChange change;
+  change.type = current.type != record.type;
+  const double rotation = normalized_rotation(record.rotation_deg);
+  change.geometry = current.position != record.position ||
+                    (record.size.is_valid() && current.size != record.size) ||
+                    current.rotation_deg != rotation;
+  if (!change.type && !change.geometry) {
+    return change;
+  }
+  current.type = record.type;
+  current.position = record.position;
+  if (record.size.is_valid()) {
+    current.size = record.size;
+  }
+  current.rotation_deg = rotation;
+  if (document_ == nullptr) {
+    writable_detached_values().record = current;
+    return change;
+  }
+  store().set_type(handle_, current.type);
+  store().set_position(handle_, current.position);
+  store().set_size(handle_, current.size);
+  store().set_rotation_deg(handle_, current.rotation_deg);
+  return change;
+}
+
+bool ShapeModel::hold_preset() {
+  if (document_ == nullptr || !is_preset_material_ || material_ != nullptr) {
+    return false;
+  }
+  material_ = document_->materials()[static_cast<size_t>(
+    store().material_index(handle_))];
+  store().set_material_index(handle_, -1);
+  return true;
+}
+
+bool ShapeModel::release_preset() {
+  if (document_ == nullptr || !is_preset_material_ || material_ == nullptr) {
+    return false;
+  }
+  const int32_t index = document_->material_index(*material_);
+  if (index < 0) {
+    return false;
+  }
+  store().set_material_index(handle_, index);
+  material_.reset();
+  return true;
+}
+
+void ShapeModel::watch_custom_material() const {
+  if (material_ == nullptr || is_preset_material_ ||
+      custom_material_connection_ >= 0) {
+    return;
+  }
+  // The custom material is edited directly (properties panel, scene items);
+  // report those edits as changes of this shape so that document observers
+  // see them
+  custom_material_connection_ =
+    material_->on_changed().connect([this](const ModelChange& /*change*/) {
+      notify_change(
+        ModelChange{ModelChange::Type::ColorChanged, "custom_material"});
+    });
+}
+
+void ShapeModel::unwatch_custom_material() const {
+  if (custom_material_connection_ < 0) {
+    return;
+  }
+  if (material_ != nullptr) {
+    material_->on_changed().disconnect(custom_material_connection_);
+  }
+  custom_material_connection_ = -1;
+}
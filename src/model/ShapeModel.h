@@ -1,11 +1,25 @@
 #pragma once
 
 #include <memory>
+#include <string>
+#include <string_view>
 
 #include "model/MaterialModel.h"
+#include "model/ShapeStore.h"
 #include "model/core/ModelObject.h"
 #include "model/core/ModelTypes.h"
 
+class DocumentModel;
+
+/**
+ * @brief Inclusion model.
+ *
+ * Once a shape belongs to a DocumentModel its type, geometry, name and preset
+ * material live in the document's ShapeStore and this object is a thin view
+ * over its row. A shape that is not (or no longer) part of a document keeps
+ * the same values locally. A custom material is only allocated once it is
+ * used; until then the shape has the default one (gray, no grid).
+ */
 class ShapeModel : public ModelObject {
  public:
   enum class ShapeType { Rectangle, Ellipse, Circle, Stick };
@@ -13,48 +27,139 @@ class ShapeModel : public ModelObject {
   enum class MaterialMode { Custom, Preset };
 
   explicit ShapeModel(ShapeType type = ShapeType::Rectangle);
+  ~ShapeModel() override;
 
-  ShapeType type() const {
-    return type_;
-  }
+  ShapeModel(const ShapeModel&) = delete;
+  ShapeModel& operator=(const ShapeModel&) = delete;
+
+  auto name() const -> std::string;
+  void set_name(const std::string& name);
+
+  ShapeType type() const;
   void set_type(ShapeType type);
 
   MaterialMode material_mode() const {
     return is_preset_material_ ? MaterialMode::Preset : MaterialMode::Custom;
   }
 
-  std::shared_ptr<MaterialModel> material() const {
-    return material_;
-  }
+  /**
+   * @brief The preset or the custom material; never nullptr. Creates the
+   * custom material on first use.
+   */
+  std::shared_ptr<MaterialModel> material() const;
+  /**
+   * @brief The custom material if it was created, else nullptr (also for
+   * presets). Never allocates.
+   */
+  std::shared_ptr<MaterialModel> custom_material() const;
+  /**
+   * @brief Values of the current material for reading (save, drawing)
+   * without creating the custom one: a default custom material reads a
+   * shared default.
+   */
+  const MaterialModel& material_values() const;
   void assign_material(const std::shared_ptr<MaterialModel>& material);
   void clear_material();
+  /**
+   * @brief Make @p material this shape's own (custom) material again, e.g.
+   * the one it had before a preset was assigned; nullptr goes back to the
+   * default custom material.
+   */
+  void set_custom_material(const std::shared_ptr<MaterialModel>& material);
+  /**
+   * @brief Copy color and grid of @p values (not its name) into the custom
+   * material. Creates it only when the values differ; ignored for presets.
+   */
+  void set_custom_values(const MaterialModel& values);
+  /**
+   * @brief As above from plain values, for loaders; frequencies that are not
+   * finite or below 1 keep the current ones, as with the material setters.
+   * A custom material created here reports a single change.
+   */
+  void set_custom_values(const Color& color, MaterialModel::GridType grid_type,
+                         double grid_frequency_x, double grid_frequency_y);
 
-  Color custom_color() const {
-    return material_ ? material_->color() : Color{};
-  }
+  /**
+   * @brief Color of the current material (preset or custom).
+   */
+  Color custom_color() const;
   void set_custom_color(const Color& color);
 
-  Point2D position() const {
-    return position_;
-  }
+  Point2D position() const;
   void set_position(const Point2D& pos);
 
-  Size2D size() const {
-    return size_;
-  }
+  Size2D size() const;
   void set_size(const Size2D& size);
 
-  double rotation_deg() const {
-    return rotation_deg_;
-  }
+  double rotation_deg() const;
   void set_rotation_deg(double rotation);
+  /**
+   * @brief Rotation as the shape keeps it: in [0, 360), 0 for a non-finite
+   * angle.
+   */
+  static double normalized_rotation(double rotation);
+
+  /**
+   * @brief Row handle in the owning document's ShapeStore (invalid while
+   * detached).
+   */
+  ShapeStore::Handle store_handle() const {
+    return handle_;
+  }
 
  private:
-  ShapeType type_;
-  std::shared_ptr<MaterialModel>
-    material_;  // Always not nullptr - either preset or custom
+  friend class DocumentModel;
+
+  static constexpr std::string_view kDefaultName = "New inclusion";
+
+  // Values of a shape outside any document
+  struct Detached {
+    ShapeStore::Record record;
+    std::string name{kDefaultName};
+  };
+
+  auto store() const -> ShapeStore&;
+  // Local values while detached; defaults until one is set
+  auto detached_values() const -> const Detached&;
+  auto writable_detached_values() -> Detached&;
+
+  // Move local values into a new store row / copy them back and free the row
+  void attach_to_store(DocumentModel* document);
+  void detach_from_store();
+  // Attach a new shape with the values of a loaded record: fields the setters
+  // would reject (unknown type, non-finite position or rotation, a size that
+  // is not positive and finite) keep their defaults and the rotation is
+  // normalized, so files cannot bring in values that the setters keep out.
+  // A material index the document does not list gives the default custom
+  // material
+  void attach_to_store(DocumentModel* document,
+                       const ShapeStore::Record& record,
+                       std::string_view name);
+  // Like detach_from_store(), but the caller erases the returned row (bulk
+  // removal)
+  auto release_store_row() -> ShapeStore::Handle;
+  // Write type and geometry of a record (not its material index) without
+  // notifying; DocumentModel reports the bulk edit
+  struct RecordChange {
+    bool type{false};
+    bool geometry{false};
+  };
+  auto write_record(const ShapeStore::Record& record) -> RecordChange;
+  // A preset that the document does not list (any longer) is kept here;
+  // listed presets are served from the material index column again. Both
+  // return whether the row's material index changed; the caller reports it
+  bool hold_preset();
+  bool release_preset();
+  // Forward edits of the custom material as changes of this shape
+  void watch_custom_material() const;
+  void unwatch_custom_material() const;
+
+  DocumentModel* document_{nullptr};
+  ShapeStore::Handle handle_;
+  std::unique_ptr<Detached> detached_;  // Only while detached, once set
+  // The custom material once created, or a preset while it is not listed by
+  // the document (nullptr: served from the store's material index)
+  mutable std::shared_ptr<MaterialModel> material_;
+  mutable int custom_material_connection_{-1};
   bool is_preset_material_{false};
-  Point2D position_;
-  Size2D size_{100.0, 100.0};
-  double rotation_deg_{0.0};
 };
@@ -0,0 +1,445 @@
+#include "model/ShapeStore.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "model/core/ModelTypes.h"
+
+namespace {
+// Name pool is compacted once garbage exceeds live bytes and this threshold
+constexpr size_t kMinNamePoolGarbageBytes = 4096;
+
+template <typename T>
+void erase_row(std::vector<T>& column, size_t row) {
+  column.erase(column.begin() + static_cast<std::ptrdiff_t>(row));
+}
+
+// Keep the rows whose flag is not set, in order
+template <typename T>
+void erase_rows(std::vector<T>& column, const std::vector<uint8_t>& erased) {
+  size_t kept = 0;
+  for (size_t row = 0; row < column.size(); ++row) {
+    if (erased[row] == 0) {
+      column[kept++] = std::move(column[row]);
+    }
+  }
+  column.resize(kept);
+}
+
+// Move the last rows.size() entries to rows (ascending), merging back to front
+template <typename T>
+void move_last_entries(std::vector<T>& column, std::span<const size_t> rows) {
+  std::vector<T> moved(
+    std::make_move_iterator(column.end() -
+                            static_cast<std::ptrdiff_t>(rows.size())),
+    std::make_move_iterator(column.end()));
+  size_t source = column.size() - rows.size();
+  size_t next = rows.size();
+  // Rows below the first moved one stay where they are
+  for (size_t row = column.size(); next > 0;) {
+    --row;
+    if (rows[next - 1] == row) {
+      column[row] = std::move(moved[--next]);
+    } else {
+      column[row] = std::move(column[--source]);
+    }
+  }
+}
+
+// True if rows is strictly ascending and below size
+bool is_row_set(std::span<const size_t> rows, size_t size) {
+  for (size_t i = 0; i < rows.size(); ++i) {
+    if (rows[i] >= size || (i > 0 && rows[i] <= rows[i - 1])) {
+      return false;
+    }
+  }
+  return true;
+}
+}  // namespace
+
+auto ShapeStore::insert(const Record& record, std::string_view name)
+  -> Handle {
+  const size_t row = types_.size();
+
+  uint32_t slot = 0;
+  if (!free_slots_.empty()) {
+    slot = free_slots_.back();
+    free_slots_.pop_back();
+    slot_row_[slot] = row;
+  } else {
+    slot = static_cast<uint32_t>(slot_row_.size());
+    slot_row_.push_back(row);
+    slot_generation_.push_back(0);
+  }
+
+  types_.push_back(record.type);
+  x_.push_back(record.position.x);
+  y_.push_back(record.position.y);
+  width_.push_back(record.size.width);
+  height_.push_back(record.size.height);
+  rotation_.push_back(record.rotation_deg);
+  material_.push_back(record.material_index);
+  name_offset_.push_back(static_cast<uint32_t>(name_pool_.size()));
+  name_length_.push_back(static_cast<uint32_t>(name.size()));
+  name_pool_.append(name);
+  row_slot_.push_back(slot);
+
+  if (float_columns_enabled_) {
+    x_f32_.push_back(static_cast<float>(record.position.x));
+    y_f32_.push_back(static_cast<float>(record.position.y));
+    width_f32_.push_back(static_cast<float>(record.size.width));
+    height_f32_.push_back(static_cast<float>(record.size.height));
+  }
+
+  return Handle{.slot = slot, .generation = slot_generation_[slot]};
+}
+
+void ShapeStore::erase(Handle handle) {
+  const size_t row = checked_row(handle);
+  if (row == kInvalidRow) {
+    return;
+  }
+
+  name_pool_garbage_ += name_length_[row];
+
+  // Keep rows in document order: shift the tail of every column down by one
+  erase_row(types_, row);
+  erase_row(x_, row);
+  erase_row(y_, row);
+  erase_row(width_, row);
+  erase_row(height_, row);
+  erase_row(rotation_, row);
+  erase_row(material_, row);
+  erase_row(name_offset_, row);
+  erase_row(name_length_, row);
+  erase_row(row_slot_, row);
+  if (float_columns_enabled_) {
+    erase_row(x_f32_, row);
+    erase_row(y_f32_, row);
+    erase_row(width_f32_, row);
+    erase_row(height_f32_, row);
+  }
+
+  for (size_t i = row; i < row_slot_.size(); ++i) {
+    slot_row_[row_slot_[i]] = i;
+  }
+
+  slot_row_[handle.slot] = kInvalidRow;
+  ++slot_generation_[handle.slot];
+  free_slots_.push_back(handle.slot);
+
+  compact_name_pool();
+}
+
+void ShapeStore::erase(std::span<const Handle> handles) {
+  std::vector<uint8_t> erased(row_slot_.size(), 0);
+  size_t erased_count = 0;
+  for (const Handle handle : handles) {
+    const size_t row = checked_row(handle);
+    if (row == kInvalidRow || erased[row] != 0) {
+      continue;
+    }
+    erased[row] = 1;
+    ++erased_count;
+    name_pool_garbage_ += name_length_[row];
+    slot_row_[handle.slot] = kInvalidRow;
+    ++slot_generation_[handle.slot];
+    free_slots_.push_back(handle.slot);
+  }
+  if (erased_count == 0) {
+    return;
+  }
+
+  erase_rows(types_, erased);
+  erase_rows(x_, erased);
+  erase_rows(y_, erased);
+  erase_rows(width_, erased);
+  erase_rows(height_, erased);
+  erase_rows(rotation_, erased);
+  erase_rows(material_, erased);
+  erase_rows(name_offset_, erased);
+  erase_rows(name_length_, erased);
+  erase_rows(row_slot_, erased);
+  if (float_columns_enabled_) {
+    erase_rows(x_f32_, erased);
+    erase_rows(y_f32_, erased);
+    erase_rows(width_f32_, erased);
+    erase_rows(height_f32_, erased);
+  }
+
+  for (size_t i = 0; i < row_slot_.size(); ++i) {
+    slot_row_[row_slot_[i]] = i;
+  }
+
+  compact_name_pool();
+}
+
+void ShapeStore::move_last_rows(std::span<const size_t> rows) {
+  if (rows.empty() || !is_row_set(rows, size())) {
+    return;
+  }
+  move_last_entries(types_, rows);
+  move_last_entries(x_, rows);
+  move_last_entries(y_, rows);
+  move_last_entries(width_, rows);
+  move_last_entries(height_, rows);
+  move_last_entries(rotation_, rows);
+  move_last_entries(material_, rows);
+  move_last_entries(name_offset_, rows);
+  move_last_entries(name_length_, rows);
+  move_last_entries(row_slot_, rows);
+  if (float_columns_enabled_) {
+    move_last_entries(x_f32_, rows);
+    move_last_entries(y_f32_, rows);
+    move_last_entries(width_f32_, rows);
+    move_last_entries(height_f32_, rows);
+  }
+
+  for (size_t i = rows.front(); i < row_slot_.size(); ++i) {
+    slot_row_[row_slot_[i]] = i;
+  }
+}
+
+void ShapeStore::clear() {
+  types_.clear();
+  x_.clear();
+  y_.clear();
+  width_.clear();
+  height_.clear();
+  rotation_.clear();
+  material_.clear();
+  name_offset_.clear();
+  name_length_.clear();
+  row_slot_.clear();
+  x_f32_.clear();
+  y_f32_.clear();
+  width_f32_.clear();
+  height_f32_.clear();
+  name_pool_.clear();
+  name_pool_garbage_ = 0;
+
+  // Invalidate every outstanding handle
+  free_slots_.clear();
+  for (uint32_t slot = 0; slot < slot_row_.size(); ++slot) {
+    if (slot_row_[slot] != kInvalidRow) {
+      slot_row_[slot] = kInvalidRow;
+      ++slot_generation_[slot];
+    }
+    free_slots_.push_back(slot);
+  }
+}
+
+void ShapeStore::reserve(size_t count) {
+  types_.reserve(count);
+  x_.reserve(count);
+  y_.reserve(count);
+  width_.reserve(count);
+  height_.reserve(count);
+  rotation_.reserve(count);
+  material_.reserve(count);
+  name_offset_.reserve(count);
+  name_length_.reserve(count);
+  row_slot_.reserve(count);
+  slot_row_.reserve(count);
+  slot_generation_.reserve(count);
+  if (float_columns_enabled_) {
+    x_f32_.reserve(count);
+    y_f32_.reserve(count);
+    width_f32_.reserve(count);
+    height_f32_.reserve(count);
+  }
+}
+
+bool ShapeStore::contains(Handle handle) const {
+  return checked_row(handle) != kInvalidRow;
+}
+
+auto ShapeStore::row_of(Handle handle) const -> size_t {
+  return checked_row(handle);
+}
+
+auto ShapeStore::handle_at(size_t row) const -> Handle {
+  if (row >= row_slot_.size()) {
+    return {};
+  }
+  const uint32_t slot = row_slot_[row];
+  return Handle{.slot = slot, .generation = slot_generation_[slot]};
+}
+
+auto ShapeStore::record(Handle handle) const -> Record {
+  const size_t row = checked_row(handle);
+  if (row == kInvalidRow) {
+    return {};
+  }
+  return Record{.type = types_[row],
+                .position = Point2D{.x = x_[row], .y = y_[row]},
+                .size = Size2D{.width = width_[row], .height = height_[row]},
+                .rotation_deg = rotation_[row],
+                .material_index = material_[row]};
+}
+
+uint8_t ShapeStore::type(Handle handle) const {
+  const size_t row = checked_row(handle);
+  return row != kInvalidRow ? types_[row] : Record{}.type;
+}
+
+void ShapeStore::set_type(Handle handle, uint8_t type) {
+  const size_t row = checked_row(handle);
+  if (row != kInvalidRow) {
+    types_[row] = type;
+  }
+}
+
+Point2D ShapeStore::position(Handle handle) const {
+  const size_t row = checked_row(handle);
+  if (row == kInvalidRow) {
+    return {};
+  }
+  return Point2D{.x = x_[row], .y = y_[row]};
+}
+
+void ShapeStore::set_position(Handle handle, const Point2D& position) {
+  const size_t row = checked_row(handle);
+  if (row == kInvalidRow) {
+    return;
+  }
+  x_[row] = position.x;
+  y_[row] = position.y;
+  sync_float_row(row);
+}
+
+Size2D ShapeStore::size(Handle handle) const {
+  const size_t row = checked_row(handle);
+  if (row == kInvalidRow) {
+    return Record{}.size;
+  }
+  return Size2D{.width = width_[row], .height = height_[row]};
+}
+
+void ShapeStore::set_size(Handle handle, const Size2D& size) {
+  const size_t row = checked_row(handle);
+  if (row == kInvalidRow) {
+    return;
+  }
+  width_[row] = size.width;
+  height_[row] = size.height;
+  sync_float_row(row);
+}
+
+double ShapeStore::rotation_deg(Handle handle) const {
+  const size_t row = checked_row(handle);
+  return row != kInvalidRow ? rotation_[row] : 0.0;
+}
+
+void ShapeStore::set_rotation_deg(Handle handle, double rotation) {
+  const size_t row = checked_row(handle);
+  if (row != kInvalidRow) {
+    rotation_[row] = rotation;
+  }
+}
+
+int32_t ShapeStore::material_index(Handle handle) const {
+  const size_t row = checked_row(handle);
+  return row != kInvalidRow ? material_[row] : -1;
+}
+
+void ShapeStore::set_material_index(Handle handle, int32_t index) {
+  const size_t row = checked_row(handle);
+  if (row != kInvalidRow) {
+    material_[row] = index;
+  }
+}
+
+std::string_view ShapeStore::name(Handle handle) const {
+  const size_t row = checked_row(handle);
+  return row != kInvalidRow ? name_at(row) : std::string_view{};
+}
+
+void ShapeStore::set_name(Handle handle, std::string_view name) {
+  const size_t row = checked_row(handle);
+  if (row == kInvalidRow) {
+    return;
+  }
+  if (name.size() <= name_length_[row]) {
+    // Fits in place; the unused tail becomes garbage
+    name_pool_.replace(name_offset_[row], name.size(), name);
+    name_pool_garbage_ += name_length_[row] - name.size();
+    name_length_[row] = static_cast<uint32_t>(name.size());
+    return;
+  }
+  name_pool_garbage_ += name_length_[row];
+  name_offset_[row] = static_cast<uint32_t>(name_pool_.size());
+  name_length_[row] = static_cast<uint32_t>(name.size());
+  name_pool_.append(name);
+  compact_name_pool();
+}
+
+std::string_view ShapeStore::name_at(size_t row) const {
+  if (row >= name_offset_.size()) {
+    return {};
+  }
+  return std::string_view(name_pool_).substr(name_offset_[row],
+                                             name_length_[row]);
+}
+
+void ShapeStore::set_float_columns_enabled(bool enabled) {
+  if (float_columns_enabled_ == enabled) {
+    return;
+  }
+  float_columns_enabled_ = enabled;
+  if (!enabled) {
+    // Release the memory, the columns are rebuilt when re-enabled
+    std::vector<float>().swap(x_f32_);
+    std::vector<float>().swap(y_f32_);
+    std::vector<float>().swap(width_f32_);
+    std::vector<float>().swap(height_f32_);
+    return;
+  }
+  x_f32_.resize(size());
+  y_f32_.resize(size());
+  width_f32_.resize(size());
+  height_f32_.resize(size());
+  for (size_t row = 0; row < size(); ++row) {
+    sync_float_row(row);
+  }
+}
+
+auto ShapeStore::checked_row(Handle handle) const -> size_t {
+  if (handle.slot >= slot_row_.size() ||
+      slot_generation_[handle.slot] != handle.generation) {
+    return kInvalidRow;
+  }
+  return slot_row_[handle.slot];
+}
+
+void ShapeStore::sync_float_row(size_t row) {
+  if (!float_columns_enabled_) {
+    return;
+  }
+  x_f32_[row] = static_cast<float>(x_[row]);
+  y_f32_[row] = static_cast<float>(y_[row]);
+  width_f32_[row] = static_cast<float>(width_[row]);
+  height_f32_[row] = static_cast<float>(height_[row]);
+}
+
+void ShapeStore::compact_name_pool() {
+  if (name_pool_garbage_ < kMinNamePoolGarbageBytes ||
+      name_pool_garbage_ * 2 < name_pool_.size()) {
+    return;
+  }
+  std::string compacted;
+  compacted.reserve(name_pool_.size() - name_pool_garbage_);
+  for (size_t row = 0; row < name_offset_.size(); ++row) {
+    const std::string_view name = name_at(row);
+    name_offset_[row] = static_cast<uint32_t>(compacted.size());
+    compacted.append(name);
+  }
+  name_pool_ = std::move(compacted);
+  name_pool_garbage_ = 0;
+}
@@ -0,0 +1,192 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "model/core/ModelTypes.h"
+
+/**
+ * @brief Columnar (structure-of-arrays) storage for document inclusions.
+ *
+ * Each inclusion occupies one row spread over contiguous columns (type,
+ * position, size, rotation, material index, name offset). Rows are kept dense
+ * and in document order, so bulk passes such as save, statistics and culling
+ * run linearly over plain arrays instead of chasing one heap object per shape.
+ *
+ * Rows are addressed from outside through a Handle, which stays valid while
+ * other rows are inserted or removed. Handles of removed rows are detected
+ * with a per-slot generation counter.
+ */
+class ShapeStore {
+ public:
+  static constexpr uint32_t kInvalidSlot = std::numeric_limits<uint32_t>::max();
+  static constexpr size_t kInvalidRow = std::numeric_limits<size_t>::max();
+
+  /**
+   * @brief Stable reference to a row.
+   */
+  struct Handle {
+    uint32_t slot{kInvalidSlot};
+    uint32_t generation{0};
+
+    bool is_valid() const {
+      return slot != kInvalidSlot;
+    }
+    bool operator==(const Handle& other) const {
+      return slot == other.slot && generation == other.generation;
+    }
+    bool operator!=(const Handle& other) const {
+      return !(*this == other);
+    }
+  };
+
+  /**
+   * @brief Value of one row without the name (the name lives in the pool).
+   */
+  struct Record {
+    uint8_t type{0};
+    Point2D position;
+    Size2D size{100.0, 100.0};
+    double rotation_deg{0.0};
+    int32_t material_index{-1};  // Index in DocumentModel::materials(), -1 =
+                                 // custom material
+  };
+
+  auto insert(const Record& record, std::string_view name = {}) -> Handle;
+  /**
+   * @brief Erase one row. Rows stay dense and in order, so the rows after it
+   * shift down: linear in their number. Erase many rows with the span
+   * overload.
+   */
+  void erase(Handle handle);
+  /**
+   * @brief Erase several rows in one pass over the columns; stale handles are
+   * skipped.
+   */
+  void erase(std::span<const Handle> handles);
+  /**
+   * @brief Move the last rows.size() rows to @p rows (ascending, in the
+   * resulting order) in one pass; the other rows keep their order. Used to
+   * put appended rows back where they were erased from. Ignored unless rows
+   * is strictly ascending and within the store.
+   */
+  void move_last_rows(std::span<const size_t> rows);
+  void clear();
+  void reserve(size_t count);
+
+  size_t size() const {
+    return types_.size();
+  }
+  bool empty() const {
+    return types_.empty();
+  }
+
+  bool contains(Handle handle) const;
+  /**
+   * @brief Current row of a handle, or kInvalidRow for stale handles.
+   */
+  auto row_of(Handle handle) const -> size_t;
+  auto handle_at(size_t row) const -> Handle;
+
+  auto record(Handle handle) const -> Record;
+
+  uint8_t type(Handle handle) const;
+  void set_type(Handle handle, uint8_t type);
+  Point2D position(Handle handle) const;
+  void set_position(Handle handle, const Point2D& position);
+  Size2D size(Handle handle) const;
+  void set_size(Handle handle, const Size2D& size);
+  double rotation_deg(Handle handle) const;
+  void set_rotation_deg(Handle handle, double rotation);
+  int32_t material_index(Handle handle) const;
+  void set_material_index(Handle handle, int32_t index);
+  std::string_view name(Handle handle) const;
+  void set_name(Handle handle, std::string_view name);
+
+  // Column access for bulk passes. Row i of every column describes the same
+  // inclusion.
+  std::span<const uint8_t> types() const {
+    return types_;
+  }
+  std::span<const double> xs() const {
+    return x_;
+  }
+  std::span<const double> ys() const {
+    return y_;
+  }
+  std::span<const double> widths() const {
+    return width_;
+  }
+  std::span<const double> heights() const {
+    return height_;
+  }
+  std::span<const double> rotations() const {
+    return rotation_;
+  }
+  std::span<const int32_t> material_indices() const {
+    return material_;
+  }
+  std::string_view name_at(size_t row) const;
+
+  /**
+   * @brief Maintain single-precision copies of the coordinate columns.
+   *
+   * Useful for culling and rasterization passes that prefer twice as many
+   * values per cache line. Disabled by default.
+   */
+  void set_float_columns_enabled(bool enabled);
+  bool float_columns_enabled() const {
+    return float_columns_enabled_;
+  }
+  std::span<const float> xs_f32() const {
+    return x_f32_;
+  }
+  std::span<const float> ys_f32() const {
+    return y_f32_;
+  }
+  std::span<const float> widths_f32() const {
+    return width_f32_;
+  }
+  std::span<const float> heights_f32() const {
+    return height_f32_;
+  }
+
+ private:
+  auto checked_row(Handle handle) const -> size_t;
+  void sync_float_row(size_t row);
+  void compact_name_pool();
+
+  // Columns (one entry per row)
+  std::vector<uint8_t> types_;
+  std::vector<double> x_;
+  std::vector<double> y_;
+  std::vector<double> width_;
+  std::vector<double> height_;
+  std::vector<double> rotation_;
+  std::vector<int32_t> material_;
+  std::vector<uint32_t> name_offset_;
+  std::vector<uint32_t> name_length_;
+  std::vector<uint32_t> row_slot_;
+
+  // Optional float32 mirrors of the coordinate columns
+  bool float_columns_enabled_{false};
+  std::vector<float> x_f32_;
+  std::vector<float> y_f32_;
+  std::vector<float> width_f32_;
+  std::vector<float> height_f32_;
+
+  // Names of all rows back to back; renamed or erased rows leave garbage that
+  // is reclaimed once it outweighs the live names.
+  std::string name_pool_;
+  size_t name_pool_garbage_{0};
+
+  // Slot table: handle.slot -> row
+  std::vector<size_t> slot_row_;
+  std::vector<uint32_t> slot_generation_;
+  std::vector<uint32_t> free_slots_;
+};
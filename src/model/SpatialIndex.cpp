@@ -0,0 +1,405 @@
+#include "model/SpatialIndex.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "model/ShapeGeometry.h"
+#include "model/ShapeStore.h"
+#include "model/core/ModelTypes.h"
+
+namespace {
+// Entries covering more cells than this go to the oversized list instead
+constexpr int64_t kMaxCellsPerEntry = 64;
+constexpr double kMinCellSize = 1.0;
+// rebuild() sizes cells to about twice the average inclusion extent
+constexpr double kCellSizeToExtentRatio = 2.0;
+constexpr uint32_t kCellCoordMask = 0xFFFFFFFFU;
+constexpr int kCellKeyShift = 32;
+
+// Clamp cell coordinates to keep far-away garbage input from overflowing
+constexpr double kMaxCellCoord = 1.0e9;
+
+int32_t to_cell(double value, double inv_cell_size) {
+  const double cell =
+    std::clamp(std::floor(value * inv_cell_size), -kMaxCellCoord,
+               kMaxCellCoord);
+  return static_cast<int32_t>(cell);
+}
+
+void erase_slot(std::vector<uint32_t>& slots, uint32_t slot) {
+  const auto slot_it = std::find(slots.begin(), slots.end(), slot);
+  if (slot_it != slots.end()) {
+    *slot_it = slots.back();
+    slots.pop_back();
+  }
+}
+}  // namespace
+
+SpatialIndex::SpatialIndex(double cell_size)
+    : cell_size_(std::max(cell_size, kMinCellSize)),
+      inv_cell_size_(1.0 / cell_size_) {}
+
+void SpatialIndex::set_cell_size(double cell_size) {
+  cell_size = std::max(cell_size, kMinCellSize);
+  if (cell_size == cell_size_) {
+    return;
+  }
+  cell_size_ = cell_size;
+  inv_cell_size_ = 1.0 / cell_size_;
+
+  cells_.clear();
+  oversized_.clear();
+  occupied_ = {};
+  for (uint32_t slot = 0; slot < entries_.size(); ++slot) {
+    if (entries_[slot].present) {
+      link(slot, entries_[slot]);
+    }
+  }
+}
+
+void SpatialIndex::rebuild(const ShapeStore& store) {
+  clear();
+  if (store.empty()) {
+    return;
+  }
+
+  std::vector<ShapeFrame> frames;
+  frames.reserve(store.size());
+  double extent_sum = 0.0;
+  for (size_t row = 0; row < store.size(); ++row) {
+    frames.push_back(ShapeGeometry::make_frame(store, row));
+    const Aabb box = ShapeGeometry::bounds(frames.back());
+    extent_sum += std::max(box.width(), box.height());
+  }
+  const double average_extent = extent_sum / static_cast<double>(store.size());
+  cell_size_ = std::max(average_extent * kCellSizeToExtentRatio, kMinCellSize);
+  inv_cell_size_ = 1.0 / cell_size_;
+
+  cells_.reserve(store.size());
+  uint32_t slot_end = 0;
+  for (size_t row = 0; row < store.size(); ++row) {
+    slot_end = std::max(slot_end, store.handle_at(row).slot + 1);
+  }
+  entries_.resize(slot_end);
+  for (size_t row = 0; row < store.size(); ++row) {
+    insert(store.handle_at(row), frames[row]);
+  }
+}
+
+void SpatialIndex::insert(Handle handle, const ShapeFrame& frame) {
+  if (!handle.is_valid()) {
+    return;
+  }
+  if (handle.slot >= entries_.size()) {
+    entries_.resize(static_cast<size_t>(handle.slot) + 1);
+  }
+  Entry& entry = entries_[handle.slot];
+  if (entry.present) {
+    unlink(handle.slot, entry);
+  } else {
+    ++count_;
+  }
+  entry.generation = handle.generation;
+  entry.present = true;
+  entry.frame = frame;
+  entry.bounds = ShapeGeometry::bounds(frame);
+  link(handle.slot, entry);
+}
+
+void SpatialIndex::update(Handle handle, const ShapeFrame& frame) {
+  if (entry_for(handle) == nullptr) {
+    return;  // Unknown handle, ignore
+  }
+  Entry& entry = entries_[handle.slot];
+  const Aabb new_bounds = ShapeGeometry::bounds(frame);
+  const CellRange new_cells = cell_range(new_bounds);
+  entry.frame = frame;
+  if (!entry.oversized && new_cells.min_x == entry.cells.min_x &&
+      new_cells.min_y == entry.cells.min_y &&
+      new_cells.max_x == entry.cells.max_x &&
+      new_cells.max_y == entry.cells.max_y) {
+    // Same cells (typical for small moves), no relinking needed
+    entry.bounds = new_bounds;
+    return;
+  }
+  unlink(handle.slot, entry);
+  entry.bounds = new_bounds;
+  link(handle.slot, entry);
+}
+
+void SpatialIndex::remove(Handle handle) {
+  if (entry_for(handle) == nullptr) {
+    return;
+  }
+  Entry& entry = entries_[handle.slot];
+  unlink(handle.slot, entry);
+  entry.present = false;
+  --count_;
+}
+
+void SpatialIndex::clear() {
+  entries_.clear();
+  cells_.clear();
+  oversized_.clear();
+  occupied_ = {};
+  count_ = 0;
+}
+
+bool SpatialIndex::contains(Handle handle) const {
+  return entry_for(handle) != nullptr;
+}
+
+auto SpatialIndex::query_box(const Aabb& box) const -> std::vector<Handle> {
+  std::vector<Handle> result;
+  visit_candidates(box, [&](uint32_t slot) {
+    const Entry& entry = entries_[slot];
+    if (entry.bounds.intersects(box) &&
+        ShapeGeometry::intersects(entry.frame, box)) {
+      result.push_back(handle_of(slot));
+    }
+  });
+  return result;
+}
+
+auto SpatialIndex::query_point(const Point2D& point) const
+  -> std::vector<Handle> {
+  std::vector<Handle> result;
+  const Aabb box{
+    .min_x = point.x, .min_y = point.y, .max_x = point.x, .max_y = point.y};
+  visit_candidates(box, [&](uint32_t slot) {
+    const Entry& entry = entries_[slot];
+    if (entry.bounds.contains(point) &&
+        ShapeGeometry::contains(entry.frame, point)) {
+      result.push_back(handle_of(slot));
+    }
+  });
+  return result;
+}
+
+auto SpatialIndex::nearest(const Point2D& point, size_t count) const
+  -> std::vector<Handle> {
+  std::vector<Handle> result;
+  if (count == 0 || count_ == 0) {
+    return result;
+  }
+
+  // Best candidates so far as a max-heap on distance
+  std::vector<std::pair<double, uint32_t>> best;
+  const auto consider = [&](uint32_t slot) {
+    const double distance =
+      ShapeGeometry::distance_to(entries_[slot].frame, point);
+    if (best.size() < count) {
+      best.emplace_back(distance, slot);
+      std::push_heap(best.begin(), best.end());
+    } else if (distance < best.front().first) {
+      std::pop_heap(best.begin(), best.end());
+      best.back() = {distance, slot};
+      std::push_heap(best.begin(), best.end());
+    }
+  };
+
+  for (const uint32_t slot : oversized_) {
+    consider(slot);
+  }
+
+  // Search rings of cells around the query cell, clipped to the occupied part
+  // of the grid. An entry first seen in ring r lies at least (r - 1) cells
+  // away, so the search stops once the k-th best distance is below that bound.
+  // Entries spanning several cells are seen more than once; keep the slots
+  // already scored.
+  if (!cells_.empty()) {
+    std::unordered_set<uint32_t> seen;
+    const int64_t origin_x = to_cell(point.x, inv_cell_size_);
+    const int64_t origin_y = to_cell(point.y, inv_cell_size_);
+    const auto visit_cell = [&](int64_t cell_x, int64_t cell_y) {
+      const auto cell_it = cells_.find(cell_key(
+        static_cast<int32_t>(cell_x), static_cast<int32_t>(cell_y)));
+      if (cell_it == cells_.end()) {
+        return;
+      }
+      for (const uint32_t slot : cell_it->second) {
+        if (seen.insert(slot).second) {
+          consider(slot);
+        }
+      }
+    };
+    const int64_t first_ring =
+      std::max({int64_t{occupied_.min_x} - origin_x,
+                origin_x - int64_t{occupied_.max_x},
+                int64_t{occupied_.min_y} - origin_y,
+                origin_y - int64_t{occupied_.max_y}, int64_t{0}});
+    const int64_t last_ring =
+      std::max({origin_x - int64_t{occupied_.min_x},
+                int64_t{occupied_.max_x} - origin_x,
+                origin_y - int64_t{occupied_.min_y},
+                int64_t{occupied_.max_y} - origin_y, int64_t{0}});
+    for (int64_t ring = first_ring; ring <= last_ring; ++ring) {
+      if (best.size() == count &&
+          best.front().first <= static_cast<double>(ring - 1) * cell_size_) {
+        break;
+      }
+      const int64_t row_min_x = std::max(origin_x - ring, int64_t{occupied_.min_x});
+      const int64_t row_max_x = std::min(origin_x + ring, int64_t{occupied_.max_x});
+      for (const int64_t cell_y : {origin_y - ring, origin_y + ring}) {
+        if (cell_y < occupied_.min_y || cell_y > occupied_.max_y) {
+          continue;
+        }
+        for (int64_t cell_x = row_min_x; cell_x <= row_max_x; ++cell_x) {
+          visit_cell(cell_x, cell_y);
+        }
+        if (ring == 0) {
+          break;  // Both rows are the same cell
+        }
+      }
+      const int64_t column_min_y =
+        std::max(origin_y - ring + 1, int64_t{occupied_.min_y});
+      const int64_t column_max_y =
+        std::min(origin_y + ring - 1, int64_t{occupied_.max_y});
+      for (const int64_t cell_x : {origin_x - ring, origin_x + ring}) {
+        if (ring == 0 || cell_x < occupied_.min_x || cell_x > occupied_.max_x) {
+          continue;
+        }
+        for (int64_t cell_y = column_min_y; cell_y <= column_max_y; ++cell_y) {
+          visit_cell(cell_x, cell_y);
+        }
+      }
+    }
+  }
+
+  std::sort_heap(best.begin(), best.end());
+  result.reserve(best.size());
+  for (const auto& [distance, slot] : best) {
+    result.push_back(handle_of(slot));
+  }
+  return result;
+}
+
+auto SpatialIndex::cell_range(const Aabb& box) const -> CellRange {
+  return CellRange{.min_x = to_cell(box.min_x, inv_cell_size_),
+                   .min_y = to_cell(box.min_y, inv_cell_size_),
+                   .max_x = to_cell(box.max_x, inv_cell_size_),
+                   .max_y = to_cell(box.max_y, inv_cell_size_)};
+}
+
+auto SpatialIndex::cell_key(int32_t cell_x, int32_t cell_y) -> uint64_t {
+  return (static_cast<uint64_t>(static_cast<uint32_t>(cell_x))
+          << kCellKeyShift) |
+         (static_cast<uint64_t>(static_cast<uint32_t>(cell_y)) &
+          kCellCoordMask);
+}
+
+void SpatialIndex::link(uint32_t slot, Entry& entry) {
+  entry.cells = cell_range(entry.bounds);
+  const int64_t cell_count =
+    (int64_t{entry.cells.max_x} - entry.cells.min_x + 1) *
+    (int64_t{entry.cells.max_y} - entry.cells.min_y + 1);
+  entry.oversized = cell_count > kMaxCellsPerEntry;
+  if (entry.oversized) {
+    oversized_.push_back(slot);
+    return;
+  }
+
+  for (int32_t cell_y = entry.cells.min_y; cell_y <= entry.cells.max_y;
+       ++cell_y) {
+    for (int32_t cell_x = entry.cells.min_x; cell_x <= entry.cells.max_x;
+         ++cell_x) {
+      cells_[cell_key(cell_x, cell_y)].push_back(slot);
+    }
+  }
+
+  if (occupied_.max_x < occupied_.min_x) {
+    occupied_ = entry.cells;
+  } else {
+    occupied_.min_x = std::min(occupied_.min_x, entry.cells.min_x);
+    occupied_.min_y = std::min(occupied_.min_y, entry.cells.min_y);
+    occupied_.max_x = std::max(occupied_.max_x, entry.cells.max_x);
+    occupied_.max_y = std::max(occupied_.max_y, entry.cells.max_y);
+  }
+}
+
+void SpatialIndex::unlink(uint32_t slot, const Entry& entry) {
+  if (entry.oversized) {
+    erase_slot(oversized_, slot);
+    return;
+  }
+  for (int32_t cell_y = entry.cells.min_y; cell_y <= entry.cells.max_y;
+       ++cell_y) {
+    for (int32_t cell_x = entry.cells.min_x; cell_x <= entry.cells.max_x;
+         ++cell_x) {
+      const auto cell_it = cells_.find(cell_key(cell_x, cell_y));
+      if (cell_it == cells_.end()) {
+        continue;
+      }
+      erase_slot(cell_it->second, slot);
+      if (cell_it->second.empty()) {
+        cells_.erase(cell_it);
+      }
+    }
+  }
+}
+
+auto SpatialIndex::entry_for(Handle handle) const -> const Entry* {
+  if (!handle.is_valid() || handle.slot >= entries_.size()) {
+    return nullptr;
+  }
+  const Entry& entry = entries_[handle.slot];
+  if (!entry.present || entry.generation != handle.generation) {
+    return nullptr;
+  }
+  return &entry;
+}
+
+auto SpatialIndex::handle_of(uint32_t slot) const -> Handle {
+  return Handle{.slot = slot, .generation = entries_[slot].generation};
+}
+
+template <typename Visitor>
+void SpatialIndex::visit_candidates(const Aabb& box, Visitor&& visit) const {
+  for (const uint32_t slot : oversized_) {
+    visit(slot);
+  }
+
+  const CellRange range = cell_range(box);
+  const int64_t cell_count = (int64_t{range.max_x} - range.min_x + 1) *
+                             (int64_t{range.max_y} - range.min_y + 1);
+  // Very large query boxes: scanning the entries beats probing empty cells
+  if (cell_count > static_cast<int64_t>(cells_.size())) {
+    for (uint32_t slot = 0; slot < entries_.size(); ++slot) {
+      if (entries_[slot].present && !entries_[slot].oversized) {
+        visit(slot);
+      }
+    }
+    return;
+  }
+
+  const bool single_cell = cell_count == 1;
+  std::vector<uint32_t> candidates;
+  for (int32_t cell_y = range.min_y; cell_y <= range.max_y; ++cell_y) {
+    for (int32_t cell_x = range.min_x; cell_x <= range.max_x; ++cell_x) {
+      const auto cell_it = cells_.find(cell_key(cell_x, cell_y));
+      if (cell_it == cells_.end()) {
+        continue;
+      }
+      if (single_cell) {
+        for (const uint32_t slot : cell_it->second) {
+          visit(slot);
+        }
+      } else {
+        candidates.insert(candidates.end(), cell_it->second.begin(),
+                          cell_it->second.end());
+      }
+    }
+  }
+  // Entries spanning several query cells must be reported once
+  std::sort(candidates.begin(), candidates.end());
+  candidates.erase(std::unique(candidates.begin(), candidates.end()),
+                   candidates.end());
+  for (const uint32_t slot : candidates) {
+    visit(slot);
+  }
+}
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "model/ShapeGeometry.h"
+#include "model/ShapeStore.h"
+#include "model/core/ModelTypes.h"
+
+/**
+ * @brief Spatial index over inclusions, keyed by ShapeStore handles.
+ *
+ * Hashed uniform grid: every entry is registered in the cells its bounding
+ * box overlaps, so insert/update/remove touch only those cells and box/point
+ * queries visit only the cells of the query. Entries much larger than a cell
+ * are kept in a separate list that every query checks. Candidates are
+ * confirmed with the exact outline (rotated rectangles, ellipses, circles,
+ * sticks) from ShapeGeometry.
+ *
+ * Queries are const and do not share scratch state, so they may run from
+ * several threads as long as nobody modifies the index at the same time.
+ */
+class SpatialIndex {
+ public:
+  using Handle = ShapeStore::Handle;
+
+  static constexpr double kDefaultCellSize = 128.0;
+
+  explicit SpatialIndex(double cell_size = kDefaultCellSize);
+
+  double cell_size() const {
+    return cell_size_;
+  }
+  /**
+   * @brief Change the grid resolution and re-register all entries.
+   */
+  void set_cell_size(double cell_size);
+
+  /**
+   * @brief Rebuild from scratch for all rows of the store, picking a cell size
+   * from the average inclusion extent.
+   */
+  void rebuild(const ShapeStore& store);
+
+  void insert(Handle handle, const ShapeFrame& frame);
+  void update(Handle handle, const ShapeFrame& frame);
+  void remove(Handle handle);
+  void clear();
+
+  size_t size() const {
+    return count_;
+  }
+  bool empty() const {
+    return count_ == 0;
+  }
+  bool contains(Handle handle) const;
+
+  /**
+   * @brief Handles whose outline intersects the box.
+   */
+  auto query_box(const Aabb& box) const -> std::vector<Handle>;
+
+  /**
+   * @brief Handles whose outline contains the point.
+   */
+  auto query_point(const Point2D& point) const -> std::vector<Handle>;
+
+  /**
+   * @brief Up to k handles ordered by distance from the point to their
+   * outline (0 for outlines containing the point).
+   */
+  auto nearest(const Point2D& point, size_t count) const
+    -> std::vector<Handle>;
+
+ private:
+  struct CellRange {
+    int32_t min_x{0};
+    int32_t min_y{0};
+    int32_t max_x{-1};
+    int32_t max_y{-1};
+  };
+
+  struct Entry {
+    uint32_t generation{0};
+    bool present{false};
+    bool oversized{false};
+    ShapeFrame frame;
+    Aabb bounds;
+    CellRange cells;
+  };
+
+  auto cell_range(const Aabb& box) const -> CellRange;
+  static auto cell_key(int32_t cell_x, int32_t cell_y) -> uint64_t;
+  void link(uint32_t slot, Entry& entry);
+  void unlink(uint32_t slot, const Entry& entry);
+  auto entry_for(Handle handle) const -> const Entry*;
+  auto handle_of(uint32_t slot) const -> Handle;
+  // Calls visit(slot) for every distinct candidate overlapping the box
+  template <typename Visitor>
+  void visit_candidates(const Aabb& box, Visitor&& visit) const;
+
+  double cell_size_;
+  double inv_cell_size_;
+  size_t count_{0};
+  std::vector<Entry> entries_;  // Indexed by handle slot
+  std::unordered_map<uint64_t, std::vector<uint32_t>> cells_;
+  std::vector<uint32_t> oversized_;
+  // Cell range covering all non-oversized entries (grown, never shrunk)
+  CellRange occupied_;
+};
@@ -3,7 +3,7 @@
 #include "model/core/ModelObject.h"
 #include "model/core/ModelTypes.h"
 
-class SubstrateModel : public ModelObject {
+class SubstrateModel : public NamedModelObject {
  public:
   SubstrateModel(const Size2D& size = {}, const Color& color = {});
 
@@ -2,8 +2,8 @@
 
 #include <atomic>
 #include <cstdint>
-#include <sstream>
 #include <string>
+#include <string_view>
 
 #include "model/core/ModelTypes.h"
 
@@ -14,35 +14,35 @@ std::atomic<uint64_t> g_id_counter{0};
 
 ModelObject::ModelObject() : id_(GenerateId()) {}
 
-void ModelObject::set_name(const std::string& name) {
-  // Trim whitespace from name
-  std::string trimmed = name;
-  const size_t first = trimmed.find_first_not_of(" \t\n\r");
-  if (first != std::string::npos) {
-    trimmed.erase(0, first);
-    const size_t last = trimmed.find_last_not_of(" \t\n\r");
-    if (last != std::string::npos) {
-      trimmed.erase(last + 1);
-    }
-  } else {
+auto ModelObject::trimmed_name(std::string_view name) -> std::string_view {
+  constexpr std::string_view kWhitespace = " \t\n\r";
+  const size_t first = name.find_first_not_of(kWhitespace);
+  if (first == std::string_view::npos) {
     // String contains only whitespace
-    trimmed.clear();
+    return {};
   }
+  const size_t last = name.find_last_not_of(kWhitespace);
+  return name.substr(first, last - first + 1);
+}
 
+void NamedModelObject::set_name(const std::string& name) {
+  const std::string_view trimmed = trimmed_name(name);
   if (trimmed == name_) {
     return;
   }
-  name_ = trimmed;
-  notify_change(ModelChange{.type=ModelChange::Type::NameChanged, .property="name"});
+  name_.assign(trimmed);
+  notify_change(
+    ModelChange{.type = ModelChange::Type::NameChanged, .property = "name"});
 }
 
 void ModelObject::notify_change(const ModelChange& change) const {
   changed_signal_.emit_signal(change);
 }
 
-auto ModelObject::GenerateId() -> std::string {
-  const uint64_t value = ++g_id_counter;
-  std::ostringstream oss;
-  oss << "obj-" << value;
-  return oss.str();
+auto ModelObject::id_string() const -> std::string {
+  return "obj-" + std::to_string(id_);
+}
+
+auto ModelObject::GenerateId() -> Id {
+  return g_id_counter.fetch_add(1, std::memory_order_relaxed) + 1;
 }
@@ -1,27 +1,34 @@
 #pragma once
 
-#include <atomic>
+#include <cstdint>
 #include <string>
+#include <string_view>
 
 #include "model/core/ModelTypes.h"
 #include "model/core/Signal.h"
 
 /**
- * @brief Base class for all pure models. Provides id, name and change signals.
+ * @brief Base class for all pure models. Provides id and change signals.
  */
 class ModelObject {
  public:
   ModelObject();
   virtual ~ModelObject() = default;
 
-  const std::string& id() const {
+  /**
+   * @brief Process-wide unique id. Ids are never reused, so an id also
+   * identifies objects that have left their document (e.g. held by undo
+   * commands).
+   */
+  using Id = uint64_t;
+  Id id() const {
     return id_;
   }
-
-  const std::string& name() const {
-    return name_;
-  }
-  void set_name(const std::string& name);
+  /**
+   * @brief Textual form of id() ("obj-<n>") for serialization, formatted on
+   * demand.
+   */
+  auto id_string() const -> std::string;
 
   using ChangeSignal = Signal<const ModelChange&>;
   ChangeSignal& on_changed() {
@@ -30,11 +37,27 @@ class ModelObject {
 
  protected:
   void notify_change(const ModelChange& change) const;
+  // Name without leading and trailing whitespace, as set_name() stores it
+  static auto trimmed_name(std::string_view name) -> std::string_view;
 
  private:
-  static auto GenerateId() -> std::string;
+  static auto GenerateId() -> Id;
 
-  std::string id_;
-  std::string name_{"New inclusion"};
+  Id id_;
   mutable ChangeSignal changed_signal_;
 };
+
+/**
+ * @brief Model that keeps its name itself (materials, the substrate). Shapes
+ * keep theirs in the document's ShapeStore.
+ */
+class NamedModelObject : public ModelObject {
+ public:
+  const std::string& name() const {
+    return name_;
+  }
+  void set_name(const std::string& name);
+
+ private:
+  std::string name_{"New inclusion"};
+};
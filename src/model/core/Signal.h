@@ -1,16 +1,30 @@
 #pragma once
 
 #include <algorithm>
+#include <atomic>
+#include <cstddef>
 #include <functional>
 #include <limits>
+#include <memory>
 #include <mutex>
+#include <utility>
 #include <vector>
 
 /**
  * @brief Lightweight signal/slot helper independent from Qt.
  *
- * Provides simple connect/disconnect semantics. Thread-safety is ensured with a
- * mutex.
+ * Provides simple connect/disconnect semantics. Connected slots are kept in an
+ * immutable list that connect() and disconnect() replace as a whole
+ * (copy-on-write, serialized by a mutex) and publish through an atomic
+ * pointer. emit_signal() neither locks nor allocates: it marks itself active,
+ * loads the current list and calls it. A replaced list is freed by the first
+ * connect() or disconnect() that sees no emission running, so an emission
+ * never loses the list it is iterating (threads that emit without pause keep
+ * replaced lists allocated until they do pause).
+ *
+ * A slot connected or disconnected during an emission (by a slot or by another
+ * thread) takes effect from the next emission on; the running emission keeps
+ * calling the list it started with.
  *
  * @note Exceptions thrown by slots are not caught - they will propagate and
  * prevent remaining slots from being called.
@@ -20,6 +34,10 @@ class Signal {
  public:
   using Slot = std::function<void(Args...)>;
 
+  Signal() = default;
+  Signal(const Signal&) = delete;
+  Signal& operator=(const Signal&) = delete;
+
   /**
    * @brief Connect slot to signal.
    * @return connection id (for disconnect), or -1 if ID counter overflowed.
@@ -32,7 +50,13 @@ class Signal {
       last_id_ = 0;
     }
     const int id = ++last_id_;
-    slots_.emplace_back(id, std::move(slot));
+    auto slots = std::make_unique<SlotList>();
+    if (current_) {
+      slots->reserve(current_->size() + 1);
+      *slots = *current_;
+    }
+    slots->emplace_back(id, std::move(slot));
+    publish(std::move(slots));
     return id;
   }
 
@@ -42,10 +66,19 @@ class Signal {
    */
   void disconnect(int id) {
     std::scoped_lock lock(mutex_);
-    auto it =
-      std::remove_if(slots_.begin(), slots_.end(),
-                     [id](const auto& pair) { return pair.first == id; });
-    slots_.erase(it, slots_.end());
+    if (!current_ ||
+        std::none_of(current_->begin(), current_->end(),
+                     [id](const auto& pair) { return pair.first == id; })) {
+      return;
+    }
+    auto slots = std::make_unique<SlotList>();
+    slots->reserve(current_->size() - 1);
+    for (const auto& pair : *current_) {
+      if (pair.first != id) {
+        slots->push_back(pair);
+      }
+    }
+    publish(std::move(slots));
   }
 
   /**
@@ -53,7 +86,7 @@ class Signal {
    */
   void disconnect_all() {
     std::scoped_lock lock(mutex_);
-    slots_.clear();
+    publish(nullptr);
   }
 
   /**
@@ -62,7 +95,7 @@ class Signal {
    */
   size_t slot_count() const {
     std::scoped_lock lock(mutex_);
-    return slots_.size();
+    return current_ ? current_->size() : 0;
   }
 
   /**
@@ -70,8 +103,7 @@ class Signal {
    * @return true if at least one slot is connected.
    */
   bool has_slots() const {
-    std::scoped_lock lock(mutex_);
-    return !slots_.empty();
+    return slots_.load(std::memory_order_acquire) != nullptr;
   }
 
   /**
@@ -81,25 +113,67 @@ class Signal {
    * @note Slots are called in the order they were connected.
    */
   void emit_signal(Args... args) const {
-    std::vector<Slot> copy;
-    {
-      std::scoped_lock lock(mutex_);
-      copy.reserve(slots_.size());
-      for (const auto& pair : slots_) {
-        copy.emplace_back(pair.second);
-      }
+    if (slots_.load(std::memory_order_acquire) == nullptr) {
+      return;  // Nothing connected; the list is not dereferenced
     }
-    // Call slots outside of lock to avoid deadlocks if slots try to
-    // connect/disconnect
-    for (const auto& slot : copy) {
-      if (slot) {  // Check if slot is valid
-        slot(args...);
+    // Marked active before loading the list: a writer that replaces it
+    // afterwards sees the emission and keeps the old list alive
+    const ActiveEmission active(active_emissions_);
+    const SlotList* slots = slots_.load();
+    if (slots == nullptr) {
+      return;
+    }
+    for (const auto& pair : *slots) {
+      if (pair.second) {  // Check if slot is valid
+        pair.second(args...);
       }
     }
   }
 
  private:
+  using SlotList = std::vector<std::pair<int, Slot>>;
+
+  class ActiveEmission {
+   public:
+    explicit ActiveEmission(std::atomic<int>& count) : count_(count) {
+      count_.fetch_add(1);
+    }
+    ~ActiveEmission() {
+      count_.fetch_sub(1);
+    }
+
+    ActiveEmission(const ActiveEmission&) = delete;
+    ActiveEmission& operator=(const ActiveEmission&) = delete;
+
+   private:
+    std::atomic<int>& count_;
+  };
+
+  // Called with mutex_ held. Empty lists are published as nullptr so that
+  // idle signals cost one load.
+  void publish(std::unique_ptr<SlotList> slots) {
+    if (slots && slots->empty()) {
+      slots.reset();
+    }
+    // Sequentially consistent with the emission's increment and load: an
+    // emission that was not counted below loads the new list
+    slots_.store(slots.get());
+    if (current_) {
+      retired_.push_back(std::move(current_));
+    }
+    current_ = std::move(slots);
+    if (active_emissions_.load() == 0) {
+      retired_.clear();
+    }
+  }
+
+  // Serializes connect() and disconnect(); emission never takes it
   mutable std::mutex mutex_;
-  std::vector<std::pair<int, Slot>> slots_;
+  std::atomic<const SlotList*> slots_{nullptr};
+  mutable std::atomic<int> active_emissions_{0};
+  // Owner of the published list and of replaced lists that an emission may
+  // still be iterating
+  std::unique_ptr<const SlotList> current_;
+  std::vector<std::unique_ptr<const SlotList>> retired_;
   int last_id_{0};
 };
@@ -0,0 +1,29 @@
+#include "scene/ISceneObject.h"
+
+#include <QGraphicsItem>
+
+#include "scene/items/CircleItem.h"
+#include "scene/items/EllipseItem.h"
+#include "scene/items/RectangleItem.h"
+#include "scene/items/StickItem.h"
+#include "ui/editor/SubstrateItem.h"
+
+ISceneObject* scene_object_cast(QGraphicsItem* item) {
+  if (item == nullptr) {
+    return nullptr;
+  }
+  switch (item->type()) {
+    case RectangleItem::Type:
+      return static_cast<RectangleItem*>(item);
+    case EllipseItem::Type:
+      return static_cast<EllipseItem*>(item);
+    case CircleItem::Type:
+      return static_cast<CircleItem*>(item);
+    case StickItem::Type:
+      return static_cast<StickItem*>(item);
+    case SubstrateItem::Type:
+      return static_cast<SubstrateItem*>(item);
+    default:
+      return nullptr;
+  }
+}
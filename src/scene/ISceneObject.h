@@ -1,7 +1,9 @@
 #pragma once
 
+#include <cstdint>
 #include <functional>
 
+class QGraphicsItem;
 class QWidget;
 class QJsonObject;
 class QString;
@@ -15,8 +17,30 @@ class QString;
  */
 class ISceneObject {
  public:
+  /**
+   * @brief Concrete kind of a scene object, so that hot paths can dispatch
+   * with a switch and static_cast instead of chains of dynamic_cast.
+   */
+  enum class Kind : uint8_t { Rectangle, Ellipse, Circle, Stick, Substrate };
+
+  /**
+   * @brief QGraphicsItem::type() of a kind: after QGraphicsItem::UserType
+   * (65536), so that scene_object_cast() can recognize the items.
+   */
+  static constexpr int item_type(Kind kind) {
+    return kFirstItemType + static_cast<int>(kind);
+  }
+
   virtual ~ISceneObject() = default;
 
+  virtual Kind kind() const = 0;
+
+  /**
+   * @brief The object as a graphics item (every scene object is one).
+   */
+  virtual QGraphicsItem* graphics_item() = 0;
+  virtual const QGraphicsItem* graphics_item() const = 0;
+
   /**
    * @brief Create a widget with controls for this object's properties.
    * @param parent Parent widget for the created widget.
@@ -75,4 +99,13 @@ class ISceneObject {
    * @param material Pointer to material model (can be nullptr for no material).
    */
   virtual void set_material_model(class MaterialModel* material) = 0;
+
+ private:
+  static constexpr int kFirstItemType = 65536 + 1;
 };
+
+/**
+ * @brief Scene object of a graphics item without RTTI (by
+ * QGraphicsItem::type()), or nullptr for other items.
+ */
+ISceneObject* scene_object_cast(QGraphicsItem* item);
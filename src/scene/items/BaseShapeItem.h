@@ -5,6 +5,7 @@
 #include <functional>
 
 #include "scene/ISceneObject.h"
+#include "scene/items/GridPathCache.h"
 
 class MaterialModel;
 
@@ -15,18 +16,36 @@ class MaterialModel;
  * This template class provides common implementation for:
  * - Name management
  * - Geometry change callbacks
- * - Material model storage
+ * - Material model storage and cached grid geometry
  * - Common itemChange handling
+ * - Kind tag and QGraphicsItem::type() for cast-free dispatch
  *
  * @tparam BaseGraphicsItem The Qt graphics item base class (QGraphicsRectItem,
  * QGraphicsEllipseItem, QGraphicsLineItem, etc.)
+ * @tparam kKind Kind reported by kind() and, through item_type(), by type()
  */
-template <typename BaseGraphicsItem>
+template <typename BaseGraphicsItem, ISceneObject::Kind kKind>
 class BaseShapeItem : public BaseGraphicsItem, public ISceneObject {
  public:
   using BaseGraphicsItem::BaseGraphicsItem;
 
+  // Used by qgraphicsitem_cast
+  static constexpr int Type = ISceneObject::item_type(kKind);
+  int type() const override {
+    return Type;
+  }
+
   // ISceneObject interface
+  Kind kind() const override {
+    return kKind;
+  }
+  QGraphicsItem* graphics_item() override {
+    return this;
+  }
+  const QGraphicsItem* graphics_item() const override {
+    return this;
+  }
+
   QString name() const override {
     return name_;
   }
@@ -49,6 +68,7 @@ class BaseShapeItem : public BaseGraphicsItem, public ISceneObject {
 
   void set_material_model(MaterialModel* material) override {
     material_model_ = material;
+    grid_path_cache_.invalidate();
     BaseGraphicsItem::update();  // Trigger repaint to show/hide grid
   }
 
@@ -70,6 +90,13 @@ class BaseShapeItem : public BaseGraphicsItem, public ISceneObject {
     return material_model_;
   }
 
+  /**
+   * @brief Cached material grid geometry for paint().
+   */
+  GridPathCache& grid_path_cache() const {
+    return grid_path_cache_;
+  }
+
   /**
    * @brief Common itemChange implementation that notifies on geometry changes.
    * Derived classes should call this from their itemChange override.
@@ -86,4 +113,5 @@ class BaseShapeItem : public BaseGraphicsItem, public ISceneObject {
   QString name_;
   std::function<void()> geometry_changed_callback_;
   MaterialModel* material_model_{nullptr};
+  mutable GridPathCache grid_path_cache_;
 };
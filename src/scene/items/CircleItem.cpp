@@ -13,8 +13,12 @@
 #include <QVariant>
 #include <QtMath>
 #include <cmath>
+#include <numbers>
 
 #include "model/MaterialModel.h"
+#include "scene/items/GridPathCache.h"
+#include "scene/items/LevelOfDetail.h"
+#include "scene/items/StaticLayer.h"
 
 namespace {
 constexpr double kMinRadiusPx = 1.0;
@@ -30,6 +34,7 @@ constexpr double kRotationSpinStep = 5.0;
 constexpr int kGridPenAlpha = 255;
 constexpr double kGridPenWidth = 0.5;
 constexpr double kFullCircleDegrees = 360.0;
+constexpr double kTwoPi = 2.0 * std::numbers::pi;
 // Grid ring parameters (as fraction of radius)
 constexpr double kInnerRingStartRatio =
   0.5;  // Inner ring starts at 50% of radius
@@ -37,11 +42,84 @@ constexpr double kOuterRingExtendRatio =
   0.5;  // Outer ring extends 50% of radius beyond boundary
 constexpr double kBoundaryRingMargin =
   0.02;  // Margin for boundary ring to avoid overlap (2% of radius)
+
+// Spacing of the concentric rings; the inner and outer ring are equally wide
+qreal ring_spacing(qreal radius, double freq_concentric) {
+  return radius * kOuterRingExtendRatio /
+         (freq_concentric + 1);  // +1 accounts for boundary circle
+}
+
+// Concentric circles and radial lines of the grid, thinned by the key's
+// strides (x: radial lines, y: rings)
+QPainterPath radial_grid_path(const GridPathKey& key) {
+  QPainterPath path;
+  const QPointF center = key.rect.center();
+  const qreal radius = key.rect.width() / kRadiusDivisor;
+
+  // Calculate ring boundaries
+  const qreal inner_ring_start_radius = radius * kInnerRingStartRatio;
+  const qreal inner_ring_end_radius = radius;
+  const qreal outer_ring_start_radius = radius;
+  const qreal outer_ring_end_radius = radius * (1.0 + kOuterRingExtendRatio);
+  const qreal boundary_margin = radius * kBoundaryRingMargin;
+
+  // Concentric circles first (so radial lines appear on top)
+
+  // Inner ring concentric circles
+  const qreal inner_ring_width =
+    inner_ring_end_radius - inner_ring_start_radius;
+  const qreal inner_spacing =
+    inner_ring_width /
+    (key.frequency_y + 1);  // +1 accounts for boundary circle
+  const qreal first_inner_radius =
+    inner_ring_start_radius +
+    inner_spacing;  // First circle (closest to center)
+  qreal current_inner_radius = first_inner_radius;
+  while (current_inner_radius < inner_ring_end_radius - boundary_margin) {
+    path.addEllipse(center, current_inner_radius, current_inner_radius);
+    current_inner_radius += inner_spacing * key.stride_y;
+  }
+
+  // Inner ring boundary circle
+  path.addEllipse(center, inner_ring_end_radius, inner_ring_end_radius);
+
+  // Main boundary circle
+  path.addEllipse(center, radius, radius);
+
+  // Outer ring concentric circles
+  const qreal outer_spacing = ring_spacing(radius, key.frequency_y);
+  qreal current_outer_radius =
+    outer_ring_start_radius + boundary_margin + outer_spacing;
+  qreal last_outer_radius =
+    outer_ring_start_radius +
+    boundary_margin;  // Last circle (farthest from center)
+  while (current_outer_radius < outer_ring_end_radius) {
+    path.addEllipse(center, current_outer_radius, current_outer_radius);
+    last_outer_radius = current_outer_radius;
+    current_outer_radius += outer_spacing * key.stride_y;
+  }
+
+  // Radial lines (after circles so they appear on top)
+  const int num_radial_lines = static_cast<int>(key.frequency_x);
+  for (int i = 0; i < num_radial_lines; i += key.stride_x) {
+    const qreal radians =
+      qDegreesToRadians((kFullCircleDegrees * i) / num_radial_lines);
+    const QPointF direction(qCos(radians), qSin(radians));
+
+    // Inner ring: from first circle to boundary
+    path.moveTo(center + first_inner_radius * direction);
+    path.lineTo(center + inner_ring_end_radius * direction);
+
+    // Outer ring: from boundary to last circle
+    path.moveTo(center + outer_ring_start_radius * direction);
+    path.lineTo(center + last_outer_radius * direction);
+  }
+  return path;
+}
 }  // namespace
 
 CircleItem::CircleItem(qreal radius, QGraphicsItem* parent)
-    : BaseShapeItem<QGraphicsEllipseItem>(
-        QRectF(-radius, -radius, 2 * radius, 2 * radius), parent) {
+    : BaseShapeItem(QRectF(-radius, -radius, 2 * radius, 2 * radius), parent) {
   setFlags(QGraphicsItem::ItemIsSelectable | QGraphicsItem::ItemIsMovable |
            QGraphicsItem::ItemSendsGeometryChanges);
   setPen(QPen(Qt::black, 1.0));
@@ -164,6 +242,16 @@ void CircleItem::from_json(const QJsonObject& json) {
 void CircleItem::paint(QPainter* painter,
                        const QStyleOptionGraphicsItem* option,
                        QWidget* widget) {
+  if (skip_paint(*this, widget)) {
+    return;
+  }
+  const qreal lod = QStyleOptionGraphicsItem::levelOfDetailFromTransform(
+    painter->worldTransform());
+  if (draw_simplified(painter, rect(), brush(), SimplifiedShape::Ellipse,
+                      lod)) {
+    return;
+  }
+
   // Draw the base ellipse first
   QGraphicsEllipseItem::paint(painter, option, widget);
 
@@ -176,18 +264,41 @@ void CircleItem::paint(QPainter* painter,
     const qreal extend = radius * kOuterRingExtendRatio;
     const QRectF extended_rect =
       base_rect.adjusted(-extend, -extend, extend, extend);
-    draw_radial_grid(painter, extended_rect, base_rect);
+    if (grid_visible(extended_rect.width(), lod)) {
+      draw_radial_grid(painter, extended_rect, base_rect, lod);
+    }
   }
 }
 
 void CircleItem::draw_radial_grid(QPainter* painter,
                                   const QRectF& /*extendedRect*/,
-                                  const QRectF& baseRect) const {
+                                  const QRectF& baseRect, qreal lod) const {
   auto* material = material_model();
   if (material == nullptr) {
     return;
   }
 
+  const qreal radius = baseRect.width() / kRadiusDivisor;
+  const double freq_radial = material->grid_frequency_x();
+  const double freq_concentric =
+    material->grid_frequency_y();  // Used for both inner and outer rings
+  const int num_radial_lines = static_cast<int>(freq_radial);
+  // Rings and lines closer than the LOD threshold on screen are thinned;
+  // radial lines are farthest apart at the outer edge of the grid
+  const qreal outer_circumference =
+    kTwoPi * radius * (1.0 + kOuterRingExtendRatio);
+  const GridPathKey key{
+    .rect = baseRect,
+    .frequency_x = freq_radial,
+    .frequency_y = freq_concentric,
+    .stride_x =
+      num_radial_lines > 0
+        ? grid_line_stride(outer_circumference / num_radial_lines, lod)
+        : 1,
+    .stride_y = grid_line_stride(ring_spacing(radius, freq_concentric), lod)};
+  const QPainterPath& grid = grid_path_cache().path(
+    key, [&key] { return radial_grid_path(key); });
+
   painter->save();
 
   // Remove clipping to allow drawing outside base rect
@@ -199,93 +310,7 @@ void CircleItem::draw_radial_grid(QPainter* painter,
   QPen grid_pen(QColor(0, 0, 0, kGridPenAlpha));
   grid_pen.setWidthF(kGridPenWidth);
   painter->setPen(grid_pen);
-
-  const QPointF center = baseRect.center();
-  const qreal radius = baseRect.width() / kRadiusDivisor;
-  const double freq_radial = material->grid_frequency_x();
-  const double freq_concentric =
-    material->grid_frequency_y();  // Used for both inner and outer rings
-
-  // Calculate ring boundaries
-  const qreal inner_ring_start_radius = radius * kInnerRingStartRatio;
-  const qreal inner_ring_end_radius = radius;
-  const qreal outer_ring_start_radius = radius;
-  const qreal outer_ring_end_radius = radius * (1.0 + kOuterRingExtendRatio);
-  const qreal boundary_margin = radius * kBoundaryRingMargin;
-
-  // Draw concentric circles first (so radial lines appear on top)
-
-  // Draw inner ring concentric circles
-  const qreal inner_ring_width =
-    inner_ring_end_radius - inner_ring_start_radius;
-  const qreal inner_spacing =
-    inner_ring_width /
-    (freq_concentric + 1);  // +1 accounts for boundary circle
-  const qreal first_inner_radius =
-    inner_ring_start_radius +
-    inner_spacing;  // First circle (closest to center)
-  qreal current_inner_radius = first_inner_radius;
-  while (current_inner_radius < inner_ring_end_radius - boundary_margin) {
-    painter->drawEllipse(center, current_inner_radius, current_inner_radius);
-    current_inner_radius += inner_spacing;
-  }
-
-  // Draw inner ring boundary circle
-  painter->drawEllipse(center, inner_ring_end_radius, inner_ring_end_radius);
-
-  // Draw main boundary circle
-  painter->drawEllipse(center, radius, radius);
-
-  // Draw outer ring concentric circles
-  const qreal outer_ring_width =
-    outer_ring_end_radius - outer_ring_start_radius;
-  const qreal outer_spacing =
-    outer_ring_width /
-    (freq_concentric + 1);  // +1 accounts for boundary circle
-  qreal current_outer_radius =
-    outer_ring_start_radius + boundary_margin + outer_spacing;
-  qreal last_outer_radius =
-    outer_ring_start_radius +
-    boundary_margin;  // Last circle (farthest from center)
-  while (current_outer_radius < outer_ring_end_radius) {
-    painter->drawEllipse(center, current_outer_radius, current_outer_radius);
-    last_outer_radius = current_outer_radius;
-    current_outer_radius += outer_spacing;
-  }
-
-  // Draw radial lines (after circles so they appear on top)
-  const int num_radial_lines = static_cast<int>(freq_radial);
-  // Precompute angles to avoid repeated calculations
-  QVector<qreal> angles(num_radial_lines);
-  QVector<qreal> cos_values(num_radial_lines);
-  QVector<qreal> sin_values(num_radial_lines);
-  for (int i = 0; i < num_radial_lines; ++i) {
-    angles[i] = (kFullCircleDegrees * i) / num_radial_lines;
-    const qreal radians = qDegreesToRadians(angles[i]);
-    cos_values[i] = qCos(radians);
-    sin_values[i] = qSin(radians);
-  }
-
-  for (int i = 0; i < num_radial_lines; ++i) {
-    const qreal cos_a = cos_values[i];
-    const qreal sin_a = sin_values[i];
-
-    // Inner ring: from first circle to boundary
-    const QPointF inner_start =
-      center + QPointF(first_inner_radius * cos_a, first_inner_radius * sin_a);
-    const QPointF inner_end = center + QPointF(inner_ring_end_radius * cos_a,
-                                               inner_ring_end_radius * sin_a);
-    painter->drawLine(inner_start, inner_end);
-
-    // Outer ring: from boundary to last circle
-    const QPointF outer_start =
-      center +
-      QPointF(outer_ring_start_radius * cos_a, outer_ring_start_radius * sin_a);
-    const QPointF outer_end =
-      center + QPointF(last_outer_radius * cos_a, last_outer_radius * sin_a);
-    painter->drawLine(outer_start, outer_end);
-  }
-
+  painter->drawPath(grid);
   painter->restore();
 }
 
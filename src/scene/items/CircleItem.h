@@ -5,7 +5,8 @@
 #include "scene/ISceneObject.h"
 #include "scene/items/BaseShapeItem.h"
 
-class CircleItem : public BaseShapeItem<QGraphicsEllipseItem> {
+class CircleItem
+    : public BaseShapeItem<QGraphicsEllipseItem, ISceneObject::Kind::Circle> {
  public:
   explicit CircleItem(qreal radius, QGraphicsItem* parent = nullptr);
   ~CircleItem() override = default;
@@ -29,5 +30,5 @@ class CircleItem : public BaseShapeItem<QGraphicsEllipseItem> {
 
  private:
   void draw_radial_grid(QPainter* painter, const QRectF& extendedRect,
-                        const QRectF& baseRect) const;
+                        const QRectF& baseRect, qreal lod) const;
 };
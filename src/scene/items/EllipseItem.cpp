@@ -13,8 +13,12 @@
 #include <QVariant>
 #include <QtMath>
 #include <cmath>
+#include <numbers>
 
 #include "model/MaterialModel.h"
+#include "scene/items/GridPathCache.h"
+#include "scene/items/LevelOfDetail.h"
+#include "scene/items/StaticLayer.h"
 
 namespace {
 constexpr double kMinSizePx = 1.0;
@@ -29,6 +33,7 @@ constexpr double kRotationSpinStep = 5.0;
 constexpr int kGridPenAlpha = 255;
 constexpr double kGridPenWidth = 0.5;
 constexpr double kFullCircleDegrees = 360.0;
+constexpr double kTwoPi = 2.0 * std::numbers::pi;
 // Grid ring parameters (as fraction of radius)
 constexpr double kInnerRingStartRatio =
   0.5;  // Inner ring starts at 50% of radius
@@ -36,10 +41,109 @@ constexpr double kOuterRingExtendRatio =
   0.5;  // Outer ring extends 50% of radius beyond boundary
 constexpr double kBoundaryRingMargin =
   0.02;  // Margin for boundary ring to avoid overlap (2% of radius)
+
+// Spacing of the concentric rings along the longer axis; the inner and outer
+// ring are equally wide
+qreal ring_spacing(qreal max_radius, double freq_concentric) {
+  return max_radius * kOuterRingExtendRatio /
+         (freq_concentric + 1);  // +1 accounts for boundary ellipse
+}
+
+// Concentric ellipses and radial lines of the grid, thinned by the key's
+// strides (x: radial lines, y: rings)
+QPainterPath radial_grid_path(const GridPathKey& key) {
+  QPainterPath path;
+  const QPointF center = key.rect.center();
+  const qreal half_width = key.rect.width() / 2.0;
+  const qreal half_height = key.rect.height() / 2.0;
+  const qreal max_radius = qMax(half_width, half_height);
+
+  // Calculate ring boundaries (using max_radius as reference)
+  const qreal inner_ring_start_radius = max_radius * kInnerRingStartRatio;
+  const qreal inner_ring_end_radius = max_radius;
+  const qreal outer_ring_start_radius = max_radius;
+  const qreal outer_ring_end_radius =
+    max_radius * (1.0 + kOuterRingExtendRatio);
+  const qreal boundary_margin = max_radius * kBoundaryRingMargin;
+
+  // Ellipse similar to the item's, scaled about its center
+  auto scaled_rect = [&](qreal scale) {
+    return QRectF(center.x() - half_width * scale,
+                  center.y() - half_height * scale, half_width * scale * 2,
+                  half_height * scale * 2);
+  };
+  // Point on the scaled ellipse in a direction given by its cosine and sine
+  auto ellipse_point = [&](qreal scale, qreal cos_a, qreal sin_a) -> QPointF {
+    const qreal ellipse_a = half_width * scale;
+    const qreal ellipse_b = half_height * scale;
+    const qreal radius =
+      (ellipse_a * ellipse_b) / qSqrt(ellipse_b * ellipse_b * cos_a * cos_a +
+                                      ellipse_a * ellipse_a * sin_a * sin_a);
+    return center + QPointF(radius * cos_a, radius * sin_a);
+  };
+
+  // Concentric ellipses first (so radial lines appear on top)
+
+  // Inner ring concentric ellipses
+  const qreal inner_ring_width =
+    inner_ring_end_radius - inner_ring_start_radius;
+  const qreal inner_spacing =
+    inner_ring_width /
+    (key.frequency_y + 1);  // +1 accounts for boundary ellipse
+  const qreal first_inner_radius =
+    inner_ring_start_radius +
+    inner_spacing;  // First ellipse (closest to center)
+  qreal current_inner_radius = first_inner_radius;
+  while (current_inner_radius < inner_ring_end_radius - boundary_margin) {
+    path.addEllipse(scaled_rect(current_inner_radius / max_radius));
+    current_inner_radius += inner_spacing * key.stride_y;
+  }
+
+  // Inner ring boundary ellipse
+  path.addEllipse(scaled_rect(inner_ring_end_radius / max_radius));
+
+  // Main boundary ellipse
+  path.addEllipse(key.rect);
+
+  // Outer ring concentric ellipses
+  const qreal outer_spacing = ring_spacing(max_radius, key.frequency_y);
+  qreal current_outer_radius =
+    outer_ring_start_radius + boundary_margin + outer_spacing;
+  qreal last_outer_radius =
+    outer_ring_start_radius +
+    boundary_margin;  // Last ellipse (farthest from center)
+  while (current_outer_radius < outer_ring_end_radius) {
+    path.addEllipse(scaled_rect(current_outer_radius / max_radius));
+    last_outer_radius = current_outer_radius;
+    current_outer_radius += outer_spacing * key.stride_y;
+  }
+
+  // Radial lines (after ellipses so they appear on top)
+  const qreal first_inner_scale = first_inner_radius / max_radius;
+  const qreal inner_end_scale = inner_ring_end_radius / max_radius;
+  const qreal outer_start_scale = outer_ring_start_radius / max_radius;
+  const qreal last_outer_scale = last_outer_radius / max_radius;
+  const int num_radial_lines = static_cast<int>(key.frequency_x);
+  for (int i = 0; i < num_radial_lines; i += key.stride_x) {
+    const qreal radians =
+      qDegreesToRadians((kFullCircleDegrees * i) / num_radial_lines);
+    const qreal cos_a = qCos(radians);
+    const qreal sin_a = qSin(radians);
+
+    // Inner ring: from first ellipse to boundary
+    path.moveTo(ellipse_point(first_inner_scale, cos_a, sin_a));
+    path.lineTo(ellipse_point(inner_end_scale, cos_a, sin_a));
+
+    // Outer ring: from boundary to last ellipse
+    path.moveTo(ellipse_point(outer_start_scale, cos_a, sin_a));
+    path.lineTo(ellipse_point(last_outer_scale, cos_a, sin_a));
+  }
+  return path;
+}
 }  // namespace
 
 EllipseItem::EllipseItem(const QRectF& rect, QGraphicsItem* parent)
-    : BaseShapeItem<QGraphicsEllipseItem>(rect, parent) {
+    : BaseShapeItem(rect, parent) {
   setFlags(QGraphicsItem::ItemIsSelectable | QGraphicsItem::ItemIsMovable |
            QGraphicsItem::ItemSendsGeometryChanges);
   setPen(QPen(Qt::black, 1.0));
@@ -184,6 +288,16 @@ void EllipseItem::from_json(const QJsonObject& json) {
 void EllipseItem::paint(QPainter* painter,
                         const QStyleOptionGraphicsItem* option,
                         QWidget* widget) {
+  if (skip_paint(*this, widget)) {
+    return;
+  }
+  const qreal lod = QStyleOptionGraphicsItem::levelOfDetailFromTransform(
+    painter->worldTransform());
+  if (draw_simplified(painter, rect(), brush(), SimplifiedShape::Ellipse,
+                      lod)) {
+    return;
+  }
+
   // Draw the base ellipse first
   QGraphicsEllipseItem::paint(painter, option, widget);
 
@@ -196,139 +310,56 @@ void EllipseItem::paint(QPainter* painter,
     const qreal extend = max_radius * kOuterRingExtendRatio;
     const QRectF extended_rect =
       base_rect.adjusted(-extend, -extend, extend, extend);
-    draw_radial_grid(painter, extended_rect, base_rect);
+    if (grid_visible(qMax(extended_rect.width(), extended_rect.height()),
+                     lod)) {
+      draw_radial_grid(painter, extended_rect, base_rect, lod);
+    }
   }
 }
 
 void EllipseItem::draw_radial_grid(QPainter* painter,
                                    const QRectF& /* extendedRect */,
-                                   const QRectF& baseRect) const {
-  // material_model_ is already checked in paint() before calling this
-  painter->save();
-
-  // Remove clipping to allow drawing outside base rect
-  painter->setClipping(false);
-
-  // Use composition mode that doesn't darken - draw only lines, no fill
-  painter->setCompositionMode(QPainter::CompositionMode_SourceOver);
-  painter->setBrush(Qt::NoBrush);
-  QPen grid_pen(QColor(0, 0, 0, kGridPenAlpha));
-  grid_pen.setWidthF(kGridPenWidth);
-  painter->setPen(grid_pen);
-
-  const QPointF center = baseRect.center();
-  const qreal half_width = baseRect.width() / 2.0;
-  const qreal half_height = baseRect.height() / 2.0;
-  const qreal max_radius = qMax(half_width, half_height);
+                                   const QRectF& baseRect, qreal lod) const {
   auto* material = material_model();
   if (material == nullptr) {
     return;
   }
+
+  const qreal max_radius = qMax(baseRect.width(), baseRect.height()) / 2.0;
   const double freq_radial = material->grid_frequency_x();
   const double freq_concentric =
     material->grid_frequency_y();  // Used for both inner and outer rings
-
-  // Calculate ring boundaries (using max_radius as reference)
-  const qreal inner_ring_start_radius = max_radius * kInnerRingStartRatio;
-  const qreal inner_ring_end_radius = max_radius;
-  const qreal outer_ring_start_radius = max_radius;
-  const qreal outer_ring_end_radius =
-    max_radius * (1.0 + kOuterRingExtendRatio);
-  const qreal boundary_margin = max_radius * kBoundaryRingMargin;
-
-  // Helper function to calculate point on ellipse at given scale
-  auto ellipse_point = [&](qreal scale, qreal angle) -> QPointF {
-    const qreal radians = qDegreesToRadians(angle);
-    const qreal cos_a = qCos(radians);
-    const qreal sin_a = qSin(radians);
-    const qreal ellipse_a = half_width * scale;
-    const qreal ellipse_b = half_height * scale;
-    const qreal radius =
-      (ellipse_a * ellipse_b) / qSqrt(ellipse_b * ellipse_b * cos_a * cos_a +
-                                      ellipse_a * ellipse_a * sin_a * sin_a);
-    return center + QPointF(radius * cos_a, radius * sin_a);
-  };
-
-  // Draw concentric ellipses first (so radial lines appear on top)
-
-  // Draw inner ring concentric ellipses
-  const qreal inner_ring_width =
-    inner_ring_end_radius - inner_ring_start_radius;
-  const qreal inner_spacing =
-    inner_ring_width /
-    (freq_concentric + 1);  // +1 accounts for boundary ellipse
-  const qreal first_inner_radius =
-    inner_ring_start_radius +
-    inner_spacing;  // First ellipse (closest to center)
-  qreal current_inner_radius = first_inner_radius;
-  while (current_inner_radius < inner_ring_end_radius - boundary_margin) {
-    const qreal scale = current_inner_radius / max_radius;
-    const QRectF ellipse_rect(center.x() - half_width * scale,
-                              center.y() - half_height * scale,
-                              half_width * scale * 2, half_height * scale * 2);
-    painter->drawEllipse(ellipse_rect);
-    current_inner_radius += inner_spacing;
-  }
-
-  // Draw inner ring boundary ellipse
-  const qreal inner_boundary_scale = inner_ring_end_radius / max_radius;
-  const QRectF inner_boundary_rect(
-    center.x() - half_width * inner_boundary_scale,
-    center.y() - half_height * inner_boundary_scale,
-    half_width * inner_boundary_scale * 2,
-    half_height * inner_boundary_scale * 2);
-  painter->drawEllipse(inner_boundary_rect);
-
-  // Draw main boundary ellipse
-  painter->drawEllipse(baseRect);
-
-  // Draw outer ring concentric ellipses
-  const qreal outer_ring_width =
-    outer_ring_end_radius - outer_ring_start_radius;
-  const qreal outer_spacing =
-    outer_ring_width /
-    (freq_concentric + 1);  // +1 accounts for boundary ellipse
-  qreal current_outer_radius =
-    outer_ring_start_radius + boundary_margin + outer_spacing;
-  qreal last_outer_radius =
-    outer_ring_start_radius +
-    boundary_margin;  // Last ellipse (farthest from center)
-  while (current_outer_radius < outer_ring_end_radius) {
-    const qreal scale = current_outer_radius / max_radius;
-    const QRectF ellipse_rect(center.x() - half_width * scale,
-                              center.y() - half_height * scale,
-                              half_width * scale * 2, half_height * scale * 2);
-    painter->drawEllipse(ellipse_rect);
-    last_outer_radius = current_outer_radius;
-    current_outer_radius += outer_spacing;
-  }
-
-  // Draw radial lines (after ellipses so they appear on top)
   const int num_radial_lines = static_cast<int>(freq_radial);
-  // Precompute angles to avoid repeated calculations
-  QVector<qreal> angles(num_radial_lines);
-  for (int i = 0; i < num_radial_lines; ++i) {
-    angles[i] = (kFullCircleDegrees * i) / num_radial_lines;
-  }
+  // Rings and lines closer than the LOD threshold on screen are thinned;
+  // radial lines are farthest apart at the outer edge of the grid, measured
+  // on the ellipse's longer axis
+  const qreal outer_circumference =
+    kTwoPi * max_radius * (1.0 + kOuterRingExtendRatio);
+  const GridPathKey key{
+    .rect = baseRect,
+    .frequency_x = freq_radial,
+    .frequency_y = freq_concentric,
+    .stride_x =
+      num_radial_lines > 0
+        ? grid_line_stride(outer_circumference / num_radial_lines, lod)
+        : 1,
+    .stride_y =
+      grid_line_stride(ring_spacing(max_radius, freq_concentric), lod)};
+  const QPainterPath& grid = grid_path_cache().path(
+    key, [&key] { return radial_grid_path(key); });
 
-  for (int i = 0; i < num_radial_lines; ++i) {
-    const qreal angle = angles[i];
-
-    // Inner ring: from first ellipse to boundary
-    const qreal first_inner_scale = first_inner_radius / max_radius;
-    const qreal inner_end_scale = inner_ring_end_radius / max_radius;
-    const QPointF inner_start = ellipse_point(first_inner_scale, angle);
-    const QPointF inner_end = ellipse_point(inner_end_scale, angle);
-    painter->drawLine(inner_start, inner_end);
+  painter->save();
 
-    // Outer ring: from boundary to last ellipse
-    const qreal outer_start_scale = outer_ring_start_radius / max_radius;
-    const qreal last_outer_scale = last_outer_radius / max_radius;
-    const QPointF outer_start = ellipse_point(outer_start_scale, angle);
-    const QPointF outer_end = ellipse_point(last_outer_scale, angle);
-    painter->drawLine(outer_start, outer_end);
-  }
+  // Remove clipping to allow drawing outside base rect
+  painter->setClipping(false);
 
+  // Use composition mode that doesn't darken - draw only lines, no fill
+  painter->setCompositionMode(QPainter::CompositionMode_SourceOver);
+  painter->setBrush(Qt::NoBrush);
+  QPen grid_pen(QColor(0, 0, 0, kGridPenAlpha));
+  grid_pen.setWidthF(kGridPenWidth);
+  painter->setPen(grid_pen);
+  painter->drawPath(grid);
   painter->restore();
 }
 
@@ -5,7 +5,8 @@
 #include "scene/ISceneObject.h"
 #include "scene/items/BaseShapeItem.h"
 
-class EllipseItem : public BaseShapeItem<QGraphicsEllipseItem> {
+class EllipseItem
+    : public BaseShapeItem<QGraphicsEllipseItem, ISceneObject::Kind::Ellipse> {
  public:
   explicit EllipseItem(const QRectF& rect, QGraphicsItem* parent = nullptr);
   ~EllipseItem() override = default;
@@ -29,5 +30,5 @@ class EllipseItem : public BaseShapeItem<QGraphicsEllipseItem> {
 
  private:
   void draw_radial_grid(QPainter* painter, const QRectF& extendedRect,
-                        const QRectF& baseRect) const;
+                        const QRectF& baseRect, qreal lod) const;
 };
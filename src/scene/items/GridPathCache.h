@@ -0,0 +1,57 @@
+#pragma once
+
+#include <QPainterPath>
+#include <QRectF>
+#include <utility>
+
+/**
+ * @brief Inputs a material grid path is built from: item rect, material grid
+ * frequencies and the level-of-detail line strides.
+ */
+struct GridPathKey {
+  QRectF rect;
+  double frequency_x{0.0};
+  double frequency_y{0.0};
+  int stride_x{1};
+  int stride_y{1};
+
+  bool operator==(const GridPathKey& other) const = default;
+};
+
+/**
+ * @brief Material grid of an item built once into a QPainterPath, so that
+ * paint() draws a single path instead of recomputing rings and lines.
+ *
+ * The path is rebuilt when the key it was built for changes (item resized,
+ * grid frequencies edited, zoom crossing a level-of-detail step) or after
+ * invalidate().
+ */
+class GridPathCache {
+ public:
+  /**
+   * @brief Path for @p key, calling @p build() only if the cached path was
+   * built for a different key.
+   */
+  template <typename Build>
+  const QPainterPath& path(const GridPathKey& key, Build&& build) {
+    if (!valid_ || !(key == key_)) {
+      path_ = std::forward<Build>(build)();
+      key_ = key;
+      valid_ = true;
+    }
+    return path_;
+  }
+
+  /**
+   * @brief Drop the cached path (e.g. when the item gets another material).
+   */
+  void invalidate() {
+    valid_ = false;
+    path_ = QPainterPath();
+  }
+
+ private:
+  QPainterPath path_;
+  GridPathKey key_;
+  bool valid_{false};
+};
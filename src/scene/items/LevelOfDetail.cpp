@@ -0,0 +1,64 @@
+#include "scene/items/LevelOfDetail.h"
+
+#include <QBrush>
+#include <QPainter>
+#include <QPen>
+#include <QRectF>
+#include <cmath>
+
+namespace {
+// Keeps the stride finite when a line spacing is far below a pixel
+constexpr int kMaxGridLineStride = 1 << 16;
+
+LevelOfDetail g_level_of_detail;
+}  // namespace
+
+const LevelOfDetail& level_of_detail() {
+  return g_level_of_detail;
+}
+
+void set_level_of_detail(const LevelOfDetail& detail) {
+  g_level_of_detail = detail;
+}
+
+int grid_line_stride(qreal spacing, qreal lod) {
+  const double min_spacing = g_level_of_detail.min_grid_spacing_px;
+  const double screen_spacing = spacing * lod;
+  if (min_spacing <= 0.0 || screen_spacing >= min_spacing) {
+    return 1;
+  }
+  if (screen_spacing <= 0.0) {
+    return kMaxGridLineStride;
+  }
+  const double stride = std::ceil(min_spacing / screen_spacing);
+  return stride < kMaxGridLineStride ? static_cast<int>(stride)
+                                     : kMaxGridLineStride;
+}
+
+bool grid_visible(qreal extent, qreal lod) {
+  return extent * lod >= g_level_of_detail.min_grid_item_px;
+}
+
+bool draw_simplified(QPainter* painter, const QRectF& rect, const QBrush& brush,
+                     SimplifiedShape shape, qreal lod) {
+  const qreal screen_extent = qMax(rect.width(), rect.height()) * lod;
+  if (screen_extent >= g_level_of_detail.min_outline_item_px) {
+    return false;
+  }
+  painter->save();
+  if (screen_extent < 1.0) {
+    // Cosmetic pen: exactly one device pixel whatever the transform
+    painter->setPen(QPen(brush.color(), 0.0));
+    painter->drawPoint(rect.center());
+  } else {
+    painter->setPen(Qt::NoPen);
+    painter->setBrush(brush);
+    if (shape == SimplifiedShape::Ellipse) {
+      painter->drawEllipse(rect);
+    } else {
+      painter->drawRect(rect);
+    }
+  }
+  painter->restore();
+  return true;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <QtGlobal>
+
+class QBrush;
+class QPainter;
+class QRectF;
+
+/**
+ * @brief Zoom-dependent detail thresholds shared by the shape items.
+ *
+ * Sizes are on-screen pixels, i.e. item units multiplied by the level of
+ * detail that QStyleOptionGraphicsItem::levelOfDetailFromTransform() reports
+ * for the painter.
+ */
+struct LevelOfDetail {
+  // Grid lines closer than this are thinned to every n-th line
+  double min_grid_spacing_px{4.0};
+  // Items smaller than this are drawn without their material grid
+  double min_grid_item_px{24.0};
+  // Items smaller than this are drawn as a plain fill without outline, and
+  // items below one pixel as a single point
+  double min_outline_item_px{3.0};
+};
+
+/**
+ * @brief Thresholds used by all items; defaults until set_level_of_detail().
+ */
+const LevelOfDetail& level_of_detail();
+
+/**
+ * @brief Replace the thresholds (non-positive values disable that reduction).
+ * Items pick them up on their next repaint.
+ */
+void set_level_of_detail(const LevelOfDetail& detail);
+
+/**
+ * @brief Step through grid lines spaced @p spacing item units apart so that
+ * drawn lines are at least LevelOfDetail::min_grid_spacing_px apart on screen.
+ * @return 1 to draw every line, n to draw every n-th line.
+ */
+int grid_line_stride(qreal spacing, qreal lod);
+
+/**
+ * @brief Whether an item of @p extent item units shows its material grid.
+ */
+bool grid_visible(qreal extent, qreal lod);
+
+enum class SimplifiedShape { Rectangle, Ellipse };
+
+/**
+ * @brief Draw an item too small on screen for its outline and grid: a single
+ * point below one pixel, otherwise @p rect filled with @p brush.
+ * @return false (and draws nothing) if the item is large enough to be drawn
+ * in full.
+ */
+bool draw_simplified(QPainter* painter, const QRectF& rect, const QBrush& brush,
+                     SimplifiedShape shape, qreal lod);
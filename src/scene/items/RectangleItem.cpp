@@ -7,6 +7,7 @@
 #include <QJsonArray>
 #include <QJsonObject>
 #include <QPainter>
+#include <QPainterPath>
 #include <QPen>
 #include <QStyleOptionGraphicsItem>
 #include <QVBoxLayout>
@@ -15,6 +16,9 @@
 #include <cmath>
 
 #include "model/MaterialModel.h"
+#include "scene/items/GridPathCache.h"
+#include "scene/items/LevelOfDetail.h"
+#include "scene/items/StaticLayer.h"
 
 namespace {
 constexpr double kMinSizePx = 1.0;
@@ -28,10 +32,36 @@ constexpr int kDefaultColorA = 128;
 constexpr double kRotationSpinStep = 5.0;
 constexpr int kGridPenAlpha = 255;
 constexpr double kGridPenWidth = 0.5;
+
+// Vertical and horizontal grid lines, thinned by the key's strides
+QPainterPath internal_grid_path(const GridPathKey& key) {
+  QPainterPath path;
+  const QRectF& rect = key.rect;
+  // Spacing for horizontal and vertical lines separately
+  const qreal step_x = rect.width() / key.frequency_x * key.stride_x;
+  const qreal step_y = rect.height() / key.frequency_y * key.stride_y;
+
+  // Vertical lines (horizontal spacing)
+  qreal x_pos = rect.left() + step_x;
+  while (x_pos <= rect.right()) {
+    path.moveTo(x_pos, rect.top());
+    path.lineTo(x_pos, rect.bottom());
+    x_pos += step_x;
+  }
+
+  // Horizontal lines (vertical spacing)
+  qreal y_pos = rect.top() + step_y;
+  while (y_pos <= rect.bottom()) {
+    path.moveTo(rect.left(), y_pos);
+    path.lineTo(rect.right(), y_pos);
+    y_pos += step_y;
+  }
+  return path;
+}
 }  // namespace
 
 RectangleItem::RectangleItem(const QRectF& rect, QGraphicsItem* parent)
-    : BaseShapeItem<QGraphicsRectItem>(rect, parent) {
+    : BaseShapeItem(rect, parent) {
   setFlags(QGraphicsItem::ItemIsSelectable | QGraphicsItem::ItemIsMovable |
            QGraphicsItem::ItemSendsGeometryChanges);
   setPen(QPen(Qt::black, 1.0));
@@ -176,23 +206,47 @@ void RectangleItem::from_json(const QJsonObject& json) {
 void RectangleItem::paint(QPainter* painter,
                           const QStyleOptionGraphicsItem* option,
                           QWidget* widget) {
+  if (skip_paint(*this, widget)) {
+    return;
+  }
+  const qreal lod = QStyleOptionGraphicsItem::levelOfDetailFromTransform(
+    painter->worldTransform());
+  const QRectF item_rect = rect();
+  if (draw_simplified(painter, item_rect, brush(), SimplifiedShape::Rectangle,
+                      lod)) {
+    return;
+  }
+
   // Draw the base rectangle first
   QGraphicsRectItem::paint(painter, option, widget);
 
   // Draw grid if material has Internal grid enabled
   if (material_model() != nullptr &&
-      material_model()->grid_type() == MaterialModel::GridType::Internal) {
-    draw_internal_grid(painter, rect());
+      material_model()->grid_type() == MaterialModel::GridType::Internal &&
+      grid_visible(qMax(item_rect.width(), item_rect.height()), lod)) {
+    draw_internal_grid(painter, item_rect, lod);
   }
 }
 
-void RectangleItem::draw_internal_grid(QPainter* painter,
-                                       const QRectF& rect) const {
+void RectangleItem::draw_internal_grid(QPainter* painter, const QRectF& rect,
+                                       qreal lod) const {
   // material_model() is already checked in paint() before calling this
   auto* material = material_model();
   if (material == nullptr) {
     return;
   }
+  const double freq_x = material->grid_frequency_x();  // Horizontal cells
+  const double freq_y = material->grid_frequency_y();  // Vertical cells
+  // Lines closer than the LOD threshold on screen are thinned
+  const GridPathKey key{
+    .rect = rect,
+    .frequency_x = freq_x,
+    .frequency_y = freq_y,
+    .stride_x = grid_line_stride(rect.width() / freq_x, lod),
+    .stride_y = grid_line_stride(rect.height() / freq_y, lod)};
+  const QPainterPath& grid = grid_path_cache().path(
+    key, [&key] { return internal_grid_path(key); });
+
   painter->save();
 
   // Draw only lines, no fill
@@ -200,30 +254,7 @@ void RectangleItem::draw_internal_grid(QPainter* painter,
   QPen grid_pen(QColor(0, 0, 0, kGridPenAlpha));  // Black lines
   grid_pen.setWidthF(kGridPenWidth);
   painter->setPen(grid_pen);
-
-  const double freq_x = material->grid_frequency_x();  // Horizontal cells
-  const double freq_y = material->grid_frequency_y();  // Vertical cells
-
-  // Calculate spacing for horizontal and vertical lines separately
-  const qreal spacing_x = rect.width() / freq_x;
-  const qreal spacing_y = rect.height() / freq_y;
-
-  // Draw vertical lines (horizontal spacing)
-  qreal x_pos = rect.left() + spacing_x;
-  while (x_pos <= rect.right()) {
-    painter->drawLine(QPointF(x_pos, rect.top()),
-                      QPointF(x_pos, rect.bottom()));
-    x_pos += spacing_x;
-  }
-
-  // Draw horizontal lines (vertical spacing)
-  qreal y_pos = rect.top() + spacing_y;
-  while (y_pos <= rect.bottom()) {
-    painter->drawLine(QPointF(rect.left(), y_pos),
-                      QPointF(rect.right(), y_pos));
-    y_pos += spacing_y;
-  }
-
+  painter->drawPath(grid);
   painter->restore();
 }
 
@@ -5,7 +5,8 @@
 #include "scene/ISceneObject.h"
 #include "scene/items/BaseShapeItem.h"
 
-class RectangleItem : public BaseShapeItem<QGraphicsRectItem> {
+class RectangleItem
+    : public BaseShapeItem<QGraphicsRectItem, ISceneObject::Kind::Rectangle> {
  public:
   explicit RectangleItem(const QRectF& rect, QGraphicsItem* parent = nullptr);
   ~RectangleItem() override = default;
@@ -28,5 +29,6 @@ class RectangleItem : public BaseShapeItem<QGraphicsRectItem> {
                       const QVariant& value) override;
 
  private:
-  void draw_internal_grid(QPainter* painter, const QRectF& rect) const;
+  void draw_internal_grid(QPainter* painter, const QRectF& rect,
+                          qreal lod) const;
 };
@@ -0,0 +1,39 @@
+#include "scene/items/StaticLayer.h"
+
+#include <QGraphicsItem>
+
+namespace {
+const QWidget* g_static_layer_viewport = nullptr;
+// Nesting depth of StaticLayerRender scopes; per thread, as items are also
+// painted by image export workers
+thread_local int g_tile_renders = 0;
+}  // namespace
+
+void set_static_layer_viewport(const QWidget* viewport) {
+  g_static_layer_viewport = viewport;
+}
+
+StaticLayerRender::StaticLayerRender() {
+  ++g_tile_renders;
+}
+
+StaticLayerRender::~StaticLayerRender() {
+  --g_tile_renders;
+}
+
+bool is_live_item(const QGraphicsItem& item) {
+  // The substrate is selectable but not movable; drawn live it would cover
+  // the cached shapes
+  return item.isSelected() &&
+         (item.flags() & QGraphicsItem::ItemIsMovable) != 0;
+}
+
+bool skip_paint(const QGraphicsItem& item, const QWidget* widget) {
+  if (g_tile_renders > 0) {
+    return is_live_item(item);
+  }
+  if (widget != nullptr && widget == g_static_layer_viewport) {
+    return !is_live_item(item);
+  }
+  return false;
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+class QGraphicsItem;
+class QWidget;
+
+/**
+ * @brief Split of item painting between a view's tile cache of the static
+ * scene layer and its live pass.
+ *
+ * Live items are the ones the user is manipulating (selected and movable);
+ * every other item is static. The editor view renders static items once into
+ * cached tiles, with a StaticLayerRender in scope, and blits the tiles when it
+ * repaints. Its live pass, on the viewport registered with
+ * set_static_layer_viewport(), then only paints live items on top. Other
+ * views and renders paint everything.
+ */
+
+/**
+ * @brief Viewport whose live pass skips static items (nullptr: none).
+ */
+void set_static_layer_viewport(const QWidget* viewport);
+
+/**
+ * @brief Marks tile rendering for skip_paint() while in scope.
+ */
+class StaticLayerRender {
+ public:
+  StaticLayerRender();
+  ~StaticLayerRender();
+
+  StaticLayerRender(const StaticLayerRender&) = delete;
+  StaticLayerRender& operator=(const StaticLayerRender&) = delete;
+};
+
+/**
+ * @brief Item drawn live over the cached tiles rather than into them.
+ */
+bool is_live_item(const QGraphicsItem& item);
+
+/**
+ * @brief Whether paint() of @p item draws nothing in the current pass;
+ * @p widget is the widget paint() was given.
+ */
+bool skip_paint(const QGraphicsItem& item, const QWidget* widget);
@@ -13,6 +13,7 @@
 #include <cmath>
 
 #include "model/MaterialModel.h"
+#include "scene/items/StaticLayer.h"
 
 namespace {
 constexpr double kMinLengthPx = 1.0;
@@ -24,7 +25,7 @@ constexpr double kRotationSpinStep = 5.0;
 }  // namespace
 
 StickItem::StickItem(const QLineF& line, QGraphicsItem* parent)
-    : BaseShapeItem<QGraphicsLineItem>(line, parent) {
+    : BaseShapeItem(line, parent) {
   setFlags(QGraphicsItem::ItemIsSelectable | QGraphicsItem::ItemIsMovable |
            QGraphicsItem::ItemSendsGeometryChanges);
   QPen pen_item(Qt::black);
@@ -180,7 +181,9 @@ QRectF StickItem::boundingRect() const {
 void StickItem::paint(QPainter* painter, const QStyleOptionGraphicsItem* option,
                       QWidget* widget) {
   Q_UNUSED(option);
-  Q_UNUSED(widget);
+  if (skip_paint(*this, widget)) {
+    return;
+  }
 
   // Draw only the line - no brush, no fill, no background
   painter->save();
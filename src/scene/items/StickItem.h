@@ -5,7 +5,8 @@
 #include "scene/ISceneObject.h"
 #include "scene/items/BaseShapeItem.h"
 
-class StickItem : public BaseShapeItem<QGraphicsLineItem> {
+class StickItem
+    : public BaseShapeItem<QGraphicsLineItem, ISceneObject::Kind::Stick> {
  public:
   explicit StickItem(const QLineF& line, QGraphicsItem* parent = nullptr);
   ~StickItem() override = default;
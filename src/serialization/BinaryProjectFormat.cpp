@@ -0,0 +1,536 @@
+#include "serialization/BinaryProjectFormat.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <ostream>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "model/DocumentModel.h"
+#include "model/MaterialModel.h"
+#include "model/ShapeModel.h"
+#include "model/ShapeStore.h"
+#include "model/SubstrateModel.h"
+#include "model/core/ModelTypes.h"
+#include "utils/Crc32.h"
+#include "utils/Logging.h"
+#include "utils/ParallelFor.h"
+
+namespace {
+constexpr std::array<char, 4> kMagic{'N', 'I', 'R', 'B'};
+constexpr uint16_t kMajorVersion = 1;
+constexpr uint16_t kMinorVersion = 0;
+constexpr uint32_t kByteOrderMark = 0x01020304U;
+constexpr size_t kAlignment = 8;
+
+constexpr uint32_t fourcc(const char (&id)[5]) {
+  return static_cast<uint32_t>(static_cast<uint8_t>(id[0])) |
+         static_cast<uint32_t>(static_cast<uint8_t>(id[1])) << 8 |
+         static_cast<uint32_t>(static_cast<uint8_t>(id[2])) << 16 |
+         static_cast<uint32_t>(static_cast<uint8_t>(id[3])) << 24;
+}
+
+constexpr uint32_t kChunkSubstrate = fourcc("SUBS");
+constexpr uint32_t kChunkMaterials = fourcc("MATL");
+constexpr uint32_t kChunkMaterialNames = fourcc("MTNM");
+constexpr uint32_t kChunkTypes = fourcc("TYPE");
+constexpr uint32_t kChunkX = fourcc("POSX");
+constexpr uint32_t kChunkY = fourcc("POSY");
+constexpr uint32_t kChunkWidth = fourcc("SIZW");
+constexpr uint32_t kChunkHeight = fourcc("SIZH");
+constexpr uint32_t kChunkRotation = fourcc("ROTN");
+constexpr uint32_t kChunkMaterialIndex = fourcc("MATI");
+constexpr uint32_t kChunkColor = fourcc("COLR");
+constexpr uint32_t kChunkGridType = fourcc("GRDT");
+constexpr uint32_t kChunkGridX = fourcc("GRDX");
+constexpr uint32_t kChunkGridY = fourcc("GRDY");
+constexpr uint32_t kChunkNameOffsets = fourcc("NOFS");
+constexpr uint32_t kChunkNames = fourcc("NAME");
+
+struct FileHeader {
+  std::array<char, 4> magic;
+  uint16_t major_version;
+  uint16_t minor_version;
+  uint32_t byte_order;
+  uint32_t chunk_count;
+  uint64_t shape_count;
+  uint32_t table_crc;
+  uint32_t header_crc;  // Of the bytes before this field
+};
+static_assert(sizeof(FileHeader) == 32);
+
+struct ChunkEntry {
+  uint32_t id;
+  uint32_t element_size;  // 1 for unstructured chunks
+  uint64_t offset;        // From the start of the file
+  uint64_t size;          // In bytes
+  uint32_t crc;
+  uint32_t reserved;
+};
+static_assert(sizeof(ChunkEntry) == 32);
+
+// SUBS: this record followed by the name
+struct SubstrateRecord {
+  double width;
+  double height;
+  uint32_t color;
+  uint32_t name_length;
+};
+static_assert(sizeof(SubstrateRecord) == 24);
+
+// MATL: one record per material, names in MTNM
+struct MaterialRecord {
+  double grid_frequency_x;
+  double grid_frequency_y;
+  uint32_t color;
+  uint32_t grid_type;
+  uint32_t name_offset;
+  uint32_t name_length;
+};
+static_assert(sizeof(MaterialRecord) == 32);
+
+uint32_t pack_color(const Color& color) {
+  return static_cast<uint32_t>(color.r) |
+         static_cast<uint32_t>(color.g) << 8 |
+         static_cast<uint32_t>(color.b) << 16 |
+         static_cast<uint32_t>(color.a) << 24;
+}
+
+Color unpack_color(uint32_t value) {
+  return Color{static_cast<uint8_t>(value & 0xFFU),
+               static_cast<uint8_t>((value >> 8) & 0xFFU),
+               static_cast<uint8_t>((value >> 16) & 0xFFU),
+               static_cast<uint8_t>(value >> 24)};
+}
+
+MaterialModel::GridType grid_type_from_value(uint32_t value) {
+  // Only None (0) and Internal (1) exist
+  return value == 1 ? MaterialModel::GridType::Internal
+                    : MaterialModel::GridType::None;
+}
+
+void apply_grid(MaterialModel& material, uint32_t grid_type, double freq_x,
+                double freq_y) {
+  material.set_grid_type(grid_type_from_value(grid_type));
+  // The setters ignore values that are not finite or below 1
+  material.set_grid_frequency_x(freq_x);
+  material.set_grid_frequency_y(freq_y);
+}
+
+// Appends aligned, checksummed chunks to a stream
+class ChunkWriter {
+ public:
+  ChunkWriter(std::ostream& stream, uint64_t position)
+      : stream_(stream), position_(position) {}
+
+  template <typename T>
+  void add(uint32_t id, std::span<const T> values) {
+    add(id, sizeof(T), values.data(), values.size_bytes());
+  }
+
+  void add(uint32_t id, uint32_t element_size, const void* data,
+           size_t size) {
+    static constexpr std::array<char, kAlignment> kPadding{};
+    const uint64_t padding = (kAlignment - position_ % kAlignment) % kAlignment;
+    stream_.write(kPadding.data(), static_cast<std::streamsize>(padding));
+    position_ += padding;
+
+    entries_.push_back(ChunkEntry{.id = id,
+                                  .element_size = element_size,
+                                  .offset = position_,
+                                  .size = size,
+                                  .crc = crc32(data, size),
+                                  .reserved = 0});
+    stream_.write(static_cast<const char*>(data),
+                  static_cast<std::streamsize>(size));
+    position_ += size;
+  }
+
+  const std::vector<ChunkEntry>& entries() const {
+    return entries_;
+  }
+
+ private:
+  std::ostream& stream_;
+  uint64_t position_;  // Relative to the start of the project
+  std::vector<ChunkEntry> entries_;
+};
+
+// Read-only view of a validated file
+class ChunkReader {
+ public:
+  explicit ChunkReader(std::span<const std::byte> data) : data_(data) {}
+
+  bool open() {
+    if (data_.size() < sizeof(FileHeader)) {
+      LOG_ERROR() << "Binary project is truncated";
+      return false;
+    }
+    std::memcpy(&header_, data_.data(), sizeof(header_));
+    if (header_.magic != kMagic) {
+      LOG_ERROR() << "Not a binary project file";
+      return false;
+    }
+    if (header_.byte_order != kByteOrderMark) {
+      LOG_ERROR() << "Binary project has a foreign byte order";
+      return false;
+    }
+    if (header_.major_version != kMajorVersion) {
+      LOG_ERROR() << "Unsupported binary project version: "
+                  << header_.major_version << "." << header_.minor_version;
+      return false;
+    }
+    if (crc32(data_.data(), offsetof(FileHeader, header_crc)) !=
+        header_.header_crc) {
+      LOG_ERROR() << "Binary project header is corrupted";
+      return false;
+    }
+
+    const uint64_t table_size =
+      static_cast<uint64_t>(header_.chunk_count) * sizeof(ChunkEntry);
+    if (table_size > data_.size() - sizeof(FileHeader) ||
+        crc32(data_.data() + sizeof(FileHeader), table_size) !=
+          header_.table_crc) {
+      LOG_ERROR() << "Binary project chunk table is corrupted";
+      return false;
+    }
+    entries_.resize(header_.chunk_count);
+    std::memcpy(entries_.data(), data_.data() + sizeof(FileHeader),
+                table_size);
+    for (const ChunkEntry& entry : entries_) {
+      if (entry.offset > data_.size() ||
+          entry.size > data_.size() - entry.offset) {
+        LOG_ERROR() << "Binary project chunk out of range";
+        return false;
+      }
+    }
+
+    // Chunks are independent, so checksum them concurrently
+    std::vector<uint8_t> valid(entries_.size(), 0);
+    parallel_for(entries_.size(), 1, [&](size_t begin, size_t end, size_t) {
+      for (size_t index = begin; index < end; ++index) {
+        const ChunkEntry& entry = entries_[index];
+        valid[index] =
+          crc32(data_.data() + entry.offset, entry.size) == entry.crc ? 1 : 0;
+      }
+    });
+    if (std::find(valid.begin(), valid.end(), 0) != valid.end()) {
+      LOG_ERROR() << "Binary project chunk checksum mismatch";
+      return false;
+    }
+    return true;
+  }
+
+  uint64_t shape_count() const {
+    return header_.shape_count;
+  }
+
+  // Whole chunk, or an empty span if it is missing
+  std::span<const std::byte> chunk(uint32_t id) const {
+    for (const ChunkEntry& entry : entries_) {
+      if (entry.id == id) {
+        return data_.subspan(entry.offset, entry.size);
+      }
+    }
+    return {};
+  }
+
+  // Column of count values of T; nullptr if missing or of another shape
+  template <typename T>
+  const std::byte* column(uint32_t id, uint64_t count) const {
+    for (const ChunkEntry& entry : entries_) {
+      if (entry.id == id) {
+        return entry.element_size == sizeof(T) &&
+                   entry.size == count * sizeof(T)
+                 ? data_.data() + entry.offset
+                 : nullptr;
+      }
+    }
+    return nullptr;
+  }
+
+ private:
+  std::span<const std::byte> data_;
+  FileHeader header_{};
+  std::vector<ChunkEntry> entries_;
+};
+
+template <typename T>
+T load(const std::byte* column, size_t index) {
+  T value;
+  std::memcpy(&value, column + index * sizeof(T), sizeof(T));
+  return value;
+}
+
+std::string_view string_at(std::span<const std::byte> pool, uint64_t offset,
+                           uint64_t length) {
+  if (offset > pool.size() || length > pool.size() - offset) {
+    return {};
+  }
+  return {reinterpret_cast<const char*>(pool.data()) + offset,
+          static_cast<size_t>(length)};
+}
+}  // namespace
+
+bool BinaryProjectFormat::write(std::ostream& stream,
+                                const DocumentModel& document) {
+  if constexpr (std::endian::native != std::endian::little) {
+    LOG_ERROR() << "Binary projects are only written on little-endian hosts";
+    return false;
+  }
+  const std::streamoff base = stream.tellp();
+  if (base < 0) {
+    return false;
+  }
+
+  const ShapeStore& store = document.shape_store();
+  const auto& shapes = document.shapes();
+  const auto& materials = document.materials();
+  const size_t count = store.size();
+
+  // Header and table are patched in once the chunk offsets are known
+  constexpr uint32_t kChunkCount = 16;
+  const std::vector<char> placeholder(
+    sizeof(FileHeader) + kChunkCount * sizeof(ChunkEntry), 0);
+  stream.write(placeholder.data(),
+               static_cast<std::streamsize>(placeholder.size()));
+  ChunkWriter writer(stream, placeholder.size());
+
+  {
+    const auto substrate = document.substrate();
+    const std::string name = substrate ? substrate->name() : std::string{};
+    const Size2D size = substrate ? substrate->size() : Size2D{};
+    const SubstrateRecord record{
+      .width = size.width,
+      .height = size.height,
+      .color = pack_color(substrate ? substrate->color() : Color{}),
+      .name_length = static_cast<uint32_t>(name.size())};
+    std::vector<char> bytes(sizeof(record) + name.size());
+    std::memcpy(bytes.data(), &record, sizeof(record));
+    std::memcpy(bytes.data() + sizeof(record), name.data(), name.size());
+    writer.add(kChunkSubstrate, 1, bytes.data(), bytes.size());
+  }
+
+  {
+    std::vector<MaterialRecord> records;
+    std::string names;
+    records.reserve(materials.size());
+    for (const auto& material : materials) {
+      records.push_back(MaterialRecord{
+        .grid_frequency_x = material->grid_frequency_x(),
+        .grid_frequency_y = material->grid_frequency_y(),
+        .color = pack_color(material->color()),
+        .grid_type = static_cast<uint32_t>(material->grid_type()),
+        .name_offset = static_cast<uint32_t>(names.size()),
+        .name_length = static_cast<uint32_t>(material->name().size())});
+      names += material->name();
+    }
+    writer.add(kChunkMaterials, std::span<const MaterialRecord>(records));
+    writer.add(kChunkMaterialNames, 1, names.data(), names.size());
+  }
+
+  // Geometry columns straight from the store
+  writer.add(kChunkTypes, store.types());
+  writer.add(kChunkX, store.xs());
+  writer.add(kChunkY, store.ys());
+  writer.add(kChunkWidth, store.widths());
+  writer.add(kChunkHeight, store.heights());
+  writer.add(kChunkRotation, store.rotations());
+  writer.add(kChunkMaterialIndex, store.material_indices());
+
+  // Custom materials live on the shapes. Rows without a listed preset are
+  // read back as custom, so they also cover presets that were removed from
+  // the document
+  {
+    const auto material_indices = store.material_indices();
+    std::vector<uint32_t> colors(count, 0);
+    std::vector<uint8_t> grid_types(count, 0);
+    std::vector<double> grid_x(count, 0.0);
+    std::vector<double> grid_y(count, 0.0);
+    for (size_t row = 0; row < count; ++row) {
+      if (material_indices[row] >= 0) {
+        continue;
+      }
+      const MaterialModel& material = shapes[row]->material_values();
+      colors[row] = pack_color(material.color());
+      grid_types[row] = static_cast<uint8_t>(material.grid_type());
+      grid_x[row] = material.grid_frequency_x();
+      grid_y[row] = material.grid_frequency_y();
+    }
+    writer.add(kChunkColor, std::span<const uint32_t>(colors));
+    writer.add(kChunkGridType, std::span<const uint8_t>(grid_types));
+    writer.add(kChunkGridX, std::span<const double>(grid_x));
+    writer.add(kChunkGridY, std::span<const double>(grid_y));
+  }
+
+  {
+    std::vector<uint64_t> offsets(count + 1, 0);
+    std::string names;
+    for (size_t row = 0; row < count; ++row) {
+      names += store.name_at(row);
+      offsets[row + 1] = names.size();
+    }
+    writer.add(kChunkNameOffsets, std::span<const uint64_t>(offsets));
+    writer.add(kChunkNames, 1, names.data(), names.size());
+  }
+
+  const auto& entries = writer.entries();
+  if (entries.size() != kChunkCount) {
+    LOG_ERROR() << "Binary project chunk count mismatch";
+    return false;
+  }
+  FileHeader header{.magic = kMagic,
+                    .major_version = kMajorVersion,
+                    .minor_version = kMinorVersion,
+                    .byte_order = kByteOrderMark,
+                    .chunk_count = kChunkCount,
+                    .shape_count = count,
+                    .table_crc = crc32(entries.data(),
+                                       entries.size() * sizeof(ChunkEntry)),
+                    .header_crc = 0};
+  header.header_crc = crc32(&header, offsetof(FileHeader, header_crc));
+  const std::streamoff end = stream.tellp();
+  stream.seekp(base);
+  stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  stream.write(reinterpret_cast<const char*>(entries.data()),
+               static_cast<std::streamsize>(entries.size() *
+                                            sizeof(ChunkEntry)));
+  stream.seekp(end);
+  return stream.good();
+}
+
+bool BinaryProjectFormat::read(std::span<const std::byte> data,
+                               DocumentModel& document) {
+  if constexpr (std::endian::native != std::endian::little) {
+    LOG_ERROR() << "Binary projects are only read on little-endian hosts";
+    return false;
+  }
+  ChunkReader reader(data);
+  if (!reader.open()) {
+    return false;
+  }
+  const uint64_t count = reader.shape_count();
+  if (count > data.size()) {  // At least one byte (the type) per shape
+    LOG_ERROR() << "Binary project shape count is corrupted";
+    return false;
+  }
+
+  const std::byte* types = reader.column<uint8_t>(kChunkTypes, count);
+  const std::byte* xs = reader.column<double>(kChunkX, count);
+  const std::byte* ys = reader.column<double>(kChunkY, count);
+  const std::byte* widths = reader.column<double>(kChunkWidth, count);
+  const std::byte* heights = reader.column<double>(kChunkHeight, count);
+  const std::byte* rotations = reader.column<double>(kChunkRotation, count);
+  const std::byte* material_indices =
+    reader.column<int32_t>(kChunkMaterialIndex, count);
+  const std::byte* name_offsets =
+    reader.column<uint64_t>(kChunkNameOffsets, count + 1);
+  const auto substrate_chunk = reader.chunk(kChunkSubstrate);
+  if (count > 0 && (types == nullptr || xs == nullptr || ys == nullptr ||
+                    widths == nullptr || heights == nullptr ||
+                    rotations == nullptr || material_indices == nullptr)) {
+    LOG_ERROR() << "Binary project is missing shape columns";
+    return false;
+  }
+  if (substrate_chunk.size() < sizeof(SubstrateRecord)) {
+    LOG_ERROR() << "Binary project is missing the substrate";
+    return false;
+  }
+
+  // Optional columns
+  const std::byte* colors = reader.column<uint32_t>(kChunkColor, count);
+  const std::byte* grid_types = reader.column<uint8_t>(kChunkGridType, count);
+  const std::byte* grid_x = reader.column<double>(kChunkGridX, count);
+  const std::byte* grid_y = reader.column<double>(kChunkGridY, count);
+  const auto names_pool = reader.chunk(kChunkNames);
+
+  const auto material_chunk = reader.chunk(kChunkMaterials);
+  const auto material_names = reader.chunk(kChunkMaterialNames);
+  const size_t material_count = material_chunk.size() / sizeof(MaterialRecord);
+
+  // Everything is validated; replace the document contents
+  document.clear_shapes();
+  document.clear_materials();
+
+  SubstrateRecord substrate_record{};
+  std::memcpy(&substrate_record, substrate_chunk.data(),
+              sizeof(substrate_record));
+  auto substrate = std::make_shared<SubstrateModel>();
+  substrate->set_name(std::string(
+    string_at(substrate_chunk, sizeof(substrate_record),
+              substrate_record.name_length)));
+  if (std::isfinite(substrate_record.width) && substrate_record.width > 0.0 &&
+      std::isfinite(substrate_record.height) &&
+      substrate_record.height > 0.0) {
+    substrate->set_size(
+      Size2D{substrate_record.width, substrate_record.height});
+  }
+  substrate->set_color(unpack_color(substrate_record.color));
+  document.set_substrate(substrate);
+
+  for (size_t index = 0; index < material_count; ++index) {
+    MaterialRecord record{};
+    std::memcpy(&record,
+                material_chunk.data() + index * sizeof(MaterialRecord),
+                sizeof(record));
+    auto material = document.create_material(
+      unpack_color(record.color),
+      std::string(
+        string_at(material_names, record.name_offset, record.name_length)));
+    apply_grid(*material, record.grid_type, record.grid_frequency_x,
+               record.grid_frequency_y);
+  }
+
+  std::vector<ShapeStore::Record> records(count);
+  std::vector<std::string_view> names(count);
+  for (size_t row = 0; row < count; ++row) {
+    ShapeStore::Record& record = records[row];
+    record.type = load<uint8_t>(types, row);
+    if (record.type > static_cast<uint8_t>(ShapeModel::ShapeType::Stick)) {
+      record.type = static_cast<uint8_t>(ShapeModel::ShapeType::Rectangle);
+    }
+    record.position = {load<double>(xs, row), load<double>(ys, row)};
+    record.size = {load<double>(widths, row), load<double>(heights, row)};
+    record.rotation_deg = load<double>(rotations, row);
+    const int32_t material_index = load<int32_t>(material_indices, row);
+    record.material_index =
+      material_index >= 0 && static_cast<size_t>(material_index) <
+                               material_count
+        ? material_index
+        : -1;
+    if (name_offsets != nullptr) {
+      const uint64_t begin = load<uint64_t>(name_offsets, row);
+      const uint64_t end = load<uint64_t>(name_offsets, row + 1);
+      if (begin <= end) {
+        names[row] = string_at(names_pool, begin, end - begin);
+      }
+    }
+  }
+
+  const auto shapes = document.create_shapes(records, names);
+  if (colors != nullptr) {
+    for (size_t row = 0; row < count; ++row) {
+      if (records[row].material_index >= 0) {
+        continue;
+      }
+      // Shapes that keep the default material do not allocate one
+      const Color color = unpack_color(load<uint32_t>(colors, row));
+      if (grid_types != nullptr && grid_x != nullptr && grid_y != nullptr) {
+        shapes[row]->set_custom_values(
+          color, grid_type_from_value(load<uint8_t>(grid_types, row)),
+          load<double>(grid_x, row), load<double>(grid_y, row));
+      } else {
+        shapes[row]->set_custom_color(color);
+      }
+    }
+  }
+  return true;
+}
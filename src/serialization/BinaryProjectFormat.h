@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+#include <ostream>
+#include <span>
+
+class DocumentModel;
+
+/**
+ * @brief Versioned binary project container (.nirb), an alternative to the
+ * JSON format for large documents.
+ *
+ * Layout (native little-endian):
+ * - 32-byte header: magic "NIRB", major/minor version, byte-order mark, chunk
+ *   count, shape count, CRC-32 of the chunk table and of the header itself;
+ * - chunk table: {fourcc id, element size, offset, size, CRC-32} per chunk;
+ * - 8-byte aligned chunks: substrate, material table and names, then one
+ *   column per shape field (type, x, y, width, height, rotation, preset
+ *   material index, custom color and grid) and the shape name pool.
+ *
+ * Columns mirror ShapeStore, so saving writes the store spans as they are and
+ * loading reads them straight out of a memory-mapped file without parsing.
+ * Every chunk is checksummed; readers skip chunks they do not know, and a
+ * newer minor version stays readable.
+ */
+class BinaryProjectFormat {
+ public:
+  static bool write(std::ostream& stream, const DocumentModel& document);
+  /**
+   * @brief Replace the document contents with the project in data (usually a
+   * mapped file). Fails without touching the document if data is invalid.
+   */
+  static bool read(std::span<const std::byte> data, DocumentModel& document);
+
+ private:
+  BinaryProjectFormat() = default;
+};
@@ -0,0 +1,774 @@
+#include "serialization/ChangeJournal.h"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+#include "model/DocumentModel.h"
+#include "model/MaterialModel.h"
+#include "model/ShapeModel.h"
+#include "model/ShapeStore.h"
+#include "model/SubstrateModel.h"
+#include "model/core/ModelTypes.h"
+#include "utils/Crc32.h"
+#include "utils/Logging.h"
+
+namespace {
+constexpr std::array<char, 4> kMagic{'N', 'I', 'R', 'J'};
+constexpr uint16_t kMajorVersion = 1;
+constexpr uint16_t kMinorVersion = 1;  // 1: ShapesInserted
+constexpr uint32_t kByteOrderMark = 0x01020304U;
+constexpr auto kJournalSuffix = ".journal";
+constexpr uint8_t kMaxShapeType =
+  static_cast<uint8_t>(ShapeModel::ShapeType::Stick);
+constexpr uint32_t kMaxGridType =
+  static_cast<uint32_t>(MaterialModel::GridType::Internal);
+// Store handles address 32-bit slots
+constexpr uint64_t kMaxShapesAdded = std::numeric_limits<uint32_t>::max();
+
+struct FileHeader {
+  std::array<char, 4> magic;
+  uint16_t major_version;
+  uint16_t minor_version;
+  uint32_t byte_order;
+  uint32_t reserved;
+  uint64_t base_size;  // Project file the journal applies to
+  int64_t base_time;   // Its last modification time
+  uint32_t reserved2;
+  uint32_t header_crc;  // Of the bytes before this field
+};
+static_assert(sizeof(FileHeader) == 40);
+
+struct FrameHeader {
+  uint32_t size;  // Payload bytes
+  uint32_t crc;   // Of the payload
+};
+static_assert(sizeof(FrameHeader) == 8);
+
+enum class Op : uint8_t {
+  ShapesAdded = 1,  // uint64 count; appended with default values
+  ShapeRemoved,     // uint64 row
+  ShapesCleared,
+  ShapeState,  // uint64 row, ShapeRecord, name
+  MaterialAdded,
+  MaterialRemoved,  // uint64 index
+  MaterialsCleared,
+  MaterialState,   // uint64 index, MaterialRecord, name
+  SubstrateState,  // SubstrateRecord, name
+  ShapesInserted,  // uint64 row, uint64 count; inserted with default values
+};
+
+struct ShapeRecord {
+  double x;
+  double y;
+  double width;
+  double height;
+  double rotation_deg;
+  double grid_frequency_x;  // Custom material
+  double grid_frequency_y;  // Custom material
+  int32_t material_index;   // Preset, -1 = custom
+  uint32_t color;           // Custom material
+  uint32_t name_length;
+  uint8_t type;
+  uint8_t grid_type;  // Custom material
+  uint16_t reserved;
+};
+static_assert(sizeof(ShapeRecord) == 72);
+
+struct MaterialRecord {
+  double grid_frequency_x;
+  double grid_frequency_y;
+  uint32_t color;
+  uint32_t grid_type;
+  uint32_t name_length;
+  uint32_t reserved;
+};
+static_assert(sizeof(MaterialRecord) == 32);
+
+struct SubstrateRecord {
+  double width;
+  double height;
+  uint32_t color;
+  uint32_t name_length;
+};
+static_assert(sizeof(SubstrateRecord) == 24);
+
+uint32_t pack_color(const Color& color) {
+  return static_cast<uint32_t>(color.r) |
+         static_cast<uint32_t>(color.g) << 8 |
+         static_cast<uint32_t>(color.b) << 16 |
+         static_cast<uint32_t>(color.a) << 24;
+}
+
+Color unpack_color(uint32_t value) {
+  return Color{static_cast<uint8_t>(value & 0xFFU),
+               static_cast<uint8_t>((value >> 8) & 0xFFU),
+               static_cast<uint8_t>((value >> 16) & 0xFFU),
+               static_cast<uint8_t>(value >> 24)};
+}
+
+template <typename T>
+void append(std::string& buffer, const T& value) {
+  buffer.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+void append_op(std::string& buffer, Op op) {
+  append(buffer, static_cast<uint8_t>(op));
+}
+
+void append_shape(std::string& buffer, uint64_t row, const ShapeModel& shape,
+                  std::string_view name, int32_t material_index) {
+  const MaterialModel& material = shape.material_values();
+  const bool is_custom = material_index < 0;
+  const ShapeRecord record{
+    .x = shape.position().x,
+    .y = shape.position().y,
+    .width = shape.size().width,
+    .height = shape.size().height,
+    .rotation_deg = shape.rotation_deg(),
+    .grid_frequency_x = is_custom ? material.grid_frequency_x() : 0.0,
+    .grid_frequency_y = is_custom ? material.grid_frequency_y() : 0.0,
+    .material_index = material_index,
+    .color = is_custom ? pack_color(material.color()) : 0,
+    .name_length = static_cast<uint32_t>(name.size()),
+    .type = static_cast<uint8_t>(shape.type()),
+    .grid_type =
+      is_custom ? static_cast<uint8_t>(material.grid_type()) : uint8_t{0},
+    .reserved = 0};
+  append_op(buffer, Op::ShapeState);
+  append(buffer, row);
+  append(buffer, record);
+  buffer.append(name);
+}
+
+void append_material(std::string& buffer, uint64_t index,
+                     const MaterialModel& material) {
+  const std::string& name = material.name();
+  const MaterialRecord record{
+    .grid_frequency_x = material.grid_frequency_x(),
+    .grid_frequency_y = material.grid_frequency_y(),
+    .color = pack_color(material.color()),
+    .grid_type = static_cast<uint32_t>(material.grid_type()),
+    .name_length = static_cast<uint32_t>(name.size()),
+    .reserved = 0};
+  append_op(buffer, Op::MaterialState);
+  append(buffer, index);
+  append(buffer, record);
+  buffer.append(name);
+}
+
+void append_substrate(std::string& buffer, const SubstrateModel& substrate) {
+  const std::string& name = substrate.name();
+  const SubstrateRecord record{
+    .width = substrate.size().width,
+    .height = substrate.size().height,
+    .color = pack_color(substrate.color()),
+    .name_length = static_cast<uint32_t>(name.size())};
+  append_op(buffer, Op::SubstrateState);
+  append(buffer, record);
+  buffer.append(name);
+}
+
+uint64_t handle_key(const ShapeStore::Handle& handle) {
+  return static_cast<uint64_t>(handle.slot) << 32 | handle.generation;
+}
+
+struct BaseStamp {
+  uint64_t size{0};
+  int64_t time{0};
+};
+
+bool stamp_project(const std::filesystem::path& project, BaseStamp& stamp) {
+  std::error_code error;
+  const auto size = std::filesystem::file_size(project, error);
+  if (error) {
+    return false;
+  }
+  const auto time = std::filesystem::last_write_time(project, error);
+  if (error) {
+    return false;
+  }
+  stamp.size = size;
+  stamp.time = static_cast<int64_t>(time.time_since_epoch().count());
+  return true;
+}
+
+// Sequential reader over one frame payload
+class RecordReader {
+ public:
+  explicit RecordReader(std::span<const std::byte> data) : data_(data) {}
+
+  bool at_end() const {
+    return position_ == data_.size();
+  }
+
+  template <typename T>
+  bool read(T& value) {
+    if (data_.size() - position_ < sizeof(T)) {
+      return false;
+    }
+    std::memcpy(&value, data_.data() + position_, sizeof(T));
+    position_ += sizeof(T);
+    return true;
+  }
+
+  bool read_string(size_t length, std::string_view& value) {
+    if (data_.size() - position_ < length) {
+      return false;
+    }
+    value = std::string_view(
+      reinterpret_cast<const char*>(data_.data() + position_), length);
+    position_ += length;
+    return true;
+  }
+
+ private:
+  std::span<const std::byte> data_;
+  size_t position_{0};
+};
+
+// Row and material counts while frames are checked before anything is applied
+struct ReplayCounts {
+  uint64_t shapes{0};
+  uint64_t materials{0};
+};
+
+void apply_shape(DocumentModel& document, uint64_t row,
+                 const ShapeRecord& record, std::string_view name) {
+  const auto& shape = document.shapes()[row];
+  shape->set_type(static_cast<ShapeModel::ShapeType>(record.type));
+  shape->set_position(Point2D{.x = record.x, .y = record.y});
+  shape->set_size(Size2D{.width = record.width, .height = record.height});
+  shape->set_rotation_deg(record.rotation_deg);
+  shape->set_name(std::string(name));
+  if (record.material_index >= 0) {
+    shape->assign_material(
+      document.materials()[static_cast<size_t>(record.material_index)]);
+    return;
+  }
+  if (shape->material_mode() == ShapeModel::MaterialMode::Preset) {
+    shape->clear_material();
+  }
+  shape->set_custom_values(
+    unpack_color(record.color),
+    static_cast<MaterialModel::GridType>(record.grid_type),
+    record.grid_frequency_x, record.grid_frequency_y);
+}
+
+void apply_material(MaterialModel& material, const MaterialRecord& record,
+                    std::string_view name) {
+  material.set_name(std::string(name));
+  material.set_color(unpack_color(record.color));
+  material.set_grid_type(
+    static_cast<MaterialModel::GridType>(record.grid_type));
+  material.set_grid_frequency_x(record.grid_frequency_x);
+  material.set_grid_frequency_y(record.grid_frequency_y);
+}
+
+/**
+ * Rows erased by consecutive ShapeRemoved records, collected so that they are
+ * removed in one DocumentModel::remove_shapes() pass instead of one linear
+ * erase each.
+ */
+class PendingRemovals {
+ public:
+  // Add the row a record erases, given after the rows collected so far
+  void add(size_t row) {
+    // The record's row skips the collected rows before it: find the first
+    // collected row j with rows_[j] - j > row
+    size_t low = 0;
+    size_t high = rows_.size();
+    while (low < high) {
+      const size_t mid = low + (high - low) / 2;
+      if (rows_[mid] - mid <= row) {
+        low = mid + 1;
+      } else {
+        high = mid;
+      }
+    }
+    rows_.insert(rows_.begin() + static_cast<std::ptrdiff_t>(low), row + low);
+  }
+
+  void flush(DocumentModel& document) {
+    if (rows_.empty()) {
+      return;
+    }
+    std::vector<std::shared_ptr<ShapeModel>> shapes;
+    shapes.reserve(rows_.size());
+    for (const size_t row : rows_) {
+      shapes.push_back(document.shapes()[row]);
+    }
+    rows_.clear();
+    document.remove_shapes(shapes);
+  }
+
+ private:
+  std::vector<size_t> rows_;  // Ascending, as rows before the first removal
+};
+
+/**
+ * Check one frame against the counts and, with a document, apply it. Checking
+ * all frames first means the document is never left half-replayed.
+ */
+bool replay_frame(std::span<const std::byte> payload, ReplayCounts& counts,
+                  DocumentModel* document) {
+  RecordReader reader(payload);
+  PendingRemovals removals;
+  while (!reader.at_end()) {
+    uint8_t op = 0;
+    if (!reader.read(op)) {
+      return false;
+    }
+    // Every other record sees the rows after the removals
+    if (document != nullptr && static_cast<Op>(op) != Op::ShapeRemoved) {
+      removals.flush(*document);
+    }
+    switch (static_cast<Op>(op)) {
+      case Op::ShapesAdded: {
+        uint64_t count = 0;
+        if (!reader.read(count) || count > kMaxShapesAdded) {
+          return false;
+        }
+        counts.shapes += count;
+        if (document != nullptr) {
+          const std::vector<ShapeStore::Record> records(count);
+          document->create_shapes(records,
+                                  std::span<const std::string_view>{});
+        }
+        break;
+      }
+      case Op::ShapesInserted: {
+        uint64_t row = 0;
+        uint64_t count = 0;
+        if (!reader.read(row) || !reader.read(count) ||
+            count > kMaxShapesAdded || row > counts.shapes) {
+          return false;
+        }
+        counts.shapes += count;
+        if (document != nullptr) {
+          const std::vector<ShapeStore::Record> records(count);
+          document->insert_shapes(static_cast<size_t>(row), records);
+        }
+        break;
+      }
+      case Op::ShapeRemoved: {
+        uint64_t row = 0;
+        if (!reader.read(row) || row >= counts.shapes) {
+          return false;
+        }
+        --counts.shapes;
+        removals.add(static_cast<size_t>(row));
+        break;
+      }
+      case Op::ShapesCleared:
+        counts.shapes = 0;
+        if (document != nullptr) {
+          document->clear_shapes();
+        }
+        break;
+      case Op::ShapeState: {
+        uint64_t row = 0;
+        ShapeRecord record{};
+        std::string_view name;
+        if (!reader.read(row) || !reader.read(record) ||
+            !reader.read_string(record.name_length, name) ||
+            row >= counts.shapes || record.type > kMaxShapeType ||
+            record.grid_type > kMaxGridType ||
+            (record.material_index >= 0 &&
+             static_cast<uint64_t>(record.material_index) >=
+               counts.materials)) {
+          return false;
+        }
+        if (document != nullptr) {
+          apply_shape(*document, row, record, name);
+        }
+        break;
+      }
+      case Op::MaterialAdded:
+        ++counts.materials;
+        if (document != nullptr) {
+          document->create_material();
+        }
+        break;
+      case Op::MaterialRemoved: {
+        uint64_t index = 0;
+        if (!reader.read(index) || index >= counts.materials) {
+          return false;
+        }
+        --counts.materials;
+        if (document != nullptr) {
+          document->remove_material(
+            document->materials()[static_cast<size_t>(index)]);
+        }
+        break;
+      }
+      case Op::MaterialsCleared:
+        counts.materials = 0;
+        if (document != nullptr) {
+          document->clear_materials();
+        }
+        break;
+      case Op::MaterialState: {
+        uint64_t index = 0;
+        MaterialRecord record{};
+        std::string_view name;
+        if (!reader.read(index) || !reader.read(record) ||
+            !reader.read_string(record.name_length, name) ||
+            index >= counts.materials || record.grid_type > kMaxGridType) {
+          return false;
+        }
+        if (document != nullptr) {
+          apply_material(*document->materials()[static_cast<size_t>(index)],
+                         record, name);
+        }
+        break;
+      }
+      case Op::SubstrateState: {
+        SubstrateRecord record{};
+        std::string_view name;
+        if (!reader.read(record) ||
+            !reader.read_string(record.name_length, name)) {
+          return false;
+        }
+        if (document != nullptr) {
+          auto substrate = document->substrate();
+          substrate->set_size(
+            Size2D{.width = record.width, .height = record.height});
+          substrate->set_color(unpack_color(record.color));
+          substrate->set_name(std::string(name));
+        }
+        break;
+      }
+      default:
+        return false;
+    }
+  }
+  if (document != nullptr) {
+    removals.flush(*document);
+  }
+  return true;
+}
+
+/**
+ * Read and check the journal of project. Returns the journal bytes and the
+ * end of every complete frame in frame_ends; false when there is no journal
+ * for this version of the project.
+ */
+bool read_journal(const std::filesystem::path& journal_path,
+                  const BaseStamp& stamp, std::vector<std::byte>& bytes,
+                  std::vector<size_t>& frame_ends) {
+  std::error_code error;
+  const auto size = std::filesystem::file_size(journal_path, error);
+  if (error || size < sizeof(FileHeader)) {
+    return false;
+  }
+  bytes.resize(static_cast<size_t>(size));
+  std::ifstream stream(journal_path, std::ios::binary);
+  if (!stream.read(reinterpret_cast<char*>(bytes.data()),
+                   static_cast<std::streamsize>(bytes.size()))) {
+    return false;
+  }
+  FileHeader header{};
+  std::memcpy(&header, bytes.data(), sizeof(header));
+  if (header.magic != kMagic || header.byte_order != kByteOrderMark ||
+      header.header_crc != crc32(&header, offsetof(FileHeader, header_crc)) ||
+      header.major_version != kMajorVersion) {
+    LOG_WARN() << "Ignoring unreadable change journal: "
+               << journal_path.string();
+    return false;
+  }
+  if (header.base_size != stamp.size || header.base_time != stamp.time) {
+    LOG_WARN() << "Ignoring stale change journal: " << journal_path.string();
+    return false;
+  }
+
+  size_t position = sizeof(FileHeader);
+  while (bytes.size() - position >= sizeof(FrameHeader)) {
+    FrameHeader frame{};
+    std::memcpy(&frame, bytes.data() + position, sizeof(frame));
+    const size_t payload = position + sizeof(FrameHeader);
+    if (bytes.size() - payload < frame.size ||
+        frame.crc != crc32(bytes.data() + payload, frame.size)) {
+      break;  // Torn or corrupted tail
+    }
+    position = payload + frame.size;
+    frame_ends.push_back(position);
+  }
+  return true;
+}
+}  // namespace
+
+ChangeJournal::~ChangeJournal() {
+  close();
+}
+
+auto ChangeJournal::path_for(const std::filesystem::path& project)
+  -> std::filesystem::path {
+  std::filesystem::path path = project;
+  path += kJournalSuffix;
+  return path;
+}
+
+auto ChangeJournal::replay(const std::filesystem::path& project,
+                           DocumentModel& document) -> ReplayResult {
+  BaseStamp stamp;
+  std::vector<std::byte> bytes;
+  std::vector<size_t> frame_ends;
+  if (!stamp_project(project, stamp) ||
+      !read_journal(path_for(project), stamp, bytes, frame_ends)) {
+    return {};
+  }
+
+  const auto payload_of = [&bytes, &frame_ends](size_t frame) {
+    const size_t begin =
+      (frame == 0 ? sizeof(FileHeader) : frame_ends[frame - 1]) +
+      sizeof(FrameHeader);
+    return std::span<const std::byte>(bytes).subspan(
+      begin, frame_ends[frame] - begin);
+  };
+  // Check every frame before touching the document; a checksummed frame that
+  // does not fit the project ends the replay like a torn one
+  ReplayCounts counts{.shapes = document.shapes().size(),
+                      .materials = document.materials().size()};
+  size_t frame_count = 0;
+  while (frame_count < frame_ends.size() &&
+         replay_frame(payload_of(frame_count), counts, nullptr)) {
+    ++frame_count;
+  }
+  if (frame_count < frame_ends.size()) {
+    LOG_WARN() << "Change journal is inconsistent after frame " << frame_count;
+  }
+
+  counts = ReplayCounts{.shapes = document.shapes().size(),
+                        .materials = document.materials().size()};
+  const DocumentModel::Batch batch(document);
+  for (size_t frame = 0; frame < frame_count; ++frame) {
+    replay_frame(payload_of(frame), counts, &document);
+  }
+  if (frame_count > 0) {
+    LOG_INFO() << "Replayed " << frame_count
+               << " journal frames: " << path_for(project).string();
+  }
+  return ReplayResult{
+    .frames = frame_count,
+    .end = frame_count > 0 ? frame_ends[frame_count - 1] : sizeof(FileHeader)};
+}
+
+bool ChangeJournal::open(const std::filesystem::path& project,
+                         DocumentModel& document, uint64_t applied_end) {
+  close();
+  BaseStamp stamp;
+  if (!stamp_project(project, stamp)) {
+    LOG_ERROR() << "Cannot journal a project that is not on disk: "
+                << project.string();
+    return false;
+  }
+  path_ = path_for(project);
+
+  // Keep the frames the document holds. Frames after them passed their
+  // checksum but did not fit on replay; new frames must not follow them
+  std::vector<std::byte> bytes;
+  std::vector<size_t> frame_ends;
+  size_t keep = 0;
+  if (applied_end > 0 && read_journal(path_, stamp, bytes, frame_ends) &&
+      (applied_end == sizeof(FileHeader) ||
+       std::ranges::binary_search(frame_ends, applied_end))) {
+    keep = static_cast<size_t>(applied_end);
+  }
+  if (keep > 0) {
+    std::error_code error;
+    std::filesystem::resize_file(path_, keep, error);
+    if (error) {
+      keep = 0;
+    }
+  }
+  if (keep > 0) {
+    stream_.open(path_, std::ios::binary | std::ios::app);
+  } else {
+    stream_.open(path_, std::ios::binary | std::ios::trunc);
+    FileHeader header{.magic = kMagic,
+                      .major_version = kMajorVersion,
+                      .minor_version = kMinorVersion,
+                      .byte_order = kByteOrderMark,
+                      .reserved = 0,
+                      .base_size = stamp.size,
+                      .base_time = stamp.time,
+                      .reserved2 = 0,
+                      .header_crc = 0};
+    header.header_crc = crc32(&header, offsetof(FileHeader, header_crc));
+    stream_.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    stream_.flush();
+    keep = sizeof(FileHeader);
+  }
+  if (!stream_) {
+    LOG_ERROR() << "Failed to open change journal: " << path_.string();
+    stream_ = std::ofstream();
+    return false;
+  }
+
+  size_bytes_ = keep;
+  base_size_ = stamp.size;
+  document_ = &document;
+  edit_connection_ = document.on_edit().connect(
+    [this](const DocumentModel::Edit& edit) { on_edit(edit); });
+  return true;
+}
+
+void ChangeJournal::close() {
+  if (document_ == nullptr) {
+    return;
+  }
+  commit();
+  detach();
+}
+
+void ChangeJournal::discard() {
+  if (document_ == nullptr) {
+    return;
+  }
+  detach();
+  std::error_code error;
+  std::filesystem::remove(path_, error);
+}
+
+void ChangeJournal::detach() {
+  document_->on_edit().disconnect(edit_connection_);
+  document_ = nullptr;
+  edit_connection_ = -1;
+  stream_.close();
+  stream_ = std::ofstream();
+  size_bytes_ = 0;
+  base_size_ = 0;
+  pending_.clear();
+  dirty_shapes_.clear();
+  dirty_keys_.clear();
+  materials_dirty_ = false;
+  substrate_dirty_ = false;
+}
+
+void ChangeJournal::on_edit(const DocumentModel::Edit& edit) {
+  using Kind = DocumentModel::Edit::Kind;
+  switch (edit.kind) {
+    case Kind::ShapesAdded:
+      // Shapes restored by undo go back to their rows
+      if (edit.index + edit.count == document_->shapes().size()) {
+        append_op(pending_, Op::ShapesAdded);
+      } else {
+        append_op(pending_, Op::ShapesInserted);
+        append(pending_, static_cast<uint64_t>(edit.index));
+      }
+      append(pending_, static_cast<uint64_t>(edit.count));
+      for (size_t row = edit.index; row < edit.index + edit.count; ++row) {
+        mark_shape(row);
+      }
+      break;
+    case Kind::ShapesRemoved:
+      // A range is removed by erasing its first row count times
+      for (size_t i = 0; i < edit.count; ++i) {
+        append_op(pending_, Op::ShapeRemoved);
+        append(pending_, static_cast<uint64_t>(edit.index));
+      }
+      break;
+    case Kind::ShapesChanged:
+      for (size_t row = edit.index; row < edit.index + edit.count; ++row) {
+        mark_shape(row);
+      }
+      break;
+    case Kind::ShapesCleared:
+      append_op(pending_, Op::ShapesCleared);
+      dirty_shapes_.clear();
+      dirty_keys_.clear();
+      break;
+    case Kind::MaterialsAdded:
+      for (size_t i = 0; i < edit.count; ++i) {
+        append_op(pending_, Op::MaterialAdded);
+      }
+      materials_dirty_ = true;
+      break;
+    case Kind::MaterialsRemoved:
+      for (size_t i = 0; i < edit.count; ++i) {
+        append_op(pending_, Op::MaterialRemoved);
+        append(pending_, static_cast<uint64_t>(edit.index));
+      }
+      materials_dirty_ = true;
+      break;
+    case Kind::MaterialsChanged:
+      materials_dirty_ = true;
+      break;
+    case Kind::MaterialsCleared:
+      append_op(pending_, Op::MaterialsCleared);
+      materials_dirty_ = true;
+      break;
+    case Kind::SubstrateChanged:
+      substrate_dirty_ = true;
+      break;
+  }
+}
+
+void ChangeJournal::mark_shape(size_t row) {
+  const ShapeStore::Handle handle = document_->shape_store().handle_at(row);
+  if (handle.is_valid() && dirty_keys_.insert(handle_key(handle)).second) {
+    dirty_shapes_.push_back(handle);
+  }
+}
+
+bool ChangeJournal::commit() {
+  if (document_ == nullptr || !has_pending()) {
+    return true;
+  }
+
+  // Structural records first, then the current state of everything touched
+  // (materials before shapes, which refer to them by index)
+  std::string payload = std::move(pending_);
+  pending_.clear();
+  if (materials_dirty_) {
+    const auto& materials = document_->materials();
+    for (size_t index = 0; index < materials.size(); ++index) {
+      append_material(payload, index, *materials[index]);
+    }
+  }
+  const ShapeStore& store = document_->shape_store();
+  const auto& shapes = document_->shapes();
+  for (const ShapeStore::Handle& handle : dirty_shapes_) {
+    const size_t row = store.row_of(handle);
+    if (row >= shapes.size()) {
+      continue;  // Removed since
+    }
+    append_shape(payload, row, *shapes[row], store.name_at(row),
+                 store.material_indices()[row]);
+  }
+  if (substrate_dirty_ && document_->substrate()) {
+    append_substrate(payload, *document_->substrate());
+  }
+  dirty_shapes_.clear();
+  dirty_keys_.clear();
+  materials_dirty_ = false;
+  substrate_dirty_ = false;
+
+  if (payload.size() > std::numeric_limits<uint32_t>::max()) {
+    LOG_ERROR() << "Change journal frame is too large";
+    return false;
+  }
+  const FrameHeader frame{.size = static_cast<uint32_t>(payload.size()),
+                          .crc = crc32(payload.data(), payload.size())};
+  stream_.write(reinterpret_cast<const char*>(&frame), sizeof(frame));
+  stream_.write(payload.data(), static_cast<std::streamsize>(payload.size()));
+  stream_.flush();
+  if (!stream_) {
+    LOG_ERROR() << "Failed to append to change journal: " << path_.string();
+    return false;
+  }
+  size_bytes_ += sizeof(frame) + payload.size();
+  return true;
+}
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "model/DocumentModel.h"
+#include "model/ShapeStore.h"
+
+/**
+ * @brief Append-only journal of document edits kept next to a project file
+ * ("<project>.journal") for incremental autosave and crash recovery.
+ *
+ * The journal follows DocumentModel::on_edit() and collects the rows touched
+ * since the last commit. commit() appends them as one frame: the structural
+ * edits in order (shapes added or removed, materials added or removed) and
+ * then the current state of every touched shape, material and the substrate.
+ * Committing therefore costs O(edits), independent of the document size.
+ *
+ * Layout (native byte order, the journal belongs to the machine that wrote
+ * it):
+ * - 40-byte header: magic "NIRJ", version, byte-order mark, size and
+ *   modification time of the project file the journal applies to, header
+ *   CRC-32;
+ * - frames: {payload size, payload CRC-32} followed by the records.
+ *
+ * A frame is only replayed when it is complete and its checksum matches, so a
+ * crash in the middle of a commit loses at most that commit. A journal whose
+ * project file has been rewritten since is stale and ignored.
+ */
+class ChangeJournal {
+ public:
+  ChangeJournal() = default;
+  ~ChangeJournal();
+
+  ChangeJournal(const ChangeJournal&) = delete;
+  ChangeJournal& operator=(const ChangeJournal&) = delete;
+
+  static auto path_for(const std::filesystem::path& project)
+    -> std::filesystem::path;
+
+  struct ReplayResult {
+    size_t frames{0};  // Number of replayed frames
+    // Journal bytes up to the end of the last replayed frame (the header
+    // alone when none applied); 0 without a usable journal
+    uint64_t end{0};
+  };
+  /**
+   * @brief Apply the journal of project to document, which must hold the
+   * project as loaded from disk. Replay stops at the first frame that is
+   * torn or does not fit the document.
+   */
+  static auto replay(const std::filesystem::path& project,
+                     DocumentModel& document) -> ReplayResult;
+
+  /**
+   * @brief Start journaling the edits of document, which must match the
+   * project file plus the first @p applied_end bytes of its journal
+   * (ReplayResult::end, or size_bytes() of the journal closed last). The
+   * journal is cut there, so frames the document does not hold are dropped
+   * before new ones follow; 0, or an offset that is not a frame end, starts
+   * a new journal.
+   */
+  bool open(const std::filesystem::path& project, DocumentModel& document,
+            uint64_t applied_end);
+  /**
+   * @brief Commit pending edits and stop journaling; the file stays for the
+   * next replay.
+   */
+  void close();
+  /**
+   * @brief Stop journaling and delete the journal (e.g. after a full save).
+   */
+  void discard();
+
+  /**
+   * @brief Append the edits since the last commit as one frame.
+   */
+  bool commit();
+
+  bool is_open() const {
+    return document_ != nullptr;
+  }
+  bool has_pending() const {
+    return !pending_.empty() || !dirty_shapes_.empty() || materials_dirty_ ||
+           substrate_dirty_;
+  }
+  // Journal bytes on disk, used to decide when to compact into the project
+  uint64_t size_bytes() const {
+    return size_bytes_;
+  }
+  // Size of the project file the journal applies to
+  uint64_t base_size() const {
+    return base_size_;
+  }
+
+ private:
+  void on_edit(const DocumentModel::Edit& edit);
+  void mark_shape(size_t row);
+  void detach();
+
+  DocumentModel* document_{nullptr};
+  int edit_connection_{-1};
+  std::filesystem::path path_;
+  std::ofstream stream_;
+  uint64_t size_bytes_{0};
+  uint64_t base_size_{0};
+
+  // Structural records of the pending frame, in edit order
+  std::string pending_;
+  // Shapes whose state goes into the pending frame (stale handles are skipped)
+  std::vector<ShapeStore::Handle> dirty_shapes_;
+  std::unordered_set<uint64_t> dirty_keys_;
+  bool materials_dirty_{false};
+  bool substrate_dirty_{false};
+};
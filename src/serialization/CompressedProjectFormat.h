@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+#include <ostream>
+#include <span>
+
+class DocumentModel;
+
+/**
+ * @brief Compressed project container (.nirz) for shared and network storage.
+ *
+ * The payload is a BinaryProjectFormat image cut into fixed-size blocks that
+ * are deflated independently (qCompress), so both saving and loading spread
+ * the codec over worker threads. Saving compresses blocks while the image is
+ * still being serialized and never holds the whole image:
+ * - 48-byte header: magic "NIRZ", version, codec, block size and count,
+ *   image size, offset and CRC-32 of the block table, header CRC-32;
+ * - compressed blocks, in any order (the first is written last);
+ * - block table: {offset, compressed size, CRC-32} per block.
+ */
+class CompressedProjectFormat {
+ public:
+  static bool write(std::ostream& stream, const DocumentModel& document);
+  /**
+   * @brief Replace the document contents with the project in data (usually a
+   * mapped file). Fails without touching the document if data is invalid.
+   */
+  static bool read(std::span<const std::byte> data, DocumentModel& document);
+
+ private:
+  CompressedProjectFormat() = default;
+};
@@ -0,0 +1,814 @@
+#include "serialization/JsonProjectFormat.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "model/DocumentModel.h"
+#include "model/MaterialModel.h"
+#include "model/ShapeModel.h"
+#include "model/ShapeStore.h"
+#include "model/SubstrateModel.h"
+#include "model/core/ModelTypes.h"
+#include "serialization/JsonPullReader.h"
+#include "utils/Logging.h"
+
+namespace {
+
+using Token = JsonPullReader::Token;
+
+// Calls member(key) for each member of the object started by token; member
+// must consume the value. Other values are skipped and read as an empty
+// object, like QJsonValue::toObject()
+template <typename MemberFn>
+bool read_object(JsonPullReader& reader, Token token, MemberFn&& member) {
+  if (token != Token::BeginObject) {
+    return reader.skip(token);
+  }
+  Token key = reader.next();
+  for (; key == Token::Key; key = reader.next()) {
+    if (!member(reader.string())) {
+      return false;
+    }
+  }
+  return key == Token::EndObject;
+}
+
+// Calls element(token) for each element of the array started by token;
+// element must consume the value token starts
+template <typename ElementFn>
+bool read_array(JsonPullReader& reader, Token token, ElementFn&& element) {
+  if (token != Token::BeginArray) {
+    return reader.skip(token);
+  }
+  for (Token item = reader.next(); item != Token::EndArray;
+       item = reader.next()) {
+    if (item == Token::Error || !element(item)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Values of other types read as 0, like QJsonValue::toDouble()
+bool read_number(JsonPullReader& reader, double& value) {
+  const Token token = reader.next();
+  value = token == Token::Number ? reader.number() : 0.0;
+  return reader.skip(token);
+}
+
+bool read_number(JsonPullReader& reader, std::optional<double>& value) {
+  double number = 0.0;
+  const bool success = read_number(reader, number);
+  value = number;
+  return success;
+}
+
+bool read_string(JsonPullReader& reader, std::string& value,
+                 std::string_view fallback) {
+  const Token token = reader.next();
+  value.assign(token == Token::String ? reader.string() : fallback);
+  return reader.skip(token);
+}
+
+// Integral doubles only, like QJsonValue::toInt()
+int to_int(double value) {
+  const bool representable =
+    std::isfinite(value) && value == std::trunc(value) &&
+    std::abs(value) <= std::numeric_limits<int>::max();
+  return representable ? static_cast<int>(value) : 0;
+}
+
+bool read_color(JsonPullReader& reader, Color& color) {
+  std::array<int, 4> components{};
+  size_t count = 0;
+  const bool success =
+    read_array(reader, reader.next(), [&](Token token) {
+      if (count < components.size()) {
+        components[count] =
+          token == Token::Number ? to_int(reader.number()) : 0;
+      }
+      ++count;
+      return reader.skip(token);
+    });
+  color = Color{};
+  if (count == components.size()) {
+    // Clamp values to valid range [0, 255]
+    constexpr int kMaxColorValue = 255;
+    const auto channel = [&](size_t index) {
+      return static_cast<uint8_t>(
+        std::clamp(components[index], 0, kMaxColorValue));
+    };
+    color = Color{channel(0), channel(1), channel(2), channel(3)};
+  }
+  return success;
+}
+
+bool read_color(JsonPullReader& reader, std::optional<Color>& color) {
+  return read_color(reader, color.emplace());
+}
+
+// {"width", "height"}; invalid or negative values give {0, 0}
+bool read_size(JsonPullReader& reader, std::optional<Size2D>& size) {
+  double width = 0.0;
+  double height = 0.0;
+  const bool success =
+    read_object(reader, reader.next(), [&](std::string_view key) {
+      if (key == "width") {
+        return read_number(reader, width);
+      }
+      if (key == "height") {
+        return read_number(reader, height);
+      }
+      return reader.skip_value();
+    });
+  size.emplace();
+  if (std::isfinite(width) && width >= 0.0 && std::isfinite(height) &&
+      height >= 0.0) {
+    *size = Size2D{width, height};
+  }
+  return success;
+}
+
+// {"x", "y"} or [x, y]; invalid values give {0, 0}
+bool read_position(JsonPullReader& reader, std::optional<Point2D>& point) {
+  double pos_x = 0.0;
+  double pos_y = 0.0;
+  size_t count = 0;
+  const Token token = reader.next();
+  bool success = true;
+  if (token == Token::BeginArray) {
+    success = read_array(reader, token, [&](Token item) {
+      if (item == Token::Number && count < 2) {
+        (count == 0 ? pos_x : pos_y) = reader.number();
+      }
+      ++count;
+      return reader.skip(item);
+    });
+  } else {
+    count = token == Token::BeginObject ? 2 : 0;
+    success = read_object(reader, token, [&](std::string_view key) {
+      if (key == "x") {
+        return read_number(reader, pos_x);
+      }
+      if (key == "y") {
+        return read_number(reader, pos_y);
+      }
+      return reader.skip_value();
+    });
+  }
+  point.emplace();
+  if (count >= 2 && std::isfinite(pos_x) && std::isfinite(pos_y)) {
+    *point = Point2D{pos_x, pos_y};
+  }
+  return success;
+}
+
+ShapeModel::ShapeType shape_type_from_string(std::string_view value) {
+  if (value == "ellipse") {
+    return ShapeModel::ShapeType::Ellipse;
+  }
+  if (value == "circle") {
+    return ShapeModel::ShapeType::Circle;
+  }
+  if (value == "stick") {
+    return ShapeModel::ShapeType::Stick;
+  }
+  return ShapeModel::ShapeType::Rectangle;
+}
+
+// Grid settings shared by materials and custom shape materials
+struct GridFields {
+  std::optional<double> type;
+  std::optional<double> frequency_x;
+  std::optional<double> frequency_y;
+  std::optional<double> frequency;  // Old format: same value for x and y
+
+  std::optional<double>* field(std::string_view key) {
+    if (key == "grid_type") {
+      return &type;
+    }
+    if (key == "grid_frequency_x") {
+      return &frequency_x;
+    }
+    if (key == "grid_frequency_y") {
+      return &frequency_y;
+    }
+    if (key == "grid_frequency") {
+      return &frequency;
+    }
+    return nullptr;
+  }
+
+  bool empty() const {
+    return !type && !frequency_x && !frequency_y && !frequency;
+  }
+};
+
+void apply_grid(MaterialModel& material, const GridFields& grid) {
+  if (grid.type) {
+    // Old Radial (1) becomes Internal (1); anything else is None
+    material.set_grid_type(to_int(*grid.type) == 1
+                             ? MaterialModel::GridType::Internal
+                             : MaterialModel::GridType::None);
+  }
+  if (grid.frequency_x && grid.frequency_y) {
+    // Validate values are finite and positive
+    if (std::isfinite(*grid.frequency_x) && *grid.frequency_x > 0.0) {
+      material.set_grid_frequency_x(*grid.frequency_x);
+    }
+    if (std::isfinite(*grid.frequency_y) && *grid.frequency_y > 0.0) {
+      material.set_grid_frequency_y(*grid.frequency_y);
+    }
+  } else if (grid.frequency && std::isfinite(*grid.frequency) &&
+             *grid.frequency > 0.0) {
+    material.set_grid_frequency_x(*grid.frequency);
+    material.set_grid_frequency_y(*grid.frequency);
+  }
+}
+
+struct MaterialFields {
+  std::string name;
+  std::optional<Color> color;
+  std::optional<Color> fill_color;  // Legacy key
+  GridFields grid;
+};
+
+struct LineFields {
+  double x1{0.0};
+  double y1{0.0};
+  double x2{0.0};
+  double y2{0.0};
+};
+
+// One object of the "objects" array, reused between objects to keep the
+// string buffers
+struct ShapeFields {
+  std::string name;
+  std::string type;
+  std::string material_mode;
+  std::string material_name;
+  bool has_material_name{false};
+  std::optional<Point2D> position;
+  std::optional<Size2D> size;
+  std::optional<double> width;
+  std::optional<double> height;
+  std::optional<double> radius;      // Legacy circles
+  std::optional<LineFields> line;    // Legacy sticks
+  std::optional<double> pen_width;   // Legacy sticks
+  std::optional<double> rotation;
+  std::optional<Color> custom_color;
+  std::optional<Color> fill_color;   // Legacy key
+  GridFields grid;
+
+  void reset() {
+    name.assign("Shape");
+    type.assign("rectangle");
+    material_mode.assign("custom");
+    material_name.clear();
+    has_material_name = false;
+    position.reset();
+    size.reset();
+    width.reset();
+    height.reset();
+    radius.reset();
+    line.reset();
+    pen_width.reset();
+    rotation.reset();
+    custom_color.reset();
+    fill_color.reset();
+    grid = {};
+  }
+};
+
+Size2D size_from_value(const ShapeFields& fields, ShapeModel::ShapeType type) {
+  if (fields.size) {
+    return *fields.size;
+  }
+  if (fields.width && fields.height) {
+    const double width = *fields.width;
+    const double height = *fields.height;
+    if (std::isfinite(width) && width > 0.0 && std::isfinite(height) &&
+        height > 0.0) {
+      return Size2D{width, height};
+    }
+  }
+  if (type == ShapeModel::ShapeType::Circle && fields.radius) {
+    constexpr double kRadiusToDiameterMultiplier = 2.0;
+    const double radius = *fields.radius;
+    if (std::isfinite(radius) && radius > 0.0) {
+      const double diameter = radius * kRadiusToDiameterMultiplier;
+      if (std::isfinite(diameter)) {
+        return Size2D{diameter, diameter};
+      }
+    }
+  }
+  if (type == ShapeModel::ShapeType::Stick && fields.line) {
+    constexpr double kDefaultPenWidth = 2.0;
+    const LineFields& line = *fields.line;
+    if (std::isfinite(line.x1) && std::isfinite(line.y1) &&
+        std::isfinite(line.x2) && std::isfinite(line.y2)) {
+      const double delta_x = line.x2 - line.x1;
+      const double delta_y = line.y2 - line.y1;
+      const double length = std::sqrt(delta_x * delta_x + delta_y * delta_y);
+      if (std::isfinite(length) && length > 0.0) {
+        const double width = fields.pen_width.value_or(kDefaultPenWidth);
+        if (std::isfinite(width) && width > 0.0) {
+          return Size2D{length, width};
+        }
+      }
+    }
+  }
+  return Size2D{100.0, 100.0};
+}
+
+Color custom_color_from_object(const ShapeFields& fields) {
+  if (fields.custom_color) {
+    return *fields.custom_color;
+  }
+  if (fields.fill_color) {
+    return *fields.fill_color;
+  }
+  return Color{};
+}
+
+// Pulls the project members into staging buffers in one pass over the
+// stream; commit() applies them to the document once the whole file parsed
+class ProjectLoader {
+ public:
+  ProjectLoader(JsonPullReader& reader, DocumentModel& document)
+      : reader_(reader), document_(document) {}
+
+  bool load() {
+    const Token root = reader_.next();
+    if (root != Token::BeginObject) {
+      return false;
+    }
+    const bool success = read_object(
+      reader_, root, [this](std::string_view key) { return read_member(key); });
+    if (!success || reader_.next() != Token::End) {
+      return false;
+    }
+    commit();
+    if (version_ != JsonProjectFormat::kVersion) {
+      LOG_WARN() << "Loading project with version mismatch";
+    }
+    return true;
+  }
+
+ private:
+  // Custom material settings of a staged shape
+  struct CustomMaterial {
+    size_t row{0};
+    std::optional<Color> color;
+    GridFields grid;
+  };
+
+  bool read_member(std::string_view key) {
+    if (key == "substrate") {
+      return read_substrate();
+    }
+    if (key == "materials") {
+      return read_materials(materials_, has_materials_);
+    }
+    if (key == "material_presets") {
+      return read_materials(presets_, has_presets_);
+    }
+    if (key == "objects") {
+      return read_objects();
+    }
+    if (key == "version") {
+      return read_string(reader_, version_, {});
+    }
+    return reader_.skip_value();
+  }
+
+  bool read_substrate() {
+    std::string name = "Substrate";
+    std::optional<Size2D> size;
+    std::optional<double> width;
+    std::optional<double> height;
+    std::optional<Color> color;
+    std::optional<Color> fill_color;
+    const bool success =
+      read_object(reader_, reader_.next(), [&](std::string_view key) {
+        if (key == "name") {
+          return read_string(reader_, name, "Substrate");
+        }
+        if (key == "size") {
+          return read_size(reader_, size);
+        }
+        if (key == "width") {
+          return read_number(reader_, width);
+        }
+        if (key == "height") {
+          return read_number(reader_, height);
+        }
+        if (key == "color") {
+          return read_color(reader_, color);
+        }
+        if (key == "fill_color") {
+          return read_color(reader_, fill_color);
+        }
+        return reader_.skip_value();
+      });
+    if (!success) {
+      return false;
+    }
+
+    auto substrate = std::make_shared<SubstrateModel>();
+    substrate->set_name(name);
+    if (size) {
+      if (size->width > 0.0 && size->height > 0.0) {
+        substrate->set_size(*size);
+      }
+    } else if (width && height && std::isfinite(*width) && *width > 0.0 &&
+               std::isfinite(*height) && *height > 0.0) {
+      substrate->set_size(Size2D{*width, *height});
+    }
+    if (color || fill_color) {
+      substrate->set_color(color ? *color : *fill_color);
+    }
+    substrate_ = std::move(substrate);
+    return true;
+  }
+
+  bool read_materials(std::vector<MaterialFields>& list, bool& seen) {
+    if (list_before_objects_) {
+      LOG_WARN() << "Ignoring a material list that follows the objects";
+      return reader_.skip_value();
+    }
+    seen = true;
+    list.clear();
+    return read_array(reader_, reader_.next(), [&](Token token) {
+      MaterialFields& material = list.emplace_back();
+      material.name = "Material";
+      return read_object(reader_, token, [&](std::string_view key) {
+        if (key == "name") {
+          return read_string(reader_, material.name, "Material");
+        }
+        if (key == "color") {
+          return read_color(reader_, material.color);
+        }
+        if (key == "fill_color") {
+          return read_color(reader_, material.fill_color);
+        }
+        if (auto* field = material.grid.field(key)) {
+          return read_number(reader_, *field);
+        }
+        return reader_.skip_value();
+      });
+    });
+  }
+
+  bool read_objects() {
+    // A list read before the objects is the one their presets refer to;
+    // without one, a list that follows is used instead
+    list_before_objects_ =
+      list_before_objects_ || has_materials_ || has_presets_;
+    return read_array(reader_, reader_.next(),
+                      [this](Token token) { return read_shape(token); });
+  }
+
+  bool read_shape(Token token) {
+    ShapeFields& shape = shape_;
+    shape.reset();
+    const bool success = read_object(reader_, token, [&](std::string_view key) {
+      if (key == "name") {
+        return read_string(reader_, shape.name, "Shape");
+      }
+      if (key == "type") {
+        return read_string(reader_, shape.type, "rectangle");
+      }
+      if (key == "position") {
+        return read_position(reader_, shape.position);
+      }
+      if (key == "size") {
+        return read_size(reader_, shape.size);
+      }
+      if (key == "width") {
+        return read_number(reader_, shape.width);
+      }
+      if (key == "height") {
+        return read_number(reader_, shape.height);
+      }
+      if (key == "radius") {
+        return read_number(reader_, shape.radius);
+      }
+      if (key == "pen_width") {
+        return read_number(reader_, shape.pen_width);
+      }
+      if (key == "rotation") {
+        return read_number(reader_, shape.rotation);
+      }
+      if (key == "line") {
+        LineFields& line = shape.line.emplace();
+        const auto coordinate = [&](std::string_view member) {
+          if (member == "x1") {
+            return read_number(reader_, line.x1);
+          }
+          if (member == "y1") {
+            return read_number(reader_, line.y1);
+          }
+          if (member == "x2") {
+            return read_number(reader_, line.x2);
+          }
+          if (member == "y2") {
+            return read_number(reader_, line.y2);
+          }
+          return reader_.skip_value();
+        };
+        return read_object(reader_, reader_.next(), coordinate);
+      }
+      if (key == "material_mode") {
+        return read_string(reader_, shape.material_mode, "custom");
+      }
+      if (key == "material_name") {
+        shape.has_material_name = true;
+        return read_string(reader_, shape.material_name, {});
+      }
+      if (key == "custom_color") {
+        return read_color(reader_, shape.custom_color);
+      }
+      if (key == "fill_color") {
+        return read_color(reader_, shape.fill_color);
+      }
+      if (auto* field = shape.grid.field(key)) {
+        return read_number(reader_, *field);
+      }
+      return reader_.skip_value();
+    });
+    if (success) {
+      add_shape();
+    }
+    return success;
+  }
+
+  void add_shape() {
+    const ShapeFields& shape = shape_;
+    const ShapeModel::ShapeType type = shape_type_from_string(shape.type);
+    ShapeStore::Record record;
+    record.type = static_cast<uint8_t>(type);
+    if (shape.position) {
+      record.position = *shape.position;
+    }
+    const Size2D size = size_from_value(shape, type);
+    if (size.width > 0.0 && size.height > 0.0) {
+      record.size = size;
+    }
+    if (shape.rotation && std::isfinite(*shape.rotation)) {
+      record.rotation_deg = *shape.rotation;
+    }
+
+    const size_t row = records_.size();
+    if (shape.material_mode == "preset" && shape.has_material_name) {
+      // Resolved to the material row by commit()
+      const auto [name_it, added] = preset_names_.try_emplace(
+        shape.material_name, static_cast<int32_t>(preset_names_.size()));
+      record.material_index = name_it->second;
+    } else if (shape.custom_color || shape.fill_color ||
+               !shape.grid.empty()) {
+      CustomMaterial& custom = customs_.emplace_back();
+      custom.row = row;
+      if (shape.custom_color || shape.fill_color) {
+        custom.color = custom_color_from_object(shape);
+      }
+      custom.grid = shape.grid;
+    }
+
+    records_.push_back(record);
+    names_.append(shape.name);
+    name_ends_.push_back(names_.size());
+  }
+
+  // Replaces the document contents with the staged project; "materials"
+  // takes precedence over the legacy "material_presets"
+  void commit() {
+    document_.clear_shapes();
+    document_.clear_materials();
+    if (substrate_ != nullptr) {
+      document_.set_substrate(substrate_);
+    }
+
+    std::unordered_map<std::string_view, int32_t> material_rows;
+    for (const MaterialFields& fields :
+         has_materials_ ? materials_ : presets_) {
+      const Color color = fields.color        ? *fields.color
+                          : fields.fill_color ? *fields.fill_color
+                                              : Color{};
+      auto material = document_.create_material(color, fields.name);
+      apply_grid(*material, fields.grid);
+      material_rows.emplace(
+        fields.name, static_cast<int32_t>(document_.materials().size() - 1));
+    }
+    // Staged preset name ids to material rows, -1 for unknown names
+    std::vector<int32_t> name_rows(preset_names_.size(), -1);
+    for (const auto& [name, id] : preset_names_) {
+      const auto material_it = material_rows.find(name);
+      if (material_it != material_rows.end()) {
+        name_rows[static_cast<size_t>(id)] = material_it->second;
+      }
+    }
+    for (ShapeStore::Record& record : records_) {
+      if (record.material_index >= 0) {
+        record.material_index =
+          name_rows[static_cast<size_t>(record.material_index)];
+      }
+    }
+
+    std::vector<std::string_view> name_views(records_.size());
+    const std::string_view pool = names_;
+    size_t begin = 0;
+    for (size_t row = 0; row < records_.size(); ++row) {
+      name_views[row] = pool.substr(begin, name_ends_[row] - begin);
+      begin = name_ends_[row];
+    }
+    const auto shapes = document_.create_shapes(records_, name_views);
+    for (const CustomMaterial& custom : customs_) {
+      // Shapes that keep the default material do not allocate one
+      const auto& shape = shapes[custom.row];
+      MaterialModel values(custom.color.value_or(shape->custom_color()));
+      apply_grid(values, custom.grid);
+      shape->set_custom_values(values);
+    }
+  }
+
+  JsonPullReader& reader_;
+  DocumentModel& document_;
+  std::string version_;
+
+  std::shared_ptr<SubstrateModel> substrate_;
+  std::vector<MaterialFields> materials_;
+  std::vector<MaterialFields> presets_;
+  bool has_materials_{false};
+  bool has_presets_{false};
+  bool list_before_objects_{false};  // Later lists are ignored
+
+  // Staged shapes; material_index is an id into preset_names_ until commit()
+  ShapeFields shape_;
+  std::vector<ShapeStore::Record> records_;
+  std::string names_;
+  std::vector<size_t> name_ends_;
+  std::vector<CustomMaterial> customs_;
+  std::unordered_map<std::string, int32_t> preset_names_;
+};
+
+std::string_view to_string(ShapeModel::ShapeType type) {
+  switch (type) {
+    case ShapeModel::ShapeType::Rectangle:
+      return "rectangle";
+    case ShapeModel::ShapeType::Ellipse:
+      return "ellipse";
+    case ShapeModel::ShapeType::Circle:
+      return "circle";
+    case ShapeModel::ShapeType::Stick:
+      return "stick";
+  }
+  return "rectangle";
+}
+
+void write_color(JsonWriter& writer, const Color& color) {
+  writer.begin_array();
+  writer.value(color.r);
+  writer.value(color.g);
+  writer.value(color.b);
+  writer.value(color.a);
+  writer.end_array();
+}
+
+void write_size(JsonWriter& writer, const Size2D& size) {
+  writer.begin_object();
+  writer.key("height");
+  writer.value(size.height);
+  writer.key("width");
+  writer.value(size.width);
+  writer.end_object();
+}
+
+// Grid members of a material object, in key order
+void write_grid(JsonWriter& writer, const MaterialModel& material) {
+  writer.key("grid_frequency");  // Backward compatibility
+  writer.value(material.grid_frequency_x());
+  writer.key("grid_frequency_x");
+  writer.value(material.grid_frequency_x());
+  writer.key("grid_frequency_y");
+  writer.value(material.grid_frequency_y());
+  writer.key("grid_type");
+  writer.value(static_cast<int>(material.grid_type()));
+}
+
+void write_materials(JsonWriter& writer, const DocumentModel& document) {
+  writer.begin_array();
+  for (const auto& material : document.materials()) {
+    if (!material) {
+      continue;
+    }
+    writer.begin_object();
+    writer.key("color");
+    write_color(writer, material->color());
+    write_grid(writer, *material);
+    writer.key("name");
+    writer.value(material->name());
+    writer.end_object();
+  }
+  writer.end_array();
+}
+
+// @p preset: the shape uses a material the document lists. A preset that
+// was removed from the document is written as the shape's custom material,
+// since no material name would resolve to it
+void write_shape(JsonWriter& writer, const ShapeModel& shape, bool preset) {
+  const MaterialModel& material = shape.material_values();
+  writer.begin_object();
+  if (!preset) {
+    // Custom material - save color and grid settings
+    writer.key("custom_color");
+    write_color(writer, material.color());
+    write_grid(writer, material);
+  }
+  writer.key("material_mode");
+  writer.value(preset ? "preset" : "custom");
+  if (preset) {
+    writer.key("material_name");
+    writer.value(material.name());
+  }
+  writer.key("name");
+  writer.value(shape.name());
+  const Point2D position = shape.position();
+  writer.key("position");
+  writer.begin_object();
+  writer.key("x");
+  writer.value(position.x);
+  writer.key("y");
+  writer.value(position.y);
+  writer.end_object();
+  writer.key("rotation");
+  writer.value(shape.rotation_deg());
+  writer.key("size");
+  write_size(writer, shape.size());
+  writer.key("type");
+  writer.value(to_string(shape.type()));
+  writer.end_object();
+}
+
+}  // namespace
+
+bool JsonProjectFormat::write(std::ostream& stream,
+                              const DocumentModel& document,
+                              JsonWriter::Layout layout) {
+  // Members in key order, as QJsonObject stored them
+  JsonWriter writer(stream, layout);
+  writer.begin_object();
+  writer.key("material_presets");  // Backward compatibility
+  write_materials(writer, document);
+  writer.key("materials");
+  write_materials(writer, document);
+
+  writer.key("objects");
+  writer.begin_array();
+  const auto material_indices = document.shape_store().material_indices();
+  const auto& shapes = document.shapes();
+  for (size_t row = 0; row < shapes.size(); ++row) {
+    if (shapes[row]) {
+      write_shape(writer, *shapes[row], material_indices[row] >= 0);
+    }
+  }
+  writer.end_array();
+
+  if (const auto substrate = document.substrate()) {
+    writer.key("substrate");
+    writer.begin_object();
+    writer.key("color");
+    write_color(writer, substrate->color());
+    writer.key("name");
+    writer.value(substrate->name());
+    writer.key("size");
+    write_size(writer, substrate->size());
+    writer.end_object();
+  }
+  writer.key("version");
+  writer.value(kVersion);
+  writer.end_object();
+  return writer.finish();
+}
+
+bool JsonProjectFormat::read(std::istream& stream, DocumentModel& document) {
+  JsonPullReader reader(stream);
+  ProjectLoader loader(reader, document);
+  if (!loader.load()) {
+    LOG_ERROR() << "Invalid project file format"
+                << (reader.error().empty() ? "" : ": ") << reader.error();
+    return false;
+  }
+  return true;
+}
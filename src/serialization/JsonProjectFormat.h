@@ -0,0 +1,41 @@
+#pragma once
+
+#include <istream>
+#include <ostream>
+#include <string_view>
+
+#include "serialization/JsonWriter.h"
+
+class DocumentModel;
+
+/**
+ * @brief Streaming reader and writer for v2.1 JSON projects.
+ *
+ * Neither side builds a QJsonDocument. Saving writes members through
+ * JsonWriter as it walks the document. Loading reads the stream once with
+ * JsonPullReader and stages shapes as compact store records, not parsed JSON,
+ * then hands them to DocumentModel in one go. Legacy keys (material_presets,
+ * fill_color, width/height, radius, line/pen_width, array positions,
+ * grid_frequency) are read as before.
+ */
+class JsonProjectFormat {
+ public:
+  static constexpr std::string_view kVersion = "2.1";
+
+  /**
+   * @brief Write the document; members are in the order QJsonDocument used
+   * (sorted by key), so files only differ in number formatting.
+   */
+  static bool write(std::ostream& stream, const DocumentModel& document,
+                    JsonWriter::Layout layout = JsonWriter::Layout::Indented);
+  /**
+   * @brief Replace the document contents with the project in stream.
+   *
+   * The stream is read once; the document is only touched after the whole
+   * file parsed, so a malformed file fails without changing it.
+   */
+  static bool read(std::istream& stream, DocumentModel& document);
+
+ private:
+  JsonProjectFormat() = default;
+};
@@ -0,0 +1,472 @@
+#include "serialization/JsonPullReader.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <string_view>
+#include <system_error>
+
+namespace {
+constexpr size_t kBlockBytes = 64 * 1024;
+constexpr size_t kMaxDepth = 512;
+constexpr int kEof = -1;
+
+bool is_digit(int c) {
+  return c >= '0' && c <= '9';
+}
+
+bool is_whitespace(char c) {
+  return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+
+bool is_number_char(char c) {
+  return is_digit(c) || c == '-' || c == '+' || c == '.' || c == 'e' ||
+         c == 'E';
+}
+
+// -?(0|[1-9][0-9]*)(.[0-9]+)?([eE][+-]?[0-9]+)?, which is stricter than
+// from_chars (no leading zeros, digits required around '.')
+bool is_json_number(std::string_view token) {
+  size_t index = 0;
+  const auto digits = [&] {
+    const size_t first = index;
+    while (index < token.size() && is_digit(token[index])) {
+      ++index;
+    }
+    return index - first;
+  };
+  if (index < token.size() && token[index] == '-') {
+    ++index;
+  }
+  if (index < token.size() && token[index] == '0') {
+    ++index;
+  } else if (digits() == 0) {
+    return false;
+  }
+  if (index < token.size() && token[index] == '.') {
+    ++index;
+    if (digits() == 0) {
+      return false;
+    }
+  }
+  if (index < token.size() && (token[index] == 'e' || token[index] == 'E')) {
+    ++index;
+    if (index < token.size() && (token[index] == '+' || token[index] == '-')) {
+      ++index;
+    }
+    if (digits() == 0) {
+      return false;
+    }
+  }
+  return index == token.size();
+}
+
+// For a valid JSON number that does not fit a double: whether it is too
+// large rather than too small, from the decimal exponent of its first
+// significant digit
+bool overflows(std::string_view token) {
+  constexpr int64_t kExponentLimit = 1'000'000;
+  size_t index = token.front() == '-' ? 1 : 0;
+  int64_t magnitude = -1;
+  bool significant = false;
+  for (; index < token.size() && is_digit(token[index]); ++index) {
+    significant = significant || token[index] != '0';
+    if (significant) {
+      ++magnitude;
+    }
+  }
+  if (index < token.size() && token[index] == '.') {
+    for (++index; index < token.size() && is_digit(token[index]); ++index) {
+      if (significant) {
+        continue;
+      }
+      if (token[index] == '0') {
+        --magnitude;
+      } else {
+        significant = true;
+      }
+    }
+  }
+  int64_t exponent = 0;
+  bool negative_exponent = false;
+  if (index < token.size()) {  // 'e' or 'E'
+    ++index;
+    if (token[index] == '+' || token[index] == '-') {
+      negative_exponent = token[index] == '-';
+      ++index;
+    }
+    for (; index < token.size(); ++index) {
+      exponent =
+        std::min<int64_t>(exponent * 10 + (token[index] - '0'), kExponentLimit);
+    }
+  }
+  return magnitude + (negative_exponent ? -exponent : exponent) > 0;
+}
+
+int hex_value(int c) {
+  if (is_digit(c)) {
+    return c - '0';
+  }
+  if (c >= 'a' && c <= 'f') {
+    return c - 'a' + 10;
+  }
+  if (c >= 'A' && c <= 'F') {
+    return c - 'A' + 10;
+  }
+  return -1;
+}
+
+void append_utf8(std::string& out, uint32_t code_point) {
+  if (code_point < 0x80) {
+    out.push_back(static_cast<char>(code_point));
+  } else if (code_point < 0x800) {
+    out.push_back(static_cast<char>(0xC0 | (code_point >> 6)));
+    out.push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+  } else if (code_point < 0x10000) {
+    out.push_back(static_cast<char>(0xE0 | (code_point >> 12)));
+    out.push_back(static_cast<char>(0x80 | ((code_point >> 6) & 0x3F)));
+    out.push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+  } else {
+    out.push_back(static_cast<char>(0xF0 | (code_point >> 18)));
+    out.push_back(static_cast<char>(0x80 | ((code_point >> 12) & 0x3F)));
+    out.push_back(static_cast<char>(0x80 | ((code_point >> 6) & 0x3F)));
+    out.push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+  }
+}
+}  // namespace
+
+JsonPullReader::JsonPullReader(std::istream& stream)
+    : stream_(stream), buffer_(kBlockBytes) {}
+
+bool JsonPullReader::fill() {
+  consumed_ += end_;
+  position_ = 0;
+  end_ = 0;
+  if (!stream_) {
+    return false;
+  }
+  stream_.read(buffer_.data(), static_cast<std::streamsize>(buffer_.size()));
+  end_ = static_cast<size_t>(stream_.gcount());
+  return end_ > 0;
+}
+
+int JsonPullReader::peek() {
+  if (position_ == end_ && !fill()) {
+    return kEof;
+  }
+  return static_cast<unsigned char>(buffer_[position_]);
+}
+
+int JsonPullReader::get() {
+  const int c = peek();
+  if (c != kEof) {
+    ++position_;
+  }
+  return c;
+}
+
+int JsonPullReader::skip_whitespace() {
+  for (;;) {
+    if (position_ == end_ && !fill()) {
+      return kEof;
+    }
+    const char* begin = buffer_.data() + position_;
+    const char* end = buffer_.data() + end_;
+    const char* cursor = begin;
+    while (cursor != end && is_whitespace(*cursor)) {
+      ++cursor;
+    }
+    position_ += static_cast<size_t>(cursor - begin);
+    if (cursor != end) {
+      return static_cast<unsigned char>(*cursor);
+    }
+  }
+}
+
+JsonPullReader::Token JsonPullReader::fail(std::string_view message) {
+  if (state_ != State::Failed) {
+    state_ = State::Failed;
+    error_ = std::string(message) + " at offset " + std::to_string(offset());
+  }
+  return Token::Error;
+}
+
+JsonPullReader::Token JsonPullReader::next() {
+  if (state_ == State::Failed) {
+    return Token::Error;
+  }
+  const int c = skip_whitespace();
+  if (c == kEof && state_ != State::Done) {
+    return fail(stream_.bad() ? "Read error" : "Unexpected end of input");
+  }
+
+  switch (state_) {
+    case State::Done:
+      return c == kEof ? Token::End : fail("Unexpected data after the root");
+    case State::Value:
+      return read_value(c);
+    case State::ValueOrEnd:
+      if (c == ']') {
+        ++position_;
+        containers_.pop_back();
+        return finish_value(Token::EndArray);
+      }
+      return read_value(c);
+    case State::KeyOrEnd:
+      if (c == '}') {
+        ++position_;
+        containers_.pop_back();
+        return finish_value(Token::EndObject);
+      }
+      return read_key();
+    case State::Key:
+      return read_key();
+    case State::CommaOrEnd: {
+      const char container = containers_.back();
+      ++position_;
+      if (c == ',') {
+        if (container == '{') {
+          skip_whitespace();
+          return read_key();
+        }
+        state_ = State::Value;
+        return read_value(skip_whitespace());
+      }
+      if ((c == '}' && container == '{') || (c == ']' && container == '[')) {
+        containers_.pop_back();
+        return finish_value(container == '{' ? Token::EndObject
+                                             : Token::EndArray);
+      }
+      --position_;
+      return fail("Expected ',' or the end of the container");
+    }
+    case State::Failed:
+      break;
+  }
+  return Token::Error;
+}
+
+JsonPullReader::Token JsonPullReader::finish_value(Token token) {
+  state_ = containers_.empty() ? State::Done : State::CommaOrEnd;
+  return token;
+}
+
+JsonPullReader::Token JsonPullReader::read_value(int c) {
+  switch (c) {
+    case '{':
+    case '[':
+      if (containers_.size() >= kMaxDepth) {
+        return fail("Nesting too deep");
+      }
+      ++position_;
+      containers_.push_back(static_cast<char>(c));
+      state_ = c == '{' ? State::KeyOrEnd : State::ValueOrEnd;
+      return c == '{' ? Token::BeginObject : Token::BeginArray;
+    case '"':
+      ++position_;
+      return read_string() ? finish_value(Token::String) : Token::Error;
+    case 't':
+      boolean_ = true;
+      return read_literal("true") ? finish_value(Token::Bool) : Token::Error;
+    case 'f':
+      boolean_ = false;
+      return read_literal("false") ? finish_value(Token::Bool) : Token::Error;
+    case 'n':
+      return read_literal("null") ? finish_value(Token::Null) : Token::Error;
+    default:
+      if (c == '-' || is_digit(c)) {
+        return read_number() ? finish_value(Token::Number) : Token::Error;
+      }
+      return c == kEof ? fail("Unexpected end of input")
+                       : fail("Unexpected character");
+  }
+}
+
+JsonPullReader::Token JsonPullReader::read_key() {
+  if (get() != '"') {
+    return fail("Expected a member name");
+  }
+  if (!read_string()) {
+    return Token::Error;
+  }
+  if (skip_whitespace() != ':') {
+    return fail("Expected ':'");
+  }
+  ++position_;
+  state_ = State::Value;
+  return Token::Key;
+}
+
+bool JsonPullReader::read_string() {
+  scratch_.clear();
+  for (;;) {
+    if (position_ == end_ && !fill()) {
+      fail("Unterminated string");
+      return false;
+    }
+    // Copy the plain run up to the next quote, escape or control character
+    const char* begin = buffer_.data() + position_;
+    const char* end = buffer_.data() + end_;
+    const char* run = begin;
+    while (run != end && *run != '"' && *run != '\\' &&
+           static_cast<unsigned char>(*run) >= 0x20) {
+      ++run;
+    }
+    scratch_.append(begin, run);
+    position_ += static_cast<size_t>(run - begin);
+    if (run == end) {
+      continue;
+    }
+    const char c = *run;
+    ++position_;
+    if (c == '"') {
+      return true;
+    }
+    if (c != '\\') {
+      fail("Control character in string");
+      return false;
+    }
+    if (!read_escape()) {
+      return false;
+    }
+  }
+}
+
+bool JsonPullReader::read_escape() {
+  const int c = get();
+  switch (c) {
+    case '"':
+    case '\\':
+    case '/':
+      scratch_.push_back(static_cast<char>(c));
+      return true;
+    case 'b':
+      scratch_.push_back('\b');
+      return true;
+    case 'f':
+      scratch_.push_back('\f');
+      return true;
+    case 'n':
+      scratch_.push_back('\n');
+      return true;
+    case 'r':
+      scratch_.push_back('\r');
+      return true;
+    case 't':
+      scratch_.push_back('\t');
+      return true;
+    case 'u':
+      break;
+    default:
+      fail("Invalid escape sequence");
+      return false;
+  }
+
+  const auto read_hex4 = [this](uint32_t& value) {
+    value = 0;
+    for (int i = 0; i < 4; ++i) {
+      const int digit = hex_value(get());
+      if (digit < 0) {
+        fail("Invalid \\u escape");
+        return false;
+      }
+      value = (value << 4) | static_cast<uint32_t>(digit);
+    }
+    return true;
+  };
+  uint32_t code_point = 0;
+  if (!read_hex4(code_point)) {
+    return false;
+  }
+  constexpr uint32_t kReplacement = 0xFFFD;
+  if (code_point >= 0xD800 && code_point < 0xDC00) {
+    // High surrogate: combine with the low surrogate that should follow
+    if (peek() == '\\') {
+      ++position_;
+      if (get() != 'u') {
+        fail("Invalid escape sequence");
+        return false;
+      }
+      uint32_t low = 0;
+      if (!read_hex4(low)) {
+        return false;
+      }
+      if (low >= 0xDC00 && low < 0xE000) {
+        code_point = 0x10000 + ((code_point - 0xD800) << 10) + (low - 0xDC00);
+      } else {
+        append_utf8(scratch_, kReplacement);
+        code_point = low >= 0xD800 && low < 0xDC00 ? kReplacement : low;
+      }
+    } else {
+      code_point = kReplacement;
+    }
+  } else if (code_point >= 0xDC00 && code_point < 0xE000) {
+    code_point = kReplacement;  // Unpaired low surrogate
+  }
+  append_utf8(scratch_, code_point);
+  return true;
+}
+
+bool JsonPullReader::read_number() {
+  // Parse in place unless the token straddles two blocks
+  scratch_.clear();
+  std::string_view token;
+  for (;;) {
+    const char* begin = buffer_.data() + position_;
+    const char* end = buffer_.data() + end_;
+    const char* cursor = begin;
+    while (cursor != end && is_number_char(*cursor)) {
+      ++cursor;
+    }
+    position_ += static_cast<size_t>(cursor - begin);
+    if (cursor != end && scratch_.empty()) {
+      token = std::string_view(begin, cursor);
+      break;
+    }
+    scratch_.append(begin, cursor);
+    if (cursor != end || !fill()) {
+      token = scratch_;
+      break;
+    }
+  }
+
+  if (!is_json_number(token)) {
+    fail("Invalid number");
+    return false;
+  }
+  const auto [last, error] =
+    std::from_chars(token.data(), token.data() + token.size(), number_);
+  if (error == std::errc::result_out_of_range) {
+    // Saturate to infinity or zero like strtod
+    number_ = std::copysign(overflows(token) ? HUGE_VAL : 0.0,
+                            token.front() == '-' ? -1.0 : 1.0);
+  } else if (error != std::errc{} || last != token.data() + token.size()) {
+    fail("Invalid number");
+    return false;
+  }
+  return true;
+}
+
+bool JsonPullReader::read_literal(std::string_view literal) {
+  for (const char expected : literal) {
+    if (get() != expected) {
+      fail("Invalid literal");
+      return false;
+    }
+  }
+  return true;
+}
+
+bool JsonPullReader::skip(Token token) {
+  if (token != Token::BeginObject && token != Token::BeginArray) {
+    return token != Token::Error && token != Token::End;
+  }
+  const size_t depth = containers_.size();
+  while (containers_.size() >= depth) {
+    if (next() == Token::Error) {
+      return false;
+    }
+  }
+  return true;
+}
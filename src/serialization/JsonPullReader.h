@@ -0,0 +1,100 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * @brief Pull tokenizer for JSON read from a stream in fixed-size blocks.
+ *
+ * Unlike QJsonDocument it never builds a tree: next() returns one token at a
+ * time and memory use is bounded by the block size, the nesting depth and the
+ * longest string, whatever the size of the input. The grammar is checked as
+ * tokens are pulled, so reading to End validates the whole document.
+ */
+class JsonPullReader {
+ public:
+  enum class Token : uint8_t {
+    BeginObject,
+    EndObject,
+    BeginArray,
+    EndArray,
+    Key,     // Object member name; string() holds it, the value follows
+    String,  // string() holds the unescaped UTF-8 value
+    Number,  // number() holds the value
+    Bool,    // boolean() holds the value
+    Null,
+    End,   // Whole document read
+    Error  // Malformed input or read failure; see error()
+  };
+
+  explicit JsonPullReader(std::istream& stream);
+
+  Token next();
+  /**
+   * @brief Skip the rest of the value that token started (a no-op for scalars,
+   * the remaining members or elements for containers).
+   */
+  bool skip(Token token);
+  bool skip_value() {
+    return skip(next());
+  }
+
+  // Valid until the next call to next()
+  std::string_view string() const {
+    return scratch_;
+  }
+  double number() const {
+    return number_;
+  }
+  bool boolean() const {
+    return boolean_;
+  }
+
+  const std::string& error() const {
+    return error_;
+  }
+  // Bytes consumed so far
+  size_t offset() const {
+    return consumed_ + position_;
+  }
+
+ private:
+  enum class State : uint8_t {
+    Value,       // Any value
+    ValueOrEnd,  // After '['
+    KeyOrEnd,    // After '{'
+    Key,         // After ',' in an object
+    CommaOrEnd,  // After a member or element
+    Done,        // Root value read
+    Failed
+  };
+
+  bool fill();
+  int peek();
+  int get();
+  int skip_whitespace();
+  Token fail(std::string_view message);
+  Token read_value(int c);
+  Token read_key();
+  Token finish_value(Token token);
+  bool read_string();
+  bool read_escape();
+  bool read_number();
+  bool read_literal(std::string_view literal);
+
+  std::istream& stream_;
+  std::vector<char> buffer_;
+  size_t position_{0};
+  size_t end_{0};
+  size_t consumed_{0};  // Bytes in blocks before the current one
+  std::vector<char> containers_;  // '{' or '[' per open container
+  State state_{State::Value};
+  std::string scratch_;
+  double number_{0.0};
+  bool boolean_{false};
+  std::string error_;
+};
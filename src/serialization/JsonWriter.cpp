@@ -0,0 +1,175 @@
+#include "serialization/JsonWriter.h"
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <cmath>
+#include <string_view>
+
+namespace {
+constexpr size_t kBlockBytes = 64 * 1024;
+constexpr size_t kIndentWidth = 4;
+constexpr std::string_view kHexDigits = "0123456789abcdef";
+}  // namespace
+
+JsonWriter::JsonWriter(std::ostream& stream, Layout layout)
+    : stream_(stream), layout_(layout), buffer_(kBlockBytes) {}
+
+JsonWriter::~JsonWriter() {
+  flush();
+}
+
+void JsonWriter::put(std::string_view text) {
+  while (!text.empty()) {
+    if (size_ == buffer_.size()) {
+      flush();
+    }
+    const size_t count = std::min(text.size(), buffer_.size() - size_);
+    text.copy(buffer_.data() + size_, count);
+    size_ += count;
+    text.remove_prefix(count);
+  }
+}
+
+void JsonWriter::flush() {
+  if (size_ > 0) {
+    stream_.write(buffer_.data(), static_cast<std::streamsize>(size_));
+    size_ = 0;
+  }
+}
+
+void JsonWriter::newline() {
+  if (layout_ == Layout::Compact) {
+    return;
+  }
+  put('\n');
+  for (size_t i = 0; i < has_items_.size() * kIndentWidth; ++i) {
+    put(' ');
+  }
+}
+
+// Separator and indentation before a member or element
+void JsonWriter::begin_value() {
+  if (after_key_) {
+    after_key_ = false;
+    return;
+  }
+  if (has_items_.empty()) {
+    return;
+  }
+  if (has_items_.back()) {
+    put(',');
+  }
+  has_items_.back() = true;
+  newline();
+}
+
+void JsonWriter::end_container(char close) {
+  has_items_.pop_back();
+  newline();
+  put(close);
+}
+
+void JsonWriter::begin_object() {
+  begin_value();
+  put('{');
+  has_items_.push_back(false);
+}
+
+void JsonWriter::end_object() {
+  end_container('}');
+}
+
+void JsonWriter::begin_array() {
+  begin_value();
+  put('[');
+  has_items_.push_back(false);
+}
+
+void JsonWriter::end_array() {
+  end_container(']');
+}
+
+void JsonWriter::key(std::string_view name) {
+  value(name);
+  put(layout_ == Layout::Compact ? ":" : ": ");
+  after_key_ = true;
+}
+
+void JsonWriter::value(std::string_view text) {
+  begin_value();
+  put('"');
+  size_t plain = 0;  // Start of the run that needs no escaping
+  for (size_t i = 0; i < text.size(); ++i) {
+    const auto c = static_cast<unsigned char>(text[i]);
+    if (c >= 0x20 && c != '"' && c != '\\') {
+      continue;
+    }
+    put(text.substr(plain, i - plain));
+    plain = i + 1;
+    switch (c) {
+      case '"':
+        put("\\\"");
+        break;
+      case '\\':
+        put("\\\\");
+        break;
+      case '\b':
+        put("\\b");
+        break;
+      case '\f':
+        put("\\f");
+        break;
+      case '\n':
+        put("\\n");
+        break;
+      case '\r':
+        put("\\r");
+        break;
+      case '\t':
+        put("\\t");
+        break;
+      default:
+        put("\\u00");
+        put(kHexDigits[c >> 4]);
+        put(kHexDigits[c & 0xF]);
+        break;
+    }
+  }
+  put(text.substr(plain));
+  put('"');
+}
+
+void JsonWriter::value(double number) {
+  begin_value();
+  if (!std::isfinite(number)) {
+    put("null");
+    return;
+  }
+  std::array<char, 32> digits{};
+  const auto result =
+    std::to_chars(digits.data(), digits.data() + digits.size(), number);
+  put(std::string_view(digits.data(), result.ptr));
+}
+
+void JsonWriter::value(int64_t number) {
+  begin_value();
+  std::array<char, 24> digits{};
+  const auto result =
+    std::to_chars(digits.data(), digits.data() + digits.size(), number);
+  put(std::string_view(digits.data(), result.ptr));
+}
+
+void JsonWriter::value(bool flag) {
+  begin_value();
+  put(flag ? "true" : "false");
+}
+
+bool JsonWriter::finish() {
+  if (layout_ == Layout::Indented) {
+    put('\n');
+  }
+  flush();
+  stream_.flush();
+  return stream_.good();
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string_view>
+#include <vector>
+
+/**
+ * @brief Streaming JSON writer, the output counterpart of JsonPullReader.
+ *
+ * Values go through a fixed block buffer straight to the stream, with no
+ * intermediate document and no allocation per value. Doubles are written in
+ * the shortest form that reads back to the same value (std::to_chars). The
+ * indented layout matches QJsonDocument::Indented, so saved files look as
+ * before.
+ */
+class JsonWriter {
+ public:
+  enum class Layout : uint8_t {
+    Indented,  // Four spaces per level, one value per line
+    Compact    // No whitespace
+  };
+
+  explicit JsonWriter(std::ostream& stream, Layout layout = Layout::Indented);
+  ~JsonWriter();
+
+  JsonWriter(const JsonWriter&) = delete;
+  JsonWriter& operator=(const JsonWriter&) = delete;
+
+  void begin_object();
+  void end_object();
+  void begin_array();
+  void end_array();
+  // Member name; the next value or container is its value
+  void key(std::string_view name);
+
+  void value(std::string_view text);
+  void value(const char* text) {
+    value(std::string_view(text));
+  }
+  // Non-finite values are written as null, like QJsonValue
+  void value(double number);
+  void value(int64_t number);
+  void value(int number) {
+    value(static_cast<int64_t>(number));
+  }
+  void value(bool flag);
+
+  /**
+   * @brief Write out buffered output; false if the stream failed.
+   */
+  bool finish();
+
+ private:
+  void begin_value();
+  void end_container(char close);
+  void newline();
+  void put(char c) {
+    if (size_ == buffer_.size()) {
+      flush();
+    }
+    buffer_[size_++] = c;
+  }
+  void put(std::string_view text);
+  void flush();
+
+  std::ostream& stream_;
+  Layout layout_;
+  std::vector<char> buffer_;
+  size_t size_{0};
+  std::vector<bool> has_items_;  // Per open container
+  bool after_key_{false};
+};
@@ -0,0 +1,221 @@
+#include "serialization/PhaseMapWriter.h"
+
+#include <algorithm>
+#include <bit>
+#include <cctype>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "analysis/PhaseRasterizer.h"
+#include "utils/Logging.h"
+
+namespace {
+constexpr size_t kTiffStripBytes = 64 * 1024;
+constexpr uint16_t kMaxByteValue = 255;
+
+// Baseline TIFF tags and field types
+constexpr uint16_t kTagImageWidth = 256;
+constexpr uint16_t kTagImageLength = 257;
+constexpr uint16_t kTagBitsPerSample = 258;
+constexpr uint16_t kTagCompression = 259;
+constexpr uint16_t kTagPhotometric = 262;
+constexpr uint16_t kTagStripOffsets = 273;
+constexpr uint16_t kTagSamplesPerPixel = 277;
+constexpr uint16_t kTagRowsPerStrip = 278;
+constexpr uint16_t kTagStripByteCounts = 279;
+constexpr uint16_t kTagPlanarConfig = 284;
+constexpr uint16_t kTagSampleFormat = 339;
+constexpr uint16_t kTypeShort = 3;
+constexpr uint16_t kTypeLong = 4;
+constexpr uint32_t kTiffHeaderBytes = 8;
+constexpr uint32_t kTiffEntryBytes = 12;
+constexpr uint16_t kTiffEntryCount = 11;
+
+void put_u16(std::vector<char>& out, uint16_t value) {
+  out.push_back(static_cast<char>(value & 0xFF));
+  out.push_back(static_cast<char>(value >> 8));
+}
+
+void put_u32(std::vector<char>& out, uint32_t value) {
+  put_u16(out, static_cast<uint16_t>(value & 0xFFFF));
+  put_u16(out, static_cast<uint16_t>(value >> 16));
+}
+
+void put_entry(std::vector<char>& out, uint16_t tag, uint16_t type,
+               uint32_t count, uint32_t value) {
+  put_u16(out, tag);
+  put_u16(out, type);
+  put_u32(out, count);
+  if (type == kTypeShort && count == 1) {
+    put_u16(out, static_cast<uint16_t>(value));  // Left-justified
+    put_u16(out, 0);
+  } else {
+    put_u32(out, value);
+  }
+}
+
+// Write pixel rows as little-endian uint16
+void write_little_endian(std::ofstream& stream, const uint16_t* pixels,
+                         size_t count) {
+  if constexpr (std::endian::native == std::endian::little) {
+    stream.write(reinterpret_cast<const char*>(pixels),
+                 static_cast<std::streamsize>(count * sizeof(uint16_t)));
+  } else {
+    std::vector<uint16_t> swapped(pixels, pixels + count);
+    for (auto& value : swapped) {
+      value = std::byteswap(value);
+    }
+    stream.write(reinterpret_cast<const char*>(swapped.data()),
+                 static_cast<std::streamsize>(count * sizeof(uint16_t)));
+  }
+}
+
+bool write_pgm(std::ofstream& stream, const PhaseMap& map) {
+  const uint16_t max_value =
+    std::max<uint16_t>(1, static_cast<uint16_t>(map.phases.empty()
+                                                   ? 1
+                                                   : map.phases.size() - 1));
+  stream << "P5\n" << map.width << ' ' << map.height << '\n'
+         << max_value << '\n';
+  if (max_value <= kMaxByteValue) {
+    std::vector<char> row(map.width);
+    for (size_t y = 0; y < map.height; ++y) {
+      const uint16_t* source = map.pixels.data() + y * map.width;
+      std::transform(source, source + map.width, row.begin(),
+                     [](uint16_t value) { return static_cast<char>(value); });
+      stream.write(row.data(), static_cast<std::streamsize>(row.size()));
+    }
+    return true;
+  }
+
+  // 16-bit PGM samples are big-endian
+  std::vector<uint16_t> row(map.width);
+  for (size_t y = 0; y < map.height; ++y) {
+    const uint16_t* source = map.pixels.data() + y * map.width;
+    if constexpr (std::endian::native == std::endian::little) {
+      std::transform(source, source + map.width, row.begin(),
+                     [](uint16_t value) { return std::byteswap(value); });
+    } else {
+      std::copy(source, source + map.width, row.begin());
+    }
+    stream.write(reinterpret_cast<const char*>(row.data()),
+                 static_cast<std::streamsize>(row.size() * sizeof(uint16_t)));
+  }
+  return true;
+}
+
+bool write_tiff(std::ofstream& stream, const PhaseMap& map) {
+  const size_t row_bytes = map.width * sizeof(uint16_t);
+  const size_t rows_per_strip =
+    std::clamp<size_t>(kTiffStripBytes / row_bytes, 1, map.height);
+  const size_t strips = (map.height + rows_per_strip - 1) / rows_per_strip;
+  const uint32_t ifd_bytes =
+    2 + kTiffEntryCount * kTiffEntryBytes + 4;  // Count, entries, next IFD
+  const uint32_t arrays_offset = kTiffHeaderBytes + ifd_bytes;
+  const size_t arrays_bytes = strips > 1 ? strips * 2 * sizeof(uint32_t) : 0;
+  const size_t data_offset = arrays_offset + arrays_bytes;
+  if (data_offset + map.height * row_bytes >
+      std::numeric_limits<uint32_t>::max()) {
+    LOG_WARN() << "Phase map too large for TIFF: " << map.width << "x"
+               << map.height;
+    return false;
+  }
+
+  std::vector<char> header;
+  header.reserve(data_offset);
+  header.push_back('I');
+  header.push_back('I');
+  put_u16(header, 42);
+  put_u32(header, kTiffHeaderBytes);
+
+  const auto strip_bytes = [&](size_t strip) {
+    const size_t rows =
+      std::min(rows_per_strip, map.height - strip * rows_per_strip);
+    return static_cast<uint32_t>(rows * row_bytes);
+  };
+  const auto width = static_cast<uint32_t>(map.width);
+  const auto height = static_cast<uint32_t>(map.height);
+  const auto strip_count = static_cast<uint32_t>(strips);
+  put_u16(header, kTiffEntryCount);
+  put_entry(header, kTagImageWidth, kTypeLong, 1, width);
+  put_entry(header, kTagImageLength, kTypeLong, 1, height);
+  put_entry(header, kTagBitsPerSample, kTypeShort, 1, 16);
+  put_entry(header, kTagCompression, kTypeShort, 1, 1);   // None
+  put_entry(header, kTagPhotometric, kTypeShort, 1, 1);   // BlackIsZero
+  put_entry(header, kTagStripOffsets, kTypeLong, strip_count,
+            strips > 1 ? arrays_offset : static_cast<uint32_t>(data_offset));
+  put_entry(header, kTagSamplesPerPixel, kTypeShort, 1, 1);
+  put_entry(header, kTagRowsPerStrip, kTypeLong, 1,
+            static_cast<uint32_t>(rows_per_strip));
+  put_entry(header, kTagStripByteCounts, kTypeLong, strip_count,
+            strips > 1 ? static_cast<uint32_t>(arrays_offset +
+                                               strips * sizeof(uint32_t))
+                       : strip_bytes(0));
+  put_entry(header, kTagPlanarConfig, kTypeShort, 1, 1);  // Chunky
+  put_entry(header, kTagSampleFormat, kTypeShort, 1, 1);  // Unsigned
+  put_u32(header, 0);                                     // No next IFD
+
+  if (strips > 1) {
+    for (size_t strip = 0; strip < strips; ++strip) {
+      put_u32(header, static_cast<uint32_t>(
+                        data_offset + strip * rows_per_strip * row_bytes));
+    }
+    for (size_t strip = 0; strip < strips; ++strip) {
+      put_u32(header, strip_bytes(strip));
+    }
+  }
+  stream.write(header.data(), static_cast<std::streamsize>(header.size()));
+  write_little_endian(stream, map.pixels.data(), map.pixels.size());
+  return true;
+}
+}  // namespace
+
+PhaseMapWriter::Format PhaseMapWriter::format_for_path(
+  const std::string& filename) {
+  const size_t dot = filename.find_last_of('.');
+  if (dot == std::string::npos) {
+    return Format::Raw;
+  }
+  std::string extension = filename.substr(dot + 1);
+  std::transform(extension.begin(), extension.end(), extension.begin(),
+                 [](unsigned char c) { return std::tolower(c); });
+  if (extension == "pgm") {
+    return Format::Pgm;
+  }
+  if (extension == "tif" || extension == "tiff") {
+    return Format::Tiff;
+  }
+  return Format::Raw;
+}
+
+bool PhaseMapWriter::write(const std::string& filename, const PhaseMap& map,
+                           Format format) {
+  if (map.width == 0 || map.height == 0 ||
+      map.pixels.size() != map.width * map.height) {
+    return false;
+  }
+  std::ofstream stream(filename, std::ios::binary | std::ios::trunc);
+  if (!stream) {
+    LOG_WARN() << "Failed to open file for writing: " << filename;
+    return false;
+  }
+
+  bool success = true;
+  switch (format) {
+    case Format::Raw:
+      write_little_endian(stream, map.pixels.data(), map.pixels.size());
+      break;
+    case Format::Pgm:
+      success = write_pgm(stream, map);
+      break;
+    case Format::Tiff:
+      success = write_tiff(stream, map);
+      break;
+  }
+  stream.flush();
+  return success && stream.good();
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <string>
+
+struct PhaseMap;
+
+/**
+ * @brief Writes phase maps as 16-bit grayscale images for external solvers.
+ *
+ * Raw is a headerless little-endian uint16 array, row-major, top row first.
+ * PGM is binary (P5), 8-bit when every phase id fits in a byte. TIFF is a
+ * baseline uncompressed 16-bit grayscale image (limited to 4 GiB).
+ */
+class PhaseMapWriter {
+ public:
+  enum class Format { Raw, Pgm, Tiff };
+
+  /**
+   * @brief Format from the file extension (.pgm, .tif/.tiff, otherwise raw).
+   */
+  static Format format_for_path(const std::string& filename);
+
+  static bool write(const std::string& filename, const PhaseMap& map,
+                    Format format);
+  static bool write(const std::string& filename, const PhaseMap& map) {
+    return write(filename, map, format_for_path(filename));
+  }
+
+ private:
+  PhaseMapWriter() = default;
+};
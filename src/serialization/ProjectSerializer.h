@@ -2,11 +2,27 @@
 
 #include <QString>
 
+#include "serialization/JsonWriter.h"
+
 class DocumentModel;
 
 class ProjectSerializer {
  public:
-  static bool save_to_file(const QString& filename, DocumentModel* document);
+  enum class Format {
+    Json,       // Interchange format (.json and anything unrecognized)
+    Binary,     // Memory-mapped columnar container (.nirb)
+    Compressed  // Block-compressed binary container (.nirz)
+  };
+
+  static Format format_for_path(const QString& filename);
+
+  /**
+   * @brief Save in the format chosen by the extension; layout only applies to
+   * JSON (compact files are smaller and faster to write and read).
+   */
+  static bool save_to_file(
+    const QString& filename, DocumentModel* document,
+    JsonWriter::Layout layout = JsonWriter::Layout::Indented);
   static bool load_from_file(const QString& filename, DocumentModel* document);
 
  private:
@@ -0,0 +1,289 @@
+#include "serialization/TiledTiffWriter.h"
+
+#include <QByteArray>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "utils/Logging.h"
+
+namespace {
+constexpr size_t kTileAlignment = 16;
+constexpr size_t kBytesPerPixel = 3;
+// Flat fills and thin lines compress well even at the fastest level
+constexpr int kCompressionLevel = 1;
+// qCompress prefixes the zlib stream with its size as a big-endian uint32
+constexpr size_t kSizePrefixBytes = 4;
+// Worst-case Deflate growth of a tile, plus the zlib header and checksum
+constexpr size_t kDeflateOverheadDivisor = 1000;
+constexpr size_t kDeflateOverheadBytes = 64;
+// Directory entries and small arrays, besides the per-tile arrays
+constexpr uint64_t kFixedDirectoryBytes = 512;
+
+// TIFF tags and field types
+constexpr uint16_t kTagImageWidth = 256;
+constexpr uint16_t kTagImageLength = 257;
+constexpr uint16_t kTagBitsPerSample = 258;
+constexpr uint16_t kTagCompression = 259;
+constexpr uint16_t kTagPhotometric = 262;
+constexpr uint16_t kTagSamplesPerPixel = 277;
+constexpr uint16_t kTagPlanarConfig = 284;
+constexpr uint16_t kTagTileWidth = 322;
+constexpr uint16_t kTagTileLength = 323;
+constexpr uint16_t kTagTileOffsets = 324;
+constexpr uint16_t kTagTileByteCounts = 325;
+constexpr uint16_t kTypeShort = 3;
+constexpr uint16_t kTypeLong = 4;
+constexpr uint16_t kTypeLong8 = 16;
+constexpr uint16_t kCompressionDeflate = 8;
+constexpr uint16_t kPhotometricRgb = 2;
+constexpr uint16_t kPlanarChunky = 1;
+constexpr uint16_t kBitsPerSample = 8;
+
+constexpr uint16_t kClassicVersion = 42;
+constexpr uint16_t kBigVersion = 43;
+constexpr uint64_t kClassicHeaderBytes = 8;
+constexpr uint64_t kBigHeaderBytes = 16;
+constexpr uint64_t kClassicOffsetField = 4;
+constexpr uint64_t kBigOffsetField = 8;
+
+void put_u16(std::vector<char>& out, uint16_t value) {
+  out.push_back(static_cast<char>(value & 0xFF));
+  out.push_back(static_cast<char>(value >> 8));
+}
+
+void put_u32(std::vector<char>& out, uint32_t value) {
+  put_u16(out, static_cast<uint16_t>(value & 0xFFFF));
+  put_u16(out, static_cast<uint16_t>(value >> 16));
+}
+
+void put_u64(std::vector<char>& out, uint64_t value) {
+  put_u32(out, static_cast<uint32_t>(value & 0xFFFFFFFF));
+  put_u32(out, static_cast<uint32_t>(value >> 32));
+}
+
+size_t type_bytes(uint16_t type) {
+  switch (type) {
+    case kTypeShort:
+      return 2;
+    case kTypeLong:
+      return 4;
+    default:
+      return 8;
+  }
+}
+
+void put_value(std::vector<char>& out, uint16_t type, uint64_t value) {
+  switch (type) {
+    case kTypeShort:
+      put_u16(out, static_cast<uint16_t>(value));
+      break;
+    case kTypeLong:
+      put_u32(out, static_cast<uint32_t>(value));
+      break;
+    default:
+      put_u64(out, value);
+      break;
+  }
+}
+
+struct Field {
+  uint16_t tag;
+  uint16_t type;
+  std::vector<uint64_t> values;
+};
+
+// Directory of @p fields (sorted by tag) for a file whose data ends at
+// @p data_offset (even). Values that do not fit their entry are stored in
+// front of the IFD; @p ifd_offset receives its position.
+std::vector<char> directory(const std::vector<Field>& fields,
+                            uint64_t data_offset, bool big_tiff,
+                            uint64_t& ifd_offset) {
+  const size_t value_field = big_tiff ? kBigOffsetField : kClassicOffsetField;
+  std::vector<char> out;
+  std::vector<uint64_t> value_offsets(fields.size(), 0);
+  for (size_t index = 0; index < fields.size(); ++index) {
+    const Field& field = fields[index];
+    if (field.values.size() * type_bytes(field.type) <= value_field) {
+      continue;
+    }
+    value_offsets[index] = data_offset + out.size();
+    for (const uint64_t value : field.values) {
+      put_value(out, field.type, value);
+    }
+  }
+  if (out.size() % 2 != 0) {
+    out.push_back(0);  // The IFD starts on a word boundary
+  }
+  ifd_offset = data_offset + out.size();
+
+  if (big_tiff) {
+    put_u64(out, fields.size());
+  } else {
+    put_u16(out, static_cast<uint16_t>(fields.size()));
+  }
+  for (size_t index = 0; index < fields.size(); ++index) {
+    const Field& field = fields[index];
+    put_u16(out, field.tag);
+    put_u16(out, field.type);
+    if (big_tiff) {
+      put_u64(out, field.values.size());
+    } else {
+      put_u32(out, static_cast<uint32_t>(field.values.size()));
+    }
+    if (value_offsets[index] != 0) {
+      put_value(out, big_tiff ? kTypeLong8 : kTypeLong, value_offsets[index]);
+      continue;
+    }
+    // Inline values are left-justified
+    const size_t end = out.size() + value_field;
+    for (const uint64_t value : field.values) {
+      put_value(out, field.type, value);
+    }
+    out.resize(end, 0);
+  }
+  put_value(out, big_tiff ? kTypeLong8 : kTypeLong, 0);  // No next IFD
+  return out;
+}
+}  // namespace
+
+TiledTiffWriter::TiledTiffWriter(size_t width, size_t height,
+                                 size_t tile_size)
+    : width_(std::max<size_t>(width, 1)),
+      height_(std::max<size_t>(height, 1)),
+      tile_size_((std::max<size_t>(tile_size, 1) + kTileAlignment - 1) /
+                 kTileAlignment * kTileAlignment),
+      tiles_across_((width_ + tile_size_ - 1) / tile_size_) {
+  const size_t tiles_down = (height_ + tile_size_ - 1) / tile_size_;
+  offsets_.assign(tiles_across_ * tiles_down, 0);
+  byte_counts_.assign(offsets_.size(), 0);
+
+  // Upper bound of the file size: incompressible tiles plus the directory
+  const uint64_t tile_bound = tile_bytes() +
+                              tile_bytes() / kDeflateOverheadDivisor +
+                              kDeflateOverheadBytes;
+  const uint64_t file_bound =
+    kClassicHeaderBytes + kFixedDirectoryBytes +
+    offsets_.size() * (tile_bound + 2 * sizeof(uint32_t));
+  big_tiff_ = file_bound > std::numeric_limits<uint32_t>::max();
+}
+
+bool TiledTiffWriter::open(const std::string& filename) {
+  const std::scoped_lock lock(mutex_);
+  stream_.open(filename, std::ios::binary | std::ios::trunc);
+  if (!stream_) {
+    LOG_WARN() << "Cannot open image file: " << filename;
+    failed_ = true;
+    return false;
+  }
+
+  std::vector<char> header{'I', 'I'};
+  if (big_tiff_) {
+    put_u16(header, kBigVersion);
+    put_u16(header, static_cast<uint16_t>(kBigOffsetField));
+    put_u16(header, 0);
+    put_u64(header, 0);  // IFD offset, set by close()
+  } else {
+    put_u16(header, kClassicVersion);
+    put_u32(header, 0);
+  }
+  stream_.write(header.data(), static_cast<std::streamsize>(header.size()));
+  position_ = header.size();
+  std::fill(offsets_.begin(), offsets_.end(), 0);
+  failed_ = !stream_;
+  return !failed_;
+}
+
+bool TiledTiffWriter::write_tile(size_t index, std::span<const uint8_t> rgb) {
+  if (index >= offsets_.size() || rgb.size() != tile_bytes()) {
+    return false;
+  }
+  const QByteArray compressed =
+    qCompress(reinterpret_cast<const uchar*>(rgb.data()),
+              static_cast<qsizetype>(rgb.size()), kCompressionLevel);
+  if (compressed.size() <= static_cast<qsizetype>(kSizePrefixBytes)) {
+    return false;
+  }
+  const auto bytes =
+    static_cast<uint64_t>(compressed.size()) - kSizePrefixBytes;
+
+  const std::scoped_lock lock(mutex_);
+  if (failed_ || !stream_.is_open()) {
+    return false;
+  }
+  if (offsets_[index] != 0) {
+    LOG_WARN() << "Image tile " << index << " written twice";
+    return false;
+  }
+  stream_.write(compressed.constData() + kSizePrefixBytes,
+                static_cast<std::streamsize>(bytes));
+  if (!stream_) {
+    LOG_WARN() << "Failed to write image tile " << index;
+    failed_ = true;
+    return false;
+  }
+  offsets_[index] = position_;
+  byte_counts_[index] = bytes;
+  position_ += bytes;
+  return true;
+}
+
+bool TiledTiffWriter::close() {
+  const std::scoped_lock lock(mutex_);
+  if (!stream_.is_open()) {
+    return false;
+  }
+  const bool complete =
+    std::find(offsets_.begin(), offsets_.end(), 0) == offsets_.end();
+  if (failed_ || !complete) {
+    stream_.close();
+    return false;
+  }
+
+  const uint16_t array_type = big_tiff_ ? kTypeLong8 : kTypeLong;
+  const std::vector<Field> fields{
+    {kTagImageWidth, kTypeLong, {width_}},
+    {kTagImageLength, kTypeLong, {height_}},
+    {kTagBitsPerSample,
+     kTypeShort,
+     {kBitsPerSample, kBitsPerSample, kBitsPerSample}},
+    {kTagCompression, kTypeShort, {kCompressionDeflate}},
+    {kTagPhotometric, kTypeShort, {kPhotometricRgb}},
+    {kTagSamplesPerPixel, kTypeShort, {kBytesPerPixel}},
+    {kTagPlanarConfig, kTypeShort, {kPlanarChunky}},
+    {kTagTileWidth, kTypeLong, {tile_size_}},
+    {kTagTileLength, kTypeLong, {tile_size_}},
+    {kTagTileOffsets, array_type, offsets_},
+    {kTagTileByteCounts, array_type, byte_counts_},
+  };
+  if (position_ % 2 != 0) {
+    stream_.put(0);
+    ++position_;
+  }
+  uint64_t ifd_offset = 0;
+  const std::vector<char> ifd =
+    directory(fields, position_, big_tiff_, ifd_offset);
+  if (!big_tiff_ &&
+      position_ + ifd.size() > std::numeric_limits<uint32_t>::max()) {
+    LOG_WARN() << "Image too large for TIFF: " << width_ << "x" << height_;
+    stream_.close();
+    return false;
+  }
+  stream_.write(ifd.data(), static_cast<std::streamsize>(ifd.size()));
+
+  std::vector<char> offset_field;
+  put_value(offset_field, array_type, ifd_offset);
+  stream_.seekp(big_tiff_ ? kBigHeaderBytes - kBigOffsetField
+                          : kClassicHeaderBytes - kClassicOffsetField);
+  stream_.write(offset_field.data(),
+                static_cast<std::streamsize>(offset_field.size()));
+  stream_.close();
+  if (!stream_) {
+    LOG_WARN() << "Failed to write image directory";
+    return false;
+  }
+  return true;
+}
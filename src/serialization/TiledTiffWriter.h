@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <span>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Streams an 8-bit RGB image to a tiled, Deflate-compressed TIFF one
+ * tile at a time, so that no more than a tile per writing thread is held in
+ * memory.
+ *
+ * Tiles may be written in any order and from several threads; each is
+ * compressed on the calling thread and appended to the file. close() then
+ * writes the directory after the tile data. Files that could exceed 4 GiB are
+ * written as BigTIFF.
+ */
+class TiledTiffWriter {
+ public:
+  /**
+   * @param tile_size Tile edge in pixels, rounded up to a multiple of 16 as
+   * TIFF requires.
+   */
+  TiledTiffWriter(size_t width, size_t height, size_t tile_size);
+
+  bool open(const std::string& filename);
+  /**
+   * @brief Write the directory and close the file; fails if a tile is
+   * missing or writing failed.
+   */
+  bool close();
+
+  size_t width() const {
+    return width_;
+  }
+  size_t height() const {
+    return height_;
+  }
+  size_t tile_size() const {
+    return tile_size_;
+  }
+  size_t tiles_across() const {
+    return tiles_across_;
+  }
+  size_t tile_count() const {
+    return offsets_.size();
+  }
+  /**
+   * @brief Bytes of one uncompressed tile (tile_size² RGB pixels).
+   */
+  size_t tile_bytes() const {
+    return tile_size_ * tile_size_ * 3;
+  }
+  bool big_tiff() const {
+    return big_tiff_;
+  }
+
+  /**
+   * @brief Compress and append tile @p index (row-major over the tile grid).
+   * Thread-safe.
+   * @param rgb tile_bytes() of row-major RGB pixels; pixels past the right or
+   * bottom image edge are stored but not shown.
+   */
+  bool write_tile(size_t index, std::span<const uint8_t> rgb);
+
+ private:
+  size_t width_;
+  size_t height_;
+  size_t tile_size_;
+  size_t tiles_across_;
+  bool big_tiff_{false};
+
+  std::mutex mutex_;  // Guards the members below
+  std::ofstream stream_;
+  uint64_t position_{0};  // End of the data written so far
+  bool failed_{false};
+  std::vector<uint64_t> offsets_;  // Of each tile, 0 while not written
+  std::vector<uint64_t> byte_counts_;
+};
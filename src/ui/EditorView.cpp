@@ -9,16 +9,23 @@
 #include <QMouseEvent>
 #include <QPainter>
 #include <QPoint>
+#include <QRect>
 #include <QRectF>
+#include <QRubberBand>
 #include <QScrollBar>
+#include <QSize>
 #include <QWheelEvent>
 #include <QWidget>
 #include <QtGlobal>
 #include <QtMath>
 #include <algorithm>
+#include <array>
 #include <cmath>  // For std::pow, std::abs
+#include <set>
+#include <utility>
 
-#include "ui/editor/SubstrateItem.h"
+#include "scene/ISceneObject.h"
+#include "scene/items/StaticLayer.h"
 
 namespace {
 constexpr qreal kZoomStep = 1.15;    // per mouse wheel notch (symmetrical)
@@ -26,6 +33,24 @@ constexpr qreal kMinScale = 0.70;    // 70%
 constexpr qreal kMaxScale = 100.0;   // 10000%
 constexpr qreal kRotateStepDeg = 5;  // rotation step per notch when Ctrl held
 constexpr qreal kScaleStep = 1.05;  // item scale step per notch when Shift held
+
+// Items the wheel scales and rotates: shapes, not the substrate or the
+// batched inclusion layer
+bool is_shape_item(QGraphicsItem* item) {
+  const ISceneObject* object = scene_object_cast(item);
+  return object != nullptr && object->kind() != ISceneObject::Kind::Substrate;
+}
+
+// Scene rects compared at 1/16 unit; a mismatch only costs a tile re-render
+using RectKey = std::array<qint64, 4>;
+constexpr qreal kRectKeyScale = 16.0;
+
+RectKey rect_key(const QRectF& rect) {
+  return {std::llround(rect.x() * kRectKeyScale),
+          std::llround(rect.y() * kRectKeyScale),
+          std::llround(rect.width() * kRectKeyScale),
+          std::llround(rect.height() * kRectKeyScale)};
+}
 }  // namespace
 
 EditorView::EditorView(QWidget* parent) : QGraphicsView(parent) {
@@ -39,7 +64,104 @@ EditorView::EditorView(QWidget* parent) : QGraphicsView(parent) {
   setAlignment(Qt::AlignCenter);
 }
 
-EditorView::~EditorView() = default;
+EditorView::~EditorView() {
+  set_static_layer_viewport(nullptr);
+}
+
+void EditorView::attachScene(QGraphicsScene* scene) {
+  if (this->scene() != nullptr) {
+    disconnect(this->scene(), nullptr, this, nullptr);
+  }
+  setScene(scene);
+  tile_cache_.clear();
+  live_items_.clear();
+  if (scene == nullptr) {
+    return;
+  }
+  connect(scene, &QGraphicsScene::changed, this, &EditorView::onSceneChanged);
+  connect(scene, &QGraphicsScene::selectionChanged, this,
+          &EditorView::onSelectionChanged);
+}
+
+void EditorView::setTileCacheEnabled(bool enabled) {
+  if (tile_cache_enabled_ == enabled) {
+    return;
+  }
+  tile_cache_enabled_ = enabled;
+  tile_cache_.clear();
+  viewport()->update();
+}
+
+void EditorView::drawBackground(QPainter* painter, const QRectF& rect) {
+  const bool cached = tile_cache_enabled_ && scene() != nullptr &&
+                      painter->device() == viewport() &&
+                      transform().type() <= QTransform::TxScale;
+  // Items skip their live paint only while the tiles hold them
+  set_static_layer_viewport(cached ? viewport() : nullptr);
+  if (!cached) {
+    QGraphicsView::drawBackground(painter, rect);
+    return;
+  }
+  tile_cache_.set_transform(transform(), devicePixelRatioF());
+  // The tile grid is fixed in the device space of transform(); the viewport
+  // shows it shifted by the scroll position
+  const QPoint origin =
+    (viewportTransform().map(QPointF()) - transform().map(QPointF()))
+      .toPoint();
+  const QRect exposed = viewportTransform().mapRect(rect).toAlignedRect();
+  painter->save();
+  painter->resetTransform();
+  tile_cache_.draw(painter, *scene(), exposed.translated(-origin), origin,
+                   viewport()->palette().color(viewport()->backgroundRole()));
+  painter->restore();
+}
+
+void EditorView::onSceneChanged(const QList<QRectF>& region) {
+  if (scene() == nullptr) {
+    return;
+  }
+  // Whole-scene updates (e.g. removing an item) are reported as the scene rect
+  if (region.size() == 1 && region.first() == scene()->sceneRect()) {
+    tile_cache_.clear();
+  }
+  // Updates of live items (their previous and current rect) leave the tiles
+  // as they are
+  std::set<RectKey> live_rects;
+  for (auto& [item, rect] : live_items_) {
+    live_rects.insert(rect_key(rect));
+    rect = item->sceneBoundingRect();
+    live_rects.insert(rect_key(rect));
+  }
+  for (const QRectF& rect : region) {
+    if (live_rects.empty() || !live_rects.contains(rect_key(rect))) {
+      tile_cache_.invalidate(rect);
+    }
+  }
+}
+
+void EditorView::onSelectionChanged() {
+  if (scene() == nullptr) {
+    return;
+  }
+  std::unordered_map<const QGraphicsItem*, QRectF> live_items;
+  for (const QGraphicsItem* item : scene()->selectedItems()) {
+    if (!is_live_item(*item)) {
+      continue;
+    }
+    const QRectF rect = item->sceneBoundingRect();
+    live_items.emplace(item, rect);
+    if (!live_items_.contains(item)) {
+      tile_cache_.invalidate(rect);  // Leaves the tiles
+    }
+  }
+  // Back into the tiles; the item itself may be gone already
+  for (const auto& [item, rect] : live_items_) {
+    if (!live_items.contains(item)) {
+      tile_cache_.invalidate(rect);
+    }
+  }
+  live_items_ = std::move(live_items);
+}
 
 void EditorView::fitToItem(const QGraphicsItem* item) {
   if (item == nullptr) {
@@ -55,6 +177,26 @@ void EditorView::fitToItem(const QGraphicsItem* item) {
   scale_ = transform().m11();
 }
 
+auto EditorView::wheelTargets(const QPoint& pos) const
+  -> QList<QGraphicsItem*> {
+  if (scene() == nullptr) {
+    return {};
+  }
+  QList<QGraphicsItem*> targets = scene()->selectedItems();
+  if (targets.isEmpty()) {
+    if (auto* hit = itemAt(pos)) {
+      targets << hit;
+    }
+  }
+  // Exclude substrate and layer
+  for (int i = static_cast<int>(targets.size()) - 1; i >= 0; --i) {
+    if (!is_shape_item(targets[i])) {
+      targets.removeAt(i);
+    }
+  }
+  return targets;
+}
+
 // necessary for wheel event handling with multiple modifiers
 void EditorView::wheelEvent(
   QWheelEvent* event) {  // NOLINT(readability-function-cognitive-complexity)
@@ -76,64 +218,19 @@ void EditorView::wheelEvent(
 #endif
 
   // Transform selected items with modifiers (scale first to avoid conflict on
-  // macOS)
-  if (scale_mod) {
-    if (scene() == nullptr) {
-      event->accept();
-      return;
-    }
-    const qreal step = (num_steps > 0) ? std::pow(kScaleStep, num_steps)
-                                       : std::pow(1.0 / kScaleStep, -num_steps);
-    QList<QGraphicsItem*> targets = scene()->selectedItems();
-    if (targets.isEmpty()) {
-      if (auto* hit = itemAt(event->position().toPoint())) {
-        targets << hit;
-      }
-    }
-    // Exclude substrate from scaling
-    for (int i = static_cast<int>(targets.size()) - 1; i >= 0; --i) {
-      if (dynamic_cast<SubstrateItem*>(targets[i]) != nullptr) {
-        targets.removeAt(i);
-      }
-    }
-    if (targets.isEmpty()) {
-      event->accept();
-      return;
-    }
-    for (QGraphicsItem* item : targets) {
-      item->setTransformOriginPoint(item->boundingRect().center());
-      const qreal new_scale = std::clamp(item->scale() * step, 0.1, 10.0);
-      item->setScale(new_scale);
-    }
-    event->accept();
-    return;
-  }
-
-  if (rotate_mod) {
-    if (scene() == nullptr) {
-      event->accept();
-      return;
-    }
-    const qreal delta =
-      (num_steps > 0 ? kRotateStepDeg : -kRotateStepDeg) * std::abs(num_steps);
-    QList<QGraphicsItem*> targets = scene()->selectedItems();
-    if (targets.isEmpty()) {
-      if (auto* hit = itemAt(event->position().toPoint())) {
-        targets << hit;
-      }
-    }
-    // Exclude substrate from rotation
-    for (int i = static_cast<int>(targets.size()) - 1; i >= 0; --i) {
-      if (dynamic_cast<SubstrateItem*>(targets[i]) != nullptr) {
-        targets.removeAt(i);
-      }
-    }
-    if (targets.isEmpty()) {
-      event->accept();
-      return;
-    }
-    for (QGraphicsItem* item : targets) {
-      item->setRotation(item->rotation() + delta);
+  // macOS). The items are edited through their shapes, as one undoable step
+  if (scale_mod || rotate_mod) {
+    const QList<QGraphicsItem*> targets =
+      wheelTargets(event->position().toPoint());
+    if (!targets.isEmpty() && scale_mod) {
+      const qreal step = (num_steps > 0)
+                           ? std::pow(kScaleStep, num_steps)
+                           : std::pow(1.0 / kScaleStep, -num_steps);
+      emit scaleItemsRequested(targets, step);
+    } else if (!targets.isEmpty()) {
+      const qreal delta = (num_steps > 0 ? kRotateStepDeg : -kRotateStepDeg) *
+                          std::abs(num_steps);
+      emit rotateItemsRequested(targets, delta);
     }
     event->accept();
     return;
@@ -153,6 +250,20 @@ void EditorView::mousePressEvent(QMouseEvent* event) {
     return;
   }
   if (event->button() == Qt::LeftButton) {
+    // Shapes drawn by the batched layer have no item for the scene's own
+    // rubber band to find, so the area goes to whoever owns the shapes
+    if ((event->modifiers() & Qt::ShiftModifier) != 0 &&
+        !is_shape_item(itemAt(event->pos()))) {
+      selecting_area_ = true;
+      area_origin_ = event->pos();
+      if (area_band_ == nullptr) {
+        area_band_ = new QRubberBand(QRubberBand::Rectangle, viewport());
+      }
+      area_band_->setGeometry(QRect(area_origin_, QSize()));
+      area_band_->show();
+      event->accept();
+      return;
+    }
     // Start panning only if click on empty space; otherwise let items handle
     // drag
     if (itemAt(event->pos()) == nullptr) {
@@ -167,6 +278,11 @@ void EditorView::mousePressEvent(QMouseEvent* event) {
 }
 
 void EditorView::mouseMoveEvent(QMouseEvent* event) {
+  if (selecting_area_) {
+    area_band_->setGeometry(QRect(area_origin_, event->pos()).normalized());
+    event->accept();
+    return;
+  }
   if (panning_) {
     const QPoint delta = event->pos() - last_mouse_pos_;
     last_mouse_pos_ = event->pos();
@@ -183,6 +299,14 @@ void EditorView::mouseMoveEvent(QMouseEvent* event) {
 }
 
 void EditorView::mouseReleaseEvent(QMouseEvent* event) {
+  if (selecting_area_ && event->button() == Qt::LeftButton) {
+    selecting_area_ = false;
+    area_band_->hide();
+    emit areaSelected(mapToScene(area_band_->geometry()).boundingRect(),
+                      (event->modifiers() & Qt::ControlModifier) != 0);
+    event->accept();
+    return;
+  }
   if (panning_ && (event->button() == Qt::MiddleButton ||
                    event->button() == Qt::LeftButton)) {
     panning_ = false;
@@ -191,6 +315,7 @@ void EditorView::mouseReleaseEvent(QMouseEvent* event) {
     return;
   }
   QGraphicsView::mouseReleaseEvent(event);
+  emit dragFinished();
 }
 
 void EditorView::applyZoom(qreal factor) {
@@ -1,9 +1,15 @@
 #pragma once
 
 #include <QGraphicsView>
+#include <QList>
+#include <QRectF>
+#include <unordered_map>
+
+#include "ui/editor/SceneTileCache.h"
 
 class QGraphicsScene;
 class QGraphicsItem;
+class QRubberBand;
 
 class EditorView : public QGraphicsView {
   Q_OBJECT
@@ -12,17 +18,65 @@ class EditorView : public QGraphicsView {
   ~EditorView() override;
 
   void fitToItem(const QGraphicsItem* item);
+  /**
+   * @brief Show @p scene and track its changes for the tile cache.
+   */
+  void attachScene(QGraphicsScene* scene);
+  /**
+   * @brief Draw unselected items from cached tiles (see StaticLayer.h)
+   * instead of repainting them on every pan step and update.
+   */
+  void setTileCacheEnabled(bool enabled);
+  bool tileCacheEnabled() const {
+    return tile_cache_enabled_;
+  }
+
+ signals:
+  /**
+   * @brief Ctrl+wheel over shapes: rotate @p items by @p delta_deg.
+   */
+  void rotateItemsRequested(const QList<QGraphicsItem*>& items,
+                            qreal delta_deg);
+  /**
+   * @brief Meta+wheel (Alt on macOS) over shapes: scale @p items by
+   * @p factor.
+   */
+  void scaleItemsRequested(const QList<QGraphicsItem*>& items, qreal factor);
+  /**
+   * @brief Mouse button released over the scene: a drag of items, if any,
+   * has ended.
+   */
+  void dragFinished();
+  /**
+   * @brief Shift+drag outside shapes: select the shapes inside
+   * @p scene_rect, added to the selection when @p add (Ctrl held).
+   */
+  void areaSelected(const QRectF& scene_rect, bool add);
 
  private:
+  void drawBackground(QPainter* painter, const QRectF& rect) override;
   void wheelEvent(QWheelEvent* event) override;
   void mousePressEvent(QMouseEvent* event) override;
   void mouseMoveEvent(QMouseEvent* event) override;
   void mouseReleaseEvent(QMouseEvent* event) override;
 
   void applyZoom(qreal factor);
+  // Selected shape items, or the shape item under pos if none is selected
+  auto wheelTargets(const QPoint& pos) const -> QList<QGraphicsItem*>;
+  void onSceneChanged(const QList<QRectF>& region);
+  void onSelectionChanged();
 
  private:
   bool panning_{false};
   QPoint last_mouse_pos_;
+  // Area selection in progress; the band is created on first use
+  bool selecting_area_{false};
+  QPoint area_origin_;
+  QRubberBand* area_band_{nullptr};
   qreal scale_{1.0};
+
+  SceneTileCache tile_cache_;
+  bool tile_cache_enabled_{true};
+  // Items drawn live, with their scene rect as of the last scene change
+  std::unordered_map<const QGraphicsItem*, QRectF> live_items_;
 };
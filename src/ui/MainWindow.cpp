@@ -2,21 +2,25 @@
 
 #include <QAbstractItemModel>
 #include <QAction>
+#include <QCoreApplication>
 #include <QDialog>
 #include <QDir>
 #include <QFileDialog>
 #include <QFileInfo>
 #include <QGraphicsScene>
 #include <QIcon>
+#include <QInputDialog>
 #include <QItemSelectionModel>
 #include <QKeySequence>
 #include <QLineF>
 #include <QList>
 #include <QMainWindow>
 #include <QMenuBar>
+#include <QMessageBox>
 #include <QModelIndex>
 #include <QPen>
 #include <QPointF>
+#include <QProgressDialog>
 #include <QSettings>
 #include <QSize>
 #include <QSizeF>
@@ -28,6 +32,9 @@
 #include <Qt>
 #include <memory>
 
+#include "analysis/AreaFractionCalculator.h"
+#include "analysis/PhaseRasterizer.h"
+#include "analysis/RsaGenerator.h"
 #include "commands/CommandManager.h"
 #include "model/DocumentModel.h"
 #include "model/MaterialModel.h"
@@ -39,12 +46,17 @@
 #include "scene/ISceneObject.h"
 #include "scene/items/CircleItem.h"
 #include "scene/items/EllipseItem.h"
+#include "scene/items/LevelOfDetail.h"
 #include "scene/items/RectangleItem.h"
 #include "scene/items/StickItem.h"
+#include "serialization/PhaseMapWriter.h"
 #include "serialization/ProjectSerializer.h"
+#include "ui/EditorView.h"
 #include "ui/bindings/ShapeModelBinder.h"
 #include "ui/controller/DocumentController.h"
 #include "ui/editor/EditorArea.h"
+#include "ui/editor/RsaDialog.h"
+#include "ui/editor/SceneImageExporter.h"
 #include "ui/editor/SubstrateDialog.h"
 #include "ui/editor/SubstrateItem.h"
 #include "ui/panels/ObjectsBar.h"
@@ -64,11 +76,34 @@ constexpr int kDefaultSubstrateColorG = 240;
 constexpr int kDefaultSubstrateColorB = 240;
 constexpr int kDefaultSubstrateColorA = 255;
 constexpr double kDefaultCircleRadius = 50.0;
+constexpr double kPercent = 100.0;
+constexpr int kMaxPhaseMapWidthPx = 65536;
+// Tiled TIFF export streams tiles, so only the file size limits the image
+constexpr int kMaxImageWidthPx = 262144;
+constexpr auto kProjectFileFilter =
+  "JSON Files (*.json);;NIR Binary Projects (*.nirb);;"
+  "Compressed NIR Projects (*.nirz)";
+
+// Rendering detail thresholds, in on-screen pixels; see LevelOfDetail
+void load_level_of_detail(const QSettings& settings) {
+  LevelOfDetail detail = level_of_detail();
+  detail.min_grid_spacing_px =
+    settings.value("render/minGridSpacingPx", detail.min_grid_spacing_px)
+      .toDouble();
+  detail.min_grid_item_px =
+    settings.value("render/minGridItemPx", detail.min_grid_item_px)
+      .toDouble();
+  detail.min_outline_item_px =
+    settings.value("render/minOutlineItemPx", detail.min_outline_item_px)
+      .toDouble();
+  set_level_of_detail(detail);
+}
 }  // namespace
 
 MainWindow::MainWindow(QWidget* parent) : QMainWindow(parent) {
   setWindowTitle("NIR Material Editor");
   setWindowIcon(QIcon(":/icons/app.svg"));
+  load_level_of_detail(QSettings("NIR", "MaterialEditor"));
 
   // Create document model and binder
   document_model_ = std::make_unique<DocumentModel>();
@@ -88,6 +123,18 @@ MainWindow::MainWindow(QWidget* parent) : QMainWindow(parent) {
   // Set editor area in controller after it's created
   if (editor_area_ != nullptr) {
     document_controller_->set_editor_area(editor_area_);
+    // Wheel rotation and scaling of the selection, as bulk commands
+    connect(editor_area_->view(), &EditorView::rotateItemsRequested,
+            document_controller_.get(), &DocumentController::rotate_items);
+    connect(editor_area_->view(), &EditorView::scaleItemsRequested,
+            document_controller_.get(), &DocumentController::scale_items);
+    connect(editor_area_->view(), &EditorView::areaSelected,
+            document_controller_.get(), &DocumentController::select_area);
+    // A drag or a spin box edit is one undo step however slowly it goes
+    connect(editor_area_->view(), &EditorView::dragFinished,
+            command_manager_.get(), &CommandManager::close_gesture);
+    connect(properties_bar_, &PropertiesBar::edit_finished,
+            command_manager_.get(), &CommandManager::close_gesture);
   }
 
   createMenuBar();
@@ -138,10 +185,72 @@ void MainWindow::createMenuBar() {
 
   file_menu->addSeparator();
 
+  auto* export_phase_map_action = new QAction("Export Phase Map...", this);
+  connect(export_phase_map_action, &QAction::triggered, this,
+          &MainWindow::export_phase_map);
+  file_menu->addAction(export_phase_map_action);
+
+  auto* export_image_action = new QAction("Export Image...", this);
+  connect(export_image_action, &QAction::triggered, this,
+          &MainWindow::export_image);
+  file_menu->addAction(export_image_action);
+
+  file_menu->addSeparator();
+
   auto* quit_action = new QAction("Quit", this);
   quit_action->setShortcut(QKeySequence::Quit);
   connect(quit_action, &QAction::triggered, this, &QMainWindow::close);
   file_menu->addAction(quit_action);
+
+  auto* view_menu = menuBar()->addMenu("View");
+
+  // One layer item draws all inclusions; for scenes too large for one item
+  // per shape
+  auto* batched_action = new QAction("Batched Inclusion Layer", this);
+  batched_action->setCheckable(true);
+  batched_action->setChecked(QSettings("NIR", "MaterialEditor")
+                               .value("render/batchedLayer", false)
+                               .toBool());
+  connect(batched_action, &QAction::toggled, this,
+          &MainWindow::set_batched_rendering);
+  view_menu->addAction(batched_action);
+  set_batched_rendering(batched_action->isChecked());
+
+  // Unselected items are drawn from cached tiles, so panning blits pixmaps
+  auto* tile_cache_action = new QAction("Cached Scene Tiles", this);
+  tile_cache_action->setCheckable(true);
+  tile_cache_action->setChecked(QSettings("NIR", "MaterialEditor")
+                                  .value("render/tileCache", true)
+                                  .toBool());
+  connect(tile_cache_action, &QAction::toggled, this, [this](bool enabled) {
+    QSettings("NIR", "MaterialEditor").setValue("render/tileCache", enabled);
+    if (editor_area_ != nullptr) {
+      editor_area_->view()->setTileCacheEnabled(enabled);
+    }
+  });
+  view_menu->addAction(tile_cache_action);
+  if (editor_area_ != nullptr) {
+    editor_area_->view()->setTileCacheEnabled(tile_cache_action->isChecked());
+  }
+}
+
+void MainWindow::set_batched_rendering(bool enabled) {
+  if (document_controller_ == nullptr ||
+      document_controller_->batched_rendering() == enabled) {
+    return;
+  }
+  QSettings("NIR", "MaterialEditor").setValue("render/batchedLayer", enabled);
+  // The scene is rebuilt; drop references to its items first
+  if (properties_bar_ != nullptr) {
+    properties_bar_->clear();
+  }
+  current_selected_item_ = nullptr;
+  document_controller_->set_batched_rendering(enabled);
+  if (properties_bar_ != nullptr && editor_area_ != nullptr &&
+      editor_area_->substrate_item() != nullptr) {
+    properties_bar_->set_selected_item(editor_area_->substrate_item(),
+                                       "Substrate");
+  }
 }
 
 void MainWindow::createActionsAndToolbar() {
@@ -215,6 +324,47 @@ void MainWindow::createActionsAndToolbar() {
   });
   toolbar->addAction(substrate_size_action);
 
+  auto* generate_action = new QAction("Generate Inclusions...", this);
+  connect(generate_action, &QAction::triggered, this, [this] {
+    if (document_controller_ == nullptr) {
+      return;
+    }
+    RsaDialog dlg(this);
+    if (dlg.exec() != QDialog::Accepted) {
+      return;
+    }
+    const RsaResult result =
+      document_controller_->generate_inclusions(dlg.settings());
+    statusBar()->showMessage(
+      QString("Generated %1 inclusions, area fraction %2%3")
+        .arg(result.shapes.size())
+        .arg(result.area_fraction * kPercent, 0, 'f', 1)
+        .arg(result.target_reached ? "%" : "% (jammed before target)"),
+      kStatusBarMessageTimeoutMs);
+  });
+  toolbar->addAction(generate_action);
+
+  auto* statistics_action = new QAction("Material Statistics...", this);
+  connect(statistics_action, &QAction::triggered, this, [this] {
+    if (document_controller_ == nullptr) {
+      return;
+    }
+    const AreaFractionReport report =
+      document_controller_->material_statistics();
+    QString text;
+    for (const auto& phase : report.phases) {
+      text += QString("%1: %2% area, interface %3 px, %4 inclusions\n")
+                .arg(QString::fromStdString(phase.name))
+                .arg(phase.area_fraction * kPercent, 0, 'f', 3)
+                .arg(phase.interface_length, 0, 'f', 1)
+                .arg(phase.inclusion_count);
+    }
+    text += QString("Total interface length: %1 px")
+              .arg(report.total_interface_length, 0, 'f', 1);
+    QMessageBox::information(this, "Material Statistics", text);
+  });
+  toolbar->addAction(statistics_action);
+
   // Shape creation is now handled in ObjectsBar via + button
 }
 
@@ -280,8 +430,7 @@ void MainWindow::createActivityObjectsBarAndEditor() {
               current_selected_item_ = nullptr;
               return;
             }
-            auto* scene_obj =
-              dynamic_cast<ISceneObject*>(current_selected_item_);
+            auto* scene_obj = scene_object_cast(current_selected_item_);
             if (scene_obj == nullptr) {
               return;
             }
@@ -301,13 +450,8 @@ void MainWindow::createActivityObjectsBarAndEditor() {
                 document_model_ == nullptr) {
               return;
             }
-            std::shared_ptr<MaterialModel> shared;
-            for (const auto& mat : document_model_->materials()) {
-              if (mat.get() == material) {
-                shared = mat;
-                break;
-              }
-            }
+            const std::shared_ptr<MaterialModel> shared =
+              document_model_->find_material(material->id());
             if (shared == nullptr) {
               return;
             }
@@ -324,12 +468,26 @@ void MainWindow::createActivityObjectsBarAndEditor() {
               return;
             }
             // Validate item is still valid
-            if (auto* graphics_item = dynamic_cast<QGraphicsItem*>(item)) {
-              if (graphics_item->scene() == nullptr) {
+            if (item->graphics_item()->scene() == nullptr) {
+              return;
+            }
+            document_controller_->change_shape_type(item, new_type);
+          });
+  // Connect PropertiesBar material choice to a material assignment
+  connect(properties_bar_, &PropertiesBar::item_material_changed, this,
+          [this](ISceneObject* item, MaterialModel* material) {
+            if (document_controller_ == nullptr || item == nullptr ||
+                document_model_ == nullptr) {
+              return;
+            }
+            std::shared_ptr<MaterialModel> shared;
+            if (material != nullptr) {
+              shared = document_model_->find_material(material->id());
+              if (shared == nullptr) {
                 return;
               }
             }
-            document_controller_->change_shape_type(item, new_type);
+            document_controller_->assign_material(item, shared);
           });
   // Bind model to the Objects bar (first sidebar entry)
   // We know SideBarWidget registered the "objects" page as index 0
@@ -373,9 +531,12 @@ void MainWindow::createActivityObjectsBarAndEditor() {
                   return;
                 }
                 auto shape_model = tree_model_->shape_from_index(current);
-                if (shape_model != nullptr && shape_binder_ != nullptr) {
-                  auto* item = shape_binder_->item_for(shape_model);
-                  if (item != nullptr) {
+                if (shape_model != nullptr && document_controller_ != nullptr) {
+                  // With the batched layer this creates the shape's proxy
+                  auto* scene_obj =
+                    document_controller_->scene_item_for(shape_model);
+                  if (scene_obj != nullptr) {
+                    QGraphicsItem* item = scene_obj->graphics_item();
                     // Validate item is still in scene
                     if (item->scene() == nullptr) {
                       return;
@@ -388,12 +549,9 @@ void MainWindow::createActivityObjectsBarAndEditor() {
                     item->setSelected(true);
                     current_selected_item_ = item;
                     if (properties_bar_ != nullptr) {
-                      auto* scene_obj = dynamic_cast<ISceneObject*>(item);
-                      if (scene_obj != nullptr) {
-                        const QString name =
-                          QString::fromStdString(shape_model->name());
-                        properties_bar_->set_selected_item(scene_obj, name);
-                      }
+                      const QString name =
+                        QString::fromStdString(shape_model->name());
+                      properties_bar_->set_selected_item(scene_obj, name);
                     }
                     return;
                   }
@@ -421,6 +579,9 @@ void MainWindow::createActivityObjectsBarAndEditor() {
             }
             auto items = editor_area_->scene()->selectedItems();
             if (items.isEmpty()) {
+              // The deselected item may be deleted next (e.g. a released
+              // proxy of the batched layer)
+              current_selected_item_ = nullptr;
               // Show substrate when nothing selected
               if (properties_bar_ != nullptr &&
                   editor_area_->substrate_item() != nullptr) {
@@ -435,7 +596,7 @@ void MainWindow::createActivityObjectsBarAndEditor() {
               return;
             }
             if (shape_binder_ != nullptr) {
-              auto* scene_obj = dynamic_cast<ISceneObject*>(first_item);
+              auto* scene_obj = scene_object_cast(first_item);
               if (scene_obj != nullptr) {
                 if (auto model = shape_binder_->model_for(scene_obj)) {
                   const QModelIndex idx = tree_model_->index_from_shape(model);
@@ -448,7 +609,7 @@ void MainWindow::createActivityObjectsBarAndEditor() {
             }
             // Update properties bar
             if (properties_bar_ != nullptr) {
-              auto* scene_obj = dynamic_cast<ISceneObject*>(first_item);
+              auto* scene_obj = scene_object_cast(first_item);
               if (scene_obj != nullptr) {
                 current_selected_item_ = first_item;
                 const QString name = scene_obj->name();
@@ -525,7 +686,7 @@ void MainWindow::save_project_as() {
   const QString default_path = last_dir + "/untitled.json";
 
   const QString filename = QFileDialog::getSaveFileName(
-    this, "Save Project As", default_path, "JSON Files (*.json)", nullptr,
+    this, "Save Project As", default_path, kProjectFileFilter, nullptr,
     QFileDialog::DontUseNativeDialog);
   if (filename.isEmpty()) {
     return;
@@ -551,7 +712,7 @@ void MainWindow::open_project() {
     settings.value("lastDirectory", QDir::homePath()).toString();
 
   const QString filename = QFileDialog::getOpenFileName(
-    this, "Open Project", last_dir, "JSON Files (*.json)", nullptr,
+    this, "Open Project", last_dir, kProjectFileFilter, nullptr,
     QFileDialog::DontUseNativeDialog);
   if (filename.isEmpty()) {
     return;
@@ -565,8 +726,12 @@ void MainWindow::open_project() {
 
   if (document_controller_->load_document(filename)) {
     settings.setValue("lastDirectory", QFileInfo(filename).absolutePath());
-    statusBar()->showMessage("Project loaded successfully",
-                             kStatusBarMessageTimeoutMs);
+    const size_t recovered = document_controller_->recovered_edit_count();
+    statusBar()->showMessage(
+      recovered > 0
+        ? QString("Project loaded, %1 unsaved edits recovered").arg(recovered)
+        : QString("Project loaded successfully"),
+      kStatusBarMessageTimeoutMs);
     // Show substrate in properties by default after loading
     if (properties_bar_ != nullptr && editor_area_ != nullptr &&
         editor_area_->substrate_item() != nullptr) {
@@ -578,3 +743,105 @@ void MainWindow::open_project() {
                              kStatusBarMessageTimeoutMs);
   }
 }
+
+void MainWindow::export_phase_map() {
+  if (document_controller_ == nullptr || editor_area_ == nullptr) {
+    return;
+  }
+
+  bool accepted = false;
+  const int width_px = QInputDialog::getInt(
+    this, "Export Phase Map", "Image width (px):",
+    static_cast<int>(editor_area_->substrate_size().width()), 1,
+    kMaxPhaseMapWidthPx, 1, &accepted);
+  if (!accepted) {
+    return;
+  }
+
+  QSettings settings("NIR", "MaterialEditor");
+  const QString last_dir =
+    settings.value("lastDirectory", QDir::homePath()).toString();
+  const QString filename = QFileDialog::getSaveFileName(
+    this, "Export Phase Map", last_dir + "/phases.tif",
+    "TIFF Images (*.tif *.tiff);;PGM Images (*.pgm);;Raw uint16 (*.raw)",
+    nullptr, QFileDialog::DontUseNativeDialog);
+  if (filename.isEmpty()) {
+    return;
+  }
+
+  PhaseRasterSettings raster_settings;
+  raster_settings.width_px = static_cast<size_t>(width_px);
+  const PhaseMap map =
+    document_controller_->rasterize_phase_map(raster_settings);
+  if (PhaseMapWriter::write(filename.toStdString(), map)) {
+    settings.setValue("lastDirectory", QFileInfo(filename).absolutePath());
+    statusBar()->showMessage(
+      QString("Exported %1x%2 phase map (%3 MP/s)")
+        .arg(map.width)
+        .arg(map.height)
+        .arg(map.megapixels_per_second(), 0, 'f', 0),
+      kStatusBarMessageTimeoutMs);
+  } else {
+    statusBar()->showMessage("Failed to export phase map",
+                             kStatusBarMessageTimeoutMs);
+  }
+}
+
+void MainWindow::export_image() {
+  if (document_controller_ == nullptr || editor_area_ == nullptr) {
+    return;
+  }
+
+  bool accepted = false;
+  const int width_px = QInputDialog::getInt(
+    this, "Export Image", "Image width (px):",
+    static_cast<int>(editor_area_->substrate_size().width()), 1,
+    kMaxImageWidthPx, 1, &accepted);
+  if (!accepted) {
+    return;
+  }
+
+  QSettings settings("NIR", "MaterialEditor");
+  const QString last_dir =
+    settings.value("lastDirectory", QDir::homePath()).toString();
+  const QString filename = QFileDialog::getSaveFileName(
+    this, "Export Image", last_dir + "/scene.tif",
+    "Tiled TIFF Images (*.tif *.tiff)", nullptr,
+    QFileDialog::DontUseNativeDialog);
+  if (filename.isEmpty()) {
+    return;
+  }
+
+  // Tiles render on worker threads; the modal dialog keeps the window
+  // responsive and the document unchanged meanwhile
+  QProgressDialog progress_dialog("Rendering image...", "Cancel", 0, 1, this);
+  progress_dialog.setWindowModality(Qt::WindowModal);
+  progress_dialog.setMinimumDuration(0);
+  const auto progress = [&progress_dialog](size_t done, size_t total) {
+    progress_dialog.setMaximum(static_cast<int>(total));
+    progress_dialog.setValue(static_cast<int>(done));
+    QCoreApplication::processEvents();
+    return !progress_dialog.wasCanceled();
+  };
+
+  SceneImageSettings image_settings;
+  image_settings.width_px = static_cast<size_t>(width_px);
+  const SceneImageResult result = document_controller_->export_image(
+    image_settings, filename.toStdString(), progress);
+  progress_dialog.reset();
+  if (result.written) {
+    settings.setValue("lastDirectory", QFileInfo(filename).absolutePath());
+    statusBar()->showMessage(
+      QString("Exported %1x%2 image (%3 MP/s)")
+        .arg(result.width)
+        .arg(result.height)
+        .arg(result.megapixels_per_second(), 0, 'f', 1),
+      kStatusBarMessageTimeoutMs);
+  } else if (result.cancelled) {
+    statusBar()->showMessage("Image export cancelled",
+                             kStatusBarMessageTimeoutMs);
+  } else {
+    statusBar()->showMessage("Failed to export image",
+                             kStatusBarMessageTimeoutMs);
+  }
+}
@@ -36,6 +36,9 @@ class MainWindow : public QMainWindow {
   void save_project();
   void save_project_as();
   void open_project();
+  void export_phase_map();
+  void export_image();
+  void set_batched_rendering(bool enabled);
 
  private:
   SideBarWidget* side_bar_widget_{nullptr};
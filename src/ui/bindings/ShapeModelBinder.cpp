@@ -27,60 +27,70 @@ auto is_item_valid(const ISceneObject* item) -> bool {
   if (item == nullptr) {
     return false;
   }
-  // Check if it's a QGraphicsItem that's still in scene
-  if (const auto* graphics_item = dynamic_cast<const QGraphicsItem*>(item)) {
-    // If scene() returns nullptr, item was removed from scene or deleted
-    return graphics_item->scene() != nullptr;
-  }
-  // For non-QGraphicsItem ISceneObject implementations, assume valid
-  // (though currently all implementations are QGraphicsItem-based)
-  return true;
+  // If scene() returns nullptr, item was removed from scene or deleted
+  return item->graphics_item()->scene() != nullptr;
+}
+
+// Filled items keep the material color in their brush, sticks in their pen
+auto filled_item(ISceneObject* item) -> QAbstractGraphicsShapeItem* {
+  switch (item->kind()) {
+    case ISceneObject::Kind::Rectangle:
+      return static_cast<RectangleItem*>(item);
+    case ISceneObject::Kind::Ellipse:
+      return static_cast<EllipseItem*>(item);
+    case ISceneObject::Kind::Circle:
+      return static_cast<CircleItem*>(item);
+    case ISceneObject::Kind::Stick:
+    case ISceneObject::Kind::Substrate:
+      return nullptr;
+  }
+  return nullptr;
 }
 
 auto ColorFromItem(const ISceneObject* item) -> Color {
   if (!is_item_valid(item)) {
     return Color{};
   }
-  if (const auto* graphics_item = dynamic_cast<const QGraphicsItem*>(item)) {
-    if (const auto* rect =
-          dynamic_cast<const QGraphicsRectItem*>(graphics_item)) {
-      return to_model_color(rect->brush().color());
-    }
-    if (const auto* ellipse =
-          dynamic_cast<const QGraphicsEllipseItem*>(graphics_item)) {
-      return to_model_color(ellipse->brush().color());
-    }
-    if (const auto* line =
-          dynamic_cast<const QGraphicsLineItem*>(graphics_item)) {
-      return to_model_color(line->pen().color());
-    }
+  switch (item->kind()) {
+    case ISceneObject::Kind::Rectangle:
+      return to_model_color(
+        static_cast<const RectangleItem*>(item)->brush().color());
+    case ISceneObject::Kind::Ellipse:
+      return to_model_color(
+        static_cast<const EllipseItem*>(item)->brush().color());
+    case ISceneObject::Kind::Circle:
+      return to_model_color(
+        static_cast<const CircleItem*>(item)->brush().color());
+    case ISceneObject::Kind::Stick:
+      return to_model_color(static_cast<const StickItem*>(item)->pen().color());
+    case ISceneObject::Kind::Substrate:
+      break;
   }
   return Color{};
 }
 
+// Item color without the scene check (also for items outside any scene)
+void set_item_color(ISceneObject* item, const Color& color) {
+  const QColor qcolor = to_qcolor(color);
+  if (auto* shape_item = filled_item(item)) {
+    QBrush brush = shape_item->brush();
+    brush.setColor(qcolor);
+    shape_item->setBrush(brush);
+  } else if (item->kind() == ISceneObject::Kind::Stick) {
+    auto* line = static_cast<StickItem*>(item);
+    QPen pen = line->pen();
+    pen.setColor(qcolor);
+    line->setPen(pen);
+    // QGraphicsLineItem doesn't have setBrush, but ensure no fill is applied
+    // StickItem handles this in its paint method
+  }
+}
+
 void ApplyColorToItem(ISceneObject* item, const Color& color) {
   if (!is_item_valid(item)) {
     return;
   }
-  const QColor qcolor = to_qcolor(color);
-  if (auto* graphics_item = dynamic_cast<QGraphicsItem*>(item)) {
-    if (auto* rect = dynamic_cast<QGraphicsRectItem*>(graphics_item)) {
-      QBrush brush = rect->brush();
-      brush.setColor(qcolor);
-      rect->setBrush(brush);
-    } else if (auto* ellipse =
-                 dynamic_cast<QGraphicsEllipseItem*>(graphics_item)) {
-      QBrush brush = ellipse->brush();
-      brush.setColor(qcolor);
-      ellipse->setBrush(brush);
-    } else if (auto* line = dynamic_cast<QGraphicsLineItem*>(graphics_item)) {
-      QPen pen = line->pen();
-      pen.setColor(qcolor);
-      line->setPen(pen);
-      // QGraphicsLineItem doesn't have setBrush, but ensure no fill is applied
-      // StickItem handles this in its paint method
-    }
-  }
+  set_item_color(item, color);
 }
 
 auto ToModelPoint(const QPointF& point) -> Point2D {
@@ -91,6 +101,103 @@ auto ToQPoint(const Point2D& point) -> QPointF {
   return {point.x, point.y};
 }
 
+// Position, rotation and model size (see update_model_geometry) of an item
+auto item_geometry(ISceneObject* item) -> ShapeModelBinder::GeometryEdit {
+  QGraphicsItem* graphics_item = item->graphics_item();
+  ShapeModelBinder::GeometryEdit geometry{
+    .position = ToModelPoint(graphics_item->pos()),
+    .rotation_deg = graphics_item->rotation(),
+    .size = {}};
+  switch (item->kind()) {
+    case ISceneObject::Kind::Circle: {
+      // Circle: rect().width() is diameter, model stores diameter x diameter
+      const qreal diameter = static_cast<CircleItem*>(item)->rect().width();
+      geometry.size = Size2D{.width = diameter, .height = diameter};
+      break;
+    }
+    case ISceneObject::Kind::Rectangle: {
+      const QRectF rect = static_cast<RectangleItem*>(item)->rect();
+      geometry.size = Size2D{.width = rect.width(), .height = rect.height()};
+      break;
+    }
+    case ISceneObject::Kind::Ellipse: {
+      const QRectF rect = static_cast<EllipseItem*>(item)->rect();
+      geometry.size = Size2D{.width = rect.width(), .height = rect.height()};
+      break;
+    }
+    case ISceneObject::Kind::Stick: {
+      const auto* line_item = static_cast<StickItem*>(item);
+      geometry.size = Size2D{.width = line_item->line().length(),
+                             .height = line_item->pen().widthF()};
+      break;
+    }
+    case ISceneObject::Kind::Substrate: {
+      const QSizeF size = graphics_item->boundingRect().size();
+      geometry.size = Size2D{.width = size.width(), .height = size.height()};
+      break;
+    }
+  }
+  return geometry;
+}
+
+// Item position, rotation and size from a shape, without the scene check
+void set_item_geometry(ISceneObject* item, const ShapeModel& model) {
+  QGraphicsItem* graphics_item = item->graphics_item();
+  graphics_item->setPos(ToQPoint(model.position()));
+  graphics_item->setRotation(model.rotation_deg());
+
+  const Size2D size = model.size();
+  constexpr double kDiameterMultiplier = 2.0;
+  switch (item->kind()) {
+    case ISceneObject::Kind::Rectangle: {
+      auto* rect_item = static_cast<RectangleItem*>(item);
+      QRectF rect = rect_item->rect();
+      rect.setWidth(size.width);
+      rect.setHeight(size.height);
+      rect_item->setRect(rect);
+      rect_item->setTransformOriginPoint(rect_item->boundingRect().center());
+      break;
+    }
+    case ISceneObject::Kind::Circle: {
+      // Circle: size stores diameter x diameter, rect must be centered at
+      // (0,0)
+      auto* circle_item = static_cast<CircleItem*>(item);
+      const qreal radius = size.width / 2.0;
+      circle_item->setRect(QRectF(-radius, -radius,
+                                  kDiameterMultiplier * radius,
+                                  kDiameterMultiplier * radius));
+      // Circle is always centered at (0,0), so transform origin is at (0,0)
+      // relative to item
+      circle_item->setTransformOriginPoint(QPointF(0, 0));
+      break;
+    }
+    case ISceneObject::Kind::Ellipse: {
+      auto* ellipse_item = static_cast<EllipseItem*>(item);
+      QRectF rect = ellipse_item->rect();
+      rect.setWidth(size.width);
+      rect.setHeight(size.height);
+      ellipse_item->setRect(rect);
+      ellipse_item->setTransformOriginPoint(
+        ellipse_item->boundingRect().center());
+      break;
+    }
+    case ISceneObject::Kind::Stick: {
+      auto* line_item = static_cast<StickItem*>(item);
+      const qreal half_length = size.width / 2.0;
+      line_item->setLine(QLineF(-half_length, 0.0, half_length, 0.0));
+      line_item->setTransformOriginPoint(line_item->boundingRect().center());
+      // For stick items, keep fixed pen width
+      constexpr double kStickPenWidth = 2.0;
+      QPen pen = line_item->pen();
+      pen.setWidthF(kStickPenWidth);  // Fixed width for stick
+      line_item->setPen(pen);
+      break;
+    }
+    case ISceneObject::Kind::Substrate:
+      break;
+  }
+}
+
 }  // namespace
 
 ShapeModelBinder::ShapeModelBinder(DocumentModel& document)
@@ -98,20 +205,28 @@ ShapeModelBinder::ShapeModelBinder(DocumentModel& document)
 
 namespace {
 ShapeModel::ShapeType type_from_item(ISceneObject* item) {
-  if (dynamic_cast<RectangleItem*>(item) != nullptr) {
-    return ShapeModel::ShapeType::Rectangle;
-  }
-  if (dynamic_cast<EllipseItem*>(item) != nullptr) {
-    return ShapeModel::ShapeType::Ellipse;
-  }
-  if (dynamic_cast<CircleItem*>(item) != nullptr) {
-    return ShapeModel::ShapeType::Circle;
-  }
-  if (dynamic_cast<StickItem*>(item) != nullptr) {
-    return ShapeModel::ShapeType::Stick;
+  switch (item->kind()) {
+    case ISceneObject::Kind::Rectangle:
+      return ShapeModel::ShapeType::Rectangle;
+    case ISceneObject::Kind::Ellipse:
+      return ShapeModel::ShapeType::Ellipse;
+    case ISceneObject::Kind::Circle:
+      return ShapeModel::ShapeType::Circle;
+    case ISceneObject::Kind::Stick:
+      return ShapeModel::ShapeType::Stick;
+    case ISceneObject::Kind::Substrate:
+      break;
   }
   return ShapeModel::ShapeType::Rectangle;
 }
+
+// Material whose grid the item draws: the preset, or the custom material once
+// created (nullptr: the default one, which has no grid)
+auto item_material(const ShapeModel& model) -> MaterialModel* {
+  return model.material_mode() == ShapeModel::MaterialMode::Preset
+           ? model.material().get()
+           : model.custom_material().get();
+}
 }  // namespace
 
 auto ShapeModelBinder::bind_shape(ISceneObject* item)
@@ -126,20 +241,18 @@ auto ShapeModelBinder::bind_shape(ISceneObject* item)
 
   auto model =
     document_.create_shape(type_from_item(item), item->name().toStdString());
-  if (model->material()) {
-    model->material()->set_color(ColorFromItem(item));
-  }
+  model->set_custom_color(ColorFromItem(item));
 
   const int connection_id = model->on_changed().connect(
     [this, item](const ModelChange& change) { handle_change(item, change); });
 
   bindings_[item] = Binding{.model = model, .connection_id = connection_id};
+  items_[model->id()] = item;
   update_material_binding(item, bindings_[item]);
   update_model_geometry(item, model);
   item->set_geometry_changed_callback(
     [this, item] { on_item_geometry_changed(item); });
-  ApplyColorToItem(item,
-                   model->material() ? model->material()->color() : Color{});
+  ApplyColorToItem(item, model->custom_color());
   return model;
 }
 
@@ -157,19 +270,27 @@ auto ShapeModelBinder::attach_shape(ISceneObject* item,
     [this, item](const ModelChange& change) { handle_change(item, change); });
 
   bindings_[item] = Binding{.model = model, .connection_id = connection_id};
+  items_[model->id()] = item;
   update_material_binding(item, bindings_[item]);
   item->set_geometry_changed_callback(
     [this, item] { on_item_geometry_changed(item); });
   apply_geometry(item, model);
-  ApplyColorToItem(item,
-                   model->material() ? model->material()->color() : Color{});
+  ApplyColorToItem(item, model->custom_color());
   // Apply material model to scene item so grid settings are displayed
-  if (model->material() != nullptr) {
-    item->set_material_model(model->material().get());
-  }
+  item->set_material_model(item_material(*model));
   return model;
 }
 
+void ShapeModelBinder::apply_shape(ISceneObject* item,
+                                   const ShapeModel& model) {
+  if (item == nullptr) {
+    return;
+  }
+  set_item_geometry(item, model);
+  set_item_color(item, model.custom_color());
+  item->set_material_model(item_material(model));
+}
+
 auto ShapeModelBinder::model_for(ISceneObject* item) const
   -> std::shared_ptr<ShapeModel> {
   if (item == nullptr || !is_item_valid(item)) {
@@ -184,17 +305,75 @@ auto ShapeModelBinder::model_for(ISceneObject* item) const
 
 auto ShapeModelBinder::item_for(const std::shared_ptr<ShapeModel>& model) const
   -> QGraphicsItem* {
-  for (const auto& entry : bindings_) {
-    if (entry.second.model == model) {
-      // Validate item is still valid before returning
-      if (is_item_valid(entry.first)) {
-        return dynamic_cast<QGraphicsItem*>(entry.first);
+  ISceneObject* item = object_for(model);
+  return item != nullptr ? item->graphics_item() : nullptr;
+}
+
+auto ShapeModelBinder::object_for(
+  const std::shared_ptr<ShapeModel>& model) const -> ISceneObject* {
+  if (model == nullptr) {
+    return nullptr;
+  }
+  const auto item_iterator = items_.find(model->id());
+  if (item_iterator == items_.end()) {
+    return nullptr;
+  }
+  // Validate item is still valid before returning; an item that left the
+  // scene while still bound would otherwise be a dangling pointer
+  if (!is_item_valid(item_iterator->second)) {
+    return nullptr;
+  }
+  return item_iterator->second;
+}
+
+auto ShapeModelBinder::bound_shapes() const
+  -> std::vector<std::shared_ptr<ShapeModel>> {
+  std::vector<std::shared_ptr<ShapeModel>> shapes;
+  shapes.reserve(bindings_.size());
+  for (const auto& [item, binding] : bindings_) {
+    if (binding.model != nullptr) {
+      shapes.push_back(binding.model);
+    }
+  }
+  return shapes;
+}
+
+void ShapeModelBinder::stack_in_document_order(ISceneObject* item) const {
+  const auto binding_it = bindings_.find(item);
+  if (binding_it == bindings_.end() || binding_it->second.model == nullptr) {
+    return;
+  }
+  const auto& shapes = document_.shapes();
+  const size_t row = document_.row_of(*binding_it->second.model);
+  if (row >= shapes.size()) {
+    return;
+  }
+  // Item of the nearest later shape: walk the later rows, or check every
+  // item when fewer items are bound than rows follow
+  ISceneObject* next = nullptr;
+  if (items_.size() < shapes.size() - row) {
+    size_t next_row = shapes.size();
+    for (const auto& [model_id, other] : items_) {
+      const auto other_it = bindings_.find(other);
+      if (other == item || other_it == bindings_.end() ||
+          other_it->second.model == nullptr || !is_item_valid(other)) {
+        continue;
       }
-      // Item is no longer valid, but we still have binding - this is a bug
-      // but we'll return nullptr to avoid dangling pointer
+      const size_t other_row = document_.row_of(*other_it->second.model);
+      if (other_row > row && other_row < next_row) {
+        next_row = other_row;
+        next = other;
+      }
+    }
+  } else {
+    for (size_t later = row + 1; later < shapes.size() && next == nullptr;
+         ++later) {
+      next = object_for(shapes[later]);
     }
   }
-  return nullptr;
+  if (next != nullptr) {
+    item->graphics_item()->stackBefore(next->graphics_item());
+  }
 }
 
 void ShapeModelBinder::unbind_shape(ISceneObject* item) {
@@ -212,6 +391,10 @@ void ShapeModelBinder::unbind_shape(ISceneObject* item) {
   detach_material_binding(binding_iterator->second);
   if (auto model = binding_iterator->second.model) {
     model->on_changed().disconnect(binding_iterator->second.connection_id);
+    const auto item_iterator = items_.find(model->id());
+    if (item_iterator != items_.end() && item_iterator->second == item) {
+      items_.erase(item_iterator);
+    }
   }
   bindings_.erase(binding_iterator);
 }
@@ -228,6 +411,7 @@ void ShapeModelBinder::clear_bindings() {
     detach_material_binding(entry.second);
   }
   bindings_.clear();
+  items_.clear();
 }
 
 void ShapeModelBinder::cleanup_invalid_bindings() {
@@ -271,12 +455,11 @@ void ShapeModelBinder::handle_change(ISceneObject* item,
     case ModelChange::Type::MaterialChanged:
       update_material_binding(item, binding_it->second);
       [[fallthrough]];
-    case ModelChange::Type::ColorChanged: {
-      const Color color =
-        model->material() ? model->material()->color() : Color{};
-      ApplyColorToItem(item, color);
+    case ModelChange::Type::ColorChanged:
+      ApplyColorToItem(item, model->custom_color());
+      // The custom material may just have been created
+      item->set_material_model(item_material(*model));
       break;
-    }
     case ModelChange::Type::GeometryChanged:
       apply_geometry(item, model);
       break;
@@ -306,10 +489,11 @@ void ShapeModelBinder::update_material_binding(ISceneObject* item,
   if (!binding.model) {
     return;
   }
-  auto material = binding.model->material();
-  if (!material) {
+  // Edits of a custom material reach the item as changes of the shape
+  if (binding.model->material_mode() != ShapeModel::MaterialMode::Preset) {
     return;
   }
+  auto material = binding.model->material();
   binding.bound_material = material;
   MaterialModel* material_ptr = material.get();
   binding.material_connection_id = material->on_changed().connect(
@@ -350,10 +534,6 @@ void ShapeModelBinder::update_model_geometry(
   if (item == nullptr || model == nullptr || !is_item_valid(item)) {
     return;
   }
-  auto* graphics_item = dynamic_cast<QGraphicsItem*>(item);
-  if (graphics_item == nullptr) {
-    return;
-  }
   auto binding_it = bindings_.find(item);
   if (binding_it == bindings_.end()) {
     return;
@@ -374,109 +554,10 @@ void ShapeModelBinder::update_model_geometry(
   };
   const SuppressGuard guard(binding_it->second.suppress_model_geometry_signal);
 
-  model->set_position(ToModelPoint(graphics_item->pos()));
-  model->set_rotation_deg(graphics_item->rotation());
-
-  // Check CircleItem first (before QGraphicsEllipseItem) since CircleItem
-  // inherits from it
-  if (auto* circle_item = dynamic_cast<CircleItem*>(item)) {
-    // Circle: rect().width() is diameter, model stores diameter x diameter
-    const QRectF rect = circle_item->rect();
-    const qreal diameter =
-      rect.width();  // For circle, width == height == diameter
-    model->set_size(Size2D{.width = diameter, .height = diameter});
-  } else if (auto* rect_item =
-               dynamic_cast<QGraphicsRectItem*>(graphics_item)) {
-    const QRectF rect = rect_item->rect();
-    model->set_size(Size2D{.width = rect.width(), .height = rect.height()});
-  } else if (auto* ellipse_item =
-               dynamic_cast<QGraphicsEllipseItem*>(graphics_item)) {
-    // This handles EllipseItem (not CircleItem, as it's checked above)
-    const QRectF rect = ellipse_item->rect();
-    model->set_size(Size2D{.width = rect.width(), .height = rect.height()});
-  } else if (auto* line_item =
-               dynamic_cast<QGraphicsLineItem*>(graphics_item)) {
-    const qreal length = line_item->line().length();
-    model->set_size(
-      Size2D{.width = length, .height = line_item->pen().widthF()});
-  } else {
-    const QSizeF size = graphics_item->boundingRect().size();
-    model->set_size(Size2D{.width = size.width(), .height = size.height()});
-  }
-}
-
-void ShapeModelBinder::apply_geometry(
-  ISceneObject* item, const std::shared_ptr<ShapeModel>& model) {
-  if (item == nullptr || model == nullptr || !is_item_valid(item)) {
-    return;
-  }
-  auto* graphics_item = dynamic_cast<QGraphicsItem*>(item);
-  if (graphics_item == nullptr) {
-    return;
-  }
-  auto binding_iterator = bindings_.find(item);
-  if (binding_iterator == bindings_.end()) {
-    return;
-  }
-
-  // Use RAII to ensure flag is reset even if exception occurs
-  // Suppress geometry callback to prevent circular updates when applying
-  // geometry from model
-  struct SuppressGuard {
-   private:
-    bool& flag_;
-
-   public:
-    explicit SuppressGuard(bool& flag_ref) : flag_(flag_ref) {
-      flag_ = true;
-    }
-    ~SuppressGuard() {
-      flag_ = false;
-    }
-  };
-  const SuppressGuard guard(
-    binding_iterator->second.suppress_geometry_callback);
-
-  graphics_item->setPos(ToQPoint(model->position()));
-  graphics_item->setRotation(model->rotation_deg());
-
-  const Size2D size = model->size();
-  constexpr double kDiameterMultiplier = 2.0;
-  if (auto* rect_item = dynamic_cast<QGraphicsRectItem*>(graphics_item)) {
-    QRectF rect = rect_item->rect();
-    rect.setWidth(size.width);
-    rect.setHeight(size.height);
-    rect_item->setRect(rect);
-    rect_item->setTransformOriginPoint(rect_item->boundingRect().center());
-  } else if (auto* circle_item = dynamic_cast<CircleItem*>(item)) {
-    // Circle: size stores diameter x diameter, rect must be centered at (0,0)
-    const qreal radius = size.width / 2.0;
-    circle_item->setRect(QRectF(-radius, -radius, kDiameterMultiplier * radius,
-                                kDiameterMultiplier * radius));
-    // Circle is always centered at (0,0), so transform origin is at (0,0)
-    // relative to item
-    circle_item->setTransformOriginPoint(QPointF(0, 0));
-  } else if (auto* ellipse_item =
-               dynamic_cast<QGraphicsEllipseItem*>(graphics_item)) {
-    QRectF rect = ellipse_item->rect();
-    rect.setWidth(size.width);
-    rect.setHeight(size.height);
-    ellipse_item->setRect(rect);
-    ellipse_item->setTransformOriginPoint(
-      ellipse_item->boundingRect().center());
-  } else if (auto* line_item =
-               dynamic_cast<QGraphicsLineItem*>(graphics_item)) {
-    const qreal half_length = size.width / 2.0;
-    line_item->setLine(QLineF(-half_length, 0.0, half_length, 0.0));
-    line_item->setTransformOriginPoint(line_item->boundingRect().center());
-    // For stick items, keep fixed pen width
-    constexpr double kStickPenWidth = 2.0;
-    if (dynamic_cast<StickItem*>(item) != nullptr) {
-      QPen pen = line_item->pen();
-      pen.setWidthF(kStickPenWidth);  // Fixed width for stick
-      line_item->setPen(pen);
-    }
-  }
+  const GeometryEdit geometry = item_geometry(item);
+  model->set_position(geometry.position);
+  model->set_rotation_deg(geometry.rotation_deg);
+  model->set_size(geometry.size);
 }
 
 void ShapeModelBinder::on_item_geometry_changed(ISceneObject* item) {
@@ -497,5 +578,11 @@ void ShapeModelBinder::on_item_geometry_changed(ISceneObject* item) {
     return;
   }
 
+  if (geometry_edit_handler_) {
+    // The handler writes the model, which may re-enter the binder
+    const auto model = binding_iterator->second.model;
+    geometry_edit_handler_(model, item_geometry(item));
+    return;
+  }
   update_model_geometry(item, binding_iterator->second.model);
 }
@@ -1,11 +1,15 @@
 #pragma once
 
+#include <functional>
 #include <memory>
 #include <unordered_map>
+#include <utility>
+#include <vector>
 
 #include "model/DocumentModel.h"
 #include "model/MaterialModel.h"
 #include "model/ShapeModel.h"
+#include "model/core/ModelTypes.h"
 
 class ISceneObject;
 class QGraphicsItem;
@@ -17,8 +21,29 @@ class QGraphicsItem;
  */
 class ShapeModelBinder {
  public:
+  /**
+   * @brief Item geometry in model terms after a user edit (drag, properties
+   * spin boxes).
+   */
+  struct GeometryEdit {
+    Point2D position;
+    double rotation_deg{0.0};
+    Size2D size;
+  };
+  using GeometryEditHandler = std::function<void(
+    const std::shared_ptr<ShapeModel>&, const GeometryEdit&)>;
+
   explicit ShapeModelBinder(DocumentModel& document);
 
+  /**
+   * @brief Hand user edits of item geometry to @p handler (e.g. to record
+   * them as undoable commands), which must write them to the model. Without
+   * a handler they are written to the model directly.
+   */
+  void set_geometry_edit_handler(GeometryEditHandler handler) {
+    geometry_edit_handler_ = std::move(handler);
+  }
+
   auto bind_shape(ISceneObject* item) -> std::shared_ptr<ShapeModel>;
   auto attach_shape(ISceneObject* item,
                     const std::shared_ptr<ShapeModel>& model)
@@ -26,6 +51,24 @@ class ShapeModelBinder {
   auto model_for(ISceneObject* item) const -> std::shared_ptr<ShapeModel>;
   auto item_for(const std::shared_ptr<ShapeModel>& model) const
     -> QGraphicsItem*;
+  auto object_for(const std::shared_ptr<ShapeModel>& model) const
+    -> ISceneObject*;
+  /**
+   * @brief Shapes that currently have a scene item.
+   */
+  auto bound_shapes() const -> std::vector<std::shared_ptr<ShapeModel>>;
+  /**
+   * @brief Stack a bound item right under the item of the next shape in
+   * document order. Items are stacked in the order they were added, so an
+   * item given back to a shape in the middle of the document (e.g. by undo)
+   * would otherwise be drawn on top of everything.
+   */
+  void stack_in_document_order(ISceneObject* item) const;
+  /**
+   * @brief Give an unbound item the geometry, color and material of @p model
+   * without binding it; the item need not be in a scene.
+   */
+  static void apply_shape(ISceneObject* item, const ShapeModel& model);
   void unbind_shape(ISceneObject* item);
   void clear_bindings();
   void cleanup_invalid_bindings();
@@ -53,5 +96,8 @@ class ShapeModelBinder {
   void on_item_geometry_changed(ISceneObject* item);
 
   DocumentModel& document_;
+  GeometryEditHandler geometry_edit_handler_;
   std::unordered_map<ISceneObject*, Binding> bindings_;
+  // Reverse of bindings_ for item_for()
+  std::unordered_map<ModelObject::Id, ISceneObject*> items_;
 };
@@ -2,11 +2,24 @@
 
 #include <QGraphicsItem>
 #include <QGraphicsScene>
+#include <QPainterPath>
 #include <QPointF>
+#include <QRectF>
 #include <QSizeF>
+#include <QTimer>
+#include <algorithm>
+#include <cstdint>
+#include <filesystem>
 #include <memory>
+#include <utility>
+#include <vector>
 
+#include "analysis/AreaFractionCalculator.h"
+#include "analysis/PhaseRasterizer.h"
+#include "analysis/RsaGenerator.h"
+#include "commands/BulkShapeCommands.h"
 #include "commands/CommandManager.h"
+#include "commands/ShapeCommands.h"
 #include "model/DocumentModel.h"
 #include "model/ShapeModel.h"
 #include "model/ShapeSizeConverter.h"
@@ -17,9 +30,11 @@
 #include "scene/items/EllipseItem.h"
 #include "scene/items/RectangleItem.h"
 #include "scene/items/StickItem.h"
+#include "serialization/ChangeJournal.h"
 #include "serialization/ProjectSerializer.h"
 #include "ui/bindings/ShapeModelBinder.h"
 #include "ui/editor/EditorArea.h"
+#include "ui/editor/InclusionLayerItem.h"
 #include "ui/editor/SubstrateItem.h"
 #include "ui/utils/ColorUtils.h"
 
@@ -31,9 +46,26 @@ constexpr int kDefaultSubstrateColorG = 240;
 constexpr int kDefaultSubstrateColorB = 240;
 constexpr int kDefaultSubstrateColorA = 255;
 constexpr double kDefaultCircleRadius = 50.0;
+// Edits outside commands (dragging, the properties panel) reach the journal
+// on this tick
+constexpr int kAutosaveIntervalMs = 5000;
+// The journal is folded into the project file once it outgrows a fraction of
+// it, so the full save is amortized over the journaled edits
+constexpr uint64_t kMinCompactionBytes = 4ULL * 1024 * 1024;
+constexpr uint64_t kCompactionRatio = 4;
+
+std::filesystem::path to_path(const QString& path) {
+  return {path.toStdU16String()};
+}
 }  // namespace
 
-DocumentController::DocumentController(QObject* parent) : QObject(parent) {}
+DocumentController::DocumentController(QObject* parent)
+    : QObject(parent), autosave_timer_(new QTimer(this)) {
+  autosave_timer_->setInterval(kAutosaveIntervalMs);
+  connect(autosave_timer_, &QTimer::timeout, this,
+          &DocumentController::autosave);
+  autosave_timer_->start();
+}
 
 DocumentController::~DocumentController() = default;
 
@@ -43,6 +75,7 @@ void DocumentController::set_document_model(DocumentModel* document) {
 
 void DocumentController::set_shape_binder(ShapeModelBinder* binder) {
   shape_binder_ = binder;
+  install_geometry_edit_handler();
 }
 
 void DocumentController::set_editor_area(EditorArea* editor_area) {
@@ -51,6 +84,39 @@ void DocumentController::set_editor_area(EditorArea* editor_area) {
 
 void DocumentController::set_command_manager(CommandManager* command_manager) {
   command_manager_ = command_manager;
+  if (command_manager_ != nullptr) {
+    command_manager_->set_change_journal(&journal_);
+  }
+  install_geometry_edit_handler();
+}
+
+void DocumentController::install_geometry_edit_handler() {
+  if (shape_binder_ == nullptr) {
+    return;
+  }
+  if (command_manager_ == nullptr) {
+    shape_binder_->set_geometry_edit_handler(nullptr);
+    return;
+  }
+  shape_binder_->set_geometry_edit_handler(
+    [manager = command_manager_](const std::shared_ptr<ShapeModel>& shape,
+                                 const ShapeModelBinder::GeometryEdit& edit) {
+      using Property = ModifyShapePropertyCommand::Property;
+      if (edit.position != shape->position()) {
+        manager->execute_coalesced(ModifyShapePropertyCommand(
+          shape, Property::kPosition, edit.position));
+      }
+      // Items may report any angle; the shape keeps it in [0, 360)
+      if (ShapeModel::normalized_rotation(edit.rotation_deg) !=
+          shape->rotation_deg()) {
+        manager->execute_coalesced(ModifyShapePropertyCommand(
+          shape, Property::kRotation, edit.rotation_deg));
+      }
+      if (edit.size != shape->size()) {
+        manager->execute_coalesced(
+          ModifyShapePropertyCommand(shape, Property::kSize, edit.size));
+      }
+    });
 }
 
 void DocumentController::new_document() {
@@ -62,18 +128,24 @@ void DocumentController::new_document() {
   if (command_manager_ != nullptr) {
     command_manager_->clear();
   }
-
-  document_model_->clear_shapes();
-  document_model_->clear_materials();
-  auto substrate = std::make_shared<SubstrateModel>(
-    Size2D{.width = kDefaultSubstrateWidthPx,
-           .height = kDefaultSubstrateHeightPx},
-    Color{.r = kDefaultSubstrateColorR,
-          .g = kDefaultSubstrateColorG,
-          .b = kDefaultSubstrateColorB,
-          .a = kDefaultSubstrateColorA});
-  substrate->set_name("Substrate");
-  document_model_->set_substrate(substrate);
+  // Unsaved edits of the previous project stay in its journal
+  sync_document_from_scene();
+  journal_.close();
+
+  {
+    const DocumentModel::Batch batch(*document_model_);
+    document_model_->clear_shapes();
+    document_model_->clear_materials();
+    auto substrate = std::make_shared<SubstrateModel>(
+      Size2D{.width = kDefaultSubstrateWidthPx,
+             .height = kDefaultSubstrateHeightPx},
+      Color{.r = kDefaultSubstrateColorR,
+            .g = kDefaultSubstrateColorG,
+            .b = kDefaultSubstrateColorB,
+            .a = kDefaultSubstrateColorA});
+    substrate->set_name("Substrate");
+    document_model_->set_substrate(substrate);
+  }
 
   current_file_path_.clear();
   emit file_path_changed(current_file_path_);
@@ -91,7 +163,10 @@ bool DocumentController::save_document(const QString& file_path) {
   const bool success =
     ProjectSerializer::save_to_file(file_path, document_model_);
   if (success) {
+    // The project file now holds every edit
+    journal_.discard();
     current_file_path_ = file_path;
+    open_journal(0);
     emit file_path_changed(current_file_path_);
   }
   return success;
@@ -102,15 +177,108 @@ bool DocumentController::load_document(const QString& file_path) {
     return false;
   }
 
+  sync_document_from_scene();
+  journal_.commit();
+  const uint64_t journaled = journal_.size_bytes();
+  journal_.close();
   const bool success =
     ProjectSerializer::load_from_file(file_path, document_model_);
-  if (success) {
-    current_file_path_ = file_path;
-    emit file_path_changed(current_file_path_);
-    rebuild_scene_from_document();
-    emit document_changed();
+  if (!success) {
+    open_journal(journaled);  // Still editing the previous project
+    return false;
+  }
+  // Undo brings back the same shape and material objects: commands of the
+  // previous project must not reach the loaded one. Clearing also closes the
+  // open gesture
+  if (command_manager_ != nullptr) {
+    command_manager_->clear();
+  }
+  // Edits journaled after the last save, e.g. before a crash
+  const ChangeJournal::ReplayResult replayed =
+    ChangeJournal::replay(to_path(file_path), *document_model_);
+  recovered_edit_count_ = replayed.frames;
+  current_file_path_ = file_path;
+  open_journal(replayed.end);
+  emit file_path_changed(current_file_path_);
+  rebuild_scene_from_document();
+  emit document_changed();
+  return true;
+}
+
+void DocumentController::open_journal(uint64_t applied_end) {
+  if (document_model_ == nullptr || current_file_path_.isEmpty()) {
+    return;
+  }
+  journal_.open(to_path(current_file_path_), *document_model_, applied_end);
+}
+
+void DocumentController::autosave() {
+  if (!journal_.is_open()) {
+    return;
+  }
+  // The substrate is edited on the scene item
+  sync_document_from_scene();
+  journal_.commit();
+  if (journal_.size_bytes() >
+      std::max(kMinCompactionBytes, journal_.base_size() / kCompactionRatio)) {
+    save_document(current_file_path_);
   }
-  return success;
+}
+
+auto DocumentController::generate_inclusions(const RsaSettings& settings)
+  -> RsaResult {
+  if (document_model_ == nullptr || editor_area_ == nullptr ||
+      shape_binder_ == nullptr || editor_area_->scene() == nullptr) {
+    return {};
+  }
+
+  // The substrate size is edited on the scene item
+  sync_document_from_scene();
+  const auto substrate = document_model_->substrate();
+  const RsaResult result = RsaGenerator(settings).generate(
+    substrate->size(), &document_model_->shape_store());
+
+  // Undoable; the layer draws new shapes by itself
+  run_command(std::make_unique<AddShapesCommand>(
+    document_model_, shape_binder_, editor_area_, result.shapes,
+    layer_ == nullptr));
+  journal_.commit();
+  emit document_changed();
+  return result;
+}
+
+auto DocumentController::material_statistics() -> AreaFractionReport {
+  if (document_model_ == nullptr) {
+    return {};
+  }
+  sync_document_from_scene();
+  return AreaFractionCalculator().compute(*document_model_);
+}
+
+auto DocumentController::rasterize_phase_map(
+  const PhaseRasterSettings& settings) -> PhaseMap {
+  if (document_model_ == nullptr) {
+    return {};
+  }
+  sync_document_from_scene();
+  return PhaseRasterizer(settings).rasterize(*document_model_);
+}
+
+auto DocumentController::export_image(
+  const SceneImageSettings& settings, const std::string& filename,
+  const SceneImageExporter::Progress& progress) -> SceneImageResult {
+  if (document_model_ == nullptr) {
+    return {};
+  }
+  sync_document_from_scene();
+  // Workers read the document while the progress callback runs the event
+  // loop
+  autosave_timer_->stop();
+  const SceneImageResult result =
+    SceneImageExporter(settings, &DocumentController::create_item_for_shape)
+      .export_tiff(*document_model_, filename, progress);
+  autosave_timer_->start();
+  return result;
 }
 
 void DocumentController::rebuild_scene_from_document() {
@@ -125,9 +293,41 @@ void DocumentController::rebuild_scene_from_document() {
   }
 
   shape_binder_->clear_bindings();
+  layer_ = nullptr;  // Deleted with the other items
   clear_scene_except_substrate();
   update_substrate_from_model();
-  create_shapes_in_scene();
+  if (!batched_rendering_) {
+    create_shapes_in_scene();
+    return;
+  }
+  layer_ = new InclusionLayerItem(*document_model_, *shape_binder_,
+                                  &DocumentController::create_item_for_shape);
+  scene->addItem(layer_);
+  // Queued: a selection change may come from inside an item's own mouse
+  // event, or be followed by selecting the proxy just created
+  connect(scene, &QGraphicsScene::selectionChanged, layer_,
+          &InclusionLayerItem::release_unused_proxies, Qt::QueuedConnection);
+}
+
+void DocumentController::set_batched_rendering(bool enabled) {
+  if (batched_rendering_ == enabled) {
+    return;
+  }
+  batched_rendering_ = enabled;
+  // Shape items carry nothing the model lacks except the substrate
+  sync_document_from_scene();
+  rebuild_scene_from_document();
+}
+
+auto DocumentController::scene_item_for(
+  const std::shared_ptr<ShapeModel>& shape) -> ISceneObject* {
+  if (shape == nullptr || shape_binder_ == nullptr) {
+    return nullptr;
+  }
+  if (ISceneObject* item = shape_binder_->object_for(shape)) {
+    return item;
+  }
+  return layer_ != nullptr ? layer_->proxy_for(shape) : nullptr;
 }
 
 void DocumentController::sync_document_from_scene() {
@@ -186,52 +386,105 @@ auto DocumentController::create_item_for_shape(
   return nullptr;
 }
 
-void DocumentController::change_shape_type(ISceneObject* old_item,
+void DocumentController::change_shape_type(ISceneObject* item,
                                            const QString& new_type) {
-  if (old_item == nullptr || editor_area_ == nullptr ||
-      shape_binder_ == nullptr) {
+  if (item == nullptr || document_model_ == nullptr ||
+      editor_area_ == nullptr || shape_binder_ == nullptr) {
     return;
   }
+  run_command(std::make_unique<ChangeShapesTypeCommand>(
+    document_model_, shape_binder_, editor_area_, edit_targets(item),
+    string_to_shape_type(new_type)));
+}
 
-  auto* old_graphics_item = dynamic_cast<QGraphicsItem*>(old_item);
-  if (old_graphics_item == nullptr) {
+void DocumentController::assign_material(
+  ISceneObject* item, const std::shared_ptr<MaterialModel>& material) {
+  if (item == nullptr || document_model_ == nullptr) {
     return;
   }
+  run_command(std::make_unique<AssignShapesMaterialCommand>(
+    document_model_, edit_targets(item), material));
+}
 
-  // Validate item is still in scene
-  if (old_graphics_item->scene() == nullptr) {
+void DocumentController::select_area(const QRectF& rect, bool add) {
+  if (editor_area_ == nullptr || editor_area_->scene() == nullptr) {
     return;
   }
-
-  auto* scene = editor_area_->scene();
-  if (scene == nullptr) {
-    return;
+  if (layer_ != nullptr) {
+    layer_->create_proxies_in(rect);
   }
+  QPainterPath area;
+  area.addRect(rect);
+  // One selection change for the whole area
+  editor_area_->scene()->setSelectionArea(
+    area, add ? Qt::AddToSelection : Qt::ReplaceSelection,
+    Qt::ContainsItemShape);
+}
 
-  auto shape_model = shape_binder_->model_for(old_item);
-  if (shape_model == nullptr) {
+void DocumentController::rotate_items(const QList<QGraphicsItem*>& items,
+                                      qreal delta_deg) {
+  if (document_model_ == nullptr) {
     return;
   }
+  auto command = TransformShapesCommand::rotate(
+    document_model_, shapes_for_items(items), delta_deg);
+  if (command_manager_ != nullptr) {
+    command_manager_->execute_coalesced(std::move(command));
+  } else {
+    command.execute();
+  }
+}
 
-  const ShapeModel::ShapeType target_type = string_to_shape_type(new_type);
-  if (shape_model->type() == target_type) {
+void DocumentController::scale_items(const QList<QGraphicsItem*>& items,
+                                     qreal factor) {
+  if (document_model_ == nullptr) {
     return;
   }
+  auto command = TransformShapesCommand::scale(
+    document_model_, shapes_for_items(items), factor);
+  if (command_manager_ != nullptr) {
+    command_manager_->execute_coalesced(std::move(command));
+  } else {
+    command.execute();
+  }
+}
 
-  // Get current properties before changing type
-  const QPointF old_center = old_graphics_item->sceneBoundingRect().center();
-  const qreal rotation = old_graphics_item->rotation();
-  const QString item_name = old_item->name();
-  const Size2D current_model_size = shape_model->size();
-  const ShapeModel::ShapeType current_type = shape_model->type();
+auto DocumentController::shapes_for_items(
+  const QList<QGraphicsItem*>& items) const
+  -> std::vector<std::shared_ptr<ShapeModel>> {
+  std::vector<std::shared_ptr<ShapeModel>> shapes;
+  if (shape_binder_ == nullptr) {
+    return shapes;
+  }
+  shapes.reserve(static_cast<size_t>(items.size()));
+  for (QGraphicsItem* item : items) {
+    if (auto shape = shape_binder_->model_for(scene_object_cast(item))) {
+      shapes.push_back(std::move(shape));
+    }
+  }
+  return shapes;
+}
 
-  // Convert size and ensure minimum
-  const Size2D new_size =
-    convert_shape_size(current_type, target_type, current_model_size);
-  shape_model->set_type(target_type);
-  shape_model->set_size(new_size);
+auto DocumentController::edit_targets(ISceneObject* item) const
+  -> std::vector<std::shared_ptr<ShapeModel>> {
+  QGraphicsItem* graphics_item = item->graphics_item();
+  if (graphics_item->isSelected() && graphics_item->scene() != nullptr) {
+    return shapes_for_items(graphics_item->scene()->selectedItems());
+  }
+  std::vector<std::shared_ptr<ShapeModel>> shapes;
+  if (auto shape = shape_binder_ != nullptr ? shape_binder_->model_for(item)
+                                            : nullptr) {
+    shapes.push_back(std::move(shape));
+  }
+  return shapes;
+}
 
-  replace_shape_item(old_item, shape_model, old_center, rotation, item_name);
+void DocumentController::run_command(std::unique_ptr<Command> command) {
+  if (command_manager_ != nullptr) {
+    command_manager_->execute(std::move(command));
+  } else {
+    command->execute();
+  }
 }
 
 auto DocumentController::string_to_shape_type(const QString& type)
@@ -370,20 +623,25 @@ void DocumentController::create_shapes_in_scene() {
   }
 
   for (const auto& shape : document_model_->shapes()) {
-    if (!shape) {
-      continue;
-    }
+    add_shape_to_scene(shape);
+  }
+}
 
-    if (auto* scene_obj = create_item_for_shape(shape)) {
-      if (auto* graphics_item = dynamic_cast<QGraphicsItem*>(scene_obj)) {
-        scene_obj->set_name(QString::fromStdString(shape->name()));
-        graphics_item->setPos(shape->position().x, shape->position().y);
-        graphics_item->setRotation(shape->rotation_deg());
-        scene->addItem(graphics_item);
-        shape_binder_->attach_shape(scene_obj, shape);
-      } else {
-        delete scene_obj;
-      }
+void DocumentController::add_shape_to_scene(
+  const std::shared_ptr<ShapeModel>& shape) {
+  if (!shape) {
+    return;
+  }
+  auto* scene = editor_area_->scene();
+  if (auto* scene_obj = create_item_for_shape(shape)) {
+    if (auto* graphics_item = dynamic_cast<QGraphicsItem*>(scene_obj)) {
+      scene_obj->set_name(QString::fromStdString(shape->name()));
+      graphics_item->setPos(shape->position().x, shape->position().y);
+      graphics_item->setRotation(shape->rotation_deg());
+      scene->addItem(graphics_item);
+      shape_binder_->attach_shape(scene_obj, shape);
+    } else {
+      delete scene_obj;
     }
   }
 }
@@ -1,18 +1,33 @@
 #pragma once
 
+#include <QList>
 #include <QObject>
+#include <QRectF>
 #include <QString>
+#include <cstddef>
+#include <cstdint>
 #include <memory>
+#include <string>
+#include <vector>
 
+#include "analysis/AreaFractionCalculator.h"
+#include "analysis/PhaseRasterizer.h"
+#include "analysis/RsaGenerator.h"
 #include "model/ShapeModel.h"
 #include "model/core/ModelTypes.h"
+#include "serialization/ChangeJournal.h"
+#include "ui/editor/SceneImageExporter.h"
 
+class Command;
 class DocumentModel;
+class MaterialModel;
 class ShapeModelBinder;
 class EditorArea;
+class InclusionLayerItem;
 class ISceneObject;
 class QGraphicsItem;
 class QGraphicsScene;
+class QTimer;
 class SubstrateItem;
 class ShapeModel;
 class CommandManager;
@@ -49,15 +64,86 @@ class DocumentController : public QObject {
   void set_current_file_path(const QString& path) {
     current_file_path_ = path;
   }
+  /**
+   * @brief Number of journal frames (unsaved edits from an earlier session)
+   * replayed by the last successful load_document().
+   */
+  size_t recovered_edit_count() const {
+    return recovered_edit_count_;
+  }
+
+  /**
+   * @brief Fill the substrate with generated inclusions (random sequential
+   * adsorption) around the existing shapes and add them to the scene, as
+   * one undoable command.
+   */
+  auto generate_inclusions(const RsaSettings& settings) -> RsaResult;
+
+  /**
+   * @brief Area fraction and interface length of every material phase of the
+   * current scene state.
+   */
+  auto material_statistics() -> AreaFractionReport;
+
+  /**
+   * @brief Material-id image of the current scene state.
+   */
+  auto rasterize_phase_map(const PhaseRasterSettings& settings) -> PhaseMap;
+
+  /**
+   * @brief Render the current scene state into a tiled TIFF on worker
+   * threads; autosave is paused until the export returns.
+   */
+  auto export_image(const SceneImageSettings& settings,
+                    const std::string& filename,
+                    const SceneImageExporter::Progress& progress)
+    -> SceneImageResult;
 
   // Scene synchronization
   void rebuild_scene_from_document();
   void sync_document_from_scene();
+  /**
+   * @brief Draw the inclusions through one InclusionLayerItem instead of one
+   * scene item per shape, and rebuild the scene accordingly.
+   */
+  void set_batched_rendering(bool enabled);
+  bool batched_rendering() const {
+    return batched_rendering_;
+  }
+  /**
+   * @brief Scene item of a shape; with batched rendering a proxy item is
+   * created for shapes that have none.
+   */
+  auto scene_item_for(const std::shared_ptr<ShapeModel>& shape)
+    -> ISceneObject*;
 
   // Shape operations
   static auto create_item_for_shape(const std::shared_ptr<ShapeModel>& shape)
     -> ISceneObject*;
-  void change_shape_type(ISceneObject* old_item, const QString& new_type);
+  /**
+   * @brief Change the type of @p item's shape, and of every other selected
+   * shape when @p item is selected, as one undoable command.
+   */
+  void change_shape_type(ISceneObject* item, const QString& new_type);
+  /**
+   * @brief Give @p item's shape, and every other selected shape when @p item
+   * is selected, a preset material (nullptr: their own custom material) as
+   * one undoable command.
+   */
+  void assign_material(ISceneObject* item,
+                       const std::shared_ptr<MaterialModel>& material);
+  /**
+   * @brief Rotate or scale the shapes of @p items about their centers in one
+   * pass; consecutive steps on the same shapes are one undoable command.
+   */
+  void rotate_items(const QList<QGraphicsItem*>& items, qreal delta_deg);
+  void scale_items(const QList<QGraphicsItem*>& items, qreal factor);
+  /**
+   * @brief Select the items inside @p rect (scene coordinates), replacing
+   * the selection unless @p add. With batched rendering the layer first
+   * gives the shapes in the area a proxy item.
+   */
+  void select_area(const QRectF& rect, bool add);
   void replace_shape_item(ISceneObject* old_item,
                           const std::shared_ptr<ShapeModel>& model,
                           const QPointF& center_position, qreal rotation,
@@ -92,10 +178,30 @@ class DocumentController : public QObject {
   void clear_scene_except_substrate();
   void update_substrate_from_model();
   void create_shapes_in_scene();
+  void add_shape_to_scene(const std::shared_ptr<ShapeModel>& shape);
+  // applied_end: journal bytes the document holds (ChangeJournal::open())
+  void open_journal(uint64_t applied_end);
+  void autosave();
+  // Record item drags and spin box edits as coalesced undoable commands
+  void install_geometry_edit_handler();
+  auto shapes_for_items(const QList<QGraphicsItem*>& items) const
+    -> std::vector<std::shared_ptr<ShapeModel>>;
+  // Shapes an edit of item applies to: the selection if item is part of it
+  auto edit_targets(ISceneObject* item) const
+    -> std::vector<std::shared_ptr<ShapeModel>>;
+  // Through the command manager if there is one
+  void run_command(std::unique_ptr<Command> command);
 
   DocumentModel* document_model_{nullptr};
   ShapeModelBinder* shape_binder_{nullptr};
   EditorArea* editor_area_{nullptr};
   CommandManager* command_manager_{nullptr};
   QString current_file_path_;
+  // Edits since the project file was written, next to the project file
+  ChangeJournal journal_;
+  QTimer* autosave_timer_{nullptr};
+  size_t recovered_edit_count_{0};
+  bool batched_rendering_{false};
+  // Owned by the scene; set while batched rendering is on
+  InclusionLayerItem* layer_{nullptr};
 };
@@ -30,7 +30,7 @@ auto EditorArea::scene() const -> QGraphicsScene* {
 
 void EditorArea::init_scene() {
   scene_ = new QGraphicsScene(this);
-  view_->setScene(scene_);
+  view_->attachScene(scene_);
 
   substrate_ =
     new SubstrateItem(QSizeF(kDefaultSubstrateWidth, kDefaultSubstrateHeight));
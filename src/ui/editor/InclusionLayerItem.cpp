@@ -0,0 +1,495 @@
+#include "ui/editor/InclusionLayerItem.h"
+
+#include <QBrush>
+#include <QGraphicsScene>
+#include <QGraphicsSceneHoverEvent>
+#include <QPainter>
+#include <QPen>
+#include <QStyleOptionGraphicsItem>
+#include <QTransform>
+#include <algorithm>
+#include <cmath>
+#include <numbers>
+#include <utility>
+
+#include "model/ShapeGeometry.h"
+#include "model/ShapeSizeConverter.h"
+#include "model/ShapeStore.h"
+#include "scene/ISceneObject.h"
+#include "scene/items/LevelOfDetail.h"
+#include "scene/items/StaticLayer.h"
+#include "ui/bindings/ShapeModelBinder.h"
+#include "ui/utils/ColorUtils.h"
+
+namespace {
+// Between the substrate (-100) and the shape items (0)
+constexpr qreal kLayerZValue = -1.0;
+// Outline of full-detail shapes, as the shape items draw it
+constexpr qreal kOutlineWidth = 1.0;
+// Below this fraction of the layer, culling goes through the spatial index
+// instead of a linear pass over the columns
+constexpr double kIndexedCullFraction = 0.25;
+// Changes of more rows than this repaint the whole layer without checking
+// which of them have items
+constexpr size_t kMaxCheckedChangedRows = 64;
+// Released proxies kept hidden in the scene for reuse
+constexpr size_t kMaxSpareProxies = 8;
+constexpr double kHalf = 0.5;
+constexpr double kRadiansToDegrees = 180.0 / std::numbers::pi;
+
+QRectF to_qrect(const Aabb& box) {
+  return {QPointF(box.min_x, box.min_y), QPointF(box.max_x, box.max_y)};
+}
+
+ISceneObject::Kind item_kind(ShapeModel::ShapeType type) {
+  switch (type) {
+    case ShapeModel::ShapeType::Ellipse:
+      return ISceneObject::Kind::Ellipse;
+    case ShapeModel::ShapeType::Circle:
+      return ISceneObject::Kind::Circle;
+    case ShapeModel::ShapeType::Stick:
+      return ISceneObject::Kind::Stick;
+    case ShapeModel::ShapeType::Rectangle:
+      break;
+  }
+  return ISceneObject::Kind::Rectangle;
+}
+
+QRectF shape_rect(const ShapeModel& shape) {
+  return to_qrect(ShapeGeometry::bounds(ShapeGeometry::make_frame(
+    static_cast<uint8_t>(shape.type()), shape.position(), shape.size(),
+    shape.rotation_deg())));
+}
+}  // namespace
+
+void InclusionLayerItem::Batch::clear() {
+  points.clear();
+  lines.clear();
+  rects.clear();
+  ellipses.clear();
+  polygons.clear();
+  rotated_ellipses.clear();
+  runs.clear();
+}
+
+void InclusionLayerItem::Batch::add(QRgb color, Primitive primitive,
+                                    bool outlined, size_t index) {
+  if (!runs.empty()) {
+    Run& last = runs.back();
+    if (last.color == color && last.primitive == primitive &&
+        last.outlined == outlined && last.end == index) {
+      ++last.end;
+      return;
+    }
+  }
+  runs.push_back(Run{.color = color,
+                     .primitive = primitive,
+                     .outlined = outlined,
+                     .begin = index,
+                     .end = index + 1});
+}
+
+InclusionLayerItem::InclusionLayerItem(DocumentModel& document,
+                                       ShapeModelBinder& binder,
+                                       ItemFactory item_factory)
+    : document_(document),
+      binder_(binder),
+      item_factory_(std::move(item_factory)) {
+  setZValue(kLayerZValue);
+  setFlag(QGraphicsItem::ItemUsesExtendedStyleOption, true);
+  // Clicks reach the proxies, the substrate and the view's area selection
+  setAcceptedMouseButtons(Qt::NoButton);
+  setAcceptHoverEvents(true);
+  changes_connection_ = document_.on_changes().connect(
+    [this](std::span<const DocumentModel::Edit> edits) {
+      on_document_changes(edits);
+    });
+}
+
+InclusionLayerItem::~InclusionLayerItem() {
+  // Proxies are scene items of their own; the scene deletes them
+  document_.on_changes().disconnect(changes_connection_);
+}
+
+auto InclusionLayerItem::boundingRect() const -> QRectF {
+  if (!bounds_valid_) {
+    const ShapeStore& store = document_.shape_store();
+    Aabb total;
+    for (size_t row = 0; row < store.size(); ++row) {
+      const Aabb box =
+        ShapeGeometry::bounds(ShapeGeometry::make_frame(store, row));
+      if (row == 0) {
+        total = box;
+        continue;
+      }
+      total.min_x = std::min(total.min_x, box.min_x);
+      total.min_y = std::min(total.min_y, box.min_y);
+      total.max_x = std::max(total.max_x, box.max_x);
+      total.max_y = std::max(total.max_y, box.max_y);
+    }
+    bounds_ = store.empty() ? QRectF()
+                            : to_qrect(total).adjusted(
+                                -kOutlineWidth, -kOutlineWidth, kOutlineWidth,
+                                kOutlineWidth);
+    bounds_valid_ = true;
+  }
+  return bounds_;
+}
+
+void InclusionLayerItem::paint(QPainter* painter,
+                               const QStyleOptionGraphicsItem* option,
+                               QWidget* widget) {
+  const ShapeStore& store = document_.shape_store();
+  if (store.empty() || skip_paint(*this, widget)) {
+    return;
+  }
+  const qreal lod = QStyleOptionGraphicsItem::levelOfDetailFromTransform(
+    painter->worldTransform());
+  const QRectF exposed = option->exposedRect;
+  const Aabb view{.min_x = exposed.left(),
+                  .min_y = exposed.top(),
+                  .max_x = exposed.right(),
+                  .max_y = exposed.bottom()};
+
+  // Shapes with their own item are drawn by it
+  skip_rows_.resize(store.size(), 0);
+  bound_rows_.clear();
+  for (const auto& shape : binder_.bound_shapes()) {
+    const size_t row = document_.row_of(*shape);
+    if (row != ShapeStore::kInvalidRow) {
+      skip_rows_[row] = 1;
+      bound_rows_.push_back(row);
+    }
+  }
+  material_colors_.clear();
+  for (const auto& material : document_.materials()) {
+    material_colors_.push_back(to_qcolor(material->color()).rgba());
+  }
+  batch_.clear();
+
+  const QRectF layer = boundingRect();
+  const double layer_area = layer.width() * layer.height();
+  if (exposed.width() * exposed.height() < kIndexedCullFraction * layer_area) {
+    // The index returns its own order; stacking follows the rows
+    visible_rows_.clear();
+    for (const auto handle : document_.spatial_index().query_box(view)) {
+      const size_t row = store.row_of(handle);
+      if (row != ShapeStore::kInvalidRow && skip_rows_[row] == 0) {
+        visible_rows_.push_back(row);
+      }
+    }
+    std::ranges::sort(visible_rows_);
+    for (const size_t row : visible_rows_) {
+      batch_row(row, lod, nullptr);
+    }
+  } else {
+    for (size_t row = 0; row < store.size(); ++row) {
+      if (skip_rows_[row] == 0) {
+        batch_row(row, lod, &view);
+      }
+    }
+  }
+  draw_batch(painter);
+
+  for (const size_t row : bound_rows_) {
+    skip_rows_[row] = 0;
+  }
+}
+
+void InclusionLayerItem::batch_row(size_t row, qreal lod, const Aabb* cull) {
+  const ShapeFrame frame =
+    ShapeGeometry::make_frame(document_.shape_store(), row);
+  if (cull != nullptr && !ShapeGeometry::bounds(frame).intersects(*cull)) {
+    return;
+  }
+  const QRgb color = color_of(row);
+  const QPointF center(frame.center.x, frame.center.y);
+  const double screen_extent =
+    2.0 * std::max(frame.half_width, frame.half_height) * lod;
+  if (screen_extent < 1.0) {
+    batch_.points.push_back(center);
+    batch_.add(color, Primitive::kPoint, false, batch_.points.size() - 1);
+    return;
+  }
+  const QPointF axis_x(frame.half_width * frame.cos_a,
+                       frame.half_width * frame.sin_a);
+  if (static_cast<ShapeModel::ShapeType>(frame.type) ==
+      ShapeModel::ShapeType::Stick) {
+    batch_.lines.emplace_back(center - axis_x, center + axis_x);
+    batch_.add(color, Primitive::kLine, false, batch_.lines.size() - 1);
+    return;
+  }
+
+  const bool outlined =
+    screen_extent >= level_of_detail().min_outline_item_px;
+  const bool rotated = frame.sin_a != 0.0;
+  const QRectF rect(center.x() - frame.half_width,
+                    center.y() - frame.half_height, 2.0 * frame.half_width,
+                    2.0 * frame.half_height);
+  if (frame.is_elliptic()) {
+    if (rotated) {
+      batch_.rotated_ellipses.push_back(RotatedEllipse{
+        .center = center,
+        .half_width = frame.half_width,
+        .half_height = frame.half_height,
+        .rotation_deg = std::atan2(frame.sin_a, frame.cos_a) *
+                        kRadiansToDegrees});
+      batch_.add(color, Primitive::kRotatedEllipse, outlined,
+                 batch_.rotated_ellipses.size() - 1);
+    } else {
+      batch_.ellipses.push_back(rect);
+      batch_.add(color, Primitive::kEllipse, outlined,
+                 batch_.ellipses.size() - 1);
+    }
+  } else if (rotated) {
+    const QPointF axis_y(-frame.half_height * frame.sin_a,
+                         frame.half_height * frame.cos_a);
+    batch_.polygons.push_back(
+      QPolygonF{center - axis_x - axis_y, center + axis_x - axis_y,
+                center + axis_x + axis_y, center - axis_x + axis_y});
+    batch_.add(color, Primitive::kPolygon, outlined,
+               batch_.polygons.size() - 1);
+  } else {
+    batch_.rects.push_back(rect);
+    batch_.add(color, Primitive::kRect, outlined, batch_.rects.size() - 1);
+  }
+}
+
+void InclusionLayerItem::draw_batch(QPainter* painter) const {
+  const QPen outline_pen(Qt::black, kOutlineWidth);
+  const QTransform base_transform = painter->worldTransform();
+  painter->save();
+  for (const Run& run : batch_.runs) {
+    const QColor color = QColor::fromRgba(run.color);
+    const int count = static_cast<int>(run.end - run.begin);
+    painter->setBrush(color);
+    painter->setPen(run.outlined ? outline_pen : QPen(Qt::NoPen));
+    switch (run.primitive) {
+      case Primitive::kPoint:
+        // Cosmetic pen: one device pixel per shape
+        painter->setPen(QPen(color, 0.0));
+        painter->drawPoints(batch_.points.data() + run.begin, count);
+        break;
+      case Primitive::kLine:
+        painter->setPen(QPen(color, ShapeConstants::kStickThickness));
+        painter->drawLines(batch_.lines.data() + run.begin, count);
+        break;
+      case Primitive::kRect:
+        painter->drawRects(batch_.rects.data() + run.begin, count);
+        break;
+      case Primitive::kEllipse:
+        for (size_t i = run.begin; i < run.end; ++i) {
+          painter->drawEllipse(batch_.ellipses[i]);
+        }
+        break;
+      case Primitive::kPolygon:
+        for (size_t i = run.begin; i < run.end; ++i) {
+          painter->drawPolygon(batch_.polygons[i]);
+        }
+        break;
+      case Primitive::kRotatedEllipse:
+        for (size_t i = run.begin; i < run.end; ++i) {
+          const RotatedEllipse& ellipse = batch_.rotated_ellipses[i];
+          QTransform transform = base_transform;
+          transform.translate(ellipse.center.x(), ellipse.center.y());
+          transform.rotate(ellipse.rotation_deg);
+          painter->setWorldTransform(transform);
+          painter->drawEllipse(QPointF(0.0, 0.0), ellipse.half_width,
+                               ellipse.half_height);
+        }
+        painter->setWorldTransform(base_transform);
+        break;
+    }
+  }
+  painter->restore();
+}
+
+auto InclusionLayerItem::color_of(size_t row) const -> QRgb {
+  const int32_t material = document_.shape_store().material_indices()[row];
+  if (material >= 0 &&
+      static_cast<size_t>(material) < material_colors_.size()) {
+    return material_colors_[static_cast<size_t>(material)];
+  }
+  return to_qcolor(document_.shapes()[row]->custom_color()).rgba();
+}
+
+void InclusionLayerItem::on_document_changes(
+  std::span<const DocumentModel::Edit> edits) {
+  bool repaint = false;
+  for (const auto& edit : edits) {
+    switch (edit.kind) {
+      case DocumentModel::Edit::Kind::ShapesAdded:
+      case DocumentModel::Edit::Kind::ShapesRemoved:
+      case DocumentModel::Edit::Kind::ShapesCleared:
+        invalidate_bounds();
+        repaint = true;
+        break;
+      case DocumentModel::Edit::Kind::ShapesChanged: {
+        // Shapes with an item (e.g. a proxy being dragged) are not drawn here
+        const auto& shapes = document_.shapes();
+        bool drawn_here = edit.count > kMaxCheckedChangedRows;
+        for (size_t row = edit.index;
+             !drawn_here && row < edit.index + edit.count &&
+             row < shapes.size();
+             ++row) {
+          drawn_here = binder_.object_for(shapes[row]) == nullptr;
+        }
+        if (drawn_here) {
+          invalidate_bounds();
+          repaint = true;
+        }
+        break;
+      }
+      case DocumentModel::Edit::Kind::MaterialsAdded:
+      case DocumentModel::Edit::Kind::MaterialsRemoved:
+      case DocumentModel::Edit::Kind::MaterialsChanged:
+      case DocumentModel::Edit::Kind::MaterialsCleared:
+        repaint = true;
+        break;
+      case DocumentModel::Edit::Kind::SubstrateChanged:
+        break;
+    }
+  }
+  if (repaint) {
+    update();
+  }
+}
+
+void InclusionLayerItem::invalidate_bounds() {
+  if (bounds_valid_) {
+    prepareGeometryChange();
+    bounds_valid_ = false;
+  }
+}
+
+auto InclusionLayerItem::proxy_for(const std::shared_ptr<ShapeModel>& shape)
+  -> ISceneObject* {
+  if (shape == nullptr) {
+    return nullptr;
+  }
+  if (ISceneObject* item = binder_.object_for(shape)) {
+    return item;
+  }
+  return create_proxy(shape);
+}
+
+auto InclusionLayerItem::create_proxy(const std::shared_ptr<ShapeModel>& shape)
+  -> ISceneObject* {
+  if (scene() == nullptr ||
+      document_.row_of(*shape) == ShapeStore::kInvalidRow) {
+    return nullptr;
+  }
+  ISceneObject* proxy = take_spare_proxy(item_kind(shape->type()));
+  if (proxy == nullptr) {
+    proxy = item_factory_(shape);
+    if (proxy == nullptr) {
+      return nullptr;
+    }
+    QGraphicsItem* item = proxy->graphics_item();
+    item->setPos(shape->position().x, shape->position().y);
+    item->setRotation(shape->rotation_deg());
+    scene()->addItem(item);
+  }
+  proxy->set_name(QString::fromStdString(shape->name()));
+  // Applies the shape's geometry, color and material to the item
+  binder_.attach_shape(proxy, shape);
+  proxy->graphics_item()->show();
+  proxies_[shape->id()] = proxy;
+  // The layer stops drawing the shape
+  update(shape_rect(*shape));
+  return proxy;
+}
+
+bool InclusionLayerItem::proxy_alive(ModelObject::Id id,
+                                     ISceneObject* proxy) const {
+  const auto shape = document_.find_shape(id);
+  return shape != nullptr && binder_.object_for(shape) == proxy;
+}
+
+void InclusionLayerItem::release_proxy(ModelObject::Id id,
+                                       ISceneObject* proxy) {
+  const auto shape = document_.find_shape(id);
+  binder_.unbind_shape(proxy);
+  QGraphicsItem* item = proxy->graphics_item();
+  if (spare_proxies_.size() < kMaxSpareProxies && item->scene() != nullptr) {
+    // Hidden rather than removed: a removal repaints the whole scene once
+    // anything listens to QGraphicsScene::changed (the view's tile cache)
+    item->hide();
+    proxy->set_material_model(nullptr);
+    spare_proxies_.push_back(proxy);
+  } else {
+    if (item->scene() != nullptr) {
+      item->scene()->removeItem(item);
+    }
+    delete item;
+  }
+  // The shape may have moved while it had its own item
+  invalidate_bounds();
+  if (shape != nullptr) {
+    update(shape_rect(*shape));
+  }
+}
+
+auto InclusionLayerItem::take_spare_proxy(ISceneObject::Kind kind)
+  -> ISceneObject* {
+  const auto spare = std::ranges::find_if(
+    spare_proxies_,
+    [kind](const ISceneObject* proxy) { return proxy->kind() == kind; });
+  if (spare == spare_proxies_.end()) {
+    return nullptr;
+  }
+  ISceneObject* proxy = *spare;
+  spare_proxies_.erase(spare);
+  return proxy;
+}
+
+void InclusionLayerItem::create_proxies_in(const QRectF& rect) {
+  const Aabb area{.min_x = rect.left(),
+                  .min_y = rect.top(),
+                  .max_x = rect.right(),
+                  .max_y = rect.bottom()};
+  for (const auto& shape : document_.shapes_in_rect(area)) {
+    if (binder_.object_for(shape) == nullptr &&
+        rect.contains(shape_rect(*shape))) {
+      create_proxy(shape);
+    }
+  }
+}
+
+void InclusionLayerItem::release_unused_proxies() {
+  for (auto iterator = proxies_.begin(); iterator != proxies_.end();) {
+    const auto [id, proxy] = *iterator;
+    if (!proxy_alive(id, proxy)) {
+      // Replaced or deleted by someone else; not ours to delete any more
+      iterator = proxies_.erase(iterator);
+      continue;
+    }
+    if (id == hovered_ || proxy->graphics_item()->isSelected()) {
+      ++iterator;
+      continue;
+    }
+    iterator = proxies_.erase(iterator);
+    release_proxy(id, proxy);
+  }
+}
+
+void InclusionLayerItem::hoverMoveEvent(QGraphicsSceneHoverEvent* event) {
+  const QPointF point = event->pos();
+  const auto shape =
+    document_.shape_at(Point2D{.x = point.x(), .y = point.y()});
+  const ModelObject::Id hovered = shape != nullptr ? shape->id() : 0;
+  if (hovered == hovered_) {
+    return;
+  }
+  hovered_ = hovered;
+  if (shape != nullptr && binder_.object_for(shape) == nullptr) {
+    create_proxy(shape);
+  }
+  release_unused_proxies();
+}
+
+void InclusionLayerItem::hoverLeaveEvent(QGraphicsSceneHoverEvent* event) {
+  QGraphicsObject::hoverLeaveEvent(event);
+  hovered_ = 0;
+  release_unused_proxies();
+}
@@ -0,0 +1,153 @@
+#pragma once
+
+#include <QColor>
+#include <QGraphicsObject>
+#include <QLineF>
+#include <QPointF>
+#include <QPolygonF>
+#include <QRectF>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+#include "model/DocumentModel.h"
+#include "model/ShapeModel.h"
+#include "model/core/ModelObject.h"
+#include "scene/ISceneObject.h"
+
+class ShapeModelBinder;
+
+/**
+ * @brief One scene item that draws every inclusion of the document straight
+ * from its columns, for scenes too large for one QGraphicsItem per shape.
+ *
+ * paint() culls the exposed area (through the document's spatial index when
+ * it covers a small part of the layer) and draws the visible shapes in
+ * document order, so overlapping inclusions stack as their items would.
+ * Consecutive shapes of the same color and primitive form a run drawn with
+ * one call: drawRects, drawLines and drawPoints for shapes below a pixel.
+ * Material grids are not drawn by the layer.
+ *
+ * Shapes the user interacts with get a regular editable item (a proxy) on
+ * top, created on hover or area selection and kept while selected, and
+ * bound through ShapeModelBinder. The layer skips every shape that has a
+ * bound item.
+ */
+class InclusionLayerItem : public QGraphicsObject {
+  Q_OBJECT
+
+ public:
+  using ItemFactory =
+    std::function<ISceneObject*(const std::shared_ptr<ShapeModel>&)>;
+
+  /**
+   * @param item_factory Creates the proxy item for a shape (not yet in a
+   * scene or bound).
+   */
+  InclusionLayerItem(DocumentModel& document, ShapeModelBinder& binder,
+                     ItemFactory item_factory);
+  ~InclusionLayerItem() override;
+
+  auto boundingRect() const -> QRectF override;
+  void paint(QPainter* painter, const QStyleOptionGraphicsItem* option,
+             QWidget* widget) override;
+
+  /**
+   * @brief Scene item of a shape, creating a proxy if it has none.
+   */
+  auto proxy_for(const std::shared_ptr<ShapeModel>& shape) -> ISceneObject*;
+
+  /**
+   * @brief Give every shape inside @p rect (scene coordinates) a proxy, found
+   * through the document's spatial index, so that an area selection of the
+   * scene items reaches them.
+   */
+  void create_proxies_in(const QRectF& rect);
+
+  /**
+   * @brief Remove proxies that are neither selected nor hovered; the layer
+   * draws their shapes again. Connected (queued) to the scene's
+   * selectionChanged.
+   */
+  void release_unused_proxies();
+
+ protected:
+  void hoverMoveEvent(QGraphicsSceneHoverEvent* event) override;
+  void hoverLeaveEvent(QGraphicsSceneHoverEvent* event) override;
+
+ private:
+  struct RotatedEllipse {
+    QPointF center;
+    qreal half_width{0.0};
+    qreal half_height{0.0};
+    qreal rotation_deg{0.0};
+  };
+  enum class Primitive : uint8_t {
+    kPoint,
+    kLine,
+    kRect,
+    kEllipse,
+    kPolygon,
+    kRotatedEllipse
+  };
+  // Consecutive shapes drawn alike: [begin, end) of the primitive's list.
+  // Fill-only shapes (too small for an outline) are not outlined.
+  struct Run {
+    QRgb color{0};
+    Primitive primitive{Primitive::kPoint};
+    bool outlined{false};
+    size_t begin{0};
+    size_t end{0};
+  };
+  // Visible shapes of one paint, in document order
+  struct Batch {
+    std::vector<QPointF> points;
+    std::vector<QLineF> lines;
+    std::vector<QRectF> rects;
+    std::vector<QRectF> ellipses;
+    std::vector<QPolygonF> polygons;
+    std::vector<RotatedEllipse> rotated_ellipses;
+    std::vector<Run> runs;
+
+    void clear();
+    // Extend the last run by the element just appended at @p index, or start
+    // a new run
+    void add(QRgb color, Primitive primitive, bool outlined, size_t index);
+  };
+
+  void on_document_changes(std::span<const DocumentModel::Edit> edits);
+  void invalidate_bounds();
+  void batch_row(size_t row, qreal lod, const Aabb* cull);
+  void draw_batch(QPainter* painter) const;
+  auto color_of(size_t row) const -> QRgb;
+  auto create_proxy(const std::shared_ptr<ShapeModel>& shape)
+    -> ISceneObject*;
+  // Proxy still bound to its shape (commands may have replaced or deleted it)
+  bool proxy_alive(ModelObject::Id id, ISceneObject* proxy) const;
+  void release_proxy(ModelObject::Id id, ISceneObject* proxy);
+  auto take_spare_proxy(ISceneObject::Kind kind) -> ISceneObject*;
+
+  DocumentModel& document_;
+  ShapeModelBinder& binder_;
+  ItemFactory item_factory_;
+  int changes_connection_{-1};
+
+  mutable QRectF bounds_;
+  mutable bool bounds_valid_{false};
+
+  std::unordered_map<ModelObject::Id, ISceneObject*> proxies_;
+  ModelObject::Id hovered_{0};  // 0: no shape under the cursor
+  // Released proxies, hidden and unbound, reused by create_proxy()
+  std::vector<ISceneObject*> spare_proxies_;
+
+  // Paint scratch, kept between paints to reuse the allocations
+  Batch batch_;
+  std::vector<size_t> visible_rows_;
+  std::vector<uint8_t> skip_rows_;
+  std::vector<size_t> bound_rows_;
+  std::vector<QRgb> material_colors_;
+};
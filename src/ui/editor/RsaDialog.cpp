@@ -0,0 +1,146 @@
+#include "RsaDialog.h"
+
+#include <QCheckBox>
+#include <QComboBox>
+#include <QDialogButtonBox>
+#include <QDoubleSpinBox>
+#include <QFormLayout>
+#include <QHBoxLayout>
+#include <QSpinBox>
+#include <QVBoxLayout>
+#include <cstdint>
+
+#include "analysis/Distribution.h"
+#include "model/ShapeModel.h"
+
+namespace {
+constexpr double kMinSizePx = 1.0;
+constexpr double kMaxSizePx = 10000.0;
+constexpr double kDefaultSizeFirstPx = 20.0;
+constexpr double kDefaultSizeSecondPx = 40.0;
+constexpr double kMinAspect = 0.01;
+constexpr double kMaxAspect = 100.0;
+constexpr double kAspectStep = 0.1;
+constexpr double kDefaultFractionPercent = 30.0;
+constexpr double kMaxFractionPercent = 90.0;
+constexpr double kPercent = 100.0;
+constexpr double kMaxGapPx = 1000.0;
+constexpr int kMaxSeed = 1000000000;
+constexpr int kSizeDecimals = 1;
+
+enum SizeLaw { kUniformLaw = 0, kNormalLaw = 1, kLogNormalLaw = 2 };
+}  // namespace
+
+RsaDialog::RsaDialog(QWidget* parent)
+    : QDialog(parent),
+      circle_check_(new QCheckBox("Circle", this)),
+      ellipse_check_(new QCheckBox("Ellipse", this)),
+      rectangle_check_(new QCheckBox("Rectangle", this)),
+      stick_check_(new QCheckBox("Stick", this)),
+      size_law_combo_(new QComboBox(this)),
+      size_first_spin_(new QDoubleSpinBox(this)),
+      size_second_spin_(new QDoubleSpinBox(this)),
+      aspect_min_spin_(new QDoubleSpinBox(this)),
+      aspect_max_spin_(new QDoubleSpinBox(this)),
+      fraction_spin_(new QDoubleSpinBox(this)),
+      gap_spin_(new QDoubleSpinBox(this)),
+      seed_spin_(new QSpinBox(this)) {
+  setWindowTitle("Generate Inclusions");
+
+  circle_check_->setChecked(true);
+  auto* types_layout = new QHBoxLayout();
+  types_layout->addWidget(circle_check_);
+  types_layout->addWidget(ellipse_check_);
+  types_layout->addWidget(rectangle_check_);
+  types_layout->addWidget(stick_check_);
+
+  size_law_combo_->addItem("Uniform (min, max)");
+  size_law_combo_->addItem("Normal (mean, std. dev.)");
+  size_law_combo_->addItem("Log-normal (mean, std. dev.)");
+  for (auto* spin : {size_first_spin_, size_second_spin_}) {
+    spin->setRange(kMinSizePx, kMaxSizePx);
+    spin->setDecimals(kSizeDecimals);
+  }
+  size_first_spin_->setValue(kDefaultSizeFirstPx);
+  size_second_spin_->setValue(kDefaultSizeSecondPx);
+  auto* size_layout = new QHBoxLayout();
+  size_layout->addWidget(size_first_spin_);
+  size_layout->addWidget(size_second_spin_);
+
+  for (auto* spin : {aspect_min_spin_, aspect_max_spin_}) {
+    spin->setRange(kMinAspect, kMaxAspect);
+    spin->setSingleStep(kAspectStep);
+    spin->setDecimals(2);
+    spin->setValue(1.0);
+  }
+  auto* aspect_layout = new QHBoxLayout();
+  aspect_layout->addWidget(aspect_min_spin_);
+  aspect_layout->addWidget(aspect_max_spin_);
+
+  fraction_spin_->setRange(0.0, kMaxFractionPercent);
+  fraction_spin_->setSuffix(" %");
+  fraction_spin_->setValue(kDefaultFractionPercent);
+
+  gap_spin_->setRange(0.0, kMaxGapPx);
+  gap_spin_->setDecimals(kSizeDecimals);
+  gap_spin_->setSuffix(" px");
+
+  seed_spin_->setRange(0, kMaxSeed);
+  seed_spin_->setSpecialValueText("Random");
+
+  auto* form = new QFormLayout();
+  form->addRow("Shapes", types_layout);
+  form->addRow("Size law", size_law_combo_);
+  form->addRow("Size (px)", size_layout);
+  form->addRow("Aspect ratio (h/w)", aspect_layout);
+  form->addRow("Target area fraction", fraction_spin_);
+  form->addRow("Minimum gap", gap_spin_);
+  form->addRow("Seed", seed_spin_);
+
+  auto* buttons =
+    new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel, this);
+  connect(buttons, &QDialogButtonBox::accepted, this, &QDialog::accept);
+  connect(buttons, &QDialogButtonBox::rejected, this, &QDialog::reject);
+
+  auto* layout = new QVBoxLayout(this);
+  layout->addLayout(form);
+  layout->addWidget(buttons);
+}
+
+auto RsaDialog::settings() const -> RsaSettings {
+  RsaSettings settings;
+  settings.shape_types.clear();
+  if (circle_check_->isChecked()) {
+    settings.shape_types.push_back(ShapeModel::ShapeType::Circle);
+  }
+  if (ellipse_check_->isChecked()) {
+    settings.shape_types.push_back(ShapeModel::ShapeType::Ellipse);
+  }
+  if (rectangle_check_->isChecked()) {
+    settings.shape_types.push_back(ShapeModel::ShapeType::Rectangle);
+  }
+  if (stick_check_->isChecked()) {
+    settings.shape_types.push_back(ShapeModel::ShapeType::Stick);
+  }
+
+  const double first = size_first_spin_->value();
+  const double second = size_second_spin_->value();
+  switch (size_law_combo_->currentIndex()) {
+    case kNormalLaw:
+      settings.size = Distribution::normal(first, second);
+      break;
+    case kLogNormalLaw:
+      settings.size = Distribution::log_normal(first, second);
+      break;
+    case kUniformLaw:
+    default:
+      settings.size = Distribution::uniform(first, second);
+      break;
+  }
+  settings.aspect_ratio =
+    Distribution::uniform(aspect_min_spin_->value(), aspect_max_spin_->value());
+  settings.target_fraction = fraction_spin_->value() / kPercent;
+  settings.min_gap = gap_spin_->value();
+  settings.seed = static_cast<uint64_t>(seed_spin_->value());
+  return settings;
+}
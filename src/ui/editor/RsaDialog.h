@@ -0,0 +1,36 @@
+#pragma once
+
+#include <QDialog>
+
+#include "analysis/RsaGenerator.h"
+
+class QCheckBox;
+class QComboBox;
+class QDoubleSpinBox;
+class QSpinBox;
+
+/**
+ * @brief Settings for filling the substrate with generated inclusions.
+ */
+class RsaDialog : public QDialog {
+  Q_OBJECT
+ public:
+  explicit RsaDialog(QWidget* parent);
+  ~RsaDialog() override = default;
+
+  auto settings() const -> RsaSettings;
+
+ private:
+  QCheckBox* circle_check_{nullptr};
+  QCheckBox* ellipse_check_{nullptr};
+  QCheckBox* rectangle_check_{nullptr};
+  QCheckBox* stick_check_{nullptr};
+  QComboBox* size_law_combo_{nullptr};
+  QDoubleSpinBox* size_first_spin_{nullptr};
+  QDoubleSpinBox* size_second_spin_{nullptr};
+  QDoubleSpinBox* aspect_min_spin_{nullptr};
+  QDoubleSpinBox* aspect_max_spin_{nullptr};
+  QDoubleSpinBox* fraction_spin_{nullptr};
+  QDoubleSpinBox* gap_spin_{nullptr};
+  QSpinBox* seed_spin_{nullptr};
+};
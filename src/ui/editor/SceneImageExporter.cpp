@@ -0,0 +1,282 @@
+#include "ui/editor/SceneImageExporter.h"
+
+#include <QColor>
+#include <QGraphicsItem>
+#include <QImage>
+#include <QPainter>
+#include <QRectF>
+#include <QSizeF>
+#include <QStyleOptionGraphicsItem>
+#include <QTransform>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <system_error>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "model/DocumentModel.h"
+#include "model/SubstrateModel.h"
+#include "scene/ISceneObject.h"
+#include "serialization/TiledTiffWriter.h"
+#include "ui/bindings/ShapeModelBinder.h"
+#include "ui/editor/SubstrateItem.h"
+#include "ui/utils/ColorUtils.h"
+#include "utils/Logging.h"
+#include "utils/ParallelFor.h"
+
+namespace {
+constexpr size_t kMinBinningChunk = 4096;
+constexpr auto kProgressInterval = std::chrono::milliseconds(50);
+// Antialiased edges reach about a pixel past an item's bounding rect
+constexpr double kEdgeMarginPx = 1.0;
+constexpr size_t kShapeTypes = 4;  // ShapeModel::ShapeType values
+
+// Tiles [first, last) along one axis
+struct TileSpan {
+  size_t first{0};
+  size_t last{0};
+};
+
+TileSpan tile_span(double min_px, double max_px, size_t limit_px,
+                   size_t tile) {
+  const double first = std::clamp(std::floor(min_px - kEdgeMarginPx), 0.0,
+                                   static_cast<double>(limit_px));
+  const double last = std::clamp(std::ceil(max_px + kEdgeMarginPx), 0.0,
+                                 static_cast<double>(limit_px));
+  if (!(first < last)) {
+    return {};
+  }
+  return {static_cast<size_t>(first) / tile,
+          (static_cast<size_t>(last) + tile - 1) / tile};
+}
+
+// Items of one thread, one per shape type, set up anew for every shape
+class ItemPool {
+ public:
+  explicit ItemPool(const SceneImageExporter::ItemFactory& factory)
+      : factory_(factory) {}
+
+  auto item_for(const std::shared_ptr<ShapeModel>& shape) -> ISceneObject* {
+    auto& item = items_[static_cast<size_t>(shape->type())];
+    if (item == nullptr) {
+      item.reset(factory_(shape));
+      if (item == nullptr) {
+        return nullptr;
+      }
+    }
+    ShapeModelBinder::apply_shape(item.get(), *shape);
+    return item.get();
+  }
+
+ private:
+  const SceneImageExporter::ItemFactory& factory_;
+  std::array<std::unique_ptr<ISceneObject>, kShapeTypes> items_;
+};
+
+void paint_item(QPainter& painter, const QTransform& tile_transform,
+                QGraphicsItem& item, QStyleOptionGraphicsItem& option) {
+  painter.save();
+  painter.setTransform(item.sceneTransform() * tile_transform);
+  option.exposedRect = item.boundingRect();
+  option.rect = option.exposedRect.toAlignedRect();
+  item.paint(&painter, &option, nullptr);
+  painter.restore();
+}
+
+// Tile pixels as packed RGB, the layout TiledTiffWriter expects
+void pack_rgb(const QImage& image, std::vector<uint8_t>& rgb) {
+  uint8_t* out = rgb.data();
+  for (int y = 0; y < image.height(); ++y) {
+    const auto* line = reinterpret_cast<const QRgb*>(image.constScanLine(y));
+    for (int x = 0; x < image.width(); ++x) {
+      *out++ = static_cast<uint8_t>(qRed(line[x]));
+      *out++ = static_cast<uint8_t>(qGreen(line[x]));
+      *out++ = static_cast<uint8_t>(qBlue(line[x]));
+    }
+  }
+}
+}  // namespace
+
+SceneImageExporter::SceneImageExporter(SceneImageSettings settings,
+                                       ItemFactory item_factory)
+    : settings_(settings), item_factory_(std::move(item_factory)) {}
+
+auto SceneImageExporter::export_tiff(const DocumentModel& document,
+                                     const std::string& filename,
+                                     const Progress& progress) const
+  -> SceneImageResult {
+  const auto started = std::chrono::steady_clock::now();
+  SceneImageResult result;
+  const auto substrate = document.substrate();
+  const Size2D substrate_size = substrate ? substrate->size() : Size2D{};
+  if (!(substrate_size.width > 0.0) || !(substrate_size.height > 0.0) ||
+      !item_factory_) {
+    return result;
+  }
+
+  // Resolve the image size, keeping the aspect ratio for a missing side
+  result.width = settings_.width_px;
+  result.height = settings_.height_px;
+  if (result.width == 0 && result.height == 0) {
+    result.width = static_cast<size_t>(std::lround(substrate_size.width));
+    result.height = static_cast<size_t>(std::lround(substrate_size.height));
+  } else if (result.width == 0) {
+    result.width = static_cast<size_t>(std::lround(
+      result.height * substrate_size.width / substrate_size.height));
+  } else if (result.height == 0) {
+    result.height = static_cast<size_t>(std::lround(
+      result.width * substrate_size.height / substrate_size.width));
+  }
+  result.width = std::max<size_t>(result.width, 1);
+  result.height = std::max<size_t>(result.height, 1);
+
+  TiledTiffWriter writer(result.width, result.height, settings_.tile_size);
+  if (!writer.open(filename)) {
+    return result;
+  }
+  const size_t tile = writer.tile_size();
+  const size_t tiles_x = writer.tiles_across();
+  const size_t tile_count = writer.tile_count();
+  const double x_scale = result.width / substrate_size.width;
+  const double y_scale = result.height / substrate_size.height;
+
+  // Bin shapes by the tiles the painted bounds of their items touch (CSR, in
+  // draw order)
+  const auto& shapes = document.shapes();
+  std::vector<TileSpan> columns(shapes.size());
+  std::vector<TileSpan> rows(shapes.size());
+  const auto bin_shapes = [&](size_t begin, size_t end, size_t /*chunk*/) {
+    ItemPool pool(item_factory_);
+    for (size_t row = begin; row < end; ++row) {
+      ISceneObject* item = pool.item_for(shapes[row]);
+      if (item == nullptr) {
+        continue;
+      }
+      const QRectF box = item->graphics_item()->sceneBoundingRect();
+      columns[row] = tile_span(box.left() * x_scale, box.right() * x_scale,
+                               result.width, tile);
+      rows[row] = tile_span(box.top() * y_scale, box.bottom() * y_scale,
+                            result.height, tile);
+    }
+  };
+  parallel_for(shapes.size(), kMinBinningChunk, bin_shapes);
+  std::vector<uint32_t> tile_offsets(tile_count + 1, 0);
+  for (size_t row = 0; row < shapes.size(); ++row) {
+    for (size_t ty = rows[row].first; ty < rows[row].last; ++ty) {
+      for (size_t tx = columns[row].first; tx < columns[row].last; ++tx) {
+        ++tile_offsets[ty * tiles_x + tx + 1];
+      }
+    }
+  }
+  for (size_t index = 1; index < tile_offsets.size(); ++index) {
+    tile_offsets[index] += tile_offsets[index - 1];
+  }
+  std::vector<uint32_t> tile_shapes(tile_offsets.back());
+  {
+    std::vector<uint32_t> cursor(tile_offsets.begin(), tile_offsets.end() - 1);
+    for (size_t row = 0; row < shapes.size(); ++row) {
+      for (size_t ty = rows[row].first; ty < rows[row].last; ++ty) {
+        for (size_t tx = columns[row].first; tx < columns[row].last; ++tx) {
+          tile_shapes[cursor[ty * tiles_x + tx]++] =
+            static_cast<uint32_t>(row);
+        }
+      }
+    }
+  }
+
+  const QColor substrate_color = to_qcolor(substrate->color());
+  std::atomic<size_t> next_tile{0};
+  std::atomic<size_t> done_tiles{0};
+  std::atomic<bool> stop{false};
+  std::atomic<bool> failed{false};
+  std::mutex mutex;
+  std::condition_variable finished;
+  const size_t thread_count = std::min(worker_thread_count(), tile_count);
+  size_t running = thread_count;  // Guarded by mutex
+
+  const auto render_tiles = [&] {
+    ItemPool pool(item_factory_);
+    SubstrateItem substrate_item(
+      QSizeF(substrate_size.width, substrate_size.height));
+    substrate_item.set_fill_color(substrate_color);
+    QImage image(static_cast<int>(tile), static_cast<int>(tile),
+                 QImage::Format_RGB32);
+    std::vector<uint8_t> rgb(writer.tile_bytes());
+    QStyleOptionGraphicsItem option;
+    for (size_t index = next_tile++; index < tile_count && !stop;
+         index = next_tile++) {
+      const size_t tx = index % tiles_x;
+      const size_t ty = index / tiles_x;
+      const QTransform tile_transform(
+        x_scale, 0.0, 0.0, y_scale, -static_cast<double>(tx * tile),
+        -static_cast<double>(ty * tile));
+      image.fill(Qt::white);
+      {
+        QPainter painter(&image);
+        painter.setRenderHint(QPainter::Antialiasing, true);
+        paint_item(painter, tile_transform, substrate_item, option);
+        for (uint32_t slot = tile_offsets[index];
+             slot < tile_offsets[index + 1]; ++slot) {
+          if (ISceneObject* item = pool.item_for(shapes[tile_shapes[slot]])) {
+            paint_item(painter, tile_transform, *item->graphics_item(),
+                       option);
+          }
+        }
+      }
+      pack_rgb(image, rgb);
+      if (!writer.write_tile(index, rgb)) {
+        failed = true;
+        stop = true;
+      }
+      ++done_tiles;
+    }
+    {
+      const std::scoped_lock lock(mutex);
+      --running;
+    }
+    finished.notify_all();
+  };
+
+  {
+    std::vector<std::jthread> workers;
+    workers.reserve(thread_count);
+    for (size_t worker = 0; worker < thread_count; ++worker) {
+      workers.emplace_back(render_tiles);
+    }
+    std::unique_lock lock(mutex);
+    while (!finished.wait_for(lock, kProgressInterval,
+                              [&running] { return running == 0; })) {
+      lock.unlock();
+      if (progress && !progress(done_tiles, tile_count)) {
+        result.cancelled = true;
+        stop = true;
+      }
+      lock.lock();
+    }
+  }
+
+  result.written = writer.close() && !failed && !result.cancelled;
+  if (!result.written) {
+    std::error_code error;
+    std::filesystem::remove(filename, error);
+    if (!result.cancelled) {
+      LOG_WARN() << "Failed to export image: " << filename;
+    }
+  } else if (progress) {
+    progress(tile_count, tile_count);
+  }
+  result.elapsed_ms = std::chrono::duration<double, std::milli>(
+                        std::chrono::steady_clock::now() - started)
+                        .count();
+  return result;
+}
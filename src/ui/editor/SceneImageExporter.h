@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <string>
+
+#include "model/ShapeModel.h"
+
+class DocumentModel;
+class ISceneObject;
+
+struct SceneImageSettings {
+  // Image size; 0 uses one pixel per scene unit, a single 0 keeps the
+  // substrate aspect ratio
+  size_t width_px{0};
+  size_t height_px{0};
+  size_t tile_size{256};  // Tile edge in pixels, the unit of parallel work
+};
+
+struct SceneImageResult {
+  bool written{false};
+  bool cancelled{false};
+  size_t width{0};
+  size_t height{0};
+  double elapsed_ms{0.0};
+
+  double megapixels_per_second() const {
+    return elapsed_ms > 0.0 ? static_cast<double>(width) *
+                                static_cast<double>(height) /
+                                (elapsed_ms * 1000.0)
+                            : 0.0;
+  }
+};
+
+/**
+ * @brief Renders the document into an image of any size, tile by tile on
+ * worker threads, and streams the tiles into a tiled TIFF.
+ *
+ * Every worker owns a substrate item and one item per shape type, built by
+ * the item factory and never added to a scene. For each shape touching a tile
+ * it gives the matching item the shape's geometry and material and calls its
+ * paint(), so the image shows what the editor shows, material grids
+ * included, at the export resolution. Shapes are binned by the painted bounds
+ * of their items and drawn in document order. Memory stays at about one tile
+ * per worker regardless of the image size.
+ */
+class SceneImageExporter {
+ public:
+  using ItemFactory =
+    std::function<ISceneObject*(const std::shared_ptr<ShapeModel>&)>;
+  /**
+   * @brief Called on the exporting thread with the finished and total tile
+   * counts while the workers run; returning false cancels the export.
+   */
+  using Progress = std::function<bool(size_t done, size_t total)>;
+
+  /**
+   * @param item_factory Creates an item for a shape; called from worker
+   * threads, so it must not touch shared state.
+   */
+  SceneImageExporter(SceneImageSettings settings, ItemFactory item_factory);
+
+  /**
+   * @brief Render @p document into @p filename. The document must not change
+   * until this returns. A cancelled or failed export removes the file.
+   */
+  auto export_tiff(const DocumentModel& document, const std::string& filename,
+                   const Progress& progress = {}) const -> SceneImageResult;
+
+ private:
+  SceneImageSettings settings_;
+  ItemFactory item_factory_;
+};
@@ -0,0 +1,125 @@
+#include "ui/editor/SceneTileCache.h"
+
+#include <QGraphicsScene>
+#include <QPainter>
+#include <QSize>
+#include <algorithm>
+#include <cmath>
+
+#include "scene/items/StaticLayer.h"
+
+namespace {
+// About 48 MB of 32-bit tiles at device pixel ratio 1
+constexpr size_t kMaxTiles = 192;
+// Antialiased edges reach slightly past an item's bounding rect
+constexpr qreal kDirtyMarginPx = 2.0;
+
+uint64_t tile_key(int column, int row) {
+  return (static_cast<uint64_t>(static_cast<uint32_t>(column)) << 32U) |
+         static_cast<uint32_t>(row);
+}
+
+int tile_column(uint64_t key) {
+  return static_cast<int32_t>(static_cast<uint32_t>(key >> 32U));
+}
+
+int tile_row(uint64_t key) {
+  return static_cast<int32_t>(static_cast<uint32_t>(key));
+}
+}  // namespace
+
+void SceneTileCache::set_transform(const QTransform& transform,
+                                   qreal device_pixel_ratio) {
+  if (transform == transform_ && device_pixel_ratio == device_pixel_ratio_) {
+    return;
+  }
+  transform_ = transform;
+  device_pixel_ratio_ = device_pixel_ratio;
+  tiles_.clear();
+}
+
+void SceneTileCache::invalidate(const QRectF& scene_rect) {
+  if (tiles_.empty()) {
+    return;
+  }
+  const QRect range = tile_range(transform_.mapRect(scene_rect).adjusted(
+    -kDirtyMarginPx, -kDirtyMarginPx, kDirtyMarginPx, kDirtyMarginPx));
+  const auto range_tiles = static_cast<size_t>(range.width()) *
+                           static_cast<size_t>(range.height());
+  if (range_tiles > tiles_.size()) {
+    std::erase_if(tiles_, [&range](const auto& entry) {
+      return range.contains(tile_column(entry.first), tile_row(entry.first));
+    });
+    return;
+  }
+  for (int row = range.top(); row <= range.bottom(); ++row) {
+    for (int column = range.left(); column <= range.right(); ++column) {
+      tiles_.erase(tile_key(column, row));
+    }
+  }
+}
+
+void SceneTileCache::clear() {
+  tiles_.clear();
+}
+
+void SceneTileCache::draw(QPainter* painter, QGraphicsScene& scene,
+                          const QRect& device_rect, const QPoint& origin,
+                          const QColor& background) {
+  const QRect range = tile_range(device_rect);
+  const auto range_tiles = static_cast<size_t>(range.width()) *
+                           static_cast<size_t>(range.height());
+  evict(range, range_tiles);
+  for (int row = range.top(); row <= range.bottom(); ++row) {
+    for (int column = range.left(); column <= range.right(); ++column) {
+      const uint64_t key = tile_key(column, row);
+      auto tile = tiles_.find(key);
+      if (tile == tiles_.end()) {
+        tile =
+          tiles_.emplace(key, render_tile(scene, column, row, background))
+            .first;
+      }
+      painter->drawPixmap(
+        origin + QPoint(column * kTileSizePx, row * kTileSizePx),
+        tile->second);
+    }
+  }
+}
+
+auto SceneTileCache::render_tile(QGraphicsScene& scene, int column, int row,
+                                 const QColor& background) const -> QPixmap {
+  QPixmap pixmap(QSize(kTileSizePx, kTileSizePx) * device_pixel_ratio_);
+  pixmap.setDevicePixelRatio(device_pixel_ratio_);
+  pixmap.fill(background);
+  QPainter painter(&pixmap);
+  painter.setRenderHint(QPainter::Antialiasing, true);
+  const QRectF device(column * kTileSizePx, row * kTileSizePx, kTileSizePx,
+                      kTileSizePx);
+  const StaticLayerRender static_layer;
+  scene.render(&painter, QRectF(0, 0, kTileSizePx, kTileSizePx),
+               transform_.inverted().mapRect(device), Qt::IgnoreAspectRatio);
+  return pixmap;
+}
+
+auto SceneTileCache::tile_range(const QRectF& device_rect) -> QRect {
+  const auto first_column =
+    static_cast<int>(std::floor(device_rect.left() / kTileSizePx));
+  const auto first_row =
+    static_cast<int>(std::floor(device_rect.top() / kTileSizePx));
+  const auto last_column =
+    static_cast<int>(std::ceil(device_rect.right() / kTileSizePx)) - 1;
+  const auto last_row =
+    static_cast<int>(std::ceil(device_rect.bottom() / kTileSizePx)) - 1;
+  return {QPoint(first_column, first_row),
+          QPoint(std::max(first_column, last_column),
+                 std::max(first_row, last_row))};
+}
+
+void SceneTileCache::evict(const QRect& keep, size_t needed) {
+  if (tiles_.size() + needed <= kMaxTiles) {
+    return;
+  }
+  std::erase_if(tiles_, [&keep](const auto& entry) {
+    return !keep.contains(tile_column(entry.first), tile_row(entry.first));
+  });
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <QColor>
+#include <QPixmap>
+#include <QPoint>
+#include <QRect>
+#include <QRectF>
+#include <QTransform>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+
+class QGraphicsScene;
+class QPainter;
+
+/**
+ * @brief Pixmap tiles of the static scene layer (see StaticLayer.h) at one
+ * view transform.
+ *
+ * Tiles are kTileSizePx squares on a grid fixed in the device space of the
+ * view transform, before scrolling, so panning only changes where existing
+ * tiles are drawn. A tile is rendered when first drawn and dropped when a
+ * dirty scene rect touches it, when the transform changes, or when it lies
+ * outside the drawn area while the cache is full.
+ */
+class SceneTileCache {
+ public:
+  static constexpr int kTileSizePx = 256;
+
+  /**
+   * @brief Transform (scaling and translation only) and device pixel ratio of
+   * the tiles; a change drops every tile.
+   */
+  void set_transform(const QTransform& transform, qreal device_pixel_ratio);
+
+  /**
+   * @brief Drop the tiles touching @p scene_rect.
+   */
+  void invalidate(const QRectF& scene_rect);
+  void clear();
+
+  /**
+   * @brief Draw the tiles covering @p device_rect (device space of the
+   * transform), rendering missing ones from @p scene.
+   * @param origin Position on @p painter of the device space origin, i.e. the
+   * negated scroll offset.
+   */
+  void draw(QPainter* painter, QGraphicsScene& scene, const QRect& device_rect,
+            const QPoint& origin, const QColor& background);
+
+ private:
+  auto render_tile(QGraphicsScene& scene, int column, int row,
+                   const QColor& background) const -> QPixmap;
+  // Tile columns and rows touching a device space rect
+  static auto tile_range(const QRectF& device_rect) -> QRect;
+  // Make room for @p needed tiles, keeping those inside @p keep
+  void evict(const QRect& keep, size_t needed);
+
+  QTransform transform_;
+  qreal device_pixel_ratio_{1.0};
+  std::unordered_map<uint64_t, QPixmap> tiles_;
+};
@@ -8,6 +8,8 @@
 #include <QPushButton>
 #include <cmath>
 
+#include "scene/items/StaticLayer.h"
+
 namespace {
 constexpr qreal kOutlineWidthPx = 1.0;
 constexpr int kSubstratePenColorR = 180;
@@ -35,7 +37,10 @@ auto SubstrateItem::boundingRect() const -> QRectF {
 
 void SubstrateItem::paint(QPainter* painter,
                           const QStyleOptionGraphicsItem* /*option*/,
-                          QWidget* /*widget*/) {
+                          QWidget* widget) {
+  if (skip_paint(*this, widget)) {
+    return;
+  }
   painter->setRenderHint(QPainter::Antialiasing, true);
   const QRectF rect = boundingRect().adjusted(
     kOutlineWidthPx, kOutlineWidthPx, -kOutlineWidthPx, -kOutlineWidthPx);
@@ -9,6 +9,12 @@ class SubstrateItem : public QGraphicsItem, public ISceneObject {
  public:
   explicit SubstrateItem(const QSizeF& size);
 
+  // Used by qgraphicsitem_cast
+  static constexpr int Type = ISceneObject::item_type(Kind::Substrate);
+  int type() const override {
+    return Type;
+  }
+
   auto boundingRect() const -> QRectF override;
   void paint(QPainter* painter, const QStyleOptionGraphicsItem* option,
              QWidget* widget) override;
@@ -24,6 +30,15 @@ class SubstrateItem : public QGraphicsItem, public ISceneObject {
   void set_fill_color(const QColor& color);
 
   // ISceneObject interface
+  Kind kind() const override {
+    return Kind::Substrate;
+  }
+  QGraphicsItem* graphics_item() override {
+    return this;
+  }
+  const QGraphicsItem* graphics_item() const override {
+    return this;
+  }
   auto create_properties_widget(QWidget* parent) -> QWidget* override;
   QJsonObject to_json() const override;
   void from_json(const QJsonObject& json) override;
@@ -11,7 +11,10 @@
 #include <QVBoxLayout>
 #include <algorithm>
 #include <memory>
+#include <utility>
+#include <vector>
 
+#include "commands/BulkShapeCommands.h"
 #include "commands/CommandManager.h"
 #include "commands/MaterialCommands.h"
 #include "commands/ShapeCommands.h"
@@ -270,14 +273,10 @@ void ObjectsBar::remove_selected_item() {
         command_manager_->execute(std::move(cmd));
       } else if (shape_binder_ != nullptr) {
         // Fallback to old method
-        if (auto* item = shape_binder_->item_for(shape)) {
-          // Convert to ISceneObject and unbind
-          // unbind_shape will safely handle invalid items (including those not
-          // in scene)
-          auto* scene_obj = dynamic_cast<ISceneObject*>(item);
-          if (scene_obj != nullptr) {
-            shape_binder_->unbind_shape(scene_obj);
-          }
+        // unbind_shape will safely handle invalid items (including those not
+        // in scene)
+        if (auto* scene_obj = shape_binder_->object_for(shape)) {
+          shape_binder_->unbind_shape(scene_obj);
         }
         const QModelIndex parent = current.parent();
         if (parent.isValid()) {
@@ -375,6 +374,12 @@ auto ObjectsBar::eventFilter(QObject* obj, QEvent* event)
               [](const QModelIndex& index_a, const QModelIndex& index_b) {
                 return index_a.row() > index_b.row();
               });
+            auto* tree_model = qobject_cast<ObjectTreeModel*>(model);
+            const bool use_command =
+              tree_model != nullptr && command_manager_ != nullptr &&
+              document_model_ != nullptr && shape_binder_ != nullptr &&
+              editor_area_ != nullptr;
+            std::vector<std::shared_ptr<ShapeModel>> shapes;
             bool any_removed = false;
             for (const QModelIndex& idx : rows) {
               if (!idx.isValid()) {
@@ -385,8 +390,21 @@ auto ObjectsBar::eventFilter(QObject* obj, QEvent* event)
               if (!idx.parent().isValid()) {
                 continue;
               }
+              // Shapes are deleted together below, as one command
+              if (use_command) {
+                if (auto shape = tree_model->shape_from_index(idx)) {
+                  shapes.push_back(std::move(shape));
+                  continue;
+                }
+              }
               any_removed |= model->removeRow(idx.row(), idx.parent());
             }
+            if (!shapes.empty()) {
+              any_removed |= command_manager_->execute(
+                std::make_unique<DeleteShapesCommand>(
+                  document_model_, shape_binder_, editor_area_,
+                  std::move(shapes)));
+            }
             if (any_removed) {
               return true;  // handled
             }
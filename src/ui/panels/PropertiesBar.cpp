@@ -1,5 +1,6 @@
 #include "PropertiesBar.h"
 
+#include <QAbstractSpinBox>
 #include <QColorDialog>
 #include <QComboBox>
 #include <QDoubleSpinBox>
@@ -217,6 +218,11 @@ void PropertiesBar::set_selected_item(ISceneObject* item, const QString& name) {
   if (content_widget_ != nullptr) {
     layout_->insertWidget(insert_index, content_widget_);
     insert_index++;  // Material controls will go after content_widget
+    // Spin box edits are coalesced into one undo step until they finish
+    for (auto* spin : content_widget_->findChildren<QAbstractSpinBox*>()) {
+      connect(spin, &QAbstractSpinBox::editingFinished, this,
+              &PropertiesBar::edit_finished);
+    }
     // Disable color editing in content widget if material preset is selected
     if (item_material_ != nullptr && content_widget_ != nullptr) {
       // Find and disable color button in content widget
@@ -481,12 +487,13 @@ void PropertiesBar::setup_material_selector() {
       auto* material = material_combo_->itemData(index).value<MaterialModel*>();
       item_material_ = material;
 
-      // Apply to current shape model
+      // Applied to the current shape (and the rest of the selection) by the
+      // receiver, as one undoable command
+      emit item_material_changed(current_item_, material);
       if (current_model_ != nullptr) {
         if (material != nullptr) {
           auto shared = find_material(material);
           if (shared) {
-            current_model_->assign_material(shared);
             current_material_shared_ = shared;
             // Show grid controls for preset material, but make them read-only
             if (grid_type_label_->parent() == this &&
@@ -498,7 +505,6 @@ void PropertiesBar::setup_material_selector() {
             }
           }
         } else {
-          current_model_->clear_material();
           current_material_shared_ = current_model_->material();
           // Show grid controls for custom material, make them editable
           if (grid_type_combo_->parent() == this &&
@@ -520,7 +526,6 @@ void PropertiesBar::setup_material_selector() {
       update_material_color_button();
       updating_ = false;
 
-      emit item_material_changed(current_item_, material);
       material_color_btn_->setEnabled(can_edit_material_color());
     });
 
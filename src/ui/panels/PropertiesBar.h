@@ -36,6 +36,8 @@ class PropertiesBar : public QWidget {
   void material_name_changed(MaterialModel* material, const QString& new_name);
   void material_color_changed(MaterialModel* material, const QColor& color);
   void item_material_changed(ISceneObject* item, MaterialModel* material);
+  // A spin box of the selected item lost focus or took Enter
+  void edit_finished();
 
  private:
   void setup_type_selector();
@@ -0,0 +1,55 @@
+#include "utils/Crc32.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace {
+constexpr uint32_t kPolynomial = 0xEDB88320U;
+constexpr size_t kSlices = 8;
+
+using CrcTables = std::array<std::array<uint32_t, 256>, kSlices>;
+
+// Slicing-by-8 tables: tables[k][b] is the CRC of byte b followed by k zeros
+constexpr auto make_tables() -> CrcTables {
+  CrcTables tables{};
+  for (uint32_t byte = 0; byte < 256; ++byte) {
+    uint32_t crc = byte;
+    for (int bit = 0; bit < 8; ++bit) {
+      crc = (crc & 1U) != 0 ? (crc >> 1) ^ kPolynomial : crc >> 1;
+    }
+    tables[0][byte] = crc;
+  }
+  for (size_t slice = 1; slice < kSlices; ++slice) {
+    for (uint32_t byte = 0; byte < 256; ++byte) {
+      const uint32_t previous = tables[slice - 1][byte];
+      tables[slice][byte] = (previous >> 8) ^ tables[0][previous & 0xFFU];
+    }
+  }
+  return tables;
+}
+
+constexpr CrcTables kTables = make_tables();
+}  // namespace
+
+auto crc32(const void* data, size_t size, uint32_t crc) -> uint32_t {
+  const auto* bytes = static_cast<const unsigned char*>(data);
+  crc = ~crc;
+  // Eight bytes per step; the loads are little-endian by construction
+  while (size >= kSlices) {
+    const uint32_t low = crc ^ (static_cast<uint32_t>(bytes[0]) |
+                                static_cast<uint32_t>(bytes[1]) << 8 |
+                                static_cast<uint32_t>(bytes[2]) << 16 |
+                                static_cast<uint32_t>(bytes[3]) << 24);
+    crc = kTables[7][low & 0xFFU] ^ kTables[6][(low >> 8) & 0xFFU] ^
+          kTables[5][(low >> 16) & 0xFFU] ^ kTables[4][low >> 24] ^
+          kTables[3][bytes[4]] ^ kTables[2][bytes[5]] ^ kTables[1][bytes[6]] ^
+          kTables[0][bytes[7]];
+    bytes += kSlices;
+    size -= kSlices;
+  }
+  while (size-- > 0) {
+    crc = (crc >> 8) ^ kTables[0][(crc ^ *bytes++) & 0xFFU];
+  }
+  return ~crc;
+}
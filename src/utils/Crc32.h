@@ -0,0 +1,11 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief CRC-32 (IEEE 802.3, the zlib/PNG polynomial) of a byte range.
+ *
+ * Pass the previous result as crc to continue over several ranges.
+ */
+auto crc32(const void* data, size_t size, uint32_t crc = 0) -> uint32_t;
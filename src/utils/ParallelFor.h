@@ -0,0 +1,52 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Number of worker threads to use for data-parallel passes.
+ */
+inline auto worker_thread_count() -> size_t {
+  const unsigned int hardware = std::thread::hardware_concurrency();
+  return hardware == 0 ? 1 : static_cast<size_t>(hardware);
+}
+
+/**
+ * @brief Split [0, count) into contiguous chunks and process them on worker
+ * threads.
+ *
+ * @param count Number of items.
+ * @param min_chunk Smallest chunk worth a thread; small inputs run inline.
+ * @param body Callable as body(begin, end, chunk_index).
+ * @return Number of chunks used (chunk_index is in [0, chunks)).
+ *
+ * @note Chunks are processed concurrently; body must only write state owned by
+ * its chunk. Exceptions must not escape body.
+ */
+template <typename Body>
+auto parallel_for(size_t count, size_t min_chunk, Body&& body) -> size_t {
+  if (count == 0) {
+    return 0;
+  }
+  min_chunk = std::max<size_t>(min_chunk, 1);
+  const size_t chunks =
+    std::clamp<size_t>(count / min_chunk, 1, worker_thread_count());
+  if (chunks == 1) {
+    body(size_t{0}, count, size_t{0});
+    return 1;
+  }
+
+  const size_t chunk_size = (count + chunks - 1) / chunks;
+  std::vector<std::jthread> workers;
+  workers.reserve(chunks - 1);
+  for (size_t chunk = 1; chunk < chunks; ++chunk) {
+    const size_t begin = std::min(chunk * chunk_size, count);
+    const size_t end = std::min(begin + chunk_size, count);
+    workers.emplace_back([&body, begin, end, chunk] { body(begin, end, chunk); });
+  }
+  // The calling thread takes the first chunk
+  body(size_t{0}, std::min(chunk_size, count), size_t{0});
+  return chunks;
+}